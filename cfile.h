@@ -92,6 +92,9 @@ typedef struct _capture_file {
   dfilter_t   *dfcode;          /* Compiled display filter program */
   gchar       *dfilter;         /* Display filter string */
   gboolean     redissecting;    /* TRUE if currently redissecting (cf_redissect_packets) */
+  gboolean     dfilter_stale;   /* TRUE if frames' passed_dfilter may not reflect dfilter */
+  gboolean     dependents_stale; /* TRUE if frames' dependent_of_displayed may miss some frames */
+  GList       *dfilter_results; /* Results of recently applied display filters */
   /* search */
   gchar       *sfilter;         /* Filter, hex value, or string being searched */
   gboolean     hex;             /* TRUE if "Hex value" search was last selected */
@@ -58,6 +58,12 @@ static GSList *color_filter_list = NULL;
 static GSList *color_filter_deleted_list = NULL;
 static GSList *color_filter_valid_list   = NULL;
 
+/* the enabled filters of color_filter_list merged into one, so that a
+ * packet is matched against all of them in a single pass; built when
+ * it is first needed and dropped whenever color_filter_list changes */
+static dfilter_group_t *color_filter_group = NULL;
+static color_filter_t **color_filter_group_members = NULL;
+
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
@@ -66,6 +72,39 @@ static gboolean filters_enabled = TRUE;
  */
 static gboolean tmp_colors_set = FALSE;
 
+/* Drop the merged filters; must be called before any filter in
+ * color_filter_list is freed or changed */
+static void
+color_filters_group_invalidate(void)
+{
+    dfilter_group_free(color_filter_group);
+    color_filter_group = NULL;
+    g_free(color_filter_group_members);
+    color_filter_group_members = NULL;
+}
+
+static void
+color_filters_group_build(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+    dfilter_t     **dfilters;
+    guint           count, i;
+
+    count = g_slist_length(color_filter_list);
+    dfilters = g_new(dfilter_t *, count);
+    color_filter_group_members = g_new(color_filter_t *, count);
+
+    for (curr = color_filter_list, i = 0; curr != NULL; curr = g_slist_next(curr), i++) {
+        colorf = (color_filter_t *)curr->data;
+        color_filter_group_members[i] = colorf;
+        dfilters[i] = colorf->disabled ? NULL : colorf->c_colorfilter;
+    }
+
+    color_filter_group = dfilter_group_new(dfilters, count);
+    g_free(dfilters);
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const gchar *name,          /* The name of the filter to create */
@@ -152,6 +191,8 @@ color_filters_set_tmp(guint8 filt_nr, gchar *filter, gboolean disabled)
     dfilter_t      *compiled_filter;
     guint8         i;
 
+    color_filters_group_invalidate();
+
     /* Go through the tomporary filters and look for the same filter string.
      * If found, clear it so that a filter can be "moved" up and down the list
      */
@@ -285,6 +326,8 @@ color_filter_list_clone(GSList *cfl)
 void
 color_filters_init(void)
 {
+    color_filters_group_invalidate();
+
     /* delete all currently existing filters */
     color_filter_list_delete(&color_filter_list);
 
@@ -300,6 +343,8 @@ color_filters_init(void)
 void
 color_filters_reload(void)
 {
+    color_filters_group_invalidate();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -371,6 +416,8 @@ color_filter_validate_cb(gpointer filter_arg, gpointer unused _U_)
 void
 color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl)
 {
+    color_filters_group_invalidate();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -435,22 +482,16 @@ color_filters_prime_edt(epan_dissect_t *edt)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    int match;
 
     /* If we have color filters, "search" for the matching one. */
     if (color_filters_used()) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
-        }
+        if (color_filter_group == NULL)
+            color_filters_group_build();
+
+        match = dfilter_group_first_match_edt(color_filter_group, edt);
+        if (match >= 0)
+            return color_filter_group_members[match];
     }
 
     return NULL;
@@ -31,6 +31,8 @@
 #include <glib.h>
 
 #include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
 #include <epan/dfilter/dfilter.h>
@@ -42,6 +44,8 @@
 #include <wsutil/privileges.h>
 #include <wsutil/report_err.h>
 
+#include <wiretap/wtap.h>
+
 #include "ui/util.h"
 #include "register.h"
 
@@ -50,6 +54,23 @@ static void open_failure_message(const char *filename, int err,
 	gboolean for_writing);
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
+static void run_benchmark(dfilter_t *df, long iterations);
+
+/* Ethernet/IPv4/TCP frame carrying an HTTP request, for "-b" */
+static const guint8 bench_packet[] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0x08, 0x00, 0x45, 0x00,
+	0x00, 0x51, 0x12, 0x34, 0x40, 0x00, 0x40, 0x06,
+	0x00, 0x00, 0xc0, 0xa8, 0x00, 0x01, 0x0a, 0x00,
+	0x00, 0x01, 0xc3, 0x50, 0x00, 0x50, 0x00, 0x00,
+	0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x50, 0x18,
+	0x20, 0x00, 0x00, 0x00, 0x00, 0x00,
+	'G', 'E', 'T', ' ', '/', ' ', 'H', 'T', 'T', 'P',
+	'/', '1', '.', '1', '\r', '\n',
+	'H', 'o', 's', 't', ':', ' ', 'w', 'w', 'w', '.',
+	'e', 'x', 'a', 'm', 'p', 'l', 'e', '.', 'c', 'o',
+	'm', '\r', '\n', '\r', '\n'
+};
 
 int
 main(int argc, char **argv)
@@ -60,6 +81,9 @@ main(int argc, char **argv)
 	int		gpf_open_errno, gpf_read_errno;
 	int		pf_open_errno, pf_read_errno;
 	dfilter_t	*df;
+	dfilter_t	*df_unoptimized;
+	int		first_arg = 1;
+	long		iterations = 0;
 
 	/*
 	 * Get credential information for later use.
@@ -132,19 +156,26 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	/* Check for benchmark request */
+	if (argc > 2 && strcmp(argv[1], "-b") == 0) {
+		iterations = strtol(argv[2], NULL, 10);
+		first_arg = 3;
+	}
+
 	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	if (argc <= first_arg || iterations < 0) {
+		fprintf(stderr, "Usage: dftest [-b <iterations>] <filter>\n");
 		exit(1);
 	}
 
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, first_arg);
 
 	printf("Filter: \"%s\"\n", text);
 
-	/* Compile it */
-	if (!dfilter_compile(text, &df)) {
+	/* Compile it, once as written and once optimized */
+	if (!dfilter_compile_unoptimized(text, &df_unoptimized) ||
+	    !dfilter_compile(text, &df)) {
 		fprintf(stderr, "dftest: %s\n", dfilter_error_msg);
 		epan_cleanup();
 		exit(2);
@@ -152,16 +183,91 @@ main(int argc, char **argv)
 
 	printf("\n");
 
-	if (df == NULL)
+	if (df == NULL) {
 		printf("Filter is empty\n");
-	else
+	}
+	else {
+		printf("Unoptimized:\n");
+		dfilter_dump(df_unoptimized);
+		printf("\nOptimized:\n");
 		dfilter_dump(df);
 
+		if (iterations > 0)
+			run_benchmark(df, iterations);
+	}
+
+	dfilter_free(df_unoptimized);
 	dfilter_free(df);
 	epan_cleanup();
 	exit(0);
 }
 
+/*
+ * Dissect bench_packet once and time applying the filter to it, first
+ * with the bytecode interpreter and then with the compiled filter.
+ */
+static void
+run_benchmark(dfilter_t *df, long iterations)
+{
+	epan_t		*session;
+	epan_dissect_t	*edt;
+	frame_data	fdata;
+	const frame_data *ref = NULL;
+	nstime_t	elapsed_time;
+	struct wtap_pkthdr phdr;
+	GTimer		*timer;
+	gdouble		interpreted, compiled;
+	gboolean	passed_interpreted, passed_compiled;
+	long		i;
+
+	memset(&phdr, 0, sizeof(phdr));
+	phdr.pkt_encap = WTAP_ENCAP_ETHERNET;
+	phdr.caplen = sizeof(bench_packet);
+	phdr.len = sizeof(bench_packet);
+	nstime_set_zero(&elapsed_time);
+
+	session = epan_new();
+	edt = epan_dissect_new(session, TRUE, FALSE);
+	epan_dissect_prime_dfilter(edt, df);
+
+	frame_data_init(&fdata, 1, &phdr, 0, 0);
+	frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, NULL);
+	epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &phdr,
+		tvb_new_real_data(bench_packet, sizeof(bench_packet),
+			sizeof(bench_packet)),
+		&fdata, NULL);
+
+	timer = g_timer_new();
+
+	passed_interpreted = dfilter_apply_edt_interpreted(df, edt);
+	g_timer_start(timer);
+	for (i = 0; i < iterations; i++)
+		dfilter_apply_edt_interpreted(df, edt);
+	interpreted = g_timer_elapsed(timer, NULL);
+
+	passed_compiled = dfilter_apply_edt(df, edt);
+	g_timer_start(timer);
+	for (i = 0; i < iterations; i++)
+		dfilter_apply_edt(df, edt);
+	compiled = g_timer_elapsed(timer, NULL);
+
+	g_timer_destroy(timer);
+
+	printf("\nBenchmark: %ld runs against a TCP/HTTP packet (%s)\n",
+		iterations, passed_compiled ? "matches" : "does not match");
+	if (passed_interpreted != passed_compiled)
+		printf("WARNING: the interpreter says the packet %s\n",
+			passed_interpreted ? "matches" : "does not match");
+	printf("Interpreted: %.3f s, %.1f ns/run\n", interpreted,
+		interpreted * 1e9 / iterations);
+	printf("Compiled:    %.3f s, %.1f ns/run\n", compiled,
+		compiled * 1e9 / iterations);
+
+	epan_dissect_free(edt);
+	frame_data_destroy(&fdata);
+	epan_free(session);
+}
+
 /*
  * General errors are reported with an console message in "dftest".
  */
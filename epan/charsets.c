@@ -22,6 +22,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/proto.h>
@@ -29,6 +31,7 @@
 
 #include <wsutil/pint.h>
 #include <wsutil/unicode-utils.h>
+#include <wsutil/ws_strscan.h>
 
 #include "charsets.h"
 
@@ -62,6 +65,21 @@
  *    http://www-03.ibm.com/systems/i/software/globalization/codepages.html
  */
 
+/*
+ * Copy a string that's already valid UTF-8 (which includes plain ASCII)
+ * and null-terminate it.
+ */
+static guint8 *
+copy_valid_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
+{
+    guint8 *strbuf;
+
+    strbuf = (guint8 *)wmem_alloc(scope, length + 1);
+    memcpy(strbuf, ptr, length);
+    strbuf[length] = '\0';
+    return strbuf;
+}
+
 /*
  * Given a wmem scope, a pointer, and a length, treat the string of bytes
  * referred to by the pointer and length as an ASCII string, with all bytes
@@ -75,18 +93,25 @@ guint8 *
 get_ascii_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
     wmem_strbuf_t *str;
+    size_t         span;
 
-    str = wmem_strbuf_sized_new(scope, length+1, 0);
+    span = ws_ascii_span(ptr, length);
+    if (span == (size_t)length)
+        return copy_valid_string(scope, ptr, length);
 
-    while (length > 0) {
-        guint8 ch = *ptr;
+    str = wmem_strbuf_sized_new(scope, length+1, 0);
 
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else
-            wmem_strbuf_append_unichar(str, UNREPL);
+    for (;;) {
+        /* Copy the run of ASCII, then replace the octet that ended it */
+        wmem_strbuf_append_len(str, (const gchar *)ptr, span);
+        ptr += span;
+        length -= (gint)span;
+        if (length == 0)
+            break;
+        wmem_strbuf_append_unichar(str, UNREPL);
         ptr++;
         length--;
+        span = ws_ascii_span(ptr, length);
     }
 
     return (guint8 *) wmem_strbuf_finalize(str);
@@ -101,25 +126,67 @@ guint8 *
 get_8859_1_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
     wmem_strbuf_t *str;
+    size_t         span;
+
+    span = ws_ascii_span(ptr, length);
+    if (span == (size_t)length)
+        return copy_valid_string(scope, ptr, length);
 
     str = wmem_strbuf_sized_new(scope, length+1, 0);
 
-    while (length > 0) {
-        guint8 ch = *ptr;
+    for (;;) {
+        wmem_strbuf_append_len(str, (const gchar *)ptr, span);
+        ptr += span;
+        length -= (gint)span;
+        if (length == 0)
+            break;
+        /*
+         * Note: we assume here that the code points
+         * 0x80-0x9F are used for C1 control characters,
+         * and thus have the same value as the corresponding
+         * Unicode code points.
+         */
+        wmem_strbuf_append_unichar(str, *ptr);
+        ptr++;
+        length--;
+        span = ws_ascii_span(ptr, length);
+    }
 
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else {
-            /*
-             * Note: we assume here that the code points
-             * 0x80-0x9F are used for C1 control characters,
-             * and thus have the same value as the corresponding
-             * Unicode code points.
-             */
-            wmem_strbuf_append_unichar(str, ch);
-        }
+    return (guint8 *) wmem_strbuf_finalize(str);
+}
+
+/*
+ * Given a wmem scope, a pointer, and a length, treat the string of bytes
+ * referred to by the pointer and length as a UTF-8 string, and return a
+ * pointer to a copy of it, allocated using the wmem scope.
+ *
+ * Invalid sequences are replaced, one octet at a time, by the Unicode
+ * REPLACEMENT CHARACTER, so the result is always valid UTF-8.
+ *
+ * XXX - embedded nulls are copied as is.
+ */
+guint8 *
+get_utf_8_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
+{
+    wmem_strbuf_t *str;
+    size_t         span;
+
+    span = ws_utf8_valid_span(ptr, length);
+    if (span == (size_t)length)
+        return copy_valid_string(scope, ptr, length);
+
+    str = wmem_strbuf_sized_new(scope, length+1, 0);
+
+    for (;;) {
+        wmem_strbuf_append_len(str, (const gchar *)ptr, span);
+        ptr += span;
+        length -= (gint)span;
+        if (length == 0)
+            break;
+        wmem_strbuf_append_unichar(str, UNREPL);
         ptr++;
         length--;
+        span = ws_utf8_valid_span(ptr, length);
     }
 
     return (guint8 *) wmem_strbuf_finalize(str);
@@ -502,6 +569,29 @@ get_unichar2_string(wmem_allocator_t *scope, const guint8 *ptr, gint length, con
     return (guint8 *) wmem_strbuf_finalize(str);
 }
 
+/*
+ * Append the leading run of ASCII characters in a little-endian UTF-16 or
+ * UCS-2 string to a strbuf, and return the number of octets consumed.
+ * Most such strings (SMB, DCE RPC, ...) are all ASCII, so this usually
+ * handles the whole string.
+ */
+static size_t
+append_utf_16le_ascii(wmem_strbuf_t *strbuf, const guint8 *ptr, gint length)
+{
+    guint8 buf[256];
+    size_t consumed = 0, chunk, narrowed;
+
+    while ((gint)consumed + 1 < length) {
+        chunk = MIN((size_t)length - consumed, 2 * sizeof buf);
+        narrowed = ws_utf16le_ascii_narrow(buf, ptr + consumed, chunk);
+        wmem_strbuf_append_len(strbuf, (const gchar *)buf, narrowed / 2);
+        consumed += narrowed;
+        if (narrowed < (chunk & ~(size_t)1))
+            break;
+    }
+    return consumed;
+}
+
 /*
  * Given a wmem scope, a pointer, and a length, treat the string of bytes
  * referred to by the pointer and length as a UCS-2 encoded string
@@ -527,7 +617,11 @@ get_ucs_2_string(wmem_allocator_t *scope, const guint8 *ptr, gint length, const
 
     strbuf = wmem_strbuf_sized_new(scope, length+1, 0);
 
-    for(i = 0; i + 1 < length; i += 2) {
+    i = 0;
+    if (encoding == ENC_LITTLE_ENDIAN)
+        i = (gint)append_utf_16le_ascii(strbuf, ptr, length);
+
+    for(; i + 1 < length; i += 2) {
         if (encoding == ENC_BIG_ENDIAN){
             uchar = pntoh16(ptr + i);
         }else{
@@ -567,7 +661,11 @@ get_utf_16_string(wmem_allocator_t *scope, const guint8 *ptr, gint length, const
 
     strbuf = wmem_strbuf_sized_new(scope, length+1, 0);
 
-    for(i = 0; i + 1 < length; i += 2) {
+    i = 0;
+    if (encoding == ENC_LITTLE_ENDIAN)
+        i = (gint)append_utf_16le_ascii(strbuf, ptr, length);
+
+    for(; i + 1 < length; i += 2) {
         if (encoding == ENC_BIG_ENDIAN)
             uchar2 = pntoh16(ptr + i);
         else
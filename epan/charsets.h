@@ -74,6 +74,9 @@ get_ascii_string(wmem_allocator_t *scope, const guint8 *ptr, gint length);
 WS_DLL_PUBLIC guint8 *
 get_8859_1_string(wmem_allocator_t *scope, const guint8 *ptr, gint length);
 
+WS_DLL_PUBLIC guint8 *
+get_utf_8_string(wmem_allocator_t *scope, const guint8 *ptr, gint length);
+
 WS_DLL_PUBLIC guint8 *
 get_unichar2_string(wmem_allocator_t *scope, const guint8 *ptr, gint length, const gunichar2 table[0x80]);
 
@@ -26,9 +26,16 @@
 
 #include <string.h>
 #include <glib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CONV_USE_SSE2
+#endif
+
 #include "packet.h"
 #include "emem.h"
 #include "conversation.h"
+#include "wmem/wmem.h"
 
 /* define DEBUG_CONVERSATION for pretty debug printing */
 /* #define DEBUG_CONVERSATION */
@@ -39,25 +46,82 @@ int _debug_conversation_indent = 0;
 #endif
 
 /*
- * Hash table for conversations with no wildcards.
- */
-static GHashTable *conversation_hashtable_exact = NULL;
-
-/*
- * Hash table for conversations with one wildcard address.
- */
-static GHashTable *conversation_hashtable_no_addr2 = NULL;
-
-/*
- * Hash table for conversations with one wildcard port.
+ * The conversations are kept in four open-addressing tables, one for each
+ * combination of the NO_ADDR2 and NO_PORT2 wildcards.  Each table entry
+ * has a flat key, holding the addresses inline rather than behind
+ * pointers, and the list of conversations created with that key,
+ * ordered by setup frame, so that finding the conversation that was
+ * current at a given frame is a binary search rather than a walk down
+ * a hash chain.
+ *
+ * The slots are probed in groups of CONV_GROUP_SIZE; every slot has a
+ * control byte that is either CONV_CTRL_EMPTY, CONV_CTRL_DELETED or 0x80
+ * plus the top seven bits of the hash of its key, so that one group can be matched against
+ * the hash being looked up with a couple of SSE2 instructions, and the
+ * keys themselves are only compared for the (rare) slots whose tag
+ * matches.
+ *
+ * When the last conversation of a key moves to another table (see
+ * conversation_set_port2() and conversation_set_addr2()) or is expired
+ * (see conversation_expire()), its slot is marked CONV_CTRL_DELETED
+ * rather than CONV_CTRL_EMPTY, so that a lookup can still stop at the
+ * first group that has an empty slot.  Deleted slots are reused for new
+ * keys and dropped when the table is rehashed.
  */
-static GHashTable *conversation_hashtable_no_port2 = NULL;
+#define CONV_GROUP_SIZE		16
+#define CONV_TABLE_MIN_SIZE	64
+#define CONV_CTRL_EMPTY		0x00
+#define CONV_CTRL_DELETED	0x01
+#define CONV_CTRL_TAG(hash)	((guint8)(0x80 | ((hash) >> 25)))
 
 /*
- * Hash table for conversations with one wildcard address and port.
+ * Address data up to this many bytes (which covers IPv4, IPv6, Ethernet,
+ * EUI-64 and Fibre Channel addresses) are stored in the key itself;
+ * longer addresses are copied with conversation_memdup().
  */
-static GHashTable *conversation_hashtable_no_addr2_or_port2 = NULL;
-
+#define CONV_ADDR_INLINE_LEN	16
+
+typedef struct conv_flat_addr {
+	guint32	type;
+	guint32	len;
+	union {
+		guint8	bytes[CONV_ADDR_INLINE_LEN];
+		const guint8 *ptr;
+	} data;
+} conv_flat_addr;
+
+typedef struct conv_flat_key {
+	conv_flat_addr addr1;
+	conv_flat_addr addr2;
+	guint32	port1;
+	guint32	port2;
+	guint32	ptype;
+} conv_flat_key;
+
+typedef struct conv_slot {
+	conv_flat_key key;
+	guint32	hash;
+	guint32	nconvs;		/* number of conversations with this key */
+	guint32	alloc;		/* allocated size of convs */
+	guint32	latest_found;	/* index of the conversation found by the last lookup */
+	conversation_t **convs;	/* conversations with this key, ordered by setup_frame */
+} conv_slot;
+
+typedef struct conv_table {
+	guint	wildcards;	/* NO_ADDR2 and/or NO_PORT2, not part of the key */
+	guint32	mask;		/* number of slots - 1 */
+	guint32	keys;		/* number of slots in use */
+	guint32	used;		/* number of slots in use or deleted */
+	guint32	conversations;	/* number of conversations in the table */
+	guint8	*ctrl;		/* control bytes, one per slot */
+	conv_slot *slots;
+} conv_table;
+
+#define CONV_TABLE_EXACT		0
+#define CONV_TABLE_NO_ADDR2		1
+#define CONV_TABLE_NO_PORT2		2
+#define CONV_TABLE_NO_ADDR2_OR_PORT2	3
+#define CONV_NUM_TABLES			4
 
 #ifdef __NOT_USED__
 typedef struct conversation_key {
@@ -69,14 +133,6 @@ typedef struct conversation_key {
 	guint32	port2;
 } conversation_key;
 #endif
-/*
- * Linked list of conversation keys, so we can, before freeing them all,
- * free the address data allocations associated with them.
- */
-static conversation_key *conversation_keys;
-
-static guint32 new_index;
-
 /*
  * Protocol-specific data attached to a conversation_t structure - protocol
  * index and opaque pointer.
@@ -86,6 +142,129 @@ typedef struct _conv_proto_data {
 	void	*proto_data;
 } conv_proto_data;
 
+/*
+ * The conversations of one epan session.
+ */
+struct conversation_state {
+	conv_table tables[CONV_NUM_TABLES];
+
+	/*
+	 * Linked list of conversation keys, so we can, before freeing
+	 * them all, free the address data allocations associated with them.
+	 */
+	conversation_key *keys;
+
+	guint32 new_index;
+
+	/*
+	 * Idle and age timeouts, in seconds, set with
+	 * conversation_set_timeouts().  While either one is set,
+	 * conversations, their keys and their conv_proto_data are allocated
+	 * with GLib rather than from the state's scope, so that
+	 * conversation_expire() can free them.
+	 */
+	guint idle_timeout;
+	guint age_timeout;
+	gboolean timeouts_enabled;
+
+	/*
+	 * Expired conversations, oldest first.  They are no longer found,
+	 * but are only freed once they have been expired for as long as the
+	 * timeout, so that a pointer to one that a dissector still keeps
+	 * (e.g. as a hash key) doesn't point to freed or reused memory.
+	 */
+	GQueue retired;
+
+	/*
+	 * While timeouts are set, the conversations ordered by when they
+	 * are due to be checked for the idle and the age timeout, so that
+	 * conversation_expire() only looks at the heads; see conv_timed.
+	 */
+	GQueue idle;
+	GQueue age;
+
+	guint64 expired;	/* conversations expired so far */
+
+	/*
+	 * Unless timeouts are set, the conversations, their keys and their
+	 * protocol data entries are allocated from here, and all freed
+	 * together when the file is closed.
+	 */
+	wmem_allocator_t *scope;
+
+	/* Capture time of the current packet, see conversation_set_current_time() */
+	time_t now;
+};
+
+/*
+ * The state the conversation routines work on, set with
+ * conversation_set_state(); while none is set they use the default
+ * state.  Like the rest of the dissection state this is process-wide,
+ * so only one session can be dissecting at a time.
+ */
+static conversation_state_t *conversation_current_state;
+
+static conversation_state_t conversation_default_state;
+
+static inline conversation_state_t *
+conv_state(void)
+{
+	conversation_state_t *cs = conversation_current_state;
+
+	return cs ? cs : &conversation_default_state;
+}
+
+/*
+ * A conversation allocated while timeouts are set, with its places in
+ * the idle and age queues of its state.  The due times are when
+ * conversation_expire() has to look at it next: a lookup moves it to the
+ * end of the idle queue, and a conversation that is due but can't be
+ * expired yet goes to the end again to be checked a timeout later.
+ * Capture time mostly grows, so appending keeps the queues ordered by due
+ * time; a packet out of order can only make a conversation expire late.
+ */
+typedef struct _conv_timed {
+	conversation_t conv;	/* must be first */
+	GList	idle_link;	/* data is NULL while not queued */
+	GList	age_link;
+	time_t	idle_due;
+	time_t	age_due;
+} conv_timed;
+
+#define CONV_TIMED(conv)	((conv_timed *)(conv))
+
+typedef struct _conv_expire_callback {
+	int	proto;
+	conversation_expire_func func;
+} conv_expire_callback;
+
+/* Callbacks registered with conversation_register_expire_callback() */
+static GArray *conversation_expire_callbacks;
+
+static gpointer
+conversation_memdup(gconstpointer data, const guint len)
+{
+	gpointer copy;
+
+	if (conv_state()->timeouts_enabled)
+		copy = g_malloc(len);
+	else
+		copy = wmem_alloc(conv_state()->scope, len);
+	memcpy(copy, data, len);
+	return copy;
+}
+
+static void
+conversation_copy_address(address *to, const address *from)
+{
+	if (conv_state()->timeouts_enabled) {
+		COPY_ADDRESS(to, from);
+	} else {
+		COPY_ADDRESS_SHALLOW(to, from);
+		to->data = conversation_memdup(from->data, from->len);
+	}
+}
+
 /*
  * Creates a new conversation with known endpoints based on a conversation
  * created with the CONVERSATION_TEMPLATE option while keeping the
@@ -183,31 +362,80 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 }
 
 /*
- * Compute the hash value for two given address/port pairs if the match
- * is to be exact.
+ * Fill in one address of a flat key.  If the address is too long to be
+ * stored inline, the key points at the caller's address data; see
+ * conv_table_find_slot() for how that is made permanent.
+ */
+static void
+conv_flat_addr_set(conv_flat_addr *fa, const address *addr)
+{
+	fa->type = addr->type;
+	if (addr->type == AT_NONE) {
+		/* ADDRESSES_EQUAL() ignores the length of AT_NONE addresses */
+		fa->len = 0;
+	} else {
+		fa->len = addr->len;
+	}
+	if (fa->len > CONV_ADDR_INLINE_LEN) {
+		fa->data.ptr = (const guint8 *)addr->data;
+	} else if (fa->len != 0) {
+		memcpy(fa->data.bytes, addr->data, fa->len);
+	}
+}
+
+static inline const guint8 *
+conv_flat_addr_data(const conv_flat_addr *fa)
+{
+	return (fa->len > CONV_ADDR_INLINE_LEN) ? fa->data.ptr : fa->data.bytes;
+}
+
+/*
+ * Build the flat key for the given address/port pairs in "table",
+ * leaving out whatever the table wildcards.  The key keeps the order
+ * of the pairs, so (A,B) and (B,A) are different keys; find_conversation()
+ * looks up the other direction itself.
  */
+static void
+conv_flat_key_init(conv_flat_key *fk, const conv_table *table, const address *addr1, const address *addr2,
+    const port_type ptype, const guint32 port1, const guint32 port2)
+{
+	memset(fk, 0, sizeof(*fk));
+	fk->ptype = ptype;
+
+	conv_flat_addr_set(&fk->addr1, addr1);
+	fk->port1 = port1;
+	if (!(table->wildcards & NO_ADDR2))
+		conv_flat_addr_set(&fk->addr2, addr2);
+	if (!(table->wildcards & NO_PORT2))
+		fk->port2 = port2;
+}
+
 /* http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing
  * One-at-a-Time hash
  */
-static guint
-conversation_hash_exact(gconstpointer v)
+static inline guint32
+conv_hash_bytes(guint32 hash_val, const guint8 *data, guint32 len)
 {
-	const conversation_key *key = (const conversation_key *)v;
-	guint hash_val;
-	address tmp_addr;
-
-	hash_val = 0;
-	tmp_addr.len  = 4;
+	guint32 i;
 
-	ADD_ADDRESS_TO_HASH(hash_val, &key->addr1);
-
-	tmp_addr.data = &key->port1;
-	ADD_ADDRESS_TO_HASH(hash_val, &tmp_addr);
+	for (i = 0; i < len; i++) {
+		hash_val += data[i];
+		hash_val += ( hash_val << 10 );
+		hash_val ^= ( hash_val >> 6 );
+	}
+	return hash_val;
+}
 
-	ADD_ADDRESS_TO_HASH(hash_val, &key->addr2);
+static guint32
+conv_flat_key_hash(const conv_flat_key *fk)
+{
+	guint32 hash_val = 0;
 
-	tmp_addr.data = &key->port2;
-	ADD_ADDRESS_TO_HASH(hash_val, &tmp_addr);
+	hash_val = conv_hash_bytes(hash_val, conv_flat_addr_data(&fk->addr1), fk->addr1.len);
+	hash_val = conv_hash_bytes(hash_val, (const guint8 *)&fk->port1, 4);
+	hash_val = conv_hash_bytes(hash_val, conv_flat_addr_data(&fk->addr2), fk->addr2.len);
+	hash_val = conv_hash_bytes(hash_val, (const guint8 *)&fk->port2, 4);
+	hash_val += fk->ptype;
 
 	hash_val += ( hash_val << 3 );
 	hash_val ^= ( hash_val >> 11 );
@@ -216,444 +444,521 @@ conversation_hash_exact(gconstpointer v)
 	return hash_val;
 }
 
+static inline gboolean
+conv_flat_addr_equal(const conv_flat_addr *a, const conv_flat_addr *b)
+{
+	if (a->type != b->type || a->len != b->len)
+		return FALSE;
+	return memcmp(conv_flat_addr_data(a), conv_flat_addr_data(b), a->len) == 0;
+}
+
+static inline gboolean
+conv_flat_key_equal(const conv_flat_key *a, const conv_flat_key *b)
+{
+	return a->port1 == b->port1 &&
+	    a->port2 == b->port2 &&
+	    a->ptype == b->ptype &&
+	    conv_flat_addr_equal(&a->addr1, &b->addr1) &&
+	    conv_flat_addr_equal(&a->addr2, &b->addr2);
+}
+
 /*
- * Compare two conversation keys for an exact match.
+ * Return a bit mask with bit i set if control byte i of the group
+ * starting at "ctrl" is equal to "tag".
  */
-static gint
-conversation_match_exact(gconstpointer v, gconstpointer w)
+static inline guint32
+conv_group_match(const guint8 *ctrl, const guint8 tag)
 {
-	const conversation_key *v1 = (const conversation_key *)v;
-	const conversation_key *v2 = (const conversation_key *)w;
+#ifdef CONV_USE_SSE2
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
 
-	if (v1->ptype != v2->ptype)
-		return 0;	/* different types of port */
+	return (guint32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+	guint32 bits = 0;
+	int i;
 
-	/*
-	 * Are the first and second port 1 values the same, the first and
-	 * second port 2 values the same, the first and second address
-	 * 1 values the same, and the first and second address 2 values
-	 * the same?
-	 */
-	if (v1->port1 == v2->port1 &&
-	    v1->port2 == v2->port2 &&
-	    ADDRESSES_EQUAL(&v1->addr1, &v2->addr1) &&
-	    ADDRESSES_EQUAL(&v1->addr2, &v2->addr2)) {
-		/*
-		 * Yes.  It's the same conversation, and the two
-		 * address/port pairs are going in the same direction.
-		 */
-		return 1;
+	for (i = 0; i < CONV_GROUP_SIZE; i++) {
+		if (ctrl[i] == tag)
+			bits |= 1U << i;
 	}
+	return bits;
+#endif
+}
 
-	/*
-	 * Is the first port 2 the same as the second port 1, the first
-	 * port 1 the same as the second port 2, the first address 2
-	 * the same as the second address 1, and the first address 1
-	 * the same as the second address 2?
-	 */
-	if (v1->port2 == v2->port1 &&
-	    v1->port1 == v2->port2 &&
-	    ADDRESSES_EQUAL(&v1->addr2, &v2->addr1) &&
-	    ADDRESSES_EQUAL(&v1->addr1, &v2->addr2)) {
-		/*
-		 * Yes.  It's the same conversation, and the two
-		 * address/port pairs are going in opposite directions.
-		 */
-		return 1;
+static inline guint32
+conv_lowest_bit(guint32 bits)
+{
+#if defined(__GNUC__)
+	return (guint32)__builtin_ctz(bits);
+#else
+	guint32 i = 0;
+
+	while (!(bits & 1)) {
+		bits >>= 1;
+		i++;
 	}
+	return i;
+#endif
+}
 
-	/*
-	 * The addresses or the ports don't match.
-	 */
-	return 0;
+static void
+conv_table_alloc(conv_table *table, const guint32 size)
+{
+	table->mask = size - 1;
+	table->keys = 0;
+	table->used = 0;
+	table->ctrl = (guint8 *)g_malloc0(size);
+	table->slots = g_new0(conv_slot, size);
 }
 
 /*
- * Compute the hash value for two given address/port pairs if the match
- * has a wildcard address 2.
+ * Return the first empty or deleted slot in the probe sequence for "hash".
  */
-static guint
-conversation_hash_no_addr2(gconstpointer v)
+static guint32
+conv_table_free_slot(const conv_table *table, const guint32 hash)
 {
-	const conversation_key *key = (const conversation_key *)v;
-	guint hash_val;
-	address tmp_addr;
-
-	hash_val = 0;
-	tmp_addr.len  = 4;
-
-	ADD_ADDRESS_TO_HASH(hash_val, &key->addr1);
+	guint32 group = hash & table->mask & ~(CONV_GROUP_SIZE - 1);
+	guint32 bits;
 
-	tmp_addr.data = &key->port1;
-	ADD_ADDRESS_TO_HASH(hash_val, &tmp_addr);
+	while ((bits = conv_group_match(table->ctrl + group, CONV_CTRL_EMPTY) |
+	    conv_group_match(table->ctrl + group, CONV_CTRL_DELETED)) == 0)
+		group = (group + CONV_GROUP_SIZE) & table->mask;
 
-	tmp_addr.data = &key->port2;
-	ADD_ADDRESS_TO_HASH(hash_val, &tmp_addr);
-
-	hash_val += ( hash_val << 3 );
-	hash_val ^= ( hash_val >> 11 );
-	hash_val += ( hash_val << 15 );
-
-	return hash_val;
+	return group + conv_lowest_bit(bits);
 }
 
 /*
- * Compare two conversation keys, except for the address 2 value.
- * We don't check both directions of the conversation - the routine
- * doing the hash lookup has to do two searches, as the hash key
- * will be different for the two directions.
+ * Move the keys of a table into a new set of slots, large enough to
+ * take as many keys again, dropping the deleted slots; the hashes are
+ * kept in the slots, so the keys don't need to be hashed again.
  */
-static gint
-conversation_match_no_addr2(gconstpointer v, gconstpointer w)
+static void
+conv_table_rehash(conv_table *table)
 {
-	const conversation_key *v1 = (const conversation_key *)v;
-	const conversation_key *v2 = (const conversation_key *)w;
-
-	if (v1->ptype != v2->ptype)
-		return 0;	/* different types of port */
-
-	/*
-	 * Are the first and second port 1 values the same, the first and
-	 * second port 2 valuess the same, and the first and second
-	 * address 1 values the same?
-	 */
-	if (v1->port1 == v2->port1 &&
-	    v1->port2 == v2->port2 &&
-	    ADDRESSES_EQUAL(&v1->addr1, &v2->addr1)) {
-		/*
-		 * Yes.  It's the same conversation, and the two
-		 * address/port pairs are going in the same direction.
-		 */
-		return 1;
+	guint8 *old_ctrl = table->ctrl;
+	conv_slot *old_slots = table->slots;
+	guint32 old_size = table->mask + 1;
+	guint32 keys = table->keys;
+	guint32 size = CONV_TABLE_MIN_SIZE;
+	guint32 i, j;
+
+	while (size * 3 < (keys + 1) * 8)
+		size *= 2;
+
+	conv_table_alloc(table, size);
+	for (i = 0; i < old_size; i++) {
+		if (!(old_ctrl[i] & 0x80))
+			continue;
+		j = conv_table_free_slot(table, old_slots[i].hash);
+		table->ctrl[j] = old_ctrl[i];
+		table->slots[j] = old_slots[i];
 	}
+	table->keys = table->used = keys;
 
-	/*
-	 * The addresses or the ports don't match.
-	 */
-	return 0;
+	g_free(old_ctrl);
+	g_free(old_slots);
 }
 
 /*
- * Compute the hash value for two given address/port pairs if the match
- * has a wildcard port 2.
+ * Find the slot for a key in a table and, if there is none and "create"
+ * is set, add one.
  */
-static guint
-conversation_hash_no_port2(gconstpointer v)
+static conv_slot *
+conv_table_find_slot(conv_table *table, const conv_flat_key *fk, const gboolean create)
 {
-	const conversation_key *key = (const conversation_key *)v;
-	guint hash_val;
-	address tmp_addr;
+	const guint32 hash = conv_flat_key_hash(fk);
+	const guint8 tag = CONV_CTRL_TAG(hash);
+	guint32 group, bits, i;
+	conv_slot *slot;
+
+	group = hash & table->mask & ~(CONV_GROUP_SIZE - 1);
+	for (;;) {
+		bits = conv_group_match(table->ctrl + group, tag);
+		while (bits != 0) {
+			slot = &table->slots[group + conv_lowest_bit(bits)];
+			if (slot->hash == hash && conv_flat_key_equal(&slot->key, fk))
+				return slot;
+			bits &= bits - 1;
+		}
+		if (conv_group_match(table->ctrl + group, CONV_CTRL_EMPTY) != 0)
+			break;
+		group = (group + CONV_GROUP_SIZE) & table->mask;
+	}
 
-	hash_val = 0;
-	tmp_addr.len  = 4;
+	if (!create)
+		return NULL;
 
-	ADD_ADDRESS_TO_HASH(hash_val, &key->addr1);
+	/* Keep the load factor, deleted slots included, at or below 3/4 */
+	if ((table->used + 1) * 4 > (table->mask + 1) * 3)
+		conv_table_rehash(table);
 
-	tmp_addr.data = &key->port1;
-	ADD_ADDRESS_TO_HASH(hash_val, &tmp_addr);
+	i = conv_table_free_slot(table, hash);
+	if (table->ctrl[i] == CONV_CTRL_EMPTY)
+		table->used++;
+	table->ctrl[i] = tag;
+	table->keys++;
 
-	ADD_ADDRESS_TO_HASH(hash_val, &key->addr2);
+	slot = &table->slots[i];
+	slot->key = *fk;
+	slot->hash = hash;
 
-	hash_val += ( hash_val << 3 );
-	hash_val ^= ( hash_val >> 11 );
-	hash_val += ( hash_val << 15 );
+	/* Long addresses point at the caller's data; make our own copy */
+	if (fk->addr1.len > CONV_ADDR_INLINE_LEN) {
+		slot->key.addr1.data.ptr = (const guint8 *)conversation_memdup(fk->addr1.data.ptr, fk->addr1.len);
+	}
+	if (fk->addr2.len > CONV_ADDR_INLINE_LEN) {
+		slot->key.addr2.data.ptr = (const guint8 *)conversation_memdup(fk->addr2.data.ptr, fk->addr2.len);
+	}
 
-	return hash_val;
+	return slot;
 }
 
 /*
- * Compare two conversation keys, except for the port 2 value.
- * We don't check both directions of the conversation - the routine
- * doing the hash lookup has to do two searches, as the hash key
- * will be different for the two directions.
+ * Remove a slot that no longer has any conversations from its table.
  */
-static gint
-conversation_match_no_port2(gconstpointer v, gconstpointer w)
+static void
+conv_table_delete_slot(conv_table *table, conv_slot *slot)
 {
-	const conversation_key *v1 = (const conversation_key *)v;
-	const conversation_key *v2 = (const conversation_key *)w;
-
-	if (v1->ptype != v2->ptype)
-		return 0;	/* different types of port */
-
-	/*
-	 * Are the first and second port 1 values the same, the first and
-	 * second address 1 values the same, and the first and second
-	 * address 2 values the same?
-	 */
-	if (v1->port1 == v2->port1 &&
-	    ADDRESSES_EQUAL(&v1->addr1, &v2->addr1) &&
-	    ADDRESSES_EQUAL(&v1->addr2, &v2->addr2)) {
-		/*
-		 * Yes.  It's the same conversation, and the two
-		 * address/port pairs are going in the same direction.
-		 */
-		return 1;
+	if (conv_state()->timeouts_enabled) {
+		if (slot->key.addr1.len > CONV_ADDR_INLINE_LEN)
+			g_free((gpointer)slot->key.addr1.data.ptr);
+		if (slot->key.addr2.len > CONV_ADDR_INLINE_LEN)
+			g_free((gpointer)slot->key.addr2.data.ptr);
 	}
+	g_free(slot->convs);
+	memset(slot, 0, sizeof(*slot));
+	table->ctrl[slot - table->slots] = CONV_CTRL_DELETED;
+	table->keys--;
+}
 
-	/*
-	 * The addresses or the ports don't match.
-	 */
-	return 0;
+/*
+ * Return the index of the first conversation in a slot that was set up
+ * after "frame_num".
+ */
+static guint32
+conv_slot_upper_bound(const conv_slot *slot, const guint32 frame_num)
+{
+	guint32 lo = 0, hi = slot->nconvs, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (slot->convs[mid]->setup_frame <= frame_num)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 /*
- * Compute the hash value for two given address/port pairs if the match
- * has a wildcard address 2 and port 2.
+ * Return the conversation with the highest setup frame not after
+ * "frame_num", or NULL if all of them were set up later.
  */
-static guint
-conversation_hash_no_addr2_or_port2(gconstpointer v)
+static conversation_t *
+conv_slot_lookup(conv_slot *slot, const guint32 frame_num)
 {
-	const conversation_key *key = (const conversation_key *)v;
-	guint hash_val;
-	address tmp_addr;
+	guint32 i;
 
-	hash_val = 0;
-	tmp_addr.len  = 4;
+	if (slot->nconvs == 0 || slot->convs[0]->setup_frame > frame_num)
+		return NULL;
 
-	ADD_ADDRESS_TO_HASH(hash_val, &key->addr1);
+	/* The common case: the most recently set up conversation. */
+	if (slot->convs[slot->nconvs - 1]->setup_frame <= frame_num)
+		return slot->convs[slot->nconvs - 1];
 
-	tmp_addr.data = &key->port1;
-	ADD_ADDRESS_TO_HASH(hash_val, &tmp_addr);
+	/* When going over the packets again, usually the same one as last time. */
+	i = slot->latest_found;
+	if (i + 1 < slot->nconvs &&
+	    slot->convs[i]->setup_frame <= frame_num &&
+	    slot->convs[i + 1]->setup_frame > frame_num)
+		return slot->convs[i];
 
-	hash_val += ( hash_val << 3 );
-	hash_val ^= ( hash_val >> 11 );
-	hash_val += ( hash_val << 15 );
+	i = conv_slot_upper_bound(slot, frame_num) - 1;
+	slot->latest_found = i;
+	return slot->convs[i];
+}
 
-	return hash_val;
+static conv_table *
+conversation_table_for_options(conversation_state_t *cs, const guint options)
+{
+	if (options & NO_ADDR2) {
+		if (options & (NO_PORT2|NO_PORT2_FORCE))
+			return &cs->tables[CONV_TABLE_NO_ADDR2_OR_PORT2];
+		return &cs->tables[CONV_TABLE_NO_ADDR2];
+	}
+	if (options & (NO_PORT2|NO_PORT2_FORCE))
+		return &cs->tables[CONV_TABLE_NO_PORT2];
+	return &cs->tables[CONV_TABLE_EXACT];
+}
+
+static conversation_expire_func
+conversation_expire_callback(const int proto)
+{
+	guint i;
+
+	if (conversation_expire_callbacks == NULL)
+		return NULL;
+
+	for (i = 0; i < conversation_expire_callbacks->len; i++) {
+		conv_expire_callback *cb = &g_array_index(conversation_expire_callbacks,
+		    conv_expire_callback, i);
+
+		if (cb->proto == proto)
+			return cb->func;
+	}
+	return NULL;
 }
 
 /*
- * Compare the address 1 and port 1 in the two conversation keys.
- * We don't check both directions of the conversation - the routine
- * doing the hash lookup has to do two searches, as the hash key
- * will be different for the two directions.
+ * Can a conversation be expired?  Only if all of its protocol data
+ * belongs to protocols that registered an expire callback, as the others
+ * may keep pointers to the conversation or its data that we don't know
+ * about.
  */
-static gint
-conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
+static gboolean
+conversation_expirable(const conversation_t *conv)
 {
-	const conversation_key *v1 = (const conversation_key *)v;
-	const conversation_key *v2 = (const conversation_key *)w;
+	GSList *item;
 
-	if (v1->ptype != v2->ptype)
-		return 0;	/* different types of port */
+	for (item = conv->data_list; item != NULL; item = item->next) {
+		conv_proto_data *p1 = (conv_proto_data *)item->data;
 
-	/*
-	 * Are the first and second port 1 values the same and the first
-	 * and second address 1 values the same?
-	 */
-	if (v1->port1 == v2->port1 &&
-	    ADDRESSES_EQUAL(&v1->addr1, &v2->addr1)) {
-		/*
-		 * Yes.  It's the same conversation, and the two
-		 * address/port pairs are going in the same direction.
-		 */
-		return 1;
+		if (conversation_expire_callback(p1->proto) == NULL)
+			return FALSE;
 	}
-
-	/*
-	 * The addresses or the ports don't match.
-	 */
-	return 0;
+	return TRUE;
 }
 
 /*
- * Free the proto_data.  The conversation itself is se_allocated.
+ * Free the proto_data list of a conversation.  If it is being expired,
+ * the dissectors get to free their data first; otherwise the file is
+ * being closed and their data goes with the file scope.
  */
 static void
-free_data_list(gpointer value)
+conversation_free_data(conversation_state_t *cs, conversation_t *conv, const gboolean expiring)
 {
-	conversation_t *conv = (conversation_t *)value;
+	conversation_expire_func func;
+	GSList *item;
 
+	for (item = conv->data_list; item != NULL; item = item->next) {
+		conv_proto_data *p1 = (conv_proto_data *)item->data;
+
+		if (expiring) {
+			func = conversation_expire_callback(p1->proto);
+			if (func != NULL)
+				func(conv, p1->proto_data);
+		}
+		if (cs->timeouts_enabled)
+			g_slice_free(conv_proto_data, p1);
+	}
 	/* TODO: se_slist? */
 	g_slist_free(conv->data_list);
-
-	/* Not really necessary, but... */
 	conv->data_list = NULL;
 
+	if (expiring && conv->heur_cache != NULL) {
+		heur_conv_cache_free(conv->heur_cache);
+		conv->heur_cache = NULL;
+	}
+}
+
+/*
+ * Free a conversation's data and, if it isn't allocated from the state's
+ * scope, the conversation itself.
+ */
+static void
+conversation_free(conversation_state_t *cs, conversation_t *conv, const gboolean expiring)
+{
+	conversation_free_data(cs, conv, expiring);
+
+	if (cs->timeouts_enabled) {
+		g_free((gpointer)conv->key_ptr->addr1.data);
+		g_free((gpointer)conv->key_ptr->addr2.data);
+		g_slice_free(conversation_key, conv->key_ptr);
+		g_slice_free(conv_timed, CONV_TIMED(conv));
+	}
+}
+
+static void
+conv_queue_push(GQueue *queue, GList *link, conversation_t *conv)
+{
+	link->data = conv;
+	g_queue_push_tail_link(queue, link);
+}
+
+static void
+conv_queue_remove(GQueue *queue, GList *link)
+{
+	if (link->data == NULL)
+		return;
+	g_queue_unlink(queue, link);
+	link->data = NULL;
+}
+
+/*
+ * Note that a timed conversation was looked up, so that it is due for the
+ * idle timeout a whole timeout from now.
+ */
+static void
+conversation_touch(conversation_state_t *cs, conversation_t *conv)
+{
+	conv_timed *timed = CONV_TIMED(conv);
+
+	conv_queue_remove(&cs->idle, &timed->idle_link);
+	timed->idle_due = cs->now + (time_t)cs->idle_timeout;
+	conv_queue_push(&cs->idle, &timed->idle_link, conv);
 }
 
 /*
  * Destroy all existing conversations
  */
-void
-conversation_cleanup(void)
+static void
+conversation_state_cleanup(conversation_state_t *cs)
 {
-	/*  Clean up the hash tables, but only after freeing any proto_data
-	 *  that may be hanging off the conversations.
-	 *  The conversation keys are se_ allocated so we don't have to clean them up.
+	guint32 i, j;
+	int t;
+
+	/*  Free any proto_data that may be hanging off the conversations,
+	 *  then the tables themselves.
+	 *  Unless timeouts are set, the conversations and their keys are
+	 *  allocated from the state's scope, which is emptied at the end.
 	 */
-	conversation_keys = NULL;
-	if (conversation_hashtable_exact != NULL) {
-		g_hash_table_destroy(conversation_hashtable_exact);
-	}
-	if (conversation_hashtable_no_addr2 != NULL) {
-		g_hash_table_destroy(conversation_hashtable_no_addr2);
-	}
-	if (conversation_hashtable_no_port2 != NULL) {
-		g_hash_table_destroy(conversation_hashtable_no_port2);
-	}
-	if (conversation_hashtable_no_addr2_or_port2 != NULL) {
-		g_hash_table_destroy(conversation_hashtable_no_addr2_or_port2);
+	cs->keys = NULL;
+	for (t = 0; t < CONV_NUM_TABLES; t++) {
+		conv_table *table = &cs->tables[t];
+
+		if (table->ctrl == NULL)
+			continue;
+
+		for (i = 0; i <= table->mask; i++) {
+			conv_slot *slot = &table->slots[i];
+
+			if (!(table->ctrl[i] & 0x80))
+				continue;
+			for (j = 0; j < slot->nconvs; j++)
+				conversation_free(cs, slot->convs[j], FALSE);
+			conv_table_delete_slot(table, slot);
+		}
+		g_free(table->ctrl);
+		g_free(table->slots);
+		memset(table, 0, sizeof(*table));
 	}
 
-	conversation_hashtable_exact = NULL;
-	conversation_hashtable_no_addr2 = NULL;
-	conversation_hashtable_no_port2 = NULL;
-	conversation_hashtable_no_addr2_or_port2 = NULL;
+	while (!g_queue_is_empty(&cs->retired))
+		conversation_free(cs, (conversation_t *)g_queue_pop_head(&cs->retired), FALSE);
+	/* Their links were in the conversations just freed */
+	g_queue_init(&cs->idle);
+	g_queue_init(&cs->age);
+
+	if (cs->scope != NULL)
+		wmem_free_all(cs->scope);
+}
+
+void
+conversation_cleanup(void)
+{
+	conversation_state_cleanup(conv_state());
 }
 
 /*
  * Initialize some variables every time a file is loaded or re-loaded.
- * Create a new hash table for the conversations in the new file.
+ * Create new tables for the conversations in the new file.
  */
 void
 conversation_init(void)
 {
-	/*
-	 * Free up any space allocated for conversation protocol data
-	 * areas.
-	 *
-	 * We can free the space, as the structures it contains are
-	 * pointed to by conversation data structures that were freed
-	 * above.
-	 */
-	conversation_hashtable_exact =
-	    g_hash_table_new_full(conversation_hash_exact,
-	      conversation_match_exact, NULL, free_data_list);
-	conversation_hashtable_no_addr2 =
-	    g_hash_table_new_full(conversation_hash_no_addr2,
-	      conversation_match_no_addr2, NULL, free_data_list);
-	conversation_hashtable_no_port2 =
-	    g_hash_table_new_full(conversation_hash_no_port2,
-	      conversation_match_no_port2, NULL, free_data_list);
-	conversation_hashtable_no_addr2_or_port2 =
-	    g_hash_table_new_full(conversation_hash_no_addr2_or_port2,
-	      conversation_match_no_addr2_or_port2, NULL, free_data_list);
+	conversation_state_t *cs = conv_state();
+	int t;
+
+	if (cs->scope == NULL)
+		cs->scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+	for (t = 0; t < CONV_NUM_TABLES; t++) {
+		cs->tables[t].wildcards =
+		    ((t & CONV_TABLE_NO_ADDR2) ? NO_ADDR2 : 0) |
+		    ((t & CONV_TABLE_NO_PORT2) ? NO_PORT2 : 0);
+		cs->tables[t].conversations = 0;
+		conv_table_alloc(&cs->tables[t], CONV_TABLE_MIN_SIZE);
+	}
 
 	/*
 	 * Start the conversation indices over at 0.
 	 */
-	new_index = 0;
+	cs->new_index = 0;
 }
 
 /*
- * Does the right thing when inserting into one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
- *
- * Mostly adapted from the old conversation_new().
+ * Add a conversation to the table for its options, keeping the
+ * conversations for its key ordered by setup frame.
  */
 static void
-conversation_insert_into_hashtable(GHashTable *hashtable, conversation_t *conv)
+conversation_insert_into_table(conv_table *table, conversation_t *conv)
 {
-	conversation_t *chain_head, *chain_tail, *cur, *prev;
-
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
-
-	if (NULL==chain_head) {
-		/* New entry */
-		conv->next = NULL;
-		conv->last = conv;
-		g_hash_table_insert(hashtable, conv->key_ptr, conv);
-		DPRINT(("created a new conversation chain"));
+	conversation_key *key = conv->key_ptr;
+	conv_flat_key fk;
+	conv_slot *slot;
+	guint32 i;
+
+	conv_flat_key_init(&fk, table, &key->addr1, &key->addr2, key->ptype,
+	    key->port1, key->port2);
+	slot = conv_table_find_slot(table, &fk, TRUE);
+
+	if (slot->nconvs == slot->alloc) {
+		slot->alloc = slot->alloc ? slot->alloc * 2 : 2;
+		slot->convs = (conversation_t **)g_realloc(slot->convs,
+		    slot->alloc * sizeof(conversation_t *));
 	}
-	else {
-		/* There's an existing chain for this key */
-		DPRINT(("there's an existing conversation chain"));
-
-		chain_tail = chain_head->last;
-
-		if(conv->setup_frame >= chain_tail->setup_frame) {
-			/* This convo belongs at the end of the chain */
-			conv->next = NULL;
-			conv->last = NULL;
-			chain_tail->next = conv;
-			chain_head->last = conv;
-		}
-		else {
-			/* Loop through the chain to find the right spot */
-			cur = chain_head;
-			prev = NULL;
-
-			for (; (conv->setup_frame > cur->setup_frame) && cur->next; prev=cur, cur=cur->next)
-				;
-
-			if (NULL==prev) {
-				/* Changing the head of the chain */
-				conv->next = chain_head;
-				conv->last = chain_tail;
-				chain_head->last = NULL;
-				g_hash_table_insert(hashtable, conv->key_ptr, conv);
-			}
-			else {
-				/* Inserting into the middle of the chain */
-				conv->next = cur;
-				conv->last = NULL;
-				prev->next = conv;
-			}
-		}
+
+	if (slot->nconvs == 0 ||
+	    conv->setup_frame >= slot->convs[slot->nconvs - 1]->setup_frame) {
+		/* This convo belongs at the end */
+		DPRINT(("appending to the conversations for this key"));
+		i = slot->nconvs;
+	} else {
+		DPRINT(("inserting before the end of the conversations for this key"));
+		i = conv_slot_upper_bound(slot, conv->setup_frame);
+		memmove(&slot->convs[i + 1], &slot->convs[i],
+		    (slot->nconvs - i) * sizeof(conversation_t *));
 	}
+	slot->convs[i] = conv;
+	slot->nconvs++;
+	table->conversations++;
 }
 
 /*
- * Does the right thing when removing from one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
+ * Remove a conversation from a table, and its key if it was the last
+ * conversation with that key.
  */
 static void
-conversation_remove_from_hashtable(GHashTable *hashtable, conversation_t *conv)
+conversation_remove_from_table(conv_table *table, conversation_t *conv)
 {
-	conversation_t *chain_head, *cur, *prev;
-
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
-
-	if (conv == chain_head) {
-		/* We are currently the front of the chain */
-		if (NULL == conv->next) {
-			/* We are the only conversation in the chain, no need to
-			 * update next pointer, but do not call
-			 * g_hash_table_remove() either because the conv data
-			 * will be re-inserted. The memory is released when
-			 * conversion_cleanup() is called. */
-			g_hash_table_steal(hashtable, conv->key_ptr);
-		}
-		else {
-			/* Update the head of the chain */
-			chain_head = conv->next;
-			chain_head->last = conv->last;
-
-			if (conv->latest_found == conv)
-				chain_head->latest_found = NULL;
-			else
-				chain_head->latest_found = conv->latest_found;
-
-			g_hash_table_insert(hashtable, chain_head->key_ptr, chain_head);
-		}
+	conversation_key *key = conv->key_ptr;
+	conv_flat_key fk;
+	conv_slot *slot;
+	guint32 i;
+
+	conv_flat_key_init(&fk, table, &key->addr1, &key->addr2, key->ptype,
+	    key->port1, key->port2);
+	slot = conv_table_find_slot(table, &fk, FALSE);
+	if (slot == NULL) {
+		/* XXX: Conversation not found. Wrong table? */
+		return;
 	}
-	else {
-		/* We are not the front of the chain. Loop through to find us.
-		 * Start loop at chain_head->next rather than chain_head because
-		 * we already know we're not at the head. */
-		cur = chain_head->next;
-		prev = chain_head;
-
-		for (; (cur != conv) && cur->next; prev=cur, cur=cur->next)
-			;
-
-		if (cur != conv) {
-			/* XXX: Conversation not found. Wrong hashtable? */
-			return;
-		}
 
-		prev->next = conv->next;
+	/* The conversations with an earlier setup frame can't be it */
+	i = conv->setup_frame ? conv_slot_upper_bound(slot, conv->setup_frame - 1) : 0;
+	for (; i < slot->nconvs && slot->convs[i] != conv; i++)
+		;
+	if (i == slot->nconvs)
+		return;
 
-		if (NULL == conv->next) {
-			/* We're at the very end of the list. */
-			chain_head->last = prev;
-		}
+	memmove(&slot->convs[i], &slot->convs[i + 1],
+	    (slot->nconvs - i - 1) * sizeof(conversation_t *));
+	slot->nconvs--;
+	slot->latest_found = 0;
+	table->conversations--;
 
-		if (chain_head->latest_found == conv)
-			chain_head->latest_found = prev;
-	}
+	if (slot->nconvs == 0)
+		conv_table_delete_slot(table, slot);
 }
 
 /*
@@ -672,7 +977,8 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	DISSECTOR_ASSERT(!(options | CONVERSATION_TEMPLATE) || ((options | (NO_ADDR2 | NO_PORT2 | NO_PORT2_FORCE))) &&
 				"A conversation template may not be constructed without wildcard options");
 */
-	GHashTable* hashtable;
+	conversation_state_t *cs = conv_state();
+	conv_table *table;
 	conversation_t *conversation=NULL;
 	conversation_key *new_key;
 
@@ -680,34 +986,28 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 		    setup_frame, ep_address_to_str(addr1), port1,
 		    ep_address_to_str(addr2), port2, ptype));
 
-	if (options & NO_ADDR2) {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
-		} else {
-			hashtable = conversation_hashtable_no_addr2;
-		}
+	table = conversation_table_for_options(cs, options);
+
+	if (cs->timeouts_enabled) {
+		/* Freed again by conversation_expire() */
+		new_key = g_slice_new(struct conversation_key);
+		new_key->next = NULL;
+		conversation = &g_slice_new0(conv_timed)->conv;
 	} else {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
-		} else {
-			hashtable = conversation_hashtable_exact;
-		}
+		new_key = wmem_new(cs->scope, struct conversation_key);
+		new_key->next = cs->keys;
+		cs->keys = new_key;
+		conversation = wmem_new0(cs->scope, conversation_t);
 	}
-
-	new_key = se_new(struct conversation_key);
-	new_key->next = conversation_keys;
-	conversation_keys = new_key;
-	SE_COPY_ADDRESS(&new_key->addr1, addr1);
-	SE_COPY_ADDRESS(&new_key->addr2, addr2);
+	conversation_copy_address(&new_key->addr1, addr1);
+	conversation_copy_address(&new_key->addr2, addr2);
 	new_key->ptype = ptype;
 	new_key->port1 = port1;
 	new_key->port2 = port2;
 
-	conversation = se_new(conversation_t);
-	memset(conversation, 0, sizeof(conversation_t));
-
-	conversation->index = new_index;
+	conversation->index = cs->new_index;
 	conversation->setup_frame = conversation->last_frame = setup_frame;
+	conversation->setup_time = conversation->last_time = cs->now;
 	conversation->data_list = NULL;
 
 	/* clear dissector handle */
@@ -717,12 +1017,21 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	conversation->options = options;
 	conversation->key_ptr = new_key;
 
-	new_index++;
+	cs->new_index++;
 
 	DINDENT();
-	conversation_insert_into_hashtable(hashtable, conversation);
+	conversation_insert_into_table(table, conversation);
 	DENDENT();
 
+	if (cs->idle_timeout != 0)
+		conversation_touch(cs, conversation);
+	if (cs->age_timeout != 0) {
+		conv_timed *timed = CONV_TIMED(conversation);
+
+		timed->age_due = cs->now + (time_t)cs->age_timeout;
+		conv_queue_push(&cs->age, &timed->age_link, conversation);
+	}
+
 	return conversation;
 }
 
@@ -733,6 +1042,8 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 void
 conversation_set_port2(conversation_t *conv, const guint32 port)
 {
+	conversation_state_t *cs;
+
    DISSECTOR_ASSERT_HINT(!(conv->options & CONVERSATION_TEMPLATE),
             "Use the conversation_create_from_template function when the CONVERSATION_TEMPLATE bit is set in the options mask");
 
@@ -745,18 +1056,11 @@ conversation_set_port2(conversation_t *conv, const guint32 port)
 		return;
 
 	DINDENT();
-	if (conv->options & NO_ADDR2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
-	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
-	}
+	cs = conv_state();
+	conversation_remove_from_table(conversation_table_for_options(cs, conv->options), conv);
 	conv->options &= ~NO_PORT2;
 	conv->key_ptr->port2  = port;
-	if (conv->options & NO_ADDR2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_addr2, conv);
-	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
-	}
+	conversation_insert_into_table(conversation_table_for_options(cs, conv->options), conv);
 	DENDENT();
 }
 
@@ -767,6 +1071,8 @@ conversation_set_port2(conversation_t *conv, const guint32 port)
 void
 conversation_set_addr2(conversation_t *conv, const address *addr)
 {
+	conversation_state_t *cs;
+
    DISSECTOR_ASSERT_HINT(!(conv->options & CONVERSATION_TEMPLATE),
             "Use the conversation_create_from_template function when the CONVERSATION_TEMPLATE bit is set in the options mask");
 
@@ -779,66 +1085,43 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
 		return;
 
 	DINDENT();
-	if (conv->options & NO_PORT2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
-	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
-	}
+	cs = conv_state();
+	conversation_remove_from_table(conversation_table_for_options(cs, conv->options), conv);
 	conv->options &= ~NO_ADDR2;
-	SE_COPY_ADDRESS(&conv->key_ptr->addr2, addr);
-	if (conv->options & NO_PORT2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_port2, conv);
-	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
-	}
+	if (cs->timeouts_enabled)
+		g_free((gpointer)conv->key_ptr->addr2.data);
+	conversation_copy_address(&conv->key_ptr->addr2, addr);
+	conversation_insert_into_table(conversation_table_for_options(cs, conv->options), conv);
 	DENDENT();
 }
 
 /*
- * Search a particular hash table for a conversation with the specified
+ * Search a particular table for a conversation with the specified
  * {addr1, port1, addr2, port2} and set up before frame_num.
  */
 static conversation_t *
-conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
+conversation_lookup_table(conversation_state_t *cs, conv_table *table, const guint32 frame_num, const address *addr1, const address *addr2,
     const port_type ptype, const guint32 port1, const guint32 port2)
 {
-	conversation_t* convo=NULL;
-	conversation_t* match=NULL;
-	conversation_t* chain_head=NULL;
-	conversation_key key;
-
-	/*
-	 * We don't make a copy of the address data, we just copy the
-	 * pointer to it, as "key" disappears when we return.
-	 */
-	key.addr1 = *addr1;
-	key.addr2 = *addr2;
-	key.ptype = ptype;
-	key.port1 = port1;
-	key.port2 = port2;
-
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, &key);
-
-	if (chain_head && (chain_head->setup_frame <= frame_num)) {
-		match = chain_head;
-
-		if((chain_head->last)&&(chain_head->last->setup_frame<=frame_num))
-			return chain_head->last;
-
-		if((chain_head->latest_found)&&(chain_head->latest_found->setup_frame<=frame_num))
-			match = chain_head->latest_found;
-
-		for (convo = match; convo && convo->setup_frame <= frame_num; convo = convo->next) {
-			if (convo->setup_frame > match->setup_frame) {
-				match = convo;
-			}
-		}
+	conversation_t *conv;
+	conv_flat_key fk;
+	conv_slot *slot;
+
+	if (table->conversations == 0)
+		return NULL;
+
+	conv_flat_key_init(&fk, table, addr1, addr2, ptype, port1, port2);
+	slot = conv_table_find_slot(table, &fk, FALSE);
+	if (slot == NULL)
+		return NULL;
+
+	conv = conv_slot_lookup(slot, frame_num);
+	if (conv != NULL) {
+		conv->last_time = cs->now;
+		if (cs->idle_timeout != 0)
+			conversation_touch(cs, conv);
 	}
-
-    if (match)
-    	chain_head->latest_found = match;
-
-	return match;
+	return conv;
 }
 
 
@@ -882,6 +1165,7 @@ conversation_t *
 find_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
     const guint32 port_a, const guint32 port_b, const guint options)
 {
+   conversation_state_t *cs = conv_state();
    conversation_t *conversation;
 
    /*
@@ -894,14 +1178,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying exact match"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_exact,
+         conversation_lookup_table(cs, &cs->tables[CONV_TABLE_EXACT],
          frame_num, addr_a, addr_b, ptype,
          port_a, port_b);
       /* Didn't work, try the other direction */
       if (conversation == NULL) {
 	      DPRINT(("trying opposite direction"));
 	      conversation =
-		 conversation_lookup_hashtable(conversation_hashtable_exact,
+		 conversation_lookup_table(cs, &cs->tables[CONV_TABLE_EXACT],
 		 frame_num, addr_b, addr_a, ptype,
 		 port_b, port_a);
       }
@@ -910,7 +1194,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
           * TCP/UDP ports are in TCP/IP.
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_exact,
+            conversation_lookup_table(cs, &cs->tables[CONV_TABLE_EXACT],
             frame_num, addr_b, addr_a, ptype,
             port_a, port_b);
       }
@@ -935,14 +1219,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying wildcarded dest address"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+         conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_ADDR2],
          frame_num, addr_a, addr_b, ptype, port_a, port_b);
       if ((conversation == NULL) && (addr_a->type == AT_FC)) {
          /* In Fibre channel, OXID & RXID are never swapped as
           * TCP/UDP ports are in TCP/IP.
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+            conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_ADDR2],
             frame_num, addr_b, addr_a, ptype,
             port_a, port_b);
       }
@@ -987,7 +1271,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
       if (!(options & NO_ADDR_B)) {
          DPRINT(("trying dest addr:port as source addr:port with wildcarded dest addr"));
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+            conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_ADDR2],
             frame_num, addr_b, addr_a, ptype, port_b, port_a);
          if (conversation != NULL) {
             /*
@@ -1031,14 +1315,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying wildcarded dest port"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_no_port2,
+         conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_PORT2],
          frame_num, addr_a, addr_b, ptype, port_a, port_b);
       if ((conversation == NULL) && (addr_a->type == AT_FC)) {
          /* In Fibre channel, OXID & RXID are never swapped as
           * TCP/UDP ports are in TCP/IP
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_port2,
+            conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_PORT2],
             frame_num, addr_b, addr_a, ptype, port_a, port_b);
       }
       if (conversation != NULL) {
@@ -1082,7 +1366,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
       if (!(options & NO_PORT_B)) {
          DPRINT(("trying dest addr:port as source addr:port and wildcarded dest port"));
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_port2,
+            conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_PORT2],
             frame_num, addr_b, addr_a, ptype, port_b, port_a);
          if (conversation != NULL) {
             /*
@@ -1121,7 +1405,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
     */
    DPRINT(("trying wildcarding dest addr:port"));
    conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_ADDR2_OR_PORT2],
       frame_num, addr_a, addr_b, ptype, port_a, port_b);
    if (conversation != NULL) {
       /*
@@ -1168,11 +1452,11 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
    DPRINT(("trying dest addr:port as source addr:port and wildcarding dest addr:port"));
    if (addr_a->type == AT_FC)
       conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_ADDR2_OR_PORT2],
       frame_num, addr_b, addr_a, ptype, port_a, port_b);
    else
       conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_table(cs, &cs->tables[CONV_TABLE_NO_ADDR2_OR_PORT2],
       frame_num, addr_b, addr_a, ptype, port_b, port_a);
    if (conversation != NULL) {
       /*
@@ -1225,7 +1509,12 @@ p_compare(gconstpointer a, gconstpointer b)
 void
 conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_data)
 {
-	conv_proto_data *p1 = se_new(conv_proto_data);
+	conv_proto_data *p1;
+
+	if (conv_state()->timeouts_enabled)
+		p1 = g_slice_new(conv_proto_data);
+	else
+		p1 = wmem_new(conv_state()->scope, conv_proto_data);
 
 	p1->proto = proto;
 	p1->proto_data = proto_data;
@@ -1259,18 +1548,18 @@ conversation_get_proto_data(const conversation_t *conv, const int proto)
 void
 conversation_delete_proto_data(conversation_t *conv, const int proto)
 {
-	conv_proto_data temp;
+	conv_proto_data temp, *p1;
 	GSList *item;
 
 	temp.proto = proto;
 	temp.proto_data = NULL;
 
-	item = g_slist_find_custom(conv->data_list, (gpointer *)&temp,
-	    p_compare);
-
-	while(item){
-		conv->data_list = g_slist_remove(conv->data_list, item->data);
-		item=item->next;
+	while ((item = g_slist_find_custom(conv->data_list, (gpointer *)&temp,
+	    p_compare)) != NULL) {
+		p1 = (conv_proto_data *)item->data;
+		conv->data_list = g_slist_remove(conv->data_list, p1);
+		if (conv_state()->timeouts_enabled)
+			g_slice_free(conv_proto_data, p1);
 	}
 }
 
@@ -1359,28 +1648,186 @@ find_or_create_conversation(packet_info *pinfo)
 	return conv;
 }
 
+void
+conversation_set_timeouts(const guint idle_timeout, const guint age_timeout)
+{
+	conversation_state_t *cs = conv_state();
+
+	cs->idle_timeout = idle_timeout;
+	cs->age_timeout = age_timeout;
+	cs->timeouts_enabled = (idle_timeout != 0 || age_timeout != 0);
+}
+
+void
+conversation_set_current_time(const time_t now)
+{
+	conv_state()->now = now;
+}
+
+void
+conversation_register_expire_callback(const int proto, conversation_expire_func func)
+{
+	conv_expire_callback cb;
+
+	if (conversation_expire_callbacks == NULL)
+		conversation_expire_callbacks = g_array_new(FALSE, FALSE, sizeof(conv_expire_callback));
+
+	cb.proto = proto;
+	cb.func = func;
+	g_array_append_val(conversation_expire_callbacks, cb);
+}
+
+/*
+ * Free the conversations that were expired longer ago than the timeout;
+ * last_time is when they were expired.
+ */
+static void
+conversation_free_retired(conversation_state_t *cs, const time_t now)
+{
+	time_t grace = (time_t)(cs->idle_timeout != 0 ? cs->idle_timeout : cs->age_timeout);
+	conversation_t *conv;
+
+	while ((conv = (conversation_t *)g_queue_peek_head(&cs->retired)) != NULL &&
+	    now - conv->last_time > grace) {
+		g_queue_pop_head(&cs->retired);
+		/* In case a dissector attached data to it in the meantime */
+		conversation_free(cs, conv, TRUE);
+	}
+}
+
+/*
+ * Expire the conversations at the head of one of the due queues whose
+ * time has come, and put the ones that can't be expired yet back at the
+ * end, to be checked again a timeout later.
+ */
+static guint
+conversation_expire_queue(conversation_state_t *cs, GQueue *queue, const gboolean idle, const time_t now)
+{
+	time_t timeout = (time_t)(idle ? cs->idle_timeout : cs->age_timeout);
+	guint expired = 0;
+	GList *link;
+
+	while ((link = g_queue_peek_head_link(queue)) != NULL) {
+		conversation_t *conv = (conversation_t *)link->data;
+		conv_timed *timed = CONV_TIMED(conv);
+
+		if ((idle ? timed->idle_due : timed->age_due) >= now)
+			break;
+
+		if (!conversation_expirable(conv)) {
+			conv_queue_remove(queue, link);
+			if (idle)
+				timed->idle_due = now + timeout;
+			else
+				timed->age_due = now + timeout;
+			conv_queue_push(queue, link, conv);
+			continue;
+		}
+
+		conv_queue_remove(&cs->idle, &timed->idle_link);
+		conv_queue_remove(&cs->age, &timed->age_link);
+		conversation_remove_from_table(conversation_table_for_options(cs, conv->options), conv);
+		conversation_free_data(cs, conv, TRUE);
+		conv->last_time = now;
+		g_queue_push_tail(&cs->retired, conv);
+		expired++;
+	}
+	return expired;
+}
+
+guint
+conversation_expire(const time_t now)
+{
+	conversation_state_t *cs = conv_state();
+	guint expired = 0;
+
+	if (!cs->timeouts_enabled)
+		return 0;
+
+	conversation_free_retired(cs, now);
+
+	expired += conversation_expire_queue(cs, &cs->idle, TRUE, now);
+	expired += conversation_expire_queue(cs, &cs->age, FALSE, now);
+
+	cs->expired += expired;
+	return expired;
+}
+
+conversation_state_t *
+conversation_state_new(void)
+{
+	return g_new0(conversation_state_t, 1);
+}
+
+void
+conversation_state_free(conversation_state_t *state)
+{
+	conversation_state_t *prev = conversation_current_state;
+
+	if (state == NULL)
+		return;
+
+	/* The conversation routines used to free it work on the current state */
+	conversation_current_state = state;
+	conversation_state_cleanup(state);
+	conversation_current_state = (prev == state) ? NULL : prev;
+	if (state->scope != NULL)
+		wmem_destroy_allocator(state->scope);
+	g_free(state);
+}
+
+void
+conversation_set_state(conversation_state_t *state)
+{
+	conversation_current_state = state;
+}
+
+void
+conversation_table_stats(const guint options, guint *keys, guint *conversations, guint *slots)
+{
+	const conv_table *table = conversation_table_for_options(conv_state(), options);
+
+	*keys = table->keys;
+	*conversations = table->conversations;
+	*slots = table->ctrl ? table->mask + 1 : 0;
+}
+
+/* Deprecated, see conversation.h */
 GHashTable *
 get_conversation_hashtable_exact(void)
 {
-	return conversation_hashtable_exact;
+	return NULL;
 }
 
 GHashTable *
 get_conversation_hashtable_no_addr2(void)
 {
-	return conversation_hashtable_no_addr2;
+	return NULL;
 }
 
 GHashTable *
 get_conversation_hashtable_no_port2(void)
 {
-	return conversation_hashtable_no_port2;
+	return NULL;
 }
 
 GHashTable *
 get_conversation_hashtable_no_addr2_or_port2(void)
 {
-	return conversation_hashtable_no_addr2_or_port2;
+	return NULL;
+}
+
+void
+conversation_expire_stats(guint *live, guint *retired, guint64 *expired)
+{
+	const conversation_state_t *cs = conv_state();
+	int t;
+
+	*live = 0;
+	for (t = 0; t < CONV_NUM_TABLES; t++)
+		*live += cs->tables[t].conversations;
+	*retired = g_queue_get_length((GQueue *)&cs->retired);
+	*expired = cs->expired;
 }
 
 /*
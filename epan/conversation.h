@@ -70,19 +70,18 @@ typedef struct conversation_key {
 } conversation_key;
 
 typedef struct conversation {
-	struct conversation *next;	/** pointer to next conversation on hash chain */
-	struct conversation *last;	/** pointer to the last conversation on hash chain */
-	struct conversation *latest_found;
-								/** pointer to the last conversation on hash chain */
 	guint32	index;				/** unique ID for conversation */
 	guint32 setup_frame;		/** frame number that setup this conversation */
 	/* Assume that setup_frame is also the lowest frame number for now. */
 	guint32 last_frame;		/** highest frame number in this conversation */
+	time_t	setup_time;			/** capture time at which this conversation was set up, when timeouts are set */
+	time_t	last_time;			/** capture time at which this conversation was last looked up, when timeouts are set */
 	GSList *data_list;			/** list of data associated with conversation */
 	dissector_handle_t dissector_handle;
 								/** handle for protocol dissector client associated with conversation */
 	guint	options;			/** wildcard flags */
 	conversation_key *key_ptr;	/** pointer to the key for this conversation */
+	void	*heur_cache;			/** heuristic dissectors that accepted/rejected this conversation, see dissector_try_heuristic() */
 } conversation_t;
 
 /**
@@ -94,7 +93,7 @@ extern void conversation_cleanup(void);
  * Initialize some variables every time a file is loaded or re-loaded.
  * Create a new hash table for the conversations in the new file.
  */
-extern void conversation_init(void);
+WS_DLL_PUBLIC void conversation_init(void);
 
 /*
  * Given two address/port pairs for a packet, create a new conversation
@@ -181,6 +180,11 @@ try_conversation_dissector(const address *addr_a, const address *addr_b, const p
 extern void conversation_set_port2(conversation_t *conv, const guint32 port);
 extern void conversation_set_addr2(conversation_t *conv, const address *addr);
 
+/*
+ * !! DEPRECATED !! - The conversations are no longer kept in GHashTables,
+ * so these always return NULL.  Use conversation_table_stats() instead;
+ * they will be removed in a later release.
+ */
 WS_DLL_PUBLIC
 GHashTable *get_conversation_hashtable_exact(void);
 
@@ -193,6 +197,119 @@ GHashTable * get_conversation_hashtable_no_port2(void);
 WS_DLL_PUBLIC
 GHashTable *get_conversation_hashtable_no_addr2_or_port2(void);
 
+/**
+ * Called for every piece of protocol data of a conversation that is
+ * about to be expired by conversation_expire(), so that the dissector
+ * can free it (it isn't called when the file is closed, as the file
+ * scope goes away then anyway).
+ *
+ * @param conv the conversation
+ * @param proto_data the data the dissector added with conversation_add_proto_data()
+ */
+typedef void (*conversation_expire_func)(conversation_t *conv, void *proto_data);
+
+/**
+ * Register a function to be called when a conversation that has data
+ * of protocol "proto" attached is expired.  Only conversations all of
+ * whose data belongs to protocols that registered one are expired, so
+ * a dissector that keeps pointers to conversations or their data
+ * elsewhere must not register one unless it forgets those pointers in
+ * it.
+ */
+WS_DLL_PUBLIC void conversation_register_expire_callback(const int proto, conversation_expire_func func);
+
+/**
+ * Set the idle and age timeouts, in seconds of capture time, after which
+ * conversation_expire() drops a conversation; 0 disables a timeout.
+ * Conversations are then allocated so that they can be freed one by one
+ * rather than when the file is closed.
+ *
+ * This must be called while there are no conversations, i.e. before
+ * the first packet is dissected.
+ */
+WS_DLL_PUBLIC void conversation_set_timeouts(const guint idle_timeout, const guint age_timeout);
+
+/**
+ * Set the capture time of the packet that is about to be dissected, which
+ * conversation_new() and find_conversation() use to track activity when
+ * timeouts are set.
+ */
+WS_DLL_PUBLIC void conversation_set_current_time(const time_t now);
+
+/**
+ * Drop the conversations that have not been looked up for longer than
+ * the idle timeout, or were set up longer ago than the age timeout,
+ * after calling the expire callbacks for their protocol data; see
+ * conversation_register_expire_callback() for which ones are dropped.
+ *
+ * A dropped conversation is no longer found, but the conversation_t
+ * itself is only freed once it has been dropped for as long as the
+ * timeout, so a stale pointer to it doesn't point to reused memory.
+ * This is still only meant for packets dissected once, in order.
+ *
+ * Only the conversations that are due are looked at, so this can be
+ * called for every second of capture time however many there are.
+ *
+ * @param now the capture time of the current packet
+ * @return the number of conversations dropped
+ */
+WS_DLL_PUBLIC guint conversation_expire(const time_t now);
+
+/**
+ * The conversation tables of one epan session.  Each session keeps its
+ * own, so a new session starts without the conversations of an earlier
+ * one, and they're all freed with it.
+ *
+ * Only the conversation tables, and the memory conversations are
+ * allocated from, belong to the session.  The data dissectors attach to
+ * them is mostly allocated from wmem_file_scope(), and circuits,
+ * per-packet protocol data, the reassembly tables, heuristic state and
+ * the dissectors' own state are process-wide, as is the choice of the
+ * current state; only one session can be dissecting at a time.
+ */
+typedef struct conversation_state conversation_state_t;
+
+/**
+ * Create an empty set of conversations; conversation_init() sets up
+ * its tables once it is made current with conversation_set_state().
+ */
+WS_DLL_PUBLIC conversation_state_t *conversation_state_new(void);
+
+/**
+ * Destroy all the conversations of a state and free the state.  If it is
+ * the current state, the default state is used again.
+ */
+WS_DLL_PUBLIC void conversation_state_free(conversation_state_t *state);
+
+/**
+ * Make the conversation routines, including conversation_init(),
+ * conversation_cleanup(), conversation_set_timeouts() and
+ * conversation_expire(), work on "state".  While none is set, or after
+ * NULL is set, they use one default state.
+ */
+WS_DLL_PUBLIC void conversation_set_state(conversation_state_t *state);
+
+/**
+ * Report the size of the conversation table used for conversations
+ * created with the given NO_ADDR2 / NO_PORT2 options.
+ *
+ * @param options NO_ADDR2 and/or NO_PORT2, as passed to conversation_new()
+ * @param keys [out] number of distinct address/port keys in the table
+ * @param conversations [out] number of conversations in the table
+ * @param slots [out] number of slots allocated for the table
+ */
+WS_DLL_PUBLIC
+void conversation_table_stats(const guint options, guint *keys, guint *conversations, guint *slots);
+
+/**
+ * Report how many conversations there are and how many have been expired.
+ *
+ * @param live [out] number of conversations that can be found
+ * @param retired [out] number of expired conversations not freed yet
+ * @param expired [out] number of conversations expired so far
+ */
+WS_DLL_PUBLIC
+void conversation_expire_stats(guint *live, guint *retired, guint64 *expired);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,431 @@
+/* conversation_test.c
+ * Conversation table tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "emem.h"
+#include "address.h"
+#include "conversation.h"
+#include "wmem/wmem.h"
+
+static conversation_state_t *test_state;
+
+static const guint8 ip_a[4] = { 192, 0, 2, 1 };
+static const guint8 ip_b[4] = { 192, 0, 2, 2 };
+static const guint8 ip_c[4] = { 192, 0, 2, 3 };
+
+static address addr_a, addr_b, addr_c;
+
+/* Each test starts with no conversations */
+static void
+conversation_test_begin(void)
+{
+    test_state = conversation_state_new();
+    conversation_set_state(test_state);
+    conversation_init();
+}
+
+static void
+conversation_test_end(void)
+{
+    conversation_state_free(test_state);
+    test_state = NULL;
+}
+
+static void
+conversation_test_lookup_exact(void)
+{
+    conversation_t *conv;
+
+    conversation_test_begin();
+
+    conv = conversation_new(10, &addr_a, &addr_b, PT_UDP, 1000, 53, 0);
+    g_assert(conv != NULL);
+
+    g_assert(find_conversation(10, &addr_a, &addr_b, PT_UDP, 1000, 53, 0) == conv);
+    g_assert(find_conversation(20, &addr_a, &addr_b, PT_UDP, 1000, 53, 0) == conv);
+    /* The other direction */
+    g_assert(find_conversation(20, &addr_b, &addr_a, PT_UDP, 53, 1000, 0) == conv);
+    /* Before it was set up */
+    g_assert(find_conversation(9, &addr_a, &addr_b, PT_UDP, 1000, 53, 0) == NULL);
+    /* Anything else */
+    g_assert(find_conversation(20, &addr_a, &addr_b, PT_UDP, 1001, 53, 0) == NULL);
+    g_assert(find_conversation(20, &addr_a, &addr_c, PT_UDP, 1000, 53, 0) == NULL);
+    g_assert(find_conversation(20, &addr_a, &addr_b, PT_TCP, 1000, 53, 0) == NULL);
+    g_assert(find_conversation(20, &addr_b, &addr_a, PT_UDP, 1000, 53, 0) == NULL);
+
+    conversation_test_end();
+}
+
+/* (A,B) and (B,A) are separate conversations if both were created */
+static void
+conversation_test_lookup_direction(void)
+{
+    conversation_t *conv_ab, *conv_ba;
+
+    conversation_test_begin();
+
+    conv_ab = conversation_new(1, &addr_a, &addr_b, PT_UDP, 5060, 5060, 0);
+    conv_ba = conversation_new(2, &addr_b, &addr_a, PT_UDP, 5060, 5060, 0);
+    g_assert(conv_ab != conv_ba);
+
+    g_assert(find_conversation(3, &addr_a, &addr_b, PT_UDP, 5060, 5060, 0) == conv_ab);
+    g_assert(find_conversation(3, &addr_b, &addr_a, PT_UDP, 5060, 5060, 0) == conv_ba);
+    /* Before the second one was set up, either direction finds the first */
+    g_assert(find_conversation(1, &addr_b, &addr_a, PT_UDP, 5060, 5060, 0) == conv_ab);
+
+    conversation_test_end();
+}
+
+/* The conversation found is the last one set up at or before the frame */
+static void
+conversation_test_lookup_setup_frame(void)
+{
+    conversation_t *conv1, *conv2, *conv3;
+
+    conversation_test_begin();
+
+    conv1 = conversation_new(1, &addr_a, &addr_b, PT_TCP, 1000, 80, 0);
+    conv2 = conversation_new(10, &addr_a, &addr_b, PT_TCP, 1000, 80, 0);
+
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv1);
+    g_assert(find_conversation(10, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv2);
+    g_assert(find_conversation(20, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv2);
+    /* Going over the packets again */
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv1);
+    g_assert(find_conversation(6, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv1);
+
+    /* Set up out of order */
+    conv3 = conversation_new(5, &addr_a, &addr_b, PT_TCP, 1000, 80, 0);
+    g_assert(find_conversation(4, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv1);
+    g_assert(find_conversation(7, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv3);
+    g_assert(find_conversation(10, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv2);
+
+    conversation_test_end();
+}
+
+/* Addresses too long to be kept in the key itself */
+static void
+conversation_test_lookup_long_address(void)
+{
+    gchar name1[] = "a-rather-long-endpoint-name-1";
+    gchar name2[] = "a-rather-long-endpoint-name-2";
+    address long1, long2;
+    conversation_t *conv;
+
+    conversation_test_begin();
+
+    SET_ADDRESS(&long1, AT_STRINGZ, (int)sizeof(name1), name1);
+    SET_ADDRESS(&long2, AT_STRINGZ, (int)sizeof(name2), name2);
+    conv = conversation_new(1, &long1, &long2, PT_NONE, 0, 0, 0);
+
+    g_assert(find_conversation(1, &long1, &long2, PT_NONE, 0, 0, 0) == conv);
+    g_assert(find_conversation(1, &long2, &long1, PT_NONE, 0, 0, 0) == conv);
+
+    /* The table has its own copy of the addresses */
+    name1[0] = 'b';
+    g_assert(find_conversation(1, &long1, &long2, PT_NONE, 0, 0, 0) == NULL);
+    name1[0] = 'a';
+    g_assert(find_conversation(1, &long1, &long2, PT_NONE, 0, 0, 0) == conv);
+
+    conversation_test_end();
+}
+
+static void
+conversation_test_wildcard_port2(void)
+{
+    conversation_t *conv;
+    guint keys, convs, slots;
+
+    conversation_test_begin();
+
+    /* UDP doesn't fill the wildcard in */
+    conv = conversation_new(1, &addr_a, &addr_b, PT_UDP, 69, 0, NO_PORT2);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 69, 2000, 0) == conv);
+    g_assert(find_conversation(2, &addr_b, &addr_a, PT_UDP, 2000, 69, 0) == conv);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 69, 3000, 0) == conv);
+    g_assert(find_conversation(2, &addr_a, &addr_c, PT_UDP, 69, 2000, 0) == NULL);
+
+    /* TCP does, and the conversation moves to the exact table */
+    conv = conversation_new(1, &addr_a, &addr_b, PT_TCP, 21, 0, NO_PORT2);
+    g_assert(find_conversation(2, &addr_b, &addr_a, PT_TCP, 2000, 21, 0) == conv);
+    g_assert(!(conv->options & NO_PORT2));
+    g_assert(conv->key_ptr->port2 == 2000);
+    g_assert(find_conversation(3, &addr_a, &addr_b, PT_TCP, 21, 2000, 0) == conv);
+    g_assert(find_conversation(3, &addr_a, &addr_b, PT_TCP, 21, 3000, 0) == NULL);
+
+    conversation_table_stats(NO_PORT2, &keys, &convs, &slots);
+    g_assert(keys == 1 && convs == 1);
+    conversation_table_stats(0, &keys, &convs, &slots);
+    g_assert(keys == 1 && convs == 1);
+
+    conversation_test_end();
+}
+
+static void
+conversation_test_wildcard_addr2(void)
+{
+    conversation_t *conv;
+
+    conversation_test_begin();
+
+    conv = conversation_new(1, &addr_a, &addr_a, PT_UDP, 5060, 5060, NO_ADDR2);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 5060, 5060, 0) == conv);
+    g_assert(find_conversation(2, &addr_c, &addr_a, PT_UDP, 5060, 5060, 0) == conv);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 5060, 5061, 0) == NULL);
+
+    conversation_test_end();
+}
+
+static void
+conversation_test_wildcard_both(void)
+{
+    conversation_t *conv, *exact;
+
+    conversation_test_begin();
+
+    conv = conversation_new(1, &addr_a, &addr_a, PT_UDP, 1719, 0, NO_ADDR2|NO_PORT2);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 1719, 4000, 0) == conv);
+    g_assert(find_conversation(2, &addr_c, &addr_a, PT_UDP, 4000, 1719, 0) == conv);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 1720, 4000, 0) == NULL);
+
+    /* A more exact match comes first */
+    exact = conversation_new(3, &addr_a, &addr_b, PT_UDP, 1719, 4000, 0);
+    g_assert(find_conversation(4, &addr_a, &addr_b, PT_UDP, 1719, 4000, 0) == exact);
+    g_assert(find_conversation(4, &addr_a, &addr_c, PT_UDP, 1719, 4000, 0) == conv);
+
+    /* Wildcards in the search */
+    g_assert(find_conversation(4, &addr_a, &addr_c, PT_UDP, 1719, 0, NO_ADDR_B|NO_PORT_B) == conv);
+
+    conversation_test_end();
+}
+
+#define CONV_TEST_MANY 5000
+
+/* The tables grow, and reuse the slots of keys that were removed */
+static void
+conversation_test_resize(void)
+{
+    guint32 *ips;
+    address *addrs;
+    conversation_t **convs;
+    guint keys, nconvs, slots;
+    guint32 i;
+
+    conversation_test_begin();
+
+    ips = g_new(guint32, CONV_TEST_MANY);
+    addrs = g_new(address, CONV_TEST_MANY);
+    convs = g_new(conversation_t *, CONV_TEST_MANY);
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        ips[i] = g_htonl(0x0a000000 + i);
+        SET_ADDRESS(&addrs[i], AT_IPv4, 4, &ips[i]);
+    }
+
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        convs[i] = conversation_new(i + 1, &addrs[i], &addr_a, PT_UDP, 1000 + (i % 7), 53, 0);
+    }
+    conversation_table_stats(0, &keys, &nconvs, &slots);
+    g_assert(keys == CONV_TEST_MANY && nconvs == CONV_TEST_MANY);
+    g_assert(slots >= CONV_TEST_MANY);
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        g_assert(find_conversation(CONV_TEST_MANY, &addrs[i], &addr_a, PT_UDP, 1000 + (i % 7), 53, 0) == convs[i]);
+        g_assert(find_conversation(CONV_TEST_MANY, &addr_a, &addrs[i], PT_UDP, 53, 1000 + (i % 7), 0) == convs[i]);
+    }
+
+    /*
+     * The first packets the other way fill in the port of TCP
+     * conversations, and their keys leave the table.
+     */
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        convs[i] = conversation_new(i + 1, &addrs[i], &addr_b, PT_TCP, 80, 0, NO_PORT2);
+    }
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        g_assert(find_conversation(CONV_TEST_MANY, &addr_b, &addrs[i], PT_TCP, 2000, 80, 0) == convs[i]);
+        g_assert(!(convs[i]->options & NO_PORT2));
+    }
+    conversation_table_stats(NO_PORT2, &keys, &nconvs, &slots);
+    g_assert(keys == 0 && nconvs == 0);
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        convs[i] = conversation_new(i + 1, &addrs[i], &addr_c, PT_TCP, 80, 0, NO_PORT2);
+    }
+    for (i = 0; i < CONV_TEST_MANY; i++) {
+        g_assert(find_conversation(CONV_TEST_MANY, &addrs[i], &addr_c, PT_TCP, 80, 0, NO_PORT_B) == convs[i]);
+    }
+    conversation_table_stats(NO_PORT2, &keys, &nconvs, &slots);
+    g_assert(keys == CONV_TEST_MANY && nconvs == CONV_TEST_MANY);
+
+    g_free(convs);
+    g_free(addrs);
+    g_free(ips);
+
+    conversation_test_end();
+}
+
+/* Protocol IDs for data attached to conversations */
+#define CONV_TEST_PROTO_EXPIRABLE 1
+#define CONV_TEST_PROTO_KEPT 2
+
+static guint expire_calls;
+
+static void
+conversation_test_expire_func(conversation_t *conv _U_, void *proto_data _U_)
+{
+    expire_calls++;
+}
+
+/* A conversation expires a whole idle timeout after it was last looked up */
+static void
+conversation_test_expire_idle(void)
+{
+    conversation_t *conv_a, *conv_c;
+    guint live, retired;
+    guint64 expired;
+
+    conversation_test_begin();
+    conversation_set_timeouts(10, 0);
+
+    conversation_set_current_time(100);
+    conv_a = conversation_new(1, &addr_a, &addr_b, PT_UDP, 1000, 53, 0);
+    conv_c = conversation_new(2, &addr_c, &addr_b, PT_UDP, 1000, 53, 0);
+    conversation_add_proto_data(conv_c, CONV_TEST_PROTO_EXPIRABLE, &expire_calls);
+
+    conversation_set_current_time(105);
+    g_assert(find_conversation(3, &addr_a, &addr_b, PT_UDP, 1000, 53, 0) == conv_a);
+
+    expire_calls = 0;
+    g_assert(conversation_expire(110) == 0);
+    g_assert(conversation_expire(111) == 1);
+    g_assert(expire_calls == 1);
+    g_assert(find_conversation(4, &addr_c, &addr_b, PT_UDP, 1000, 53, 0) == NULL);
+    conversation_expire_stats(&live, &retired, &expired);
+    g_assert(live == 1 && retired == 1 && expired == 1);
+
+    g_assert(conversation_expire(115) == 0);
+    g_assert(conversation_expire(116) == 1);
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_UDP, 1000, 53, 0) == NULL);
+
+    /* The first one has been retired for longer than the timeout */
+    g_assert(conversation_expire(122) == 0);
+    conversation_expire_stats(&live, &retired, &expired);
+    g_assert(live == 0 && retired == 1 && expired == 2);
+
+    conversation_test_end();
+}
+
+/* A conversation expires a whole age timeout after it was set up, in use or not */
+static void
+conversation_test_expire_age(void)
+{
+    conversation_t *conv;
+
+    conversation_test_begin();
+    conversation_set_timeouts(0, 10);
+
+    conversation_set_current_time(100);
+    conv = conversation_new(1, &addr_a, &addr_b, PT_TCP, 1000, 80, 0);
+
+    conversation_set_current_time(110);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == conv);
+    g_assert(conversation_expire(110) == 0);
+    g_assert(conversation_expire(111) == 1);
+    g_assert(find_conversation(3, &addr_a, &addr_b, PT_TCP, 1000, 80, 0) == NULL);
+
+    conversation_test_end();
+}
+
+/*
+ * A conversation with data of a protocol that can't have it expired is
+ * kept, and checked again a timeout later.
+ */
+static void
+conversation_test_expire_kept(void)
+{
+    conversation_t *conv;
+
+    conversation_test_begin();
+    conversation_set_timeouts(10, 0);
+
+    conversation_set_current_time(100);
+    conv = conversation_new(1, &addr_a, &addr_b, PT_UDP, 1000, 53, 0);
+    conversation_add_proto_data(conv, CONV_TEST_PROTO_KEPT, &expire_calls);
+
+    g_assert(conversation_expire(111) == 0);
+    conversation_set_current_time(111);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_UDP, 1000, 53, 0) == conv);
+
+    conversation_delete_proto_data(conv, CONV_TEST_PROTO_KEPT);
+    g_assert(conversation_expire(121) == 0);
+    g_assert(conversation_expire(122) == 1);
+
+    conversation_test_end();
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/conversation/lookup/exact", conversation_test_lookup_exact);
+    g_test_add_func("/conversation/lookup/direction", conversation_test_lookup_direction);
+    g_test_add_func("/conversation/lookup/setup_frame", conversation_test_lookup_setup_frame);
+    g_test_add_func("/conversation/lookup/long_address", conversation_test_lookup_long_address);
+    g_test_add_func("/conversation/wildcard/port2", conversation_test_wildcard_port2);
+    g_test_add_func("/conversation/wildcard/addr2", conversation_test_wildcard_addr2);
+    g_test_add_func("/conversation/wildcard/both", conversation_test_wildcard_both);
+    g_test_add_func("/conversation/resize", conversation_test_resize);
+    g_test_add_func("/conversation/expire/idle", conversation_test_expire_idle);
+    g_test_add_func("/conversation/expire/age", conversation_test_expire_age);
+    g_test_add_func("/conversation/expire/kept", conversation_test_expire_kept);
+
+    conversation_register_expire_callback(CONV_TEST_PROTO_EXPIRABLE, conversation_test_expire_func);
+
+    SET_ADDRESS(&addr_a, AT_IPv4, 4, ip_a);
+    SET_ADDRESS(&addr_b, AT_IPv4, 4, ip_b);
+    SET_ADDRESS(&addr_c, AT_IPv4, 4, ip_c);
+
+    emem_init();
+    wmem_init();
+    result = g_test_run();
+    wmem_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,485 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfilter-int.h"
+#include "dfvm.h"
+#include <epan/epan_dissect.h>
+#include <ftypes/ftypes-int.h>
+
+/*
+ * A group splices the programs of its dfilters into a single program,
+ * in which each filter ends with SET_RESULT instead of RETURN. The
+ * registers are renumbered so that the merged program has:
+ *
+ *	- one register per field, so that a field used by several
+ *	  filters is read from the proto_tree once per packet;
+ *	- one register per distinct constant;
+ *	- a private register for each range or function result.
+ *
+ * A test that appears in more than one filter - the existence of a
+ * field, or a comparison between a field and a constant - gets a memo
+ * slot, so that only the first filter that reaches it evaluates it.
+ *
+ * The merged instructions point at the fvalues, ranges, sets and
+ * functions of the original filters rather than copying them.
+ */
+
+struct epan_dfilter_group {
+	dfilter_t	*prog;
+};
+
+/* Constant registers are numbered from this until all filters are
+ * merged, and then moved after the other registers. */
+#define CONST_REGISTER	0x80000000U
+
+typedef struct {
+	dfilter_t	*prog;
+	GHashTable	*field_regs;	/* hfinfo -> register + 1 */
+	GHashTable	*const_regs;	/* constant key -> const index + 1 */
+	GHashTable	*tests;		/* test key -> test index + 1 */
+	GArray		*test_uses;	/* number of filters using each test */
+	GHashTable	*interesting_fields;
+	guint		next_register;
+	guint		next_const;
+	gboolean	compiled;	/* some filter went through dfvm_compile() */
+} group_build_t;
+
+static dfvm_value_t*
+borrow_value(const dfvm_value_t *v)
+{
+	dfvm_value_t	*copy;
+
+	if (!v)
+		return NULL;
+
+	copy = dfvm_value_new(v->type);
+	copy->value = v->value;
+	return copy;
+}
+
+/* Frees merged instructions, but not the values they borrowed. */
+static void
+free_borrowed_insns(GPtrArray *insns)
+{
+	guint		i;
+	dfvm_insn_t	*insn;
+
+	for (i = 0; i < insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(insns, i);
+		g_free(insn->arg1);
+		g_free(insn->arg2);
+		g_free(insn->arg3);
+		g_free(insn->arg4);
+		g_free(insn->needle);
+		g_free(insn);
+	}
+	g_ptr_array_free(insns, TRUE);
+}
+
+/* Returns a string that is the same for two constants only if they
+ * have the same type and value, or NULL if there is no such string. */
+static char*
+const_key(fvalue_t *fv)
+{
+	char	*repr, *key;
+
+	repr = fvalue_to_string_repr(fv, FTREPR_DFILTER, BASE_NONE, NULL);
+	if (!repr)
+		return NULL;
+
+	/* The netmask or prefix is not part of the representation */
+	switch (fvalue_type_ftenum(fv)) {
+		case FT_IPv4:
+			key = g_strdup_printf("%s %s/%08x", fvalue_type_name(fv),
+				repr, fv->value.ipv4.nmask);
+			break;
+		case FT_IPv6:
+			key = g_strdup_printf("%s %s/%u", fvalue_type_name(fv),
+				repr, fv->value.ipv6.prefix);
+			break;
+		default:
+			key = g_strdup_printf("%s %s", fvalue_type_name(fv), repr);
+			break;
+	}
+	g_free(repr);
+	return key;
+}
+
+/* Returns the register holding constant fv, sharing it with an equal
+ * constant of an earlier filter. */
+static guint
+group_const(group_build_t *gb, fvalue_t *fv)
+{
+	dfvm_insn_t	*insn;
+	fvalue_t	*other;
+	char		*key;
+	guint		idx;
+
+	key = const_key(fv);
+	if (key) {
+		idx = GPOINTER_TO_UINT(g_hash_table_lookup(gb->const_regs, key));
+		if (idx) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(gb->prog->consts, idx - 1);
+			other = insn->arg1->value.fvalue;
+			/* Don't trust the representation of inexact values */
+			if (!ftype_can_eq(fvalue_type_ftenum(fv)) || fvalue_eq(fv, other)) {
+				g_free(key);
+				return CONST_REGISTER + idx - 1;
+			}
+			g_free(key);
+			key = NULL;
+		}
+	}
+
+	idx = gb->next_const++;
+	insn = dfvm_insn_new(PUT_FVALUE);
+	insn->id = idx;
+	insn->arg1 = dfvm_value_new(FVALUE);
+	insn->arg1->value.fvalue = fv;
+	insn->arg2 = dfvm_value_new(REGISTER);
+	insn->arg2->value.numeric = CONST_REGISTER + idx;
+	g_ptr_array_add(gb->prog->consts, insn);
+
+	if (key)
+		g_hash_table_insert(gb->const_regs, key, GUINT_TO_POINTER(idx + 1));
+
+	return CONST_REGISTER + idx;
+}
+
+/* Returns the register that field hfinfo is read into. */
+static guint
+group_field(group_build_t *gb, header_field_info *hfinfo)
+{
+	guint	reg;
+
+	reg = GPOINTER_TO_UINT(g_hash_table_lookup(gb->field_regs, hfinfo));
+	if (reg)
+		return reg - 1;
+
+	reg = gb->next_register++;
+	g_hash_table_insert(gb->field_regs, hfinfo, GUINT_TO_POINTER(reg + 1));
+	return reg;
+}
+
+/* Gives insn the index of a test, if it is one that can be shared. */
+static void
+group_test(group_build_t *gb, dfvm_insn_t *insn, const gboolean *shared)
+{
+	char	*key;
+	guint	idx, uses;
+
+	switch (insn->op) {
+		case CHECK_EXISTS:
+			key = g_strdup_printf("%d %p", insn->op,
+				(void *)insn->arg1->value.hfinfo);
+			break;
+		case ANY_EQ:
+		case ANY_NE:
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+		case ANY_BITWISE_AND:
+		case ANY_CONTAINS:
+		case ANY_MATCHES:
+			if (!shared[0] || !shared[1])
+				return;
+			key = g_strdup_printf("%d %u %u", insn->op,
+				insn->arg1->value.numeric, insn->arg2->value.numeric);
+			break;
+		default:
+			return;
+	}
+
+	idx = GPOINTER_TO_UINT(g_hash_table_lookup(gb->tests, key));
+	if (idx) {
+		g_free(key);
+		idx--;
+		uses = g_array_index(gb->test_uses, guint, idx) + 1;
+		g_array_index(gb->test_uses, guint, idx) = uses;
+	}
+	else {
+		idx = gb->test_uses->len;
+		uses = 1;
+		g_array_append_val(gb->test_uses, uses);
+		g_hash_table_insert(gb->tests, key, GUINT_TO_POINTER(idx + 1));
+	}
+	insn->memo = idx;
+}
+
+/* Appends the program of df, which sets result bit n. */
+static void
+group_add(group_build_t *gb, const dfilter_t *df, guint n)
+{
+	guint		*regmap;
+	gboolean	*shared_reg;
+	gboolean	shared[2];
+	guint		base, i, j, reg;
+	dfvm_insn_t	*insn, *new_insn;
+	dfvm_value_t	*args[4], **new_args[4];
+
+	regmap = g_new(guint, df->max_registers);
+	shared_reg = g_new0(gboolean, df->max_registers);
+	for (i = 0; i < df->max_registers; i++)
+		regmap[i] = G_MAXUINT;
+
+	for (i = 0; i < df->consts->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, i);
+		reg = insn->arg2->value.numeric;
+		regmap[reg] = group_const(gb, insn->arg1->value.fvalue);
+		shared_reg[reg] = TRUE;
+	}
+
+	base = gb->prog->insns->len;
+	for (i = 0; i < df->insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+
+		if (insn->op == RETURN) {
+			new_insn = dfvm_insn_new(SET_RESULT);
+			new_insn->arg1 = dfvm_value_new(INTEGER);
+			new_insn->arg1->value.numeric = n;
+		}
+		else {
+			new_insn = dfvm_insn_new(insn->op);
+			args[0] = insn->arg1;
+			args[1] = insn->arg2;
+			args[2] = insn->arg3;
+			args[3] = insn->arg4;
+			new_args[0] = &new_insn->arg1;
+			new_args[1] = &new_insn->arg2;
+			new_args[2] = &new_insn->arg3;
+			new_args[3] = &new_insn->arg4;
+			shared[0] = shared[1] = FALSE;
+
+			for (j = 0; j < 4; j++) {
+				*new_args[j] = borrow_value(args[j]);
+				if (!args[j])
+					continue;
+
+				if (args[j]->type == INSN_NUMBER) {
+					(*new_args[j])->value.numeric += base;
+				}
+				else if (args[j]->type == REGISTER) {
+					reg = args[j]->value.numeric;
+					if (regmap[reg] == G_MAXUINT) {
+						if (insn->op == READ_TREE) {
+							regmap[reg] = group_field(gb,
+								insn->arg1->value.hfinfo);
+							shared_reg[reg] = TRUE;
+						}
+						else {
+							regmap[reg] = gb->next_register++;
+						}
+					}
+					(*new_args[j])->value.numeric = regmap[reg];
+					if (j < 2)
+						shared[j] = shared_reg[reg];
+				}
+			}
+			group_test(gb, new_insn, shared);
+		}
+
+		new_insn->id = gb->prog->insns->len;
+		g_ptr_array_add(gb->prog->insns, new_insn);
+	}
+
+	for (i = 0; i < (guint)df->num_interesting_fields; i++) {
+		g_hash_table_insert(gb->interesting_fields,
+			GINT_TO_POINTER(df->interesting_fields[i]),
+			GUINT_TO_POINTER(TRUE));
+	}
+
+	if (df->compiled)
+		gb->compiled = TRUE;
+
+	g_free(regmap);
+	g_free(shared_reg);
+}
+
+static void
+add_interesting_field(gpointer key, gpointer value _U_, gpointer user_data)
+{
+	dfilter_t	*prog = (dfilter_t *)user_data;
+
+	prog->interesting_fields[prog->num_interesting_fields++] =
+		GPOINTER_TO_INT(key);
+}
+
+/* Now that the number of registers is known, puts the constants after
+ * them, and keeps memo slots only for the tests that are shared. */
+static void
+group_finish(group_build_t *gb)
+{
+	dfilter_t	*prog = gb->prog;
+	GPtrArray	*lists[2];
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*args[4];
+	guint		*slots;
+	guint		i, j, k;
+
+	slots = g_new(guint, gb->test_uses->len);
+	for (i = 0; i < gb->test_uses->len; i++) {
+		if (g_array_index(gb->test_uses, guint, i) > 1)
+			slots[i] = prog->num_memos++;
+		else
+			slots[i] = G_MAXUINT;
+	}
+
+	lists[0] = prog->consts;
+	lists[1] = prog->insns;
+	for (k = 0; k < 2; k++) {
+		for (i = 0; i < lists[k]->len; i++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(lists[k], i);
+			args[0] = insn->arg1;
+			args[1] = insn->arg2;
+			args[2] = insn->arg3;
+			args[3] = insn->arg4;
+			for (j = 0; j < 4; j++) {
+				if (args[j] && args[j]->type == REGISTER &&
+				    args[j]->value.numeric >= CONST_REGISTER) {
+					args[j]->value.numeric += gb->next_register - CONST_REGISTER;
+				}
+			}
+			if (insn->memo >= 0) {
+				insn->memo = slots[insn->memo] == G_MAXUINT ?
+					-1 : (int)slots[insn->memo];
+			}
+		}
+	}
+	g_free(slots);
+
+	prog->num_registers = gb->next_register;
+	prog->max_registers = gb->next_register + gb->next_const;
+	prog->registers = g_new0(GList*, prog->max_registers);
+	prog->attempted_load = g_new0(gboolean, prog->max_registers);
+	prog->memos = g_new0(guint8, prog->num_memos);
+
+	prog->interesting_fields = g_new(int,
+		g_hash_table_size(gb->interesting_fields));
+	g_hash_table_foreach(gb->interesting_fields, add_interesting_field, prog);
+
+	dfvm_init_const(prog);
+	if (gb->compiled)
+		dfvm_compile(prog);
+}
+
+dfilter_group_t*
+dfilter_group_new(dfilter_t **dfilters, guint num_dfilters)
+{
+	dfilter_group_t	*group;
+	group_build_t	gb;
+	dfvm_insn_t	*insn;
+	guint		i;
+
+	group = g_new(dfilter_group_t, 1);
+	group->prog = g_new0(dfilter_t, 1);
+	group->prog->insns = g_ptr_array_new();
+	group->prog->consts = g_ptr_array_new();
+	group->prog->num_results = num_dfilters;
+	group->prog->results = g_new0(guint32, num_dfilters / 32 + 1);
+
+	gb.prog = group->prog;
+	gb.field_regs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	gb.const_regs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	gb.tests = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	gb.test_uses = g_array_new(FALSE, FALSE, sizeof(guint));
+	gb.interesting_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	gb.next_register = 0;
+	gb.next_const = 0;
+	gb.compiled = FALSE;
+
+	for (i = 0; i < num_dfilters; i++) {
+		if (dfilters[i])
+			group_add(&gb, dfilters[i], i);
+	}
+
+	insn = dfvm_insn_new(RETURN);
+	insn->id = group->prog->insns->len;
+	g_ptr_array_add(group->prog->insns, insn);
+
+	group_finish(&gb);
+
+	g_hash_table_destroy(gb.field_regs);
+	g_hash_table_destroy(gb.const_regs);
+	g_hash_table_destroy(gb.tests);
+	g_array_free(gb.test_uses, TRUE);
+	g_hash_table_destroy(gb.interesting_fields);
+
+	return group;
+}
+
+void
+dfilter_group_free(dfilter_group_t *group)
+{
+	if (!group)
+		return;
+
+	free_borrowed_insns(group->prog->insns);
+	free_borrowed_insns(group->prog->consts);
+	group->prog->insns = NULL;
+	group->prog->consts = NULL;
+	dfilter_free(group->prog);
+	g_free(group);
+}
+
+const guint32*
+dfilter_group_apply_edt(dfilter_group_t *group, epan_dissect_t *edt)
+{
+	dfilter_t	*prog = group->prog;
+
+	memset(prog->results, 0, (prog->num_results / 32 + 1) * sizeof(guint32));
+	prog->stop_at_match = FALSE;
+	dfvm_apply(prog, edt->tree);
+	return prog->results;
+}
+
+int
+dfilter_group_first_match_edt(dfilter_group_t *group, epan_dissect_t *edt)
+{
+	dfilter_t	*prog = group->prog;
+	guint		i;
+
+	memset(prog->results, 0, (prog->num_results / 32 + 1) * sizeof(guint32));
+	prog->stop_at_match = TRUE;
+	if (!dfvm_apply(prog, edt->tree))
+		return -1;
+
+	for (i = 0; i < prog->num_results; i++) {
+		if (DFILTER_GROUP_MATCHED(prog->results, i))
+			return i;
+	}
+	return -1;
+}
+
+void
+dfilter_group_prime_proto_tree(const dfilter_group_t *group, proto_tree *tree)
+{
+	dfilter_prime_proto_tree(group->prog, tree);
+}
+
+void
+dfilter_group_dump(dfilter_group_t *group)
+{
+	dfvm_dump(stdout, group->prog);
+}
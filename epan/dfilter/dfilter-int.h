@@ -38,6 +38,13 @@ struct epan_dfilter {
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	gboolean	compiled;	/* dfvm_compile() has been run */
+	/* Only used by the merged program of a dfilter_group_t */
+	guint8		*memos;
+	guint		num_memos;
+	guint32		*results;
+	guint		num_results;
+	gboolean	stop_at_match;
 };
 
 typedef struct {
@@ -21,12 +21,14 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "dfilter-int.h"
 #include "syntax-tree.h"
 #include "gencode.h"
 #include "semcheck.h"
+#include "optimize.h"
 #include "dfvm.h"
 #include <epan/epan_dissect.h>
 #include "dfilter.h"
@@ -46,6 +48,9 @@ int     df_lex(void);
 /* Holds the singular instance of our Lemon parser object */
 static void*	ParserObj = NULL;
 
+/* Don't compile filters; they are run by the interpreter */
+static gboolean	interpret_only = FALSE;
+
 void
 dfilter_fail(const char *format, ...)
 {
@@ -88,6 +93,8 @@ dfilter_init(void)
 	sttype_init();
 
 	dfilter_macro_init();
+
+	interpret_only = (getenv("WIRESHARK_DEBUG_DFILTER_INTERPRET") != NULL);
 }
 
 /* Clean-up the dfilter module */
@@ -164,6 +171,8 @@ dfilter_free(dfilter_t *df)
 
 	g_free(df->registers);
 	g_free(df->attempted_load);
+	g_free(df->memos);
+	g_free(df->results);
 	g_free(df);
 }
 
@@ -205,8 +214,8 @@ dfwork_free(dfwork_t *dfw)
 	g_free(dfw);
 }
 
-gboolean
-dfilter_compile(const gchar *text, dfilter_t **dfp)
+static gboolean
+compile_filter(const gchar *text, dfilter_t **dfp, gboolean optimize)
 {
 	int		token;
 	dfilter_t	*dfilter;
@@ -321,6 +330,10 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 			goto FAILURE;
 		}
 
+		/* Make it cheaper to run */
+		if (optimize)
+			dfw_optimize(dfw);
+
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
@@ -342,6 +355,10 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
 
+		/* Give each instruction its specialized function */
+		if (!interpret_only)
+			dfvm_compile(dfilter);
+
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
 
@@ -367,6 +384,18 @@ FAILURE:
 
 }
 
+gboolean
+dfilter_compile(const gchar *text, dfilter_t **dfp)
+{
+	return compile_filter(text, dfp, TRUE);
+}
+
+gboolean
+dfilter_compile_unoptimized(const gchar *text, dfilter_t **dfp)
+{
+	return compile_filter(text, dfp, FALSE);
+}
+
 
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
@@ -380,6 +409,12 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 	return dfvm_apply(df, edt->tree);
 }
 
+gboolean
+dfilter_apply_edt_interpreted(dfilter_t *df, epan_dissect_t* edt)
+{
+	return dfvm_interpret(df, edt->tree);
+}
+
 
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
@@ -391,6 +426,215 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
     }
 }
 
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields)
+{
+    *num_fields = df->num_interesting_fields;
+    return df->interesting_fields;
+}
+
+/* Characters that the scanner runs together into a field name or value,
+ * and so also into the "and" and "or" keywords. */
+static gboolean
+is_word_char(char c)
+{
+	return g_ascii_isalnum(c) || c == '-' || c == '+' || c == '_' ||
+		c == '.' || c == ':';
+}
+
+/* If text starts with an "and" or "or" token, returns its length and sets
+ * *is_and accordingly; otherwise returns 0. */
+static size_t
+logical_op_len(const char *text, gboolean *is_and)
+{
+	if (strncmp(text, "&&", 2) == 0 ||
+	    (strncmp(text, "and", 3) == 0 && !is_word_char(text[3]))) {
+		*is_and = TRUE;
+		return text[0] == '&' ? 2 : 3;
+	}
+	if (strncmp(text, "||", 2) == 0 ||
+	    (strncmp(text, "or", 2) == 0 && !is_word_char(text[2]))) {
+		*is_and = FALSE;
+		return 2;
+	}
+	return 0;
+}
+
+/* Looks for "and"s (or "or"s) in the text that aren't in parentheses or
+ * quoted strings, and sets *last to the last one, or to NULL if there are
+ * none, and *last_len to its length.  Returns FALSE if the text can't be
+ * scanned that way. */
+static gboolean
+find_outer_op(const char *text, gboolean want_and, const char **last,
+	      size_t *last_len)
+{
+	const char *p;
+	int depth = 0;
+	size_t len;
+	gboolean is_and;
+
+	*last = NULL;
+	*last_len = 0;
+	for (p = text; *p != '\0'; p++) {
+		if (*p == '"') {
+			for (p++; *p != '"'; p++) {
+				if (*p == '\\' && p[1] != '\0')
+					p++;
+				if (*p == '\0')
+					return FALSE;
+			}
+		} else if (*p == '(') {
+			depth++;
+		} else if (*p == ')') {
+			if (--depth < 0)
+				return FALSE;
+		} else if (depth == 0 &&
+			   (!is_word_char(*p) || p == text || !is_word_char(p[-1])) &&
+			   (len = logical_op_len(p, &is_and)) != 0) {
+			if (is_and == want_and) {
+				*last = p;
+				*last_len = len;
+			}
+			p += len - 1;
+		}
+	}
+	return depth == 0;
+}
+
+/* Does the text have an "and" that isn't in parentheses or a quoted
+ * string? When in doubt, says it does. */
+static gboolean
+has_outer_and(const char *text)
+{
+	const char *op;
+	size_t op_len;
+
+	return !find_outer_op(text, TRUE, &op, &op_len) || op != NULL;
+}
+
+/* "and" is the loosest-binding operator and is left-associative, so
+ * "old && rest" always means (old) && (rest), whatever old and rest are.
+ * "or" binds more tightly than "and", so "old || rest" only means
+ * (old) || (rest) if neither has an "and" of its own at the top level;
+ * but if only old has, appending "|| rest" still just loosens its last
+ * term, which is enough for the result to be a relaxation. */
+dfilter_relation_t
+dfilter_text_relation(const gchar *old_text, const gchar *new_text)
+{
+	size_t old_len, op_len;
+	const char *p;
+	gboolean is_and;
+
+	if (old_text == NULL)
+		old_text = "";
+	if (new_text == NULL)
+		new_text = "";
+	while (g_ascii_isspace(*old_text))
+		old_text++;
+	while (g_ascii_isspace(*new_text))
+		new_text++;
+	old_len = strlen(old_text);
+	while (old_len > 0 && g_ascii_isspace(old_text[old_len - 1]))
+		old_len--;
+
+	if (old_len == 0)
+		return DFILTER_UNRELATED;
+	if (*new_text == '\0')
+		return DFILTER_RELAXES;
+
+	/* A macro might not expand to what it did when old_text was applied. */
+	if (strchr(new_text, '$') != NULL)
+		return DFILTER_UNRELATED;
+
+	if (strncmp(new_text, old_text, old_len) != 0)
+		return DFILTER_UNRELATED;
+
+	p = new_text + old_len;
+	while (g_ascii_isspace(*p))
+		p++;
+	op_len = logical_op_len(p, &is_and);
+	if (op_len == 0)
+		return DFILTER_UNRELATED;
+	/* "tcp" followed by "and" with no space in between is one word. */
+	if (p == new_text + old_len && is_word_char(*p) && is_word_char(p[-1]))
+		return DFILTER_UNRELATED;
+
+	p += op_len;
+	while (g_ascii_isspace(*p))
+		p++;
+	if (*p == '\0')
+		return DFILTER_UNRELATED;
+
+	if (is_and)
+		return DFILTER_REFINES;
+	return has_outer_and(p) ? DFILTER_UNRELATED : DFILTER_RELAXES;
+}
+
+gchar *
+dfilter_text_normalize(const gchar *text)
+{
+	GString *str = g_string_sized_new(text ? strlen(text) : 0);
+	const char *p;
+	gboolean space = FALSE;
+
+	for (p = text ? text : ""; *p != '\0'; p++) {
+		if (g_ascii_isspace(*p)) {
+			space = TRUE;
+			continue;
+		}
+		if (space && str->len > 0)
+			g_string_append_c(str, ' ');
+		space = FALSE;
+		g_string_append_c(str, *p);
+		if (*p == '"') {
+			/* Copy quoted strings as they are */
+			for (p++; *p != '\0' && *p != '"'; p++) {
+				if (*p == '\\' && p[1] != '\0')
+					g_string_append_c(str, *p++);
+				g_string_append_c(str, *p);
+			}
+			if (*p == '\0')
+				break;
+			g_string_append_c(str, *p);
+		}
+	}
+	return g_string_free(str, FALSE);
+}
+
+/* As "and" binds more loosely than "or", and both are left-associative,
+ * a filter's last outer "and", if it has one, is the root of its syntax
+ * tree; if it doesn't, its last outer "or" is. */
+gboolean
+dfilter_text_split(const gchar *text, gboolean *is_and, gchar **left,
+		   gchar **right)
+{
+	const char *op;
+	size_t op_len;
+
+	if (text == NULL || strchr(text, '$') != NULL)
+		return FALSE;
+
+	if (!find_outer_op(text, TRUE, &op, &op_len))
+		return FALSE;
+	*is_and = (op != NULL);
+	if (op == NULL) {
+		find_outer_op(text, FALSE, &op, &op_len);
+		if (op == NULL)
+			return FALSE;
+	}
+
+	*left = g_strndup(text, op - text);
+	*right = g_strdup(op + op_len);
+	g_strstrip(*left);
+	g_strstrip(*right);
+	if (**left == '\0' || **right == '\0') {
+		g_free(*left);
+		g_free(*right);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -62,6 +62,12 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp);
 
+/* Same as dfilter_compile(), but without rearranging the filter to
+ * make it run faster; dftest uses it to show what the optimizer did. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_compile_unoptimized(const gchar *text, dfilter_t **dfp);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
@@ -86,10 +92,53 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* Apply compiled dfilter by interpreting its bytecode rather than
+ * running the functions it was compiled into. Slower; for debugging
+ * and for comparing the two. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_apply_edt_interpreted(dfilter_t *df, struct epan_dissect *edt);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 
+/* Returns the ids of the fields/protocols used in a dfilter, and sets
+ * *num_fields to how many there are. */
+WS_DLL_PUBLIC
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields);
+
+/* How a display filter relates to the one that was applied before it. */
+typedef enum {
+	DFILTER_UNRELATED,	/* can't tell; apply it to every packet */
+	DFILTER_REFINES,	/* "old && ...": passes a subset of what old did */
+	DFILTER_RELAXES		/* "old || ..." or none: passes a superset */
+} dfilter_relation_t;
+
+/* Tells from their text alone whether new_text is a refinement or a
+ * relaxation of old_text, so that only the packets that passed (or
+ * failed) old_text need to be tested again. Either may be NULL. */
+WS_DLL_PUBLIC
+dfilter_relation_t
+dfilter_text_relation(const gchar *old_text, const gchar *new_text);
+
+/* Returns a copy of a filter's text with leading and trailing white
+ * space removed, and other runs of it outside quoted strings replaced by
+ * a single space, so that it can be compared with other filters. */
+WS_DLL_PUBLIC
+gchar *
+dfilter_text_normalize(const gchar *text);
+
+/* If a filter is "left && right" or "left || right" at its top level,
+ * sets *is_and accordingly, sets *left and *right to newly-allocated
+ * copies of the operands' text, and returns TRUE. Returns FALSE if it
+ * isn't, or if it uses macros. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_text_split(const gchar *text, gboolean *is_and, gchar **left,
+		   gchar **right);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
@@ -99,6 +148,49 @@ WS_DLL_PUBLIC
 void
 dfilter_dump(dfilter_t *df);
 
+/* A group of compiled dfilters that are applied to the same packets,
+ * such as the coloring rules. The group evaluates all of them in one
+ * pass, reading each field only once and computing tests that several
+ * filters have in common only once. */
+typedef struct epan_dfilter_group dfilter_group_t;
+
+/* Builds a group out of an array of dfilters; NULL entries never match.
+ * The group refers to the dfilters, so they must not be freed before
+ * the group is. */
+WS_DLL_PUBLIC
+dfilter_group_t *
+dfilter_group_new(dfilter_t **dfilters, guint num_dfilters);
+
+WS_DLL_PUBLIC
+void
+dfilter_group_free(dfilter_group_t *group);
+
+/* Apply all of the filters in a group. Returns a bitmask in which
+ * DFILTER_GROUP_MATCHED() is TRUE for each filter that matched; it
+ * belongs to the group and is overwritten by the next call. */
+WS_DLL_PUBLIC
+const guint32 *
+dfilter_group_apply_edt(dfilter_group_t *group, struct epan_dissect *edt);
+
+#define DFILTER_GROUP_MATCHED(mask, i) \
+	(((mask)[(i) / 32] & (1U << ((i) % 32))) != 0)
+
+/* Apply the filters of a group in order and stop at the first one
+ * that matches. Returns its index, or -1 if none matched. */
+WS_DLL_PUBLIC
+int
+dfilter_group_first_match_edt(dfilter_group_t *group, struct epan_dissect *edt);
+
+/* Prime a proto_tree using the fields/protocols used in a group. */
+WS_DLL_PUBLIC
+void
+dfilter_group_prime_proto_tree(const dfilter_group_t *group, proto_tree *tree);
+
+/* Print the merged bytecode of a group to stdout */
+WS_DLL_PUBLIC
+void
+dfilter_group_dump(dfilter_group_t *group);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
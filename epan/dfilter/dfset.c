@@ -0,0 +1,450 @@
+/* dfset.c
+ * Constant sets for the display filter "in" operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfset.h"
+#include <ftypes/ftypes-int.h>
+
+typedef enum {
+	SET_LINEAR,		/* no hash; compare with fvalue_eq() */
+	SET_UINTEGER,
+	SET_BOOLEAN,
+	SET_INTEGER64,
+	SET_STRING,
+	SET_BYTES,
+	SET_IPv4,
+	SET_IPv6
+} set_kind_t;
+
+/* One node of the prefix trie; bit n of an address selects
+ * child[] at depth n. */
+typedef struct _prefix_node_t {
+	struct _prefix_node_t	*child[2];
+	gboolean		terminal;
+} prefix_node_t;
+
+struct _df_set_t {
+	set_kind_t	kind;
+	GPtrArray	*members;	/* every member, in order; owns them */
+	GHashTable	*exact;		/* members that match a single value */
+	prefix_node_t	*prefixes;	/* IPv4/IPv6 networks */
+};
+
+static set_kind_t
+set_kind(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			return SET_UINTEGER;
+
+		case FT_BOOLEAN:
+			return SET_BOOLEAN;
+
+		case FT_UINT64:
+		case FT_INT64:
+		case FT_EUI64:
+			return SET_INTEGER64;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return SET_STRING;
+
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_FCWWN:
+			return SET_BYTES;
+
+		case FT_IPv4:
+			return SET_IPv4;
+
+		case FT_IPv6:
+			return SET_IPv6;
+
+		default:
+			return SET_LINEAR;
+	}
+}
+
+static guint
+uinteger_hash(gconstpointer key)
+{
+	return ((const fvalue_t *)key)->value.uinteger;
+}
+
+static gboolean
+uinteger_equal(gconstpointer a, gconstpointer b)
+{
+	return ((const fvalue_t *)a)->value.uinteger ==
+		((const fvalue_t *)b)->value.uinteger;
+}
+
+/* Booleans compare as "zero" and "not zero", like bool_eq() does. */
+static guint
+boolean_hash(gconstpointer key)
+{
+	return ((const fvalue_t *)key)->value.uinteger != 0;
+}
+
+static gboolean
+boolean_equal(gconstpointer a, gconstpointer b)
+{
+	return (((const fvalue_t *)a)->value.uinteger != 0) ==
+		(((const fvalue_t *)b)->value.uinteger != 0);
+}
+
+static guint
+integer64_hash(gconstpointer key)
+{
+	guint64 val = ((const fvalue_t *)key)->value.integer64;
+
+	return (guint)(val ^ (val >> 32));
+}
+
+static gboolean
+integer64_equal(gconstpointer a, gconstpointer b)
+{
+	return ((const fvalue_t *)a)->value.integer64 ==
+		((const fvalue_t *)b)->value.integer64;
+}
+
+static guint
+string_hash(gconstpointer key)
+{
+	return g_str_hash(((const fvalue_t *)key)->value.string);
+}
+
+static gboolean
+string_equal(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const fvalue_t *)a)->value.string,
+		((const fvalue_t *)b)->value.string) == 0;
+}
+
+/* FNV-1a */
+static guint
+data_hash(const guint8 *data, guint len)
+{
+	guint32 hash = 2166136261U;
+	guint i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static guint
+bytes_hash(gconstpointer key)
+{
+	const GByteArray *bytes = ((const fvalue_t *)key)->value.bytes;
+
+	return data_hash(bytes->data, bytes->len);
+}
+
+static gboolean
+bytes_equal(gconstpointer a, gconstpointer b)
+{
+	const GByteArray *ba = ((const fvalue_t *)a)->value.bytes;
+	const GByteArray *bb = ((const fvalue_t *)b)->value.bytes;
+
+	return ba->len == bb->len && memcmp(ba->data, bb->data, ba->len) == 0;
+}
+
+static guint
+ipv4_hash(gconstpointer key)
+{
+	return ((const fvalue_t *)key)->value.ipv4.addr;
+}
+
+static gboolean
+ipv4_equal(gconstpointer a, gconstpointer b)
+{
+	return ((const fvalue_t *)a)->value.ipv4.addr ==
+		((const fvalue_t *)b)->value.ipv4.addr;
+}
+
+static guint
+ipv6_hash(gconstpointer key)
+{
+	return data_hash(((const fvalue_t *)key)->value.ipv6.addr.bytes, 16);
+}
+
+static gboolean
+ipv6_equal(gconstpointer a, gconstpointer b)
+{
+	return memcmp(((const fvalue_t *)a)->value.ipv6.addr.bytes,
+		((const fvalue_t *)b)->value.ipv6.addr.bytes, 16) == 0;
+}
+
+df_set_t *
+df_set_new(ftenum_t ftype)
+{
+	df_set_t	*set;
+
+	set = g_new0(df_set_t, 1);
+	set->kind = set_kind(ftype);
+	set->members = g_ptr_array_new();
+
+	switch (set->kind) {
+		case SET_UINTEGER:
+			set->exact = g_hash_table_new(uinteger_hash, uinteger_equal);
+			break;
+		case SET_BOOLEAN:
+			set->exact = g_hash_table_new(boolean_hash, boolean_equal);
+			break;
+		case SET_INTEGER64:
+			set->exact = g_hash_table_new(integer64_hash, integer64_equal);
+			break;
+		case SET_STRING:
+			set->exact = g_hash_table_new(string_hash, string_equal);
+			break;
+		case SET_BYTES:
+			set->exact = g_hash_table_new(bytes_hash, bytes_equal);
+			break;
+		case SET_IPv4:
+			set->exact = g_hash_table_new(ipv4_hash, ipv4_equal);
+			break;
+		case SET_IPv6:
+			set->exact = g_hash_table_new(ipv6_hash, ipv6_equal);
+			break;
+		case SET_LINEAR:
+			break;
+	}
+
+	return set;
+}
+
+static void
+prefix_free(prefix_node_t *node)
+{
+	if (node) {
+		prefix_free(node->child[0]);
+		prefix_free(node->child[1]);
+		g_free(node);
+	}
+}
+
+void
+df_set_free(df_set_t *set)
+{
+	guint		i;
+	fvalue_t	*fv;
+
+	for (i = 0; i < set->members->len; i++) {
+		fv = (fvalue_t *)g_ptr_array_index(set->members, i);
+		FVALUE_FREE(fv);
+	}
+	g_ptr_array_free(set->members, TRUE);
+	if (set->exact)
+		g_hash_table_destroy(set->exact);
+	prefix_free(set->prefixes);
+	g_free(set);
+}
+
+#define ADDR_BIT(addr, n)	(((addr)[(n) / 8] >> (7 - (n) % 8)) & 1)
+
+/* Add the network made up of the first "prefix" bits of "addr". */
+static void
+prefix_insert(df_set_t *set, const guint8 *addr, guint prefix)
+{
+	prefix_node_t	**node = &set->prefixes;
+	guint		i;
+
+	for (i = 0; ; i++) {
+		if (*node == NULL)
+			*node = g_new0(prefix_node_t, 1);
+		if (i == prefix) {
+			(*node)->terminal = TRUE;
+			return;
+		}
+		if ((*node)->terminal) {
+			/* Already covered by a shorter prefix */
+			return;
+		}
+		node = &(*node)->child[ADDR_BIT(addr, i)];
+	}
+}
+
+/* Is "addr" within any of the networks in the trie? */
+static gboolean
+prefix_lookup(const prefix_node_t *node, const guint8 *addr, guint bits)
+{
+	guint		i;
+
+	for (i = 0; node != NULL; i++) {
+		if (node->terminal)
+			return TRUE;
+		if (i == bits)
+			break;
+		node = node->child[ADDR_BIT(addr, i)];
+	}
+	return FALSE;
+}
+
+static void
+ipv4_to_bytes(guint32 addr, guint8 *bytes)
+{
+	bytes[0] = (guint8)(addr >> 24);
+	bytes[1] = (guint8)(addr >> 16);
+	bytes[2] = (guint8)(addr >> 8);
+	bytes[3] = (guint8)addr;
+}
+
+static guint
+ipv4_prefix_len(guint32 nmask)
+{
+	guint	len = 0;
+
+	while (len < 32 && (nmask & (0x80000000U >> len)))
+		len++;
+	return len;
+}
+
+void
+df_set_add(df_set_t *set, fvalue_t *fv)
+{
+	guint8		bytes[4];
+	guint		prefix;
+
+	g_ptr_array_add(set->members, fv);
+
+	if (set->kind != SET_LINEAR && set_kind(fv->ftype->ftype) != set->kind) {
+		/* The members don't all hash alike (say, a boolean field
+		 * compared with both "1" and "True", which becomes an
+		 * FT_UINT32); give up on the hash table and the trie. */
+		set->kind = SET_LINEAR;
+		g_hash_table_destroy(set->exact);
+		set->exact = NULL;
+		prefix_free(set->prefixes);
+		set->prefixes = NULL;
+	}
+
+	switch (set->kind) {
+		case SET_LINEAR:
+			break;
+
+		case SET_IPv4:
+			prefix = ipv4_prefix_len(fv->value.ipv4.nmask);
+			if (prefix < 32) {
+				ipv4_to_bytes(fv->value.ipv4.addr, bytes);
+				prefix_insert(set, bytes, prefix);
+			}
+			else {
+				g_hash_table_insert(set->exact, fv, fv);
+			}
+			break;
+
+		case SET_IPv6:
+			prefix = MIN(fv->value.ipv6.prefix, 128);
+			if (prefix < 128)
+				prefix_insert(set, fv->value.ipv6.addr.bytes, prefix);
+			else
+				g_hash_table_insert(set->exact, fv, fv);
+			break;
+
+		default:
+			g_hash_table_insert(set->exact, fv, fv);
+			break;
+	}
+}
+
+guint
+df_set_size(const df_set_t *set)
+{
+	return set->members->len;
+}
+
+fvalue_t *
+df_set_member(const df_set_t *set, guint n)
+{
+	return (fvalue_t *)g_ptr_array_index(set->members, n);
+}
+
+static gboolean
+linear_contains(const df_set_t *set, const fvalue_t *fv)
+{
+	guint		i;
+
+	for (i = 0; i < set->members->len; i++) {
+		if (fvalue_eq(fv, (fvalue_t *)g_ptr_array_index(set->members, i)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+df_set_contains(const df_set_t *set, const fvalue_t *fv)
+{
+	guint8		bytes[4];
+
+	/* Only a value that hashes like the members can be looked up;
+	 * anything else (e.g. an FT_BOOLEAN field against FT_UINT32
+	 * members) is compared the way "==" would compare it. */
+	if (set->kind == SET_LINEAR || set_kind(fv->ftype->ftype) != set->kind)
+		return linear_contains(set, fv);
+
+	switch (set->kind) {
+
+		case SET_IPv4:
+			/* A field value with a netmask of its own compares
+			 * under the shorter of the two masks. */
+			if (fv->value.ipv4.nmask != 0xffffffff)
+				return linear_contains(set, fv);
+			if (g_hash_table_lookup(set->exact, fv))
+				return TRUE;
+			ipv4_to_bytes(fv->value.ipv4.addr, bytes);
+			return prefix_lookup(set->prefixes, bytes, 32);
+
+		case SET_IPv6:
+			if (fv->value.ipv6.prefix < 128)
+				return linear_contains(set, fv);
+			if (g_hash_table_lookup(set->exact, fv))
+				return TRUE;
+			return prefix_lookup(set->prefixes,
+				fv->value.ipv6.addr.bytes, 128);
+
+		default:
+			return g_hash_table_lookup(set->exact, fv) != NULL;
+	}
+}
+
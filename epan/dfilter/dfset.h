@@ -0,0 +1,61 @@
+/* dfset.h
+ * Constant sets for the display filter "in" operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DFSET_H
+#define DFSET_H
+
+#include <glib.h>
+#include <ftypes/ftypes.h>
+
+/* A set of constant fvalues that can be asked whether it has a member
+ * that is "==" to a given fvalue.  Integers, strings, byte strings and
+ * host addresses are kept in a hash table; IPv4 and IPv6 networks in
+ * CIDR notation are kept in a binary trie, so the cost of a lookup
+ * doesn't depend on the number of members.  Members of other types
+ * are compared one by one. */
+typedef struct _df_set_t df_set_t;
+
+/* Create an empty set for members of type "ftype". */
+df_set_t *
+df_set_new(ftenum_t ftype);
+
+/* Free the set and the fvalues in it. */
+void
+df_set_free(df_set_t *set);
+
+/* Add a member; the set takes ownership of the fvalue. */
+void
+df_set_add(df_set_t *set, fvalue_t *fv);
+
+/* Number of members. */
+guint
+df_set_size(const df_set_t *set);
+
+/* Return the nth member, for dumping the set. */
+fvalue_t *
+df_set_member(const df_set_t *set, guint n);
+
+/* Is there a member that is equal to "fv", in the sense of fvalue_eq()? */
+gboolean
+df_set_contains(const df_set_t *set, const fvalue_t *fv);
+
+#endif
@@ -22,7 +22,10 @@
 
 #include "dfvm.h"
 
+#include <string.h>
+
 #include <ftypes/ftypes-int.h>
+#include <epan/exceptions.h>
 
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
@@ -35,6 +38,11 @@ dfvm_insn_new(dfvm_opcode_t op)
 	insn->arg2 = NULL;
 	insn->arg3 = NULL;
 	insn->arg4 = NULL;
+	insn->memo = -1;
+	insn->fn = NULL;
+	insn->cmp = NULL;
+	insn->cst = NULL;
+	insn->needle = NULL;
 	return insn;
 }
 
@@ -48,6 +56,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			df_set_free(v->value.set);
+			break;
 		default:
 			/* nothing */
 			;
@@ -70,6 +81,7 @@ dfvm_insn_free(dfvm_insn_t *insn)
 	if (insn->arg4) {
 		dfvm_value_free(insn->arg4);
 	}
+	g_free(insn->needle);
 	g_free(insn);
 }
 
@@ -130,8 +142,10 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
+			case SET_RESULT:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -264,6 +278,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				fprintf(f, "%05d ANY_IN\t\treg#%u in {%u values}\n",
+					id, arg1->value.numeric,
+					df_set_size(arg2->value.set));
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -272,6 +292,11 @@ dfvm_dump(FILE *f, dfilter_t *df)
 				fprintf(f, "%05d RETURN\n", id);
 				break;
 
+			case SET_RESULT:
+				fprintf(f, "%05d SET_RESULT\t#%u\n",
+						id, arg1->value.numeric);
+				break;
+
 			case IF_TRUE_GOTO:
 				fprintf(f, "%05d IF-TRUE-GOTO\t%d\n",
 						id, arg1->value.numeric);
@@ -325,6 +350,8 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 		len = finfos->len;
 		for (i = 0; i < len; i++) {
 			finfo = (field_info *)g_ptr_array_index(finfos, i);
+			/* The tests look at the values directly */
+			fvalue_materialize(&finfo->value);
 			fvalues = g_list_prepend(fvalues, &finfo->value);
 		}
 
@@ -347,7 +374,10 @@ put_fvalue(dfilter_t *df, fvalue_t *fv, int reg)
 	return TRUE;
 }
 
-typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
+/* States of a memo slot during one run */
+#define MEMO_UNKNOWN	0
+#define MEMO_FALSE	1
+#define MEMO_TRUE	2
 
 static gboolean
 any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
@@ -370,6 +400,21 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 }
 
 
+/* Does any of the fvalues in the register equal a member of the set? */
+static gboolean
+any_in(dfilter_t *df, int reg, const df_set_t *set)
+{
+	GList	*list;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (df_set_contains(set, (fvalue_t *)list->data)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
 /* Free the list nodes w/o freeing the memory that each
  * list node points to. */
 static void
@@ -384,6 +429,9 @@ free_register_overhead(dfilter_t* df)
 			df->registers[i] = NULL;
 		}
 	}
+	if (df->num_memos) {
+		memset(df->memos, MEMO_UNKNOWN, df->num_memos);
+	}
 }
 
 /* Takes the list of fvalue_t's in a register, uses fvalue_slice()
@@ -415,8 +463,10 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 
+/* Runs the program one instruction at a time, without the functions
+ * set up by dfvm_compile(). */
 gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+dfvm_interpret(dfilter_t *df, proto_tree *tree)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -440,6 +490,12 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 		arg1 = insn->arg1;
 		arg2 = insn->arg2;
 
+		/* Already computed for another filter of the group? */
+		if (insn->memo >= 0 && df->memos[insn->memo] != MEMO_UNKNOWN) {
+			accum = df->memos[insn->memo] == MEMO_TRUE;
+			continue;
+		}
+
 		switch (insn->op) {
 			case CHECK_EXISTS:
 				hfinfo = arg1->value.hfinfo;
@@ -527,6 +583,11 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				accum = any_in(df, arg1->value.numeric,
+						arg2->value.set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -535,6 +596,17 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				free_register_overhead(df);
 				return accum;
 
+			case SET_RESULT:
+				if (accum) {
+					df->results[arg1->value.numeric / 32] |=
+						1U << (arg1->value.numeric % 32);
+					if (df->stop_at_match) {
+						free_register_overhead(df);
+						return TRUE;
+					}
+				}
+				break;
+
 			case IF_TRUE_GOTO:
 				if (accum) {
 					id = arg1->value.numeric;
@@ -561,6 +633,10 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				g_assert_not_reached();
 				break;
 		}
+
+		if (insn->memo >= 0) {
+			df->memos[insn->memo] = accum ? MEMO_TRUE : MEMO_FALSE;
+		}
 	}
 
 	g_assert_not_reached();
@@ -601,8 +677,10 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
+			case SET_RESULT:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -613,3 +691,405 @@ dfvm_init_const(dfilter_t *df)
 
 	return;
 }
+
+/*
+ * Threaded code. dfvm_compile() gives each instruction a function that
+ * does only what that instruction needs, so that running a filter is a
+ * chain of calls rather than a trip through the switch in
+ * dfvm_interpret() for every instruction. A test against a constant of
+ * one of the common types is compiled into a function that compares
+ * the values inline instead of going through fvalue_eq() and friends.
+ */
+
+static int
+fn_check_exists(dfilter_t *df _U_, proto_tree *tree, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	header_field_info	*hfinfo;
+
+	for (hfinfo = insn->arg1->value.hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (proto_check_for_protocol_or_field(tree, hfinfo->id)) {
+			*accum = TRUE;
+			return insn->id + 1;
+		}
+	}
+	*accum = FALSE;
+	return insn->id + 1;
+}
+
+static int
+fn_read_tree(dfilter_t *df, proto_tree *tree, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	*accum = read_tree(df, tree, insn->arg1->value.hfinfo,
+			insn->arg2->value.numeric);
+	return insn->id + 1;
+}
+
+static int
+fn_call_function(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	GList	*param1 = NULL;
+	GList	*param2 = NULL;
+
+	if (insn->arg3) {
+		param1 = df->registers[insn->arg3->value.numeric];
+	}
+	if (insn->arg4) {
+		param2 = df->registers[insn->arg4->value.numeric];
+	}
+	*accum = insn->arg1->value.funcdef->function(param1, param2,
+			&df->registers[insn->arg2->value.numeric]);
+	return insn->id + 1;
+}
+
+static int
+fn_mk_range(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum _U_)
+{
+	mk_range(df, insn->arg1->value.numeric, insn->arg2->value.numeric,
+			insn->arg3->value.drange);
+	return insn->id + 1;
+}
+
+static int
+fn_any_test(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	*accum = any_test(df, insn->cmp, insn->arg1->value.numeric,
+			insn->arg2->value.numeric);
+	return insn->id + 1;
+}
+
+static int
+fn_any_in(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	*accum = any_in(df, insn->arg1->value.numeric, insn->arg2->value.set);
+	return insn->id + 1;
+}
+
+static int
+fn_not(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	*accum = !*accum;
+	return insn->id + 1;
+}
+
+static int
+fn_return(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn _U_,
+		gboolean *accum _U_)
+{
+	free_register_overhead(df);
+	return -1;
+}
+
+static int
+fn_set_result(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	if (*accum) {
+		df->results[insn->arg1->value.numeric / 32] |=
+			1U << (insn->arg1->value.numeric % 32);
+		if (df->stop_at_match) {
+			free_register_overhead(df);
+			return -1;
+		}
+	}
+	return insn->id + 1;
+}
+
+static int
+fn_if_true_goto(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	return *accum ? (int)insn->arg1->value.numeric : insn->id + 1;
+}
+
+static int
+fn_if_false_goto(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_insn_t *insn,
+		gboolean *accum)
+{
+	return *accum ? insn->id + 1 : (int)insn->arg1->value.numeric;
+}
+
+/* Same as the FT_PROTOCOL cmp_contains(), with the needle prepared
+ * beforehand. */
+static gboolean
+tvb_contains_needle(tvbuff_t *tvb, const ws_memmem_pattern_t *needle)
+{
+	volatile gboolean	found = FALSE;
+	guint			len;
+
+	TRY {
+		len = tvb_length(tvb);
+		if (len > 0 && ws_memmem_exec(needle,
+				tvb_get_ptr(tvb, 0, len), len) != NULL) {
+			found = TRUE;
+		}
+	}
+	CATCH_ALL {
+		/* nothing */
+	}
+	ENDTRY;
+
+	return found;
+}
+
+/* Defines a test of a register against the constant insn->cst, where
+ * "a" is a value from the register and "b" the constant, both known to
+ * be of the constant's type. A value of another type (from a field that
+ * shares its name with a field of a different type) is compared with
+ * the generic function instead. */
+#define CONSTANT_TEST(name, test) \
+static int \
+name(dfilter_t *df, proto_tree *tree _U_, const dfvm_insn_t *insn, \
+		gboolean *accum) \
+{ \
+	const fvalue_t	*a; \
+	const fvalue_t	*b = insn->cst; \
+	GList		*list; \
+\
+	for (list = df->registers[insn->arg1->value.numeric]; list; \
+			list = g_list_next(list)) { \
+		a = (const fvalue_t *)list->data; \
+		if (a->ftype == b->ftype ? (test) : insn->cmp(a, b)) { \
+			*accum = TRUE; \
+			return insn->id + 1; \
+		} \
+	} \
+	*accum = FALSE; \
+	return insn->id + 1; \
+}
+
+CONSTANT_TEST(fn_integer_eq, a->value.uinteger == b->value.uinteger)
+CONSTANT_TEST(fn_integer_ne, a->value.uinteger != b->value.uinteger)
+CONSTANT_TEST(fn_integer_bitwise_and, (a->value.uinteger & b->value.uinteger) != 0)
+CONSTANT_TEST(fn_uinteger_gt, a->value.uinteger > b->value.uinteger)
+CONSTANT_TEST(fn_uinteger_ge, a->value.uinteger >= b->value.uinteger)
+CONSTANT_TEST(fn_uinteger_lt, a->value.uinteger < b->value.uinteger)
+CONSTANT_TEST(fn_uinteger_le, a->value.uinteger <= b->value.uinteger)
+CONSTANT_TEST(fn_sinteger_gt, a->value.sinteger > b->value.sinteger)
+CONSTANT_TEST(fn_sinteger_ge, a->value.sinteger >= b->value.sinteger)
+CONSTANT_TEST(fn_sinteger_lt, a->value.sinteger < b->value.sinteger)
+CONSTANT_TEST(fn_sinteger_le, a->value.sinteger <= b->value.sinteger)
+/* Same as ipv4_addr_eq() */
+CONSTANT_TEST(fn_ipv4_eq, ((a->value.ipv4.addr ^ b->value.ipv4.addr) &
+	MIN(a->value.ipv4.nmask, b->value.ipv4.nmask)) == 0)
+/* Most byte strings that differ already do so in length or first byte */
+CONSTANT_TEST(fn_bytes_eq, a->value.bytes->len == b->value.bytes->len &&
+	(a->value.bytes->len == 0 ||
+	 (a->value.bytes->data[0] == b->value.bytes->data[0] &&
+	  memcmp(a->value.bytes->data, b->value.bytes->data, a->value.bytes->len) == 0)))
+CONSTANT_TEST(fn_bytes_contains, ws_memmem_exec(insn->needle,
+	a->value.bytes->data, a->value.bytes->len) != NULL)
+CONSTANT_TEST(fn_string_contains, ws_memmem_exec(insn->needle,
+	(const guint8 *)a->value.string, strlen(a->value.string)) != NULL)
+CONSTANT_TEST(fn_protocol_contains, tvb_contains_needle(a->value.tvb,
+	insn->needle))
+
+/* Returns the specialized function for comparing with a constant of
+ * type ftype, or NULL if there is none. */
+static dfvm_insn_fn
+constant_test_fn(dfvm_opcode_t op, ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			switch (op) {
+				case ANY_EQ:		return fn_integer_eq;
+				case ANY_NE:		return fn_integer_ne;
+				case ANY_GT:		return fn_uinteger_gt;
+				case ANY_GE:		return fn_uinteger_ge;
+				case ANY_LT:		return fn_uinteger_lt;
+				case ANY_LE:		return fn_uinteger_le;
+				case ANY_BITWISE_AND:	return fn_integer_bitwise_and;
+				default:		return NULL;
+			}
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			switch (op) {
+				case ANY_EQ:		return fn_integer_eq;
+				case ANY_NE:		return fn_integer_ne;
+				case ANY_GT:		return fn_sinteger_gt;
+				case ANY_GE:		return fn_sinteger_ge;
+				case ANY_LT:		return fn_sinteger_lt;
+				case ANY_LE:		return fn_sinteger_le;
+				case ANY_BITWISE_AND:	return fn_integer_bitwise_and;
+				default:		return NULL;
+			}
+
+		case FT_IPv4:
+			return op == ANY_EQ ? fn_ipv4_eq : NULL;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_ETHER:
+			switch (op) {
+				case ANY_EQ:		return fn_bytes_eq;
+				case ANY_CONTAINS:	return fn_bytes_contains;
+				default:		return NULL;
+			}
+
+		case FT_AX25:
+		case FT_VINES:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return op == ANY_CONTAINS ? fn_bytes_contains : NULL;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return op == ANY_CONTAINS ? fn_string_contains : NULL;
+
+		case FT_PROTOCOL:
+			return op == ANY_CONTAINS ? fn_protocol_contains : NULL;
+
+		default:
+			return NULL;
+	}
+}
+
+/* Prepares the constant of a "contains" test with a specialized
+ * function, so that looking for it needn't start from scratch in
+ * every value. The needle borrows the constant's data. */
+static ws_memmem_pattern_t *
+needle_new(const fvalue_t *fv)
+{
+	ws_memmem_pattern_t	*needle;
+	const guint8		*data = NULL;
+	guint			len;
+
+	needle = g_new(ws_memmem_pattern_t, 1);
+	switch (fv->ftype->ftype) {
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			ws_memmem_compile(needle, (const guint8 *)fv->value.string,
+					strlen(fv->value.string));
+			break;
+
+		case FT_PROTOCOL:
+			len = tvb_length(fv->value.tvb);
+			if (len > 0)
+				data = tvb_get_ptr(fv->value.tvb, 0, len);
+			ws_memmem_compile(needle, data, len);
+			break;
+
+		default:
+			ws_memmem_compile(needle, fv->value.bytes->data,
+					fv->value.bytes->len);
+			break;
+	}
+	return needle;
+}
+
+/* Chooses the function for every instruction of df. Must be called
+ * after dfvm_init_const(), as it looks at the values of the constants. */
+void
+dfvm_compile(dfilter_t *df)
+{
+	guint		id, reg;
+	dfvm_insn_t	*insn;
+	dfvm_insn_fn	specialized;
+
+	for (id = 0; id < df->insns->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		insn->id = id;
+
+		switch (insn->op) {
+			case CHECK_EXISTS:	insn->fn = fn_check_exists;	break;
+			case READ_TREE:		insn->fn = fn_read_tree;	break;
+			case CALL_FUNCTION:	insn->fn = fn_call_function;	break;
+			case MK_RANGE:		insn->fn = fn_mk_range;		break;
+			case ANY_IN:		insn->fn = fn_any_in;		break;
+			case NOT:		insn->fn = fn_not;		break;
+			case RETURN:		insn->fn = fn_return;		break;
+			case SET_RESULT:	insn->fn = fn_set_result;	break;
+			case IF_TRUE_GOTO:	insn->fn = fn_if_true_goto;	break;
+			case IF_FALSE_GOTO:	insn->fn = fn_if_false_goto;	break;
+
+			case ANY_EQ:		insn->cmp = fvalue_eq;		break;
+			case ANY_NE:		insn->cmp = fvalue_ne;		break;
+			case ANY_GT:		insn->cmp = fvalue_gt;		break;
+			case ANY_GE:		insn->cmp = fvalue_ge;		break;
+			case ANY_LT:		insn->cmp = fvalue_lt;		break;
+			case ANY_LE:		insn->cmp = fvalue_le;		break;
+			case ANY_BITWISE_AND:	insn->cmp = fvalue_bitwise_and;	break;
+			case ANY_CONTAINS:	insn->cmp = fvalue_contains;	break;
+			case ANY_MATCHES:	insn->cmp = fvalue_matches;	break;
+
+			case PUT_FVALUE:
+			default:
+				g_assert_not_reached();
+				break;
+		}
+
+		if (insn->cmp) {
+			insn->fn = fn_any_test;
+
+			/* Is the second operand a constant? */
+			reg = insn->arg2->value.numeric;
+			if (reg >= df->num_registers && df->registers[reg] &&
+			    !g_list_next(df->registers[reg])) {
+				insn->cst = (const fvalue_t *)df->registers[reg]->data;
+				specialized = constant_test_fn(insn->op,
+						insn->cst->ftype->ftype);
+				if (specialized)
+					insn->fn = specialized;
+				if (specialized && insn->op == ANY_CONTAINS)
+					insn->needle = needle_new(insn->cst);
+			}
+		}
+	}
+
+	df->compiled = TRUE;
+}
+
+/* Runs the program through the functions set up by dfvm_compile(),
+ * or with the interpreter if there is none. */
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	dfvm_insn_t	**insns;
+	dfvm_insn_t	*insn;
+	gboolean	accum = TRUE;
+	int		id = 0;
+
+	if (!df->compiled)
+		return dfvm_interpret(df, tree);
+
+	g_assert(tree);
+
+	insns = (dfvm_insn_t **)df->insns->pdata;
+	do {
+		insn = insns[id];
+		if (insn->memo < 0) {
+			id = insn->fn(df, tree, insn, &accum);
+		}
+		else if (df->memos[insn->memo] != MEMO_UNKNOWN) {
+			/* Already computed for another filter of the group */
+			accum = df->memos[insn->memo] == MEMO_TRUE;
+			id++;
+		}
+		else {
+			id = insn->fn(df, tree, insn, &accum);
+			df->memos[insn->memo] = accum ? MEMO_TRUE : MEMO_FALSE;
+		}
+	} while (id >= 0);
+
+	return accum;
+}
@@ -23,10 +23,12 @@
 
 #include <stdio.h>
 #include <epan/proto.h>
+#include <wsutil/ws_memmem.h>
 #include "dfilter-int.h"
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "dfset.h"
 
 typedef enum {
 	EMPTY,
@@ -36,7 +38,8 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET
 } dfvm_value_type_t;
 
 typedef struct {
@@ -48,6 +51,7 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		df_set_t		*set;
 	} value;
 
 } dfvm_value_t;
@@ -71,18 +75,37 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_IN,
 	MK_RANGE,
-    CALL_FUNCTION
+    CALL_FUNCTION,
+	SET_RESULT
 
 } dfvm_opcode_t;
 
-typedef struct {
+struct _dfvm_insn_t;
+
+/* Code for one instruction, chosen by dfvm_compile(). Returns
+ * the index of the next instruction to run, or -1 if the program is
+ * done and *accum holds its result. */
+typedef int (*dfvm_insn_fn)(dfilter_t *df, proto_tree *tree,
+		const struct _dfvm_insn_t *insn, gboolean *accum);
+
+typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
+
+typedef struct _dfvm_insn_t {
 	int		id;
 	dfvm_opcode_t	op;
 	dfvm_value_t	*arg1;
 	dfvm_value_t	*arg2;
 	dfvm_value_t	*arg3;
 	dfvm_value_t	*arg4;
+	int		memo;	/* slot remembering the result, or -1 */
+
+	/* Set by dfvm_compile() */
+	dfvm_insn_fn	fn;
+	FvalueCmpFunc	cmp;	/* for ANY_* tests */
+	const fvalue_t	*cst;	/* constant 2nd operand of a test, or NULL */
+	ws_memmem_pattern_t *needle;	/* cst prepared for ANY_CONTAINS */
 } dfvm_insn_t;
 
 dfvm_insn_t*
@@ -100,6 +123,12 @@ dfvm_dump(FILE *f, dfilter_t *df);
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree);
 
+gboolean
+dfvm_interpret(dfilter_t *df, proto_tree *tree);
+
+void
+dfvm_compile(dfilter_t *df);
+
 void
 dfvm_init_const(dfilter_t *df);
 
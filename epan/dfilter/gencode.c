@@ -27,6 +27,8 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
+#include "dfset.h"
 #include "ftypes/ftypes.h"
 
 static void
@@ -277,6 +279,43 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	}
 }
 
+static void
+gen_set_membership(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp = NULL;
+	df_set_t	*set = NULL;
+	GSList		*members;
+	fvalue_t	*fv;
+	int		reg;
+
+	reg = gen_entity(dfw, st_arg1, &jmp);
+
+	/* The members were all turned into fvalues by semcheck;
+	 * the set takes them over, the same way PUT_FVALUE does. */
+	for (members = sttype_set_members(st_arg2); members; members = members->next) {
+		fv = (fvalue_t *)stnode_data((stnode_t *)members->data);
+		if (!set) {
+			set = df_set_new(fvalue_type_ftenum(fv));
+		}
+		df_set_add(set, fv);
+	}
+
+	insn = dfvm_insn_new(ANY_IN);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg;
+	val2 = dfvm_value_new(FVALUE_SET);
+	val2->value.set = set;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp) {
+		jmp->value.numeric = dfw->next_insn_id;
+	}
+}
+
 /* Parse an entity, returning the reg that it gets put into.
  * p_jmp will be set if it has to be set by the calling code; it should
  * be set to the place to jump to, to return to the calling code,
@@ -422,6 +461,10 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 		case TEST_OP_MATCHES:
 			gen_relation(dfw, ANY_MATCHES, st_arg1, st_arg2);
 			break;
+
+		case TEST_OP_IN:
+			gen_set_membership(dfw, st_arg1, st_arg2);
+			break;
 	}
 }
 
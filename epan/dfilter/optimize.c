@@ -0,0 +1,386 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "dfilter-int.h"
+#include "optimize.h"
+#include "syntax-tree.h"
+#include "sttype-range.h"
+#include "sttype-test.h"
+#include "sttype-function.h"
+#include "sttype-set.h"
+
+/*
+ * The optimizer runs between semcheck and gencode, so all of the
+ * constants in the tree have already been turned into fvalues.  It
+ * does three things:
+ *
+ *  - "not not x" is folded into "x";
+ *  - within a chain of "or"s, the "field == constant" and "field in {...}"
+ *    tests of one field are merged into a single "in" test, so that the
+ *    field is read and compared once;
+ *  - the operands of a chain of "and"s or of "or"s are put in order of
+ *    their estimated cost, so that cheap tests (most of all, checking
+ *    whether a protocol is present at all) can short-circuit the
+ *    expensive ones.
+ *
+ * None of the tests has side effects, so any order gives the same result.
+ */
+
+/* Rough relative costs, used only to order tests. */
+#define COST_EXISTS	1	/* proto_check_for_protocol_or_field() */
+#define COST_READ	2	/* READ_TREE of a field */
+#define COST_COMPARE	1	/* ANY_EQ and friends, ANY_IN */
+#define COST_SLICE	2	/* MK_RANGE */
+#define COST_CONTAINS	4
+#define COST_FUNCTION	4
+#define COST_MATCHES	16
+
+typedef struct {
+	stnode_t	*node;
+	int		cost;
+	guint		pos;		/* original position, to keep the sort stable */
+} operand_t;
+
+typedef struct {
+	stnode_t	*test;		/* the test the others are merged into */
+	GSList		*members;	/* members merged into it, last first */
+} merge_t;
+
+static stnode_t *
+optimize(stnode_t *node);
+
+static int
+entity_cost(stnode_t *node)
+{
+	GSList		*params;
+	int		cost;
+
+	switch (stnode_type_id(node)) {
+		case STTYPE_FIELD:
+			return COST_READ;
+		case STTYPE_RANGE:
+			return entity_cost(sttype_range_entity(node)) + COST_SLICE;
+		case STTYPE_FUNCTION:
+			cost = COST_FUNCTION;
+			for (params = sttype_function_params(node); params; params = params->next) {
+				cost += entity_cost((stnode_t *)params->data);
+			}
+			return cost;
+		default:
+			/* Constants are loaded once, before the filter runs */
+			return 0;
+	}
+}
+
+static gboolean
+is_test(stnode_t *node, test_op_t op)
+{
+	test_op_t	node_op;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return FALSE;
+	sttype_test_get(node, &node_op, NULL, NULL);
+	return node_op == op;
+}
+
+static int
+test_cost(stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*val1, *val2;
+	int		cost = 0;
+
+	sttype_test_get(node, &op, &val1, &val2);
+
+	/* Chains are left-deep; walk down them iteratively. */
+	while (op == TEST_OP_AND || op == TEST_OP_OR) {
+		cost += test_cost(val2);
+		sttype_test_get(val1, &op, &val1, &val2);
+	}
+
+	switch (op) {
+		case TEST_OP_EXISTS:
+			return cost + COST_EXISTS;
+		case TEST_OP_NOT:
+			return cost + test_cost(val1);
+		case TEST_OP_CONTAINS:
+			return cost + entity_cost(val1) + entity_cost(val2) + COST_CONTAINS;
+		case TEST_OP_MATCHES:
+			return cost + entity_cost(val1) + entity_cost(val2) + COST_MATCHES;
+		default:
+			return cost + entity_cost(val1) + entity_cost(val2) + COST_COMPARE;
+	}
+}
+
+/* Take apart a chain of tests joined by "op", putting the operands into
+ * "operands" from left to right and freeing the "op" nodes.  The parser
+ * builds long chains left-deep, so walk down the left side iteratively. */
+static void
+collect_operands(stnode_t *node, test_op_t op, GPtrArray *operands)
+{
+	GPtrArray	*rights;
+	stnode_t	*left, *right;
+	guint		i;
+
+	rights = g_ptr_array_new();
+
+	while (is_test(node, op)) {
+		sttype_test_get(node, NULL, &left, &right);
+		sttype_test_set2_args(node, NULL, NULL);
+		stnode_free(node);
+		g_ptr_array_add(rights, right);
+		node = left;
+	}
+	g_ptr_array_add(operands, node);
+
+	for (i = rights->len; i > 0; i--) {
+		collect_operands((stnode_t *)g_ptr_array_index(rights, i - 1),
+				op, operands);
+	}
+	g_ptr_array_free(rights, TRUE);
+}
+
+/* If "node" is "field == constant" or "field in {...}", return the
+ * first field of the field's name (the one gencode reads). */
+static header_field_info *
+membership_field(stnode_t *node)
+{
+	test_op_t		op;
+	stnode_t		*val1, *val2;
+	header_field_info	*hfinfo;
+
+	if (stnode_type_id(node) != STTYPE_TEST)
+		return NULL;
+
+	sttype_test_get(node, &op, &val1, &val2);
+	if (op == TEST_OP_EQ) {
+		if (stnode_type_id(val2) != STTYPE_FVALUE)
+			return NULL;
+	}
+	else if (op != TEST_OP_IN) {
+		return NULL;
+	}
+	if (stnode_type_id(val1) != STTYPE_FIELD)
+		return NULL;
+
+	hfinfo = (header_field_info *)stnode_data(val1);
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+	return hfinfo;
+}
+
+/* Free a "field == constant" or "field in {...}" test, handing back
+ * its constants. */
+static GSList *
+take_members(stnode_t *node, GSList *members)
+{
+	test_op_t	op;
+	stnode_t	*field, *value;
+	GSList		*set_members, *l;
+
+	sttype_test_get(node, &op, &field, &value);
+	sttype_test_set2_args(node, NULL, NULL);
+	stnode_free(node);
+	stnode_free(field);
+
+	if (op == TEST_OP_EQ)
+		return g_slist_prepend(members, value);
+
+	set_members = sttype_set_members(value);
+	sttype_set_set_members(value, NULL);
+	stnode_free(value);
+
+	for (l = set_members; l; l = l->next) {
+		members = g_slist_prepend(members, l->data);
+	}
+	g_slist_free(set_members);
+	return members;
+}
+
+/* Turn "field == a" (or "field in {a}") into "field in {a ...}". */
+static void
+add_members(stnode_t *node, GSList *members)
+{
+	test_op_t	op;
+	stnode_t	*field, *value, *set;
+
+	sttype_test_get(node, &op, &field, &value);
+	if (op == TEST_OP_EQ) {
+		set = stnode_new(STTYPE_SET, NULL);
+		sttype_set_set_members(set, g_slist_prepend(NULL, value));
+		sttype_test_set2(node, TEST_OP_IN, field, set);
+	}
+	else {
+		set = value;
+	}
+	sttype_set_set_members(set, g_slist_concat(sttype_set_members(set),
+				g_slist_reverse(members)));
+}
+
+/* Merge the equality and membership tests of each field in a chain of
+ * "or"s; "f == a || f == b" is "f in {a b}".  (This isn't true of "and"
+ * and "!=", as a field can occur more than once in a packet.) */
+static void
+merge_memberships(GPtrArray *operands)
+{
+	GHashTable		*merges;
+	GPtrArray		*targets;
+	header_field_info	*hfinfo;
+	stnode_t		*node;
+	merge_t			*merge;
+	guint			i, j;
+
+	merges = g_hash_table_new(g_direct_hash, g_direct_equal);
+	targets = g_ptr_array_new();
+
+	for (i = 0, j = 0; i < operands->len; i++) {
+		node = (stnode_t *)g_ptr_array_index(operands, i);
+		hfinfo = membership_field(node);
+		if (hfinfo) {
+			merge = (merge_t *)g_hash_table_lookup(merges, hfinfo);
+			if (merge) {
+				merge->members = take_members(node, merge->members);
+				continue;
+			}
+			merge = g_new(merge_t, 1);
+			merge->test = node;
+			merge->members = NULL;
+			g_hash_table_insert(merges, hfinfo, merge);
+			g_ptr_array_add(targets, merge);
+		}
+		g_ptr_array_index(operands, j++) = node;
+	}
+	g_ptr_array_set_size(operands, j);
+
+	for (i = 0; i < targets->len; i++) {
+		merge = (merge_t *)g_ptr_array_index(targets, i);
+		if (merge->members)
+			add_members(merge->test, merge->members);
+		g_free(merge);
+	}
+	g_ptr_array_free(targets, TRUE);
+	g_hash_table_destroy(merges);
+}
+
+static int
+compare_operands(const void *a, const void *b)
+{
+	const operand_t *op_a = (const operand_t *)a;
+	const operand_t *op_b = (const operand_t *)b;
+
+	if (op_a->cost != op_b->cost)
+		return op_a->cost < op_b->cost ? -1 : 1;
+	if (op_a->pos != op_b->pos)
+		return op_a->pos < op_b->pos ? -1 : 1;
+	return 0;
+}
+
+/* Optimize a chain of "and"s or "or"s and rebuild it, cheapest first. */
+static stnode_t *
+optimize_chain(stnode_t *node, test_op_t op)
+{
+	GPtrArray	*raw, *operands;
+	operand_t	*sorted;
+	stnode_t	*chain, *test;
+	guint		i;
+
+	raw = g_ptr_array_new();
+	collect_operands(node, op, raw);
+
+	/* An operand can turn into a chain of its own (e.g. "not not (a or b)"),
+	 * which then gets flattened into this one. */
+	operands = g_ptr_array_new();
+	for (i = 0; i < raw->len; i++) {
+		collect_operands(optimize((stnode_t *)g_ptr_array_index(raw, i)),
+				op, operands);
+	}
+	g_ptr_array_free(raw, TRUE);
+
+	if (op == TEST_OP_OR)
+		merge_memberships(operands);
+
+	sorted = g_new(operand_t, operands->len);
+	for (i = 0; i < operands->len; i++) {
+		sorted[i].node = (stnode_t *)g_ptr_array_index(operands, i);
+		sorted[i].cost = test_cost(sorted[i].node);
+		sorted[i].pos = i;
+	}
+	qsort(sorted, operands->len, sizeof(operand_t), compare_operands);
+
+	chain = sorted[0].node;
+	for (i = 1; i < operands->len; i++) {
+		test = stnode_new(STTYPE_TEST, NULL);
+		sttype_test_set2(test, op, chain, sorted[i].node);
+		chain = test;
+	}
+
+	g_free(sorted);
+	g_ptr_array_free(operands, TRUE);
+
+	return chain;
+}
+
+/* Optimize a test, returning the test that replaces it */
+static stnode_t *
+optimize(stnode_t *node)
+{
+	test_op_t	op, inner_op;
+	stnode_t	*val1, *inner;
+
+	g_assert(stnode_type_id(node) == STTYPE_TEST);
+	sttype_test_get(node, &op, &val1, NULL);
+
+	switch (op) {
+		case TEST_OP_NOT:
+			sttype_test_get(val1, &inner_op, &inner, NULL);
+			if (inner_op == TEST_OP_NOT) {
+				/* "not not x" is "x" */
+				sttype_test_set2_args(val1, NULL, NULL);
+				stnode_free(node);
+				return optimize(inner);
+			}
+			sttype_test_set2_args(node, optimize(val1), NULL);
+			return node;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return optimize_chain(node, op);
+
+		case TEST_OP_UNINITIALIZED:
+			g_assert_not_reached();
+			return node;
+
+		default:
+			/* Relations, "in" and existence tests are left as they are */
+			return node;
+	}
+}
+
+void
+dfw_optimize(dfwork_t *dfw)
+{
+	if (dfw->st_root)
+		dfw->st_root = optimize(dfw->st_root);
+}
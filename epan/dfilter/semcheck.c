@@ -28,6 +28,7 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
 
 #include <epan/exceptions.h>
 #include <epan/packet.h>
@@ -387,6 +388,7 @@ check_exists(stnode_t *st_arg1)
 		case STTYPE_TEST:
 		case STTYPE_INTEGER:
 		case STTYPE_FVALUE:
+		case STTYPE_SET:
 		case STTYPE_NUM_TYPES:
 			g_assert_not_reached();
 	}
@@ -1209,6 +1211,78 @@ header_field_info   *hfinfo;
 	}
 }
 
+/* Check a set-membership test. The left-hand side has to be a field,
+ * and every member of the set is converted to an fvalue the same way
+ * the right-hand side of "==" would be. */
+static void
+check_set_membership(stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info	*hfinfo;
+	ftenum_t		ftype;
+	sttype_id_t		type2;
+	stnode_t		*member;
+	fvalue_t		*fvalue;
+	GSList			*members, *l, *p;
+	char			*s;
+
+	DebugLog(("    5 check_set_membership()\n"));
+
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD) {
+		dfilter_fail("Only a field can be tested for membership in a set.");
+		THROW(TypeError);
+	}
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	ftype = hfinfo->type;
+
+	if (!ftype_can_eq(ftype)) {
+		dfilter_fail("%s (type=%s) cannot participate in 'in' comparison.",
+				hfinfo->abbrev, ftype_pretty_name(ftype));
+		THROW(TypeError);
+	}
+
+	members = sttype_set_members(st_arg2);
+	g_assert(members != NULL);
+
+	/* Skip incompatible fields, going by the first member, so that
+	 * all of the members end up with the same type. */
+	type2 = stnode_type_id((stnode_t *)members->data);
+	while (hfinfo->same_name_prev_id != -1 &&
+			((type2 == STTYPE_STRING && ftype != FT_STRING && ftype != FT_STRINGZ) ||
+			(type2 != STTYPE_STRING && (ftype == FT_STRING || ftype == FT_STRINGZ)))) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+		ftype = hfinfo->type;
+	}
+
+	for (l = members; l; l = l->next) {
+		member = (stnode_t *)l->data;
+		s = (char *)stnode_data(member);
+
+		if (stnode_type_id(member) == STTYPE_STRING)
+			fvalue = fvalue_from_string(ftype, s, dfilter_fail);
+		else
+			fvalue = fvalue_from_unparsed(ftype, s, FALSE, dfilter_fail);
+
+		if (!fvalue) {
+			/* check value_string */
+			fvalue = mk_fvalue_from_val_string(hfinfo, s);
+		}
+
+		if (!fvalue) {
+			/* FVALUE nodes don't own their fvalue, so free the
+			 * ones already converted. */
+			for (p = members; p != l; p = p->next) {
+				fvalue = (fvalue_t *)stnode_data((stnode_t *)p->data);
+				FVALUE_FREE(fvalue);
+			}
+			THROW(TypeError);
+		}
+
+		l->data = stnode_new(STTYPE_FVALUE, fvalue);
+		stnode_free(member);
+	}
+}
+
 /* Check the semantics of any type of TEST */
 static void
 check_test(stnode_t *st_node, GPtrArray *deprecated)
@@ -1284,6 +1358,9 @@ check_test(stnode_t *st_node, GPtrArray *deprecated)
 			break;
 		case TEST_OP_MATCHES:
 			check_relation("matches", TRUE, ftype_can_matches, st_node, st_arg1, st_arg2);			break;
+		case TEST_OP_IN:
+			check_set_membership(st_arg1, st_arg2);
+			break;
 
 		default:
 			g_assert_not_reached();
@@ -0,0 +1,122 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include "syntax-tree.h"
+#include "sttype-set.h"
+
+typedef struct {
+	guint32		magic;
+	GSList		*members;
+} set_t;
+
+#define SET_MAGIC	0xc3a5e7b1
+
+static gpointer
+set_new(gpointer junk)
+{
+	set_t		*set;
+
+	g_assert(junk == NULL);
+
+	set = g_new(set_t, 1);
+
+	set->magic = SET_MAGIC;
+	set->members = NULL;
+
+	return (gpointer) set;
+}
+
+static gpointer
+set_dup(gconstpointer data)
+{
+	const set_t	*org = (const set_t *)data;
+	set_t		*set;
+	GSList		*p;
+
+	set = (set_t *)set_new(NULL);
+
+	for (p = org->members; p; p = p->next) {
+		const stnode_t *member = (const stnode_t *)p->data;
+		set->members = g_slist_append(set->members, stnode_dup(member));
+	}
+	return (gpointer) set;
+}
+
+static void
+slist_stnode_free(gpointer data, gpointer user_data _U_)
+{
+	stnode_free((stnode_t *)data);
+}
+
+void
+st_setmembers_free(GSList *members)
+{
+	g_slist_foreach(members, slist_stnode_free, NULL);
+	g_slist_free(members);
+}
+
+static void
+set_free(gpointer value)
+{
+	set_t		*set = (set_t *)value;
+	assert_magic(set, SET_MAGIC);
+	st_setmembers_free(set->members);
+	g_free(set);
+}
+
+/* Set the members of a set stnode_t. */
+void
+sttype_set_set_members(stnode_t *node, GSList *members)
+{
+	set_t		*set;
+
+	set = (set_t *)stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	set->members = members;
+}
+
+/* Get the members of a set stnode_t. */
+GSList*
+sttype_set_members(stnode_t *node)
+{
+	set_t		*set;
+
+	set = (set_t *)stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+	return set->members;
+}
+
+
+void
+sttype_register_set(void)
+{
+	static sttype_t set_type = {
+		STTYPE_SET,
+		"SET",
+		set_new,
+		set_free,
+		set_dup
+	};
+
+	sttype_register(&set_type);
+}
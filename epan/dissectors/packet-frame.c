@@ -472,6 +472,11 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 		return tvb_captured_length(tvb);
 	}
 
+	if (fr_data && fr_data->metadata_only) {
+		/* Only the fields describing the frame itself are wanted */
+		return tvb_captured_length(tvb);
+	}
+
 	/* Portable Exception Handling to trap Wireshark specific exceptions like BoundsError exceptions */
 	TRY {
 #ifdef _MSC_VER
@@ -629,6 +634,22 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 	return tvb_captured_length(tvb);
 }
 
+gboolean
+frame_field_is_metadata(int hfid)
+{
+	int parent;
+
+	if (hfid == proto_frame || hfid == proto_pkt_comment)
+		return TRUE;
+
+	/* Filled in from the layers found by the other dissectors */
+	if (hfid == hf_frame_protocols)
+		return FALSE;
+
+	parent = proto_registrar_get_parent(hfid);
+	return parent == proto_frame || parent == proto_pkt_comment;
+}
+
 void
 proto_register_frame(void)
 {
@@ -31,6 +31,14 @@
 void
 register_frame_end_routine(packet_info *pinfo, void (*func)(void));
 
+/*
+ * Returns TRUE if the field or protocol is one that the frame dissector
+ * sets from the record's metadata, i.e. one that's there even if the
+ * contents of the frame aren't dissected.
+ */
+extern gboolean
+frame_field_is_metadata(int hfid);
+
 /*
  * The frame dissector and the PPI dissector both use this
  */
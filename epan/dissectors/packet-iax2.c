@@ -1494,7 +1494,7 @@ static guint32 dissect_ies(tvbuff_t *tvb, packet_info *pinfo, guint32 offset,
            else we have to allocate a block to put the text into */
         if (ie_finfo && ie_finfo->rep != NULL)
           proto_item_set_text(ti, "Information Element: %s",
-                              ie_finfo->rep->representation);
+                              proto_item_get_label(ie_finfo, NULL));
         else {
           guint8 *ie_val = NULL;
           ie_val = (guint8 *)wmem_alloc(wmem_packet_scope(), ITEM_LABEL_LENGTH);
@@ -145,7 +145,7 @@ samr_query_dispinfo(void *dummy _U_, packet_info *pinfo, epan_dissect_t *edt, co
 			g_hash_table_remove(ctx_handle_table, GINT_TO_POINTER(pinfo->fd->num));
 		}
 		if(!old_ctx){
-			old_ctx=wmem_memdup(wmem_file_scope(), fi->value.value.bytes->data, 20);
+			old_ctx=wmem_memdup(wmem_file_scope(), ((GByteArray *)fvalue_get(&fi->value))->data, 20);
 		}
 		g_hash_table_insert(ctx_handle_table, GINT_TO_POINTER(pinfo->fd->num), old_ctx);
 
@@ -208,7 +208,7 @@ samr_query_dispinfo(void *dummy _U_, packet_info *pinfo, epan_dissect_t *edt, co
 		g_strlcpy(sid_name_str, sid, 256);
 		sid_name_str[len++]='-';
 		g_snprintf(sid_name_str+len, 256-len, "%d",fi_rid->value.value.sinteger);
-		add_sid_name_mapping(sid_name_str, fi_name->value.value.string);
+		add_sid_name_mapping(sid_name_str, (char *)fvalue_get(&fi_name->value));
 	}
 	return 1;
 }
@@ -244,14 +244,14 @@ lsa_policy_information(void *dummy _U_, packet_info *pinfo _U_, epan_dissect_t *
 			return 0;
 		}
 		fi=(field_info *)gp->pdata[0];
-		domain=fi->value.value.string;
+		domain=(char *)fvalue_get(&fi->value);
 
 		gp=proto_get_finfo_ptr_array(edt->tree, hf_nt_domain_sid);
 		if(!gp || gp->len!=1){
 			return 0;
 		}
 		fi=(field_info *)gp->pdata[0];
-		sid=fi->value.value.string;
+		sid=(char *)fvalue_get(&fi->value);
 
 		add_sid_name_mapping(sid, domain);
 		break;
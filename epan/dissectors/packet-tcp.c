@@ -735,6 +735,32 @@ init_tcp_conversation_data(packet_info *pinfo)
     return tcpd;
 }
 
+static void
+free_tcp_flow(tcp_flow_t *flow)
+{
+    tcp_unacked_t *ual, *next;
+
+    for (ual = flow->segments; ual; ual = next) {
+        next = ual->next;
+        wmem_free(wmem_file_scope(), ual);
+    }
+    wmem_tree_destroy(flow->multisegment_pdus, TRUE);
+    wmem_free(wmem_file_scope(), flow->username);
+    wmem_free(wmem_file_scope(), flow->command);
+}
+
+/* Free the data of a conversation that is expired before the file is closed */
+static void
+tcp_conversation_expire(conversation_t *conv _U_, void *proto_data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)proto_data;
+
+    free_tcp_flow(&tcpd->flow1);
+    free_tcp_flow(&tcpd->flow2);
+    wmem_tree_destroy(tcpd->acked_table, TRUE);
+    wmem_free(wmem_file_scope(), tcpd);
+}
+
 struct tcp_analysis *
 get_tcp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
@@ -6024,6 +6050,7 @@ proto_register_tcp(void)
         &tcp_exp_options_with_magic);
 
     register_init_routine(tcp_init);
+    conversation_register_expire_callback(proto_tcp, tcp_conversation_expire);
 
     register_decode_as(&tcp_da);
 
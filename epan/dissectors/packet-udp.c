@@ -232,6 +232,19 @@ init_udp_conversation_data(void)
   return udpd;
 }
 
+/* Free the data of a conversation that is expired before the file is closed */
+static void
+udp_conversation_expire(conversation_t *conv _U_, void *proto_data)
+{
+  struct udp_analysis *udpd = (struct udp_analysis *)proto_data;
+
+  wmem_free(wmem_file_scope(), udpd->flow1.username);
+  wmem_free(wmem_file_scope(), udpd->flow1.command);
+  wmem_free(wmem_file_scope(), udpd->flow2.username);
+  wmem_free(wmem_file_scope(), udpd->flow2.command);
+  wmem_free(wmem_file_scope(), udpd);
+}
+
 struct udp_analysis *
 get_udp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
@@ -550,6 +563,18 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
   call_dissector(data_handle,next_tvb, pinfo, tree);
 }
 
+/* The summary in the protocol item, only formatted if it's looked at;
+   the ports are packed into the data as (source << 16) | destination */
+static void
+udp_summary_label(field_info *fi, gchar *label_str, gpointer data)
+{
+  guint sport = GPOINTER_TO_UINT(data) >> 16;
+  guint dport = GPOINTER_TO_UINT(data) & 0xffff;
+
+  g_snprintf(label_str, ITEM_LABEL_LENGTH, "%s, Src Port: %s (%u), Dst Port: %s (%u)",
+             fi->hfinfo->name, ep_udp_port_to_display(sport), sport,
+             ep_udp_port_to_display(dport), dport);
+}
 
 static void
 dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, guint32 ip_proto)
@@ -590,18 +615,10 @@ dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, guint32 ip_proto)
     COL_ADD_LSTR_TERMINATOR);
 
   if (tree) {
+    ti = proto_tree_add_item(tree, (ip_proto == IP_PROTO_UDP) ? hfi_udp : hfi_udplite, tvb, offset, 8, ENC_NA);
     if (udp_summary_in_tree) {
-      if (ip_proto == IP_PROTO_UDP) {
-        ti = proto_tree_add_protocol_format(tree, hfi_udp->id, tvb, offset, 8,
-        "User Datagram Protocol, Src Port: %s (%u), Dst Port: %s (%u)",
-        src_port_str, udph->uh_sport, dst_port_str, udph->uh_dport);
-      } else {
-        ti = proto_tree_add_protocol_format(tree, hfi_udplite->id, tvb, offset, 8,
-        "Lightweight User Datagram Protocol, Src Port: %s (%u), Dst Port: %s (%u)",
-        src_port_str, udph->uh_sport, dst_port_str, udph->uh_dport);
-      }
-    } else {
-      ti = proto_tree_add_item(tree, (ip_proto == IP_PROTO_UDP) ? hfi_udp : hfi_udplite, tvb, offset, 8, ENC_NA);
+      proto_item_set_label_func(ti, udp_summary_label,
+                                GUINT_TO_POINTER((udph->uh_sport << 16) | udph->uh_dport));
     }
     udp_tree = proto_item_add_subtree(ti, ett_udp);
 
@@ -1010,6 +1027,7 @@ proto_register_udp(void)
   register_color_conversation_filter("udp", "UDP", udp_color_filter_valid, udp_build_color_filter);
 
   register_init_routine(udp_init);
+  conversation_register_expire_callback(proto_udp, udp_conversation_expire);
 
 }
 
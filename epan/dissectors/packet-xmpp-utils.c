@@ -789,7 +789,7 @@ proto_item_get_text(proto_item *item)
         return NULL;
 
 
-    result = wmem_strdup(wmem_packet_scope(), fi->rep->representation);
+    result = wmem_strdup(wmem_packet_scope(), proto_item_get_label(fi, NULL));
     return result;
 }
 
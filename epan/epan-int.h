@@ -31,6 +31,25 @@ struct epan_session {
 	const nstime_t *(*get_frame_ts)(void *data, guint32 frame_num);
 	const char *(*get_interface_name)(void *data, guint32 interface_id);
 	const char *(*get_user_comment)(void *data, const frame_data *fd);
+
+	/* Protocol ids needed in minimal dissection mode, or NULL to
+	 * dissect everything; see epan_set_minimal_dissection(). */
+	GArray *minimal_protos;
+	/* Other protocols that may carry those again, and are dissected
+	 * even once all of them are in a packet's layers. */
+	GArray *minimal_carriers;
+
+	/* Timeouts for per-flow state, see epan_set_flow_timeouts(). */
+	guint flow_idle_timeout;
+	guint flow_age_timeout;
+	time_t flow_next_sweep;
+	/* Capture time and first frame of previous sweeps, to map the
+	 * idle timeout onto frame numbers for the reassembly tables. */
+	GArray *flow_sweeps;
+
+	/* The conversations of this session; the thread dissecting with
+	 * the session makes them current, see conversation_set_state(). */
+	struct conversation_state *conversations;
 };
 
 #endif
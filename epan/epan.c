@@ -38,6 +38,7 @@
 
 #include "conversation.h"
 #include "circuit.h"
+#include "reassemble.h"
 #include "except.h"
 #include "packet.h"
 #include "prefs.h"
@@ -48,6 +49,7 @@
 #include "emem.h"
 #include "wmem/wmem.h"
 #include "expert.h"
+#include "dissectors/packet-frame.h"
 
 #ifdef HAVE_LUA
 #include <lua.h>
@@ -154,7 +156,12 @@ epan_cleanup(void)
 epan_t *
 epan_new(void)
 {
-	epan_t *session = g_slice_new(epan_t);
+	epan_t *session = g_slice_new0(epan_t);
+
+	/* The conversation routines use the session's conversation
+	 * tables from now on. */
+	session->conversations = conversation_state_new();
+	conversation_set_state(session->conversations);
 
 	/* XXX, it should take session as param */
 	init_dissection();
@@ -198,13 +205,130 @@ void
 epan_free(epan_t *session)
 {
 	if (session) {
+		conversation_set_state(session->conversations);
+
 		/* XXX, it should take session as param */
 		cleanup_dissection();
 
+		if (session->minimal_protos) {
+			g_array_free(session->minimal_protos, TRUE);
+			g_array_free(session->minimal_carriers, TRUE);
+		}
+
+		if (session->flow_sweeps)
+			g_array_free(session->flow_sweeps, TRUE);
+
+		conversation_state_free(session->conversations);
+
 		g_slice_free(epan_t, session);
 	}
 }
 
+gboolean
+epan_set_minimal_dissection(epan_t *session, epan_dissect_t *edt)
+{
+	GArray *protos;
+	void   *cookie;
+	int     proto_id;
+
+	if (session->minimal_protos) {
+		g_array_free(session->minimal_protos, TRUE);
+		g_array_free(session->minimal_carriers, TRUE);
+		session->minimal_protos = NULL;
+		session->minimal_carriers = NULL;
+	}
+
+	protos = g_array_new(FALSE, FALSE, sizeof(int));
+	if (!tap_listeners_get_protocols(protos)) {
+		g_array_free(protos, TRUE);
+		return FALSE;
+	}
+
+	/* Tap filters reference fields like any other filter */
+	tap_build_interesting(edt);
+
+	/*
+	 * Priming a field marks its protocol as referenced, so the
+	 * protocols with a reference are the ones we need.
+	 */
+	for (proto_id = proto_get_first_protocol(&cookie); proto_id != -1;
+	     proto_id = proto_get_next_protocol(&cookie)) {
+		if (proto_registrar_get_nth(proto_id)->ref_type != HF_REF_TYPE_NONE)
+			g_array_append_val(protos, proto_id);
+	}
+
+	session->minimal_carriers = g_array_new(FALSE, FALSE, sizeof(int));
+	dissector_tables_get_carriers(protos, session->minimal_carriers);
+	session->minimal_protos = protos;
+	return TRUE;
+}
+
+typedef struct {
+	time_t	secs;
+	guint32	frame_num;
+} flow_sweep_t;
+
+void
+epan_set_flow_timeouts(epan_t *session, guint idle_timeout, guint age_timeout)
+{
+	session->flow_idle_timeout = idle_timeout;
+	session->flow_age_timeout = age_timeout;
+	session->flow_next_sweep = 0;
+	if (idle_timeout || age_timeout) {
+		if (!session->flow_sweeps)
+			session->flow_sweeps = g_array_new(FALSE, FALSE, sizeof(flow_sweep_t));
+	} else if (session->flow_sweeps) {
+		g_array_free(session->flow_sweeps, TRUE);
+		session->flow_sweeps = NULL;
+	}
+	conversation_set_state(session->conversations);
+	conversation_set_timeouts(idle_timeout, age_timeout);
+}
+
+/*
+ * Called before a packet is dissected; at most once per second of
+ * capture time, drop the per-flow state that timed out.
+ */
+static void
+epan_expire_flows(epan_t *session, const frame_data *fd)
+{
+	time_t now = fd->abs_ts.secs;
+	flow_sweep_t sweep;
+	guint32 oldest_frame = 0;
+	guint i;
+
+	conversation_set_current_time(now);
+	if (now < session->flow_next_sweep)
+		return;
+	session->flow_next_sweep = now + 1;
+
+	conversation_expire(now);
+
+	if (session->flow_idle_timeout) {
+		/*
+		 * Fragments have frame numbers rather than timestamps; the
+		 * first frame of the latest sweep at least idle_timeout
+		 * seconds ago is where reassemblies are still alive.
+		 */
+		for (i = 0; i < session->flow_sweeps->len; i++) {
+			flow_sweep_t *prev = &g_array_index(session->flow_sweeps, flow_sweep_t, i);
+
+			if (now - prev->secs < (time_t)session->flow_idle_timeout)
+				break;
+			oldest_frame = prev->frame_num;
+		}
+		/* The sweeps before that one won't be needed again */
+		if (i > 1)
+			g_array_remove_range(session->flow_sweeps, 0, i - 1);
+		if (oldest_frame)
+			reassembly_tables_expire(oldest_frame);
+
+		sweep.secs = now;
+		sweep.frame_num = fd->num;
+		g_array_append_val(session->flow_sweeps, sweep);
+	}
+}
+
 void
 epan_conversation_init(void)
 {
@@ -328,8 +452,14 @@ epan_dissect_run(epan_dissect_t *edt, int file_type_subtype,
 #ifdef HAVE_LUA
 	wslua_prime_dfilter(edt); /* done before entering wmem scope */
 #endif
+	if (edt->session) {
+		conversation_set_state(edt->session->conversations);
+		if (edt->session->flow_sweeps)
+			epan_expire_flows(edt->session, fd);
+	}
+
 	wmem_enter_packet_scope();
-	dissect_record(edt, file_type_subtype, phdr, tvb, fd, cinfo);
+	dissect_record(edt, file_type_subtype, phdr, tvb, fd, cinfo, FALSE);
 
 	/* free all memory allocated */
 	ep_free_all();
@@ -341,9 +471,15 @@ epan_dissect_run_with_taps(epan_dissect_t *edt, int file_type_subtype,
         struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd,
         column_info *cinfo)
 {
+	if (edt->session) {
+		conversation_set_state(edt->session->conversations);
+		if (edt->session->flow_sweeps)
+			epan_expire_flows(edt->session, fd);
+	}
+
 	wmem_enter_packet_scope();
 	tap_queue_init(edt);
-	dissect_record(edt, file_type_subtype, phdr, tvb, fd, cinfo);
+	dissect_record(edt, file_type_subtype, phdr, tvb, fd, cinfo, FALSE);
 	tap_push_tapped_queue(edt);
 
 	/* free all memory allocated */
@@ -351,6 +487,21 @@ epan_dissect_run_with_taps(epan_dissect_t *edt, int file_type_subtype,
 	wmem_leave_packet_scope();
 }
 
+void
+epan_dissect_run_metadata(epan_dissect_t *edt, int file_type_subtype,
+        struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd)
+{
+	if (edt->session)
+		conversation_set_state(edt->session->conversations);
+
+	wmem_enter_packet_scope();
+	dissect_record(edt, file_type_subtype, phdr, tvb, fd, NULL, TRUE);
+
+	/* free all memory allocated */
+	ep_free_all();
+	wmem_leave_packet_scope();
+}
+
 void
 epan_dissect_file_run(epan_dissect_t *edt, struct wtap_pkthdr *phdr,
         tvbuff_t *tvb, frame_data *fd, column_info *cinfo)
@@ -422,6 +573,22 @@ epan_dissect_prime_dfilter(epan_dissect_t *edt, const dfilter_t* dfcode)
     dfilter_prime_proto_tree(dfcode, edt->tree);
 }
 
+gboolean
+epan_dfilter_is_metadata_only(const dfilter_t *dfcode)
+{
+    const int *fields;
+    int        num_fields, i;
+
+    fields = dfilter_interesting_fields(dfcode, &num_fields);
+    if (num_fields == 0)
+        return FALSE;
+    for (i = 0; i < num_fields; i++) {
+        if (!frame_field_is_metadata(fields[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
 /* ----------------------- */
 const gchar *
 epan_custom_set(epan_dissect_t *edt, GSList *field_ids,
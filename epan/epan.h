@@ -140,6 +140,34 @@ const nstime_t *epan_get_frame_ts(const epan_t *session, guint32 frame_num);
 
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
+/**
+ * Restrict dissection in a session to the protocols that can contribute
+ * the fields primed in edt (see epan_dissect_prime_dfilter()) or data to
+ * the registered tap listeners.  Once all of those protocols have been
+ * added to a packet's layers, no further subdissectors are called for
+ * that packet, except for protocols that are in a dissector table along
+ * with one of them and so may carry it again (e.g. GRE or ICMP alongside
+ * IP in "ip.proto"); lower layers, and with them conversations and
+ * reassembly, are dissected as usual.
+ *
+ * Returns FALSE, and leaves full dissection in place, if a tap listener
+ * needs the columns or listens to a tap that isn't named after a protocol.
+ */
+WS_DLL_PUBLIC gboolean epan_set_minimal_dissection(epan_t *session, epan_dissect_t *edt);
+
+/**
+ * Free per-flow state as a session goes on, rather than when the file
+ * is closed: conversations, with the protocol data attached to them, that
+ * have not been seen for idle_timeout seconds of capture time or were set
+ * up more than age_timeout seconds ago, and reassemblies that have not
+ * had a fragment for idle_timeout seconds.  A timeout of 0 disables it.
+ *
+ * Expired state is gone for good, so this is only meant for dissecting
+ * each packet once, in order, as in a single pass over a live capture.
+ * It must be called before the first packet is dissected.
+ */
+WS_DLL_PUBLIC void epan_set_flow_timeouts(epan_t *session, guint idle_timeout, guint age_timeout);
+
 WS_DLL_PUBLIC const gchar*
 epan_get_version(void);
 
@@ -189,6 +217,22 @@ epan_dissect_run_with_taps(epan_dissect_t *edt, int file_type_subtype,
         struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd,
         struct epan_column_info *cinfo);
 
+/** Add only the fields that describe the record itself (frame.len,
+ * frame.time, frame.number, ...), without dissecting its contents.
+ * Neither the dissectors nor the taps see the packet, and it isn't
+ * marked as visited. */
+WS_DLL_PUBLIC
+void
+epan_dissect_run_metadata(epan_dissect_t *edt, int file_type_subtype,
+        struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd);
+
+/** Returns TRUE if the dfilter only uses fields that
+ * epan_dissect_run_metadata() fills in, so that it can be applied
+ * without a full dissection. */
+WS_DLL_PUBLIC
+gboolean
+epan_dfilter_is_metadata_only(const struct epan_dfilter *dfcode);
+
 /** run a single file packet dissection */
 WS_DLL_PUBLIC
 void
@@ -34,12 +34,18 @@ static void
 bytes_fvalue_new(fvalue_t *fv)
 {
 	fv->value.bytes = NULL;
+	FVALUE_PENDING(fv) = FALSE;
 }
 
 static void
 bytes_fvalue_free(fvalue_t *fv)
 {
-	if (fv->value.bytes) {
+	if (FVALUE_PENDING(fv)) {
+		/* Nothing was fetched, so there's nothing to free */
+		FVALUE_PENDING(fv) = FALSE;
+		fv->value.bytes = NULL;
+	}
+	else if (fv->value.bytes) {
 		g_byte_array_free(fv->value.bytes, TRUE);
 		fv->value.bytes=NULL;
 	}
@@ -55,6 +61,34 @@ bytes_fvalue_set(fvalue_t *fv, GByteArray *value)
 	fv->value.bytes = value;
 }
 
+static void
+bytes_fvalue_set_tvb_range(fvalue_t *fv, tvbuff_t *tvb, gint offset, gint length, guint encoding _U_)
+{
+	/* Free up the old value, if we have one */
+	bytes_fvalue_free(fv);
+
+	fv->value.range.tvb = tvb;
+	fv->value.range.offset = offset;
+	fv->value.range.length = length;
+	FVALUE_PENDING(fv) = TRUE;
+}
+
+static void
+bytes_fvalue_materialize(fvalue_t *fv)
+{
+	tvbuff_t	*tvb = fv->value.range.tvb;
+	gint		offset = fv->value.range.offset;
+	gint		length = fv->value.range.length;
+	GByteArray	*bytes;
+
+	bytes = g_byte_array_new();
+	if (length > 0) {
+		g_byte_array_append(bytes, tvb_get_ptr(tvb, offset, length), length);
+	}
+	FVALUE_PENDING(fv) = FALSE;
+	fv->value.bytes = bytes;
+}
+
 static int
 bytes_repr_len(fvalue_t *fv, ftrepr_t rtype _U_, int field_display _U_)
 {
@@ -657,18 +691,6 @@ static gboolean
 cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 {
 	GByteArray *a = fv_a->value.bytes;
-	GRegex *regex = fv_b->value.re;
-
-	/* fv_b is always a FT_PCRE, otherwise the dfilter semcheck() would have
-	 * warned us. For the same reason (and because we're using g_malloc()),
-	 * fv_b->value.re is not NULL.
-	 */
-	if (strcmp(fv_b->ftype->name, "FT_PCRE") != 0) {
-		return FALSE;
-	}
-	if (! regex) {
-		return FALSE;
-	}
 	/*
 	 * XXX - do we want G_REGEX_RAW or not?
 	 *
@@ -693,16 +715,7 @@ cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 	 *
 	 * So we don't use G_REGEX_RAW for now.
 	 */
-	return g_regex_match_full(
-		regex,			/* Compiled PCRE */
-		(char *)a->data,	/* The data to check for the pattern... */
-		(int)a->len,		/* ... and its length */
-		0,			/* Start offset within data */
-		(GRegexMatchFlags)0,	/* GRegexMatchFlags */
-		NULL,			/* We are not interested in the match information */
-		NULL			/* We don't want error information */
-		);
-	/* NOTE - DO NOT g_free(data) */
+	return fvalue_regex_match(fv_b, (const char *)a->data, (gssize)a->len);
 }
 
 void
@@ -750,6 +763,9 @@ ftype_register_bytes(void)
 
 		len,
 		slice,
+
+		bytes_fvalue_set_tvb_range,	/* set_value_tvb_range */
+		bytes_fvalue_materialize,	/* materialize */
 	};
 
 	static ftype_t uint_bytes_type = {
@@ -793,6 +809,9 @@ ftype_register_bytes(void)
 
 		len,
 		slice,
+
+		bytes_fvalue_set_tvb_range,	/* set_value_tvb_range */
+		bytes_fvalue_materialize,	/* materialize */
 	};
 
 	static ftype_t ax25_type = {
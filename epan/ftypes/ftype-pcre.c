@@ -30,6 +30,264 @@
 #include <glib.h>
 #include <string.h>
 
+#include <epan/strutil.h>
+
+/* A compiled pattern.  Identical patterns (e.g. the same "matches"
+ * clause in several color filters and taps) share one of these, so
+ * each distinct pattern is compiled and studied only once. */
+struct _fvalue_regex_t {
+    gchar       *key;           /* compile flags and pattern */
+    GRegex      *regex;
+    guint        refs;
+    gchar       *literal;       /* text every match contains, or NULL */
+    guint        literal_len;
+};
+
+/* fvalue_regex_t's, keyed by their key */
+static GHashTable *regex_cache = NULL;
+G_LOCK_DEFINE_STATIC(regex_cache);
+
+/* Escapes that match a character class or an assertion (or a single
+ * character we don't bother to translate); they end a literal run
+ * but leave the rest of the pattern understandable. */
+static const gchar simple_escapes[] = "dDsSwWbBhHvVRXAzZGKnrtfea";
+
+/* Returns a pointer just past the ']' closing the character class
+ * starting at p, or NULL if the class isn't terminated. */
+static const gchar *
+skip_class(const gchar *p)
+{
+    p++;
+    if (*p == '^')
+        p++;
+    if (*p == ']')
+        p++;
+    while (*p != ']') {
+        if (*p == '\\') {
+            if (p[1] == '\0')
+                return NULL;
+            p += 2;
+        } else if (p[0] == '[' && p[1] == ':') {
+            p = strstr(p + 2, ":]");
+            if (p == NULL)
+                return NULL;
+            p += 2;
+        } else if (*p == '\0') {
+            return NULL;
+        } else {
+            p++;
+        }
+    }
+    return p + 1;
+}
+
+/* Returns a pointer just past the ')' closing the group starting at p,
+ * or NULL if the group isn't terminated. */
+static const gchar *
+skip_group(const gchar *p)
+{
+    int depth = 0;
+
+    do {
+        switch (*p) {
+        case '\0':
+            return NULL;
+        case '\\':
+            if (p[1] == '\0')
+                return NULL;
+            p += 2;
+            continue;
+        case '[':
+            p = skip_class(p);
+            if (p == NULL)
+                return NULL;
+            continue;
+        case '(':
+            depth++;
+            break;
+        case ')':
+            depth--;
+            break;
+        }
+        p++;
+    } while (depth > 0);
+    return p;
+}
+
+/* Find the longest run of characters that every match of the pattern
+ * must contain, so that data lacking it can be rejected with a plain
+ * substring search instead of running the regex engine.  Only the
+ * top level of simple patterns is examined; alternation, inline
+ * options, verbs, quoting and unusual escapes make us give up. */
+static gchar *
+required_literal(const gchar *pattern, guint *literal_len)
+{
+    GString *run, *best;
+    const gchar *p, *next;
+    gchar c;
+    gboolean literal;
+    gchar *ret = NULL;
+
+    if (strchr(pattern, '|') != NULL || strstr(pattern, "(?") != NULL ||
+        strstr(pattern, "(*") != NULL || strstr(pattern, "\\Q") != NULL)
+        return NULL;
+
+    run = g_string_new("");
+    best = g_string_new("");
+    p = pattern;
+    while (*p != '\0') {
+        c = *p;
+        literal = FALSE;
+        next = p + 1;
+        switch (c) {
+        case '\\':
+            if (p[1] == '\0')
+                goto give_up;
+            next = p + 2;
+            if (strchr(simple_escapes, p[1]) != NULL)
+                break;
+            if (g_ascii_isalnum(p[1]) || (guchar)p[1] >= 0x80)
+                goto give_up;
+            c = p[1];
+            literal = TRUE;
+            break;
+        case '[':
+            next = skip_class(p);
+            if (next == NULL)
+                goto give_up;
+            break;
+        case '(':
+            next = skip_group(p);
+            if (next == NULL)
+                goto give_up;
+            break;
+        case '{':
+            /* A counted repeat of whatever came before */
+            next = p + 1;
+            while (g_ascii_isdigit(*next) || *next == ',')
+                next++;
+            if (*next != '}')
+                goto give_up;
+            next++;
+            break;
+        case ')':
+            goto give_up;
+        case '.': case '^': case '$':
+        case '*': case '+': case '?':
+            break;
+        default:
+            literal = (guchar)c < 0x80;
+            break;
+        }
+
+        if (literal && (*next == '?' || *next == '*' || *next == '{')) {
+            /* Optional, or repeated a possibly-zero number of times */
+            literal = FALSE;
+        }
+        if (literal)
+            g_string_append_c(run, c);
+        if (!literal || *next == '+') {
+            if (run->len > best->len)
+                g_string_assign(best, run->str);
+            g_string_truncate(run, 0);
+        }
+        p = next;
+    }
+    if (run->len > best->len)
+        g_string_assign(best, run->str);
+    if (best->len > 0) {
+        *literal_len = (guint)best->len;
+        ret = g_string_free(best, FALSE);
+        best = NULL;
+    }
+
+give_up:
+    g_string_free(run, TRUE);
+    if (best)
+        g_string_free(best, TRUE);
+    return ret;
+}
+
+/* Look up the pattern in the cache, compiling it if it isn't there.
+ * Uses the specified logfunc() to report errors. */
+static fvalue_regex_t *
+regex_acquire(const char *pattern, GRegexCompileFlags cflags, LogFunc logfunc)
+{
+    GError *regex_error = NULL;
+    fvalue_regex_t *re;
+    GRegex *regex;
+    gchar *key;
+
+    key = g_strdup_printf("%x:%s", (guint)cflags, pattern);
+
+    G_LOCK(regex_cache);
+    if (regex_cache == NULL)
+        regex_cache = g_hash_table_new(g_str_hash, g_str_equal);
+    re = (fvalue_regex_t *)g_hash_table_lookup(regex_cache, key);
+    if (re) {
+        re->refs++;
+        G_UNLOCK(regex_cache);
+        g_free(key);
+        return re;
+    }
+    G_UNLOCK(regex_cache);
+
+    regex = g_regex_new(
+            pattern,            /* pattern */
+            cflags,             /* Compile options */
+            (GRegexMatchFlags)0,                  /* Match options */
+            &regex_error        /* Compile / study errors */
+            );
+
+    if (regex_error) {
+        if (logfunc) {
+            logfunc(regex_error->message);
+        }
+        g_error_free(regex_error);
+        if (regex) {
+            g_regex_unref(regex);
+        }
+        g_free(key);
+        return NULL;
+    }
+
+    G_LOCK(regex_cache);
+    re = (fvalue_regex_t *)g_hash_table_lookup(regex_cache, key);
+    if (re) {
+        /* Someone else compiled it while we weren't looking */
+        re->refs++;
+        G_UNLOCK(regex_cache);
+        g_regex_unref(regex);
+        g_free(key);
+        return re;
+    }
+    re = g_new(fvalue_regex_t, 1);
+    re->key = key;
+    re->regex = regex;
+    re->refs = 1;
+    re->literal = required_literal(pattern, &re->literal_len);
+    g_hash_table_insert(regex_cache, re->key, re);
+    G_UNLOCK(regex_cache);
+    return re;
+}
+
+static void
+regex_release(fvalue_regex_t *re)
+{
+    G_LOCK(regex_cache);
+    if (--re->refs > 0) {
+        G_UNLOCK(regex_cache);
+        return;
+    }
+    g_hash_table_remove(regex_cache, re->key);
+    G_UNLOCK(regex_cache);
+
+    g_regex_unref(re->regex);
+    g_free(re->literal);
+    g_free(re->key);
+    g_free(re);
+}
+
 static void
 gregex_fvalue_new(fvalue_t *fv)
 {
@@ -40,7 +298,7 @@ static void
 gregex_fvalue_free(fvalue_t *fv)
 {
     if (fv->value.re) {
-        g_regex_unref(fv->value.re);
+        regex_release(fv->value.re);
         fv->value.re = NULL;
     }
 }
@@ -72,7 +330,6 @@ raw_flag_needed(const gchar *pattern)
 static gboolean
 val_from_string(fvalue_t *fv, const char *pattern, LogFunc logfunc)
 {
-    GError *regex_error = NULL;
     GRegexCompileFlags cflags = G_REGEX_OPTIMIZE;
 
     /* Set RAW flag only if pattern requires matching raw byte
@@ -85,24 +342,8 @@ val_from_string(fvalue_t *fv, const char *pattern, LogFunc logfunc)
     /* Free up the old value, if we have one */
     gregex_fvalue_free(fv);
 
-    fv->value.re = g_regex_new(
-            pattern,            /* pattern */
-            cflags,             /* Compile options */
-            (GRegexMatchFlags)0,                  /* Match options */
-            &regex_error        /* Compile / study errors */
-            );
-
-    if (regex_error) {
-        if (logfunc) {
-            logfunc(regex_error->message);
-        }
-        g_error_free(regex_error);
-        if (fv->value.re) {
-            g_regex_unref(fv->value.re);
-        }
-        return FALSE;
-    }
-    return TRUE;
+    fv->value.re = regex_acquire(pattern, cflags, logfunc);
+    return fv->value.re != NULL;
 }
 
 /* Generate a FT_PCRE from an unparsed string pattern.
@@ -119,14 +360,14 @@ static int
 gregex_repr_len(fvalue_t *fv, ftrepr_t rtype, int field_display _U_)
 {
     g_assert(rtype == FTREPR_DFILTER);
-    return (int)strlen(g_regex_get_pattern(fv->value.re));
+    return (int)strlen(g_regex_get_pattern(fv->value.re->regex));
 }
 
 static void
 gregex_to_repr(fvalue_t *fv, ftrepr_t rtype, int field_display _U_, char *buf)
 {
     g_assert(rtype == FTREPR_DFILTER);
-    strcpy(buf, g_regex_get_pattern(fv->value.re));
+    strcpy(buf, g_regex_get_pattern(fv->value.re->regex));
 }
 
 /* BEHOLD - value contains the string representation of the regular expression,
@@ -143,7 +384,36 @@ gregex_fvalue_set(fvalue_t *fv, const char *value)
 static gpointer
 gregex_fvalue_get(fvalue_t *fv)
 {
-    return fv->value.re;
+    return fv->value.re ? fv->value.re->regex : NULL;
+}
+
+gboolean
+fvalue_regex_match(const fvalue_t *re_fv, const char *data, gssize len)
+{
+    const fvalue_regex_t *re = re_fv->value.re;
+
+    /* re_fv is always a FT_PCRE, otherwise the dfilter semcheck() would
+     * have warned us. For the same reason re_fv->value.re is not NULL.
+     */
+    if (re_fv->ftype->ftype != FT_PCRE || re == NULL) {
+        return FALSE;
+    }
+    /* Most data doesn't match; don't start the regex engine when a
+     * string that any match must contain is missing. */
+    if (re->literal != NULL &&
+        epan_memmem((const guint8 *)data, (guint)len,
+                    (const guint8 *)re->literal, re->literal_len) == NULL) {
+        return FALSE;
+    }
+    return g_regex_match_full(
+            re->regex,          /* Compiled PCRE */
+            data,               /* The data to check for the pattern... */
+            len,                /* ... and its length */
+            0,                  /* Start offset within data */
+            (GRegexMatchFlags)0,        /* GRegexMatchFlags */
+            NULL,               /* We are not interested in the match information */
+            NULL                /* We don't want error information */
+            );
 }
 
 void
@@ -33,11 +33,18 @@ static void
 string_fvalue_new(fvalue_t *fv)
 {
 	fv->value.string = NULL;
+	FVALUE_PENDING(fv) = FALSE;
 }
 
 static void
 string_fvalue_free(fvalue_t *fv)
 {
+	if (FVALUE_PENDING(fv)) {
+		/* Nothing was fetched, so there's nothing to free */
+		FVALUE_PENDING(fv) = FALSE;
+		fv->value.string = NULL;
+		return;
+	}
 	g_free(fv->value.string);
 }
 
@@ -52,6 +59,32 @@ string_fvalue_set_string(fvalue_t *fv, const gchar *value)
 	fv->value.string = (gchar *)g_strdup(value);
 }
 
+static void
+string_fvalue_set_tvb_range(fvalue_t *fv, tvbuff_t *tvb, gint offset, gint length, guint encoding)
+{
+	/* Free up the old value, if we have one */
+	string_fvalue_free(fv);
+
+	fv->value.range.tvb = tvb;
+	fv->value.range.offset = offset;
+	fv->value.range.length = length;
+	fv->value.range.encoding = encoding;
+	FVALUE_PENDING(fv) = TRUE;
+}
+
+static void
+string_fvalue_materialize(fvalue_t *fv)
+{
+	gchar	*string;
+
+	/* NULL scope, so this is g_malloc()ed like a set string */
+	string = (gchar *)tvb_get_string_enc(NULL, fv->value.range.tvb,
+	    fv->value.range.offset, fv->value.range.length,
+	    fv->value.range.encoding);
+	FVALUE_PENDING(fv) = FALSE;
+	fv->value.string = string;
+}
+
 static int
 string_repr_len(fvalue_t *fv, ftrepr_t rtype, int field_display _U_)
 {
@@ -202,27 +235,8 @@ static gboolean
 cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 {
 	char *str = fv_a->value.string;
-	GRegex *regex = fv_b->value.re;
 
-	/* fv_b is always a FT_PCRE, otherwise the dfilter semcheck() would have
-	 * warned us. For the same reason (and because we're using g_malloc()),
-	 * fv_b->value.re is not NULL.
-	 */
-	if (strcmp(fv_b->ftype->name, "FT_PCRE") != 0) {
-		return FALSE;
-	}
-	if (! regex) {
-		return FALSE;
-	}
-	return g_regex_match_full(
-			regex,		/* Compiled PCRE */
-			str,		/* The data to check for the pattern... */
-			(int)strlen(str),	/* ... and its length */
-			0,		/* Start offset within data */
-			(GRegexMatchFlags)0,		/* GRegexMatchFlags */
-			NULL,		/* We are not interested in the match information */
-			NULL		/* We don't want error information */
-			);
+	return fvalue_regex_match(fv_b, str, (gssize)strlen(str));
 }
 
 void
@@ -270,6 +284,9 @@ ftype_register_string(void)
 
 		len,
 		slice,
+
+		string_fvalue_set_tvb_range,	/* set_value_tvb_range */
+		string_fvalue_materialize,	/* materialize */
 	};
 	static ftype_t stringz_type = {
 		FT_STRINGZ,			/* ftype */
@@ -312,6 +329,9 @@ ftype_register_string(void)
 
 		len,
 		slice,
+
+		string_fvalue_set_tvb_range,	/* set_value_tvb_range */
+		string_fvalue_materialize,	/* materialize */
 	};
 	static ftype_t uint_string_type = {
 		FT_UINT_STRING,		/* ftype */
@@ -354,6 +374,9 @@ ftype_register_string(void)
 
 		len,
 		slice,
+
+		string_fvalue_set_tvb_range,	/* set_value_tvb_range */
+		string_fvalue_materialize,	/* materialize */
 	};
 	static ftype_t stringzpad_type = {
 		FT_STRINGZPAD,			/* ftype */
@@ -396,6 +419,9 @@ ftype_register_string(void)
 
 		len,
 		slice,
+
+		string_fvalue_set_tvb_range,	/* set_value_tvb_range */
+		string_fvalue_materialize,	/* materialize */
 	};
 
 	ftype_register(FT_STRING, &string_type);
@@ -45,6 +45,10 @@ void ftype_register_time(void);
 void ftype_register_tvbuff(void);
 void ftype_register_pcre(void);
 
+/* Match data against the FT_PCRE value re_fv; used by the "matches"
+ * methods of the types that can be matched against a regex. */
+gboolean fvalue_regex_match(const fvalue_t *re_fv, const char *data, gssize len);
+
 typedef void (*FvalueNewFunc)(fvalue_t*);
 typedef void (*FvalueFreeFunc)(fvalue_t*);
 
@@ -63,6 +67,7 @@ typedef void (*FvalueSetUnsignedIntegerFunc)(fvalue_t*, guint32);
 typedef void (*FvalueSetSignedIntegerFunc)(fvalue_t*, gint32);
 typedef void (*FvalueSetInteger64Func)(fvalue_t*, guint64);
 typedef void (*FvalueSetFloatingFunc)(fvalue_t*, gdouble);
+typedef void (*FvalueSetTvbRangeFunc)(fvalue_t*, tvbuff_t *, gint, gint, guint);
 
 typedef gpointer (*FvalueGetFunc)(fvalue_t*);
 typedef guint32 (*FvalueGetUnsignedIntegerFunc)(fvalue_t*);
@@ -74,6 +79,7 @@ typedef gboolean (*FvalueCmp)(const fvalue_t*, const fvalue_t*);
 
 typedef guint (*FvalueLen)(fvalue_t*);
 typedef void (*FvalueSlice)(fvalue_t*, GByteArray *, guint offset, guint length);
+typedef void (*FvalueMaterializeFunc)(fvalue_t*);
 
 struct _ftype_t {
 	ftenum_t		ftype;
@@ -118,8 +124,24 @@ struct _ftype_t {
 
 	FvalueLen		len;
 	FvalueSlice		slice;
+
+	/* Only for the types whose values can be left in the packet
+	 * until they're needed; NULL for the others. */
+	FvalueSetTvbRangeFunc	set_value_tvb_range;
+	FvalueMaterializeFunc	materialize;
 };
 
+/* The fvalue_gboolean1 flag of an fvalue whose value.range
+ * hasn't been fetched yet, for the types that have materialize(). */
+#define FVALUE_PENDING(fv)	((fv)->fvalue_gboolean1)
+
+#define FVALUE_MATERIALIZE(fv)					\
+	{							\
+		if ((fv)->ftype->materialize && FVALUE_PENDING(fv)) { \
+			(fv)->ftype->materialize((fv));		\
+		}						\
+	}
+
 /* Free all memory used by an fvalue_t. With MSVC and a
  * libwireshark.dll, we need a special declaration.
  */
@@ -341,6 +341,7 @@ fvalue_type_name(fvalue_t *fv)
 guint
 fvalue_length(fvalue_t *fv)
 {
+	FVALUE_MATERIALIZE(fv);
 	if (fv->ftype->len)
 		return fv->ftype->len(fv);
 	else
@@ -351,6 +352,7 @@ int
 fvalue_string_repr_len(fvalue_t *fv, ftrepr_t rtype, int field_display)
 {
 	g_assert(fv->ftype->len_string_repr);
+	FVALUE_MATERIALIZE(fv);
 	return fv->ftype->len_string_repr(fv, rtype, field_display);
 }
 
@@ -361,6 +363,7 @@ fvalue_to_string_repr(fvalue_t *fv, ftrepr_t rtype, int field_display, char *buf
 		/* no value-to-string-representation function, so the value cannot be represented */
 		return NULL;
 	}
+	FVALUE_MATERIALIZE(fv);
 	if (!buf) {
 		int len;
 		if ((len = fvalue_string_repr_len(fv, rtype, field_display)) >= 0) {
@@ -457,6 +460,7 @@ fvalue_slice(fvalue_t *fv, drange_t *d_range)
 	slice_data_t	slice_data;
 	fvalue_t	*new_fv;
 
+	FVALUE_MATERIALIZE(fv);
 	slice_data.fv = fv;
 	slice_data.bytes = g_byte_array_new();
 	slice_data.slice_failure = FALSE;
@@ -516,6 +520,21 @@ fvalue_set_tvbuff(fvalue_t *fv, tvbuff_t *value)
 	fv->ftype->set_value_tvbuff(fv, value);
 }
 
+gboolean
+fvalue_set_tvb_range(fvalue_t *fv, tvbuff_t *tvb, gint offset, gint length, guint encoding)
+{
+	if (!fv->ftype->set_value_tvb_range)
+		return FALSE;
+	fv->ftype->set_value_tvb_range(fv, tvb, offset, length, encoding);
+	return TRUE;
+}
+
+void
+fvalue_materialize(fvalue_t *fv)
+{
+	FVALUE_MATERIALIZE(fv);
+}
+
 void
 fvalue_set_uinteger(fvalue_t *fv, guint32 value)
 {
@@ -550,6 +569,7 @@ gpointer
 fvalue_get(fvalue_t *fv)
 {
 	g_assert(fv->ftype->get_value);
+	FVALUE_MATERIALIZE(fv);
 	return fv->ftype->get_value(fv);
 }
 
@@ -582,11 +602,21 @@ fvalue_get_floating(fvalue_t *fv)
 	return fv->ftype->get_value_floating(fv);
 }
 
+/* Fetching a pending value doesn't change what it compares as, so
+ * the comparisons may do it even though their operands are const. */
+static void
+materialize_operands(const fvalue_t *a, const fvalue_t *b)
+{
+	FVALUE_MATERIALIZE((fvalue_t *)a);
+	FVALUE_MATERIALIZE((fvalue_t *)b);
+}
+
 gboolean
 fvalue_eq(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_eq);
+	materialize_operands(a, b);
 	return a->ftype->cmp_eq(a, b);
 }
 
@@ -595,6 +625,7 @@ fvalue_ne(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_ne);
+	materialize_operands(a, b);
 	return a->ftype->cmp_ne(a, b);
 }
 
@@ -603,6 +634,7 @@ fvalue_gt(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_gt);
+	materialize_operands(a, b);
 	return a->ftype->cmp_gt(a, b);
 }
 
@@ -611,6 +643,7 @@ fvalue_ge(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_ge);
+	materialize_operands(a, b);
 	return a->ftype->cmp_ge(a, b);
 }
 
@@ -619,6 +652,7 @@ fvalue_lt(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_lt);
+	materialize_operands(a, b);
 	return a->ftype->cmp_lt(a, b);
 }
 
@@ -627,6 +661,7 @@ fvalue_le(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_le);
+	materialize_operands(a, b);
 	return a->ftype->cmp_le(a, b);
 }
 
@@ -635,6 +670,7 @@ fvalue_bitwise_and(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_bitwise_and);
+	materialize_operands(a, b);
 	return a->ftype->cmp_bitwise_and(a, b);
 }
 
@@ -643,6 +679,7 @@ fvalue_contains(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_contains);
+	materialize_operands(a, b);
 	return a->ftype->cmp_contains(a, b);
 }
 
@@ -651,5 +688,6 @@ fvalue_matches(const fvalue_t *a, const fvalue_t *b)
 {
 	/* XXX - check compatibility of a and b */
 	g_assert(a->ftype->cmp_matches);
+	materialize_operands(a, b);
 	return a->ftype->cmp_matches(a, b);
 }
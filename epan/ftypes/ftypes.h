@@ -178,6 +178,9 @@ ftype_can_matches(enum ftenum ftype);
 #include <wsutil/nstime.h>
 #include <epan/dfilter/drange.h>
 
+/* A compiled FT_PCRE pattern; private to ftype-pcre.c */
+typedef struct _fvalue_regex_t fvalue_regex_t;
+
 typedef struct _fvalue_t {
 	ftype_t	*ftype;
 	union {
@@ -194,7 +197,15 @@ typedef struct _fvalue_t {
 		e_guid_t	guid;
 		nstime_t	time;
 		tvbuff_t	*tvb;
-		GRegex	        *re;
+		fvalue_regex_t	*re;
+		/* A value that hasn't been fetched from the packet yet;
+		 * see fvalue_set_tvb_range(). */
+		struct {
+			tvbuff_t	*tvb;
+			gint		offset;
+			gint		length;
+			guint		encoding;
+		} range;
 	} value;
 
 	/* The following is provided for private use
@@ -268,6 +279,20 @@ fvalue_set_string(fvalue_t *fv, const gchar *value);
 void
 fvalue_set_tvbuff(fvalue_t *fv, tvbuff_t *value);
 
+/* Refer to a value in a tvbuff, without fetching it yet; it is
+ * fetched the first time it's needed.  The tvbuff must outlive the
+ * fvalue, and the caller must have checked that the bytes exist.
+ * Returns FALSE, leaving the fvalue untouched, if its type can't
+ * do this. */
+gboolean
+fvalue_set_tvb_range(fvalue_t *fv, tvbuff_t *tvb, gint offset, gint length, guint encoding);
+
+/* Fetch a value set with fvalue_set_tvb_range(), if it hasn't
+ * been fetched yet. Code that looks at fv->value directly must
+ * call this first; the fvalue_*() accessors do it themselves. */
+WS_DLL_PUBLIC void
+fvalue_materialize(fvalue_t *fv);
+
 void
 fvalue_set_uinteger(fvalue_t *fv, guint32 value);
 
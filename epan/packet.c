@@ -45,6 +45,8 @@
 #include "addr_resolv.h"
 #include "tvbuff.h"
 #include "epan_dissect.h"
+#include "epan-int.h"
+#include "conversation.h"
 
 #include "emem.h"
 #include "wmem/wmem.h"
@@ -111,6 +113,58 @@ static GHashTable *registered_dissectors = NULL;
  */
 struct heur_dissector_list {
 	GSList		*dissectors;
+	guint		 num_dissectors;
+	guint		 generation;	/* bumped whenever dissectors changes */
+	guint64		 tried;		/* entries called */
+	guint64		 avoided;	/* entries skipped by the cache */
+};
+
+/*
+ * Per-conversation memory of how a heuristic dissector list fared on the
+ * first HEUR_CACHE_LEARN_PACKETS packets of the conversation.  After that
+ * the entry that accepted is tried first, and entries that rejected every
+ * one of those packets aren't tried at all.
+ */
+#define HEUR_CACHE_LEARN_PACKETS 3
+
+/*
+ * What was learned is forgotten after it has been used for this many
+ * packets, and learned again from the next ones, so that an entry that
+ * rejected the first packets of a conversation still gets to see data
+ * that only becomes recognizable later.
+ */
+#define HEUR_CACHE_RELEARN_PACKETS 64
+
+/*
+ * Lists with fewer entries than this are cheaper to try in full than to
+ * look up the conversation for.
+ */
+#define HEUR_CACHE_MIN_ENTRIES 4
+
+typedef struct heur_conv_cache {
+	struct heur_conv_cache *next;		/* cache for another list */
+	heur_dissector_list_t   sub_dissectors;
+	guint                   generation;	/* of sub_dissectors when built */
+	guint                   learned;	/* packets learned from */
+	guint32                 learn_frame;	/* last frame learned from */
+	guint                   used;		/* packets skipped entries for since */
+	heur_dtbl_entry_t      *accepted;	/* last entry that accepted */
+	guint                   num_entries;
+	guint8                 *rejected;	/* per entry position */
+} heur_conv_cache_t;
+
+/*
+ * The conversation the heuristic lists were last tried for in a packet,
+ * so that lists tried one after the other, or nested, look it up only
+ * once as long as the addresses and ports stay the same.
+ */
+struct heur_conv_memo {
+	address         src;
+	address         dst;
+	port_type       ptype;
+	guint32         srcport;
+	guint32         destport;
+	conversation_t *conversation;
 };
 
 static GHashTable *heur_dissector_lists = NULL;
@@ -428,7 +482,8 @@ final_registration_all_protocols(void)
 /* Creates the top-most tvbuff and calls dissect_frame() */
 void
 dissect_record(epan_dissect_t *edt, int file_type_subtype,
-    struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd, column_info *cinfo)
+    struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd, column_info *cinfo,
+    gboolean metadata_only)
 {
 	const char *volatile record_type;
 	frame_data_t frame_dissector_data;
@@ -492,6 +547,7 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	else
 		frame_dissector_data.pkt_comment = NULL;
 	frame_dissector_data.file_type_subtype = file_type_subtype;
+	frame_dissector_data.metadata_only = metadata_only;
 
 	EP_CHECK_CANARY(("before dissecting record %d",fd->num));
 
@@ -517,7 +573,10 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 
 	EP_CHECK_CANARY(("after dissecting record %d",fd->num));
 
-	fd->flags.visited = 1;
+	/* The dissectors haven't seen the frame if we only looked at
+	 * its metadata. */
+	if (!metadata_only)
+		fd->flags.visited = 1;
 }
 
 /* Creates the top-most tvbuff and calls dissect_file() */
@@ -665,6 +724,56 @@ static int
 call_dissector_work_error(dissector_handle_t handle, tvbuff_t *tvb,
 			  packet_info *pinfo_arg, proto_tree *tree, void *);
 
+static gboolean
+proto_in_array(const GArray *protos, const int proto_id)
+{
+	guint i;
+
+	for (i = 0; i < protos->len; i++) {
+		if (g_array_index(protos, int, i) == proto_id)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * In minimal dissection mode (see epan_set_minimal_dissection()), once
+ * every protocol that the filters, taps and output fields need is in
+ * this packet's layers, there's no point in calling any other dissector,
+ * except for one that may carry a needed protocol again.
+ */
+static gboolean
+minimal_dissection_done(packet_info *pinfo, protocol_t *protocol)
+{
+	GArray            *needed;
+	wmem_list_frame_t *frame;
+	int                proto_id;
+	guint              i;
+
+	if (pinfo->epan == NULL || pinfo->epan->minimal_protos == NULL)
+		return FALSE;
+
+	needed = pinfo->epan->minimal_protos;
+	if (protocol != NULL) {
+		proto_id = proto_get_id(protocol);
+		if (proto_in_array(needed, proto_id) ||
+		    proto_in_array(pinfo->epan->minimal_carriers, proto_id))
+			return FALSE;
+	}
+
+	for (i = 0; i < needed->len; i++) {
+		proto_id = g_array_index(needed, int, i);
+		for (frame = wmem_list_head(pinfo->layers); frame != NULL;
+		     frame = wmem_list_frame_next(frame)) {
+			if (GPOINTER_TO_INT(wmem_list_frame_data(frame)) == proto_id)
+				break;
+		}
+		if (frame == NULL)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 static int
 call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo_arg,
 		    proto_tree *tree, gboolean add_proto_name, void *data)
@@ -683,6 +792,15 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		return 0;
 	}
 
+	if (minimal_dissection_done(pinfo, handle->protocol)) {
+		/*
+		 * Nothing this dissector could add is wanted; claim
+		 * the data so that our caller doesn't go on to try
+		 * other dissectors on it.
+		 */
+		return tvb_captured_length(tvb);
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
 	saved_layers_len = wmem_list_count(pinfo->layers);
@@ -1676,6 +1794,52 @@ dissector_table_foreach (const char *table_name,
 	g_hash_table_foreach(sub_dissectors->hash_table, dissector_table_foreach_func, &info);
 }
 
+static int
+dtbl_entry_proto(const dtbl_entry_t *dtbl_entry)
+{
+	if (dtbl_entry->current == NULL || dtbl_entry->current->protocol == NULL)
+		return -1;
+	return proto_get_id(dtbl_entry->current->protocol);
+}
+
+/*
+ * Add to "carriers" the protocols that are in a dissector table along
+ * with one of "protos".  They are other payloads of whatever carries
+ * those protocols, so they may carry them again, as with IP in IP or
+ * GRE, or the packet quoted by an ICMP error.
+ */
+void
+dissector_tables_get_carriers(const GArray *protos, GArray *carriers)
+{
+	GHashTableIter    tables, entries;
+	gpointer          value;
+	dissector_table_t sub_dissectors;
+	gboolean          found;
+	int               proto_id;
+
+	g_hash_table_iter_init(&tables, dissector_tables);
+	while (g_hash_table_iter_next(&tables, NULL, &value)) {
+		sub_dissectors = (dissector_table_t)value;
+
+		found = FALSE;
+		g_hash_table_iter_init(&entries, sub_dissectors->hash_table);
+		while (!found && g_hash_table_iter_next(&entries, NULL, &value)) {
+			proto_id = dtbl_entry_proto((dtbl_entry_t *)value);
+			found = proto_id != -1 && proto_in_array(protos, proto_id);
+		}
+		if (!found)
+			continue;
+
+		g_hash_table_iter_init(&entries, sub_dissectors->hash_table);
+		while (g_hash_table_iter_next(&entries, NULL, &value)) {
+			proto_id = dtbl_entry_proto((dtbl_entry_t *)value);
+			if (proto_id != -1 && !proto_in_array(protos, proto_id) &&
+			    !proto_in_array(carriers, proto_id))
+				g_array_append_val(carriers, proto_id);
+		}
+	}
+}
+
 /*
  * Walk one dissector table's list of handles calling a user supplied
  * function on each entry.
@@ -1939,6 +2103,8 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const int proto
 	/* do the table insertion */
 	sub_dissectors->dissectors = g_slist_prepend(sub_dissectors->dissectors,
 	    (gpointer)hdtbl_entry);
+	sub_dissectors->num_dissectors++;
+	sub_dissectors->generation++;
 }
 
 
@@ -1973,6 +2139,8 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 		g_slice_free(heur_dtbl_entry_t, found_entry->data);
 		sub_dissectors->dissectors = g_slist_delete_link(sub_dissectors->dissectors,
 		    found_entry);
+		sub_dissectors->num_dissectors--;
+		sub_dissectors->generation++;
 	}
 }
 
@@ -1999,6 +2167,165 @@ heur_dissector_set_enabled(const char *name, heur_dissector_t dissector, const i
 	}
 }
 
+/*
+ * Find the conversation of the packet's current addresses and ports.
+ */
+static conversation_t *
+heur_conv_find(packet_info *pinfo)
+{
+	struct heur_conv_memo *memo = pinfo->heur_conv_memo;
+
+	if (memo != NULL && memo->ptype == pinfo->ptype &&
+	    memo->srcport == pinfo->srcport && memo->destport == pinfo->destport &&
+	    ADDRESSES_EQUAL(&memo->src, &pinfo->src) &&
+	    ADDRESSES_EQUAL(&memo->dst, &pinfo->dst))
+		return memo->conversation;
+
+	if (memo == NULL) {
+		memo = wmem_new(pinfo->pool, struct heur_conv_memo);
+		pinfo->heur_conv_memo = memo;
+	}
+	/* The addresses' data lasts as long as the packet */
+	memo->src          = pinfo->src;
+	memo->dst          = pinfo->dst;
+	memo->ptype        = pinfo->ptype;
+	memo->srcport      = pinfo->srcport;
+	memo->destport     = pinfo->destport;
+	memo->conversation = find_conversation(pinfo->fd->num, &pinfo->src, &pinfo->dst,
+	    pinfo->ptype, pinfo->srcport, pinfo->destport, 0);
+	return memo->conversation;
+}
+
+/*
+ * Forget what a cache learned, and learn from the next packets.
+ */
+static void
+heur_conv_cache_reset(heur_conv_cache_t *cache, heur_dissector_list_t sub_dissectors)
+{
+	cache->generation  = sub_dissectors->generation;
+	cache->learned     = 0;
+	cache->learn_frame = 0;
+	cache->used        = 0;
+	cache->accepted    = NULL;
+	if (cache->rejected != NULL && cache->num_entries == sub_dissectors->num_dissectors) {
+		memset(cache->rejected, 0, cache->num_entries);
+		return;
+	}
+	cache->num_entries = sub_dissectors->num_dissectors;
+	if (cache->rejected != NULL)
+		wmem_free(wmem_file_scope(), cache->rejected);
+	cache->rejected    = wmem_alloc0_array(wmem_file_scope(), guint8, cache->num_entries);
+}
+
+/*
+ * Find the heuristic cache of the current conversation for a list,
+ * creating it if need be; returns NULL if there's no conversation, or
+ * if the list is too short to need one.
+ */
+static heur_conv_cache_t *
+heur_conv_cache_get(heur_dissector_list_t sub_dissectors, packet_info *pinfo)
+{
+	conversation_t    *conversation;
+	heur_conv_cache_t *cache;
+
+	if (pinfo->ptype == PT_NONE ||
+	    sub_dissectors->num_dissectors < HEUR_CACHE_MIN_ENTRIES)
+		return NULL;
+
+	conversation = heur_conv_find(pinfo);
+	if (conversation == NULL)
+		return NULL;
+
+	for (cache = (heur_conv_cache_t *)conversation->heur_cache; cache != NULL;
+	    cache = cache->next) {
+		if (cache->sub_dissectors == sub_dissectors)
+			break;
+	}
+	if (cache == NULL) {
+		cache = wmem_new0(wmem_file_scope(), heur_conv_cache_t);
+		cache->sub_dissectors = sub_dissectors;
+		cache->next = (heur_conv_cache_t *)conversation->heur_cache;
+		conversation->heur_cache = cache;
+	}
+
+	if (cache->rejected == NULL || cache->generation != sub_dissectors->generation) {
+		/* The list changed; start learning again. */
+		heur_conv_cache_reset(cache, sub_dissectors);
+	} else if (cache->used >= HEUR_CACHE_RELEARN_PACKETS && !pinfo->fd->flags.visited) {
+		/* Give the entries skipped so far another chance */
+		heur_conv_cache_reset(cache, sub_dissectors);
+	}
+	return cache;
+}
+
+void
+heur_conv_cache_free(void *heur_cache)
+{
+	heur_conv_cache_t *cache = (heur_conv_cache_t *)heur_cache;
+	heur_conv_cache_t *next;
+
+	for (; cache != NULL; cache = next) {
+		next = cache->next;
+		if (cache->rejected != NULL)
+			wmem_free(wmem_file_scope(), cache->rejected);
+		wmem_free(wmem_file_scope(), cache);
+	}
+}
+
+/*
+ * Try one heuristic dissector; the protocol is added to the layers while
+ * it runs, and removed again if it rejects the packet.
+ */
+static gboolean
+try_heur_entry(heur_dissector_list_t sub_dissectors, heur_dtbl_entry_t *hdtbl_entry,
+	       tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
+{
+	guint saved_layers_len = wmem_list_count(pinfo->layers);
+	int   proto_id;
+
+	proto_id = proto_get_id(hdtbl_entry->protocol);
+	if (hdtbl_entry->protocol != NULL) {
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heurisitc dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+	sub_dissectors->tried++;
+
+	EP_CHECK_CANARY(("before calling heuristic dissector for protocol: %s", proto_get_protocol_filter_name(proto_id)));
+	if ((hdtbl_entry->dissector)(tvb, pinfo, tree, data)) {
+		EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has accepted and dissected packet", proto_get_protocol_filter_name(proto_id)));
+		return TRUE;
+	}
+
+	EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has returned false", proto_get_protocol_filter_name(proto_id)));
+
+	/*
+	 * That dissector didn't accept the packet, so
+	 * remove its protocol's name from the list
+	 * of protocols.
+	 */
+	while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+		wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+	}
+	return FALSE;
+}
+
+static gboolean
+heur_entry_enabled(const heur_dtbl_entry_t *hdtbl_entry)
+{
+	return hdtbl_entry->protocol == NULL ||
+	    (proto_is_protocol_enabled(hdtbl_entry->protocol) && hdtbl_entry->enabled);
+}
+
 gboolean
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **heur_dtbl_entry, void *data)
@@ -2008,9 +2335,10 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	const char        *saved_heur_list_name;
 	GSList            *entry;
 	guint16            saved_can_desegment;
-	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
+	heur_conv_cache_t *cache;
+	gboolean           use_cache, learning;
+	guint              pos;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
 	   then everytime a subdissector is called it is decremented by one.
@@ -2029,65 +2357,99 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	saved_curr_proto = pinfo->current_proto;
 	saved_heur_list_name = pinfo->heur_list_name;
 
-	saved_layers_len = wmem_list_count(pinfo->layers);
 	*heur_dtbl_entry = NULL;
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
-	    entry = g_slist_next(entry)) {
+	if (minimal_dissection_done(pinfo, NULL)) {
+		pinfo->can_desegment = saved_can_desegment;
+		return FALSE;
+	}
+
+	/*
+	 * Only packets after the ones we learned from use the cache, so
+	 * that dissecting a packet again gives the same result.
+	 */
+	cache = heur_conv_cache_get(sub_dissectors, pinfo);
+	use_cache = cache != NULL && cache->learned >= HEUR_CACHE_LEARN_PACKETS &&
+	    pinfo->fd->num > cache->learn_frame;
+	learning = cache != NULL && cache->learned < HEUR_CACHE_LEARN_PACKETS &&
+	    !pinfo->fd->flags.visited;
+
+	if (use_cache && cache->accepted != NULL && heur_entry_enabled(cache->accepted)) {
+		if (try_heur_entry(sub_dissectors, cache->accepted, tvb, pinfo, tree, data)) {
+			/* Everything in front of it in the list was skipped */
+			for (entry = sub_dissectors->dissectors;
+			    entry != NULL && entry->data != cache->accepted;
+			    entry = g_slist_next(entry)) {
+				if (heur_entry_enabled((heur_dtbl_entry_t *)entry->data))
+					sub_dissectors->avoided++;
+			}
+			*heur_dtbl_entry = cache->accepted;
+			status = TRUE;
+		}
+	}
+
+	for (entry = sub_dissectors->dissectors, pos = 0; !status && entry != NULL;
+	    entry = g_slist_next(entry), pos++) {
 		/* XXX - why set this now and above? */
 		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
 		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
 
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
+		if (!heur_entry_enabled(hdtbl_entry)) {
 			/*
 			 * No - don't try this dissector.
 			 */
 			continue;
 		}
 
-		proto_id = proto_get_id(hdtbl_entry->protocol);
-		if (hdtbl_entry->protocol != NULL) {
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heurisitc dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
-
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+		if (use_cache) {
+			if (hdtbl_entry == cache->accepted) {
+				/* Already tried above */
+				continue;
+			}
+			if (cache->rejected[pos] >= HEUR_CACHE_LEARN_PACKETS) {
+				sub_dissectors->avoided++;
+				continue;
+			}
 		}
 
-		pinfo->heur_list_name = hdtbl_entry->list_name;
-
-		EP_CHECK_CANARY(("before calling heuristic dissector for protocol: %s", proto_get_protocol_filter_name(proto_id)));
-		if ((hdtbl_entry->dissector)(tvb, pinfo, tree, data)) {
-			EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has accepted and dissected packet", proto_get_protocol_filter_name(proto_id)));
+		if (try_heur_entry(sub_dissectors, hdtbl_entry, tvb, pinfo, tree, data)) {
 			*heur_dtbl_entry = hdtbl_entry;
 			status = TRUE;
-			break;
-		} else {
-			EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has returned false", proto_get_protocol_filter_name(proto_id)));
-
-			/*
-			 * That dissector didn't accept the packet, so
-			 * remove its protocol's name from the list
-			 * of protocols.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
-			}
+		} else if (learning) {
+			cache->rejected[pos]++;
 		}
 	}
 
+	if (learning) {
+		if (status)
+			cache->accepted = *heur_dtbl_entry;
+		cache->learned++;
+		cache->learn_frame = pinfo->fd->num;
+	} else if (use_cache && !pinfo->fd->flags.visited) {
+		cache->used++;
+	}
+
 	pinfo->current_proto = saved_curr_proto;
 	pinfo->heur_list_name = saved_heur_list_name;
 	pinfo->can_desegment = saved_can_desegment;
 	return status;
 }
 
+void
+heur_dissector_cache_stats(guint64 *tried, guint64 *avoided)
+{
+	GHashTableIter         iter;
+	heur_dissector_list_t  sub_dissectors;
+
+	*tried   = 0;
+	*avoided = 0;
+	g_hash_table_iter_init(&iter, heur_dissector_lists);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&sub_dissectors)) {
+		*tried   += sub_dissectors->tried;
+		*avoided += sub_dissectors->avoided;
+	}
+}
+
 typedef struct heur_dissector_foreach_info {
 	gpointer      caller_data;
 	DATFunc_heur  caller_func;
@@ -2235,6 +2597,10 @@ register_heur_dissector_list(const char *name)
 	/* a pointer to the dissector table. */
 	sub_dissectors = g_slice_new(struct heur_dissector_list);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->num_dissectors = 0;
+	sub_dissectors->generation = 0;
+	sub_dissectors->tried = 0;
+	sub_dissectors->avoided = 0;
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
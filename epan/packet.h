@@ -82,6 +82,13 @@ extern void packet_init(void);
 extern void packet_cache_proto_handles(void);
 extern void packet_cleanup(void);
 
+/* Free the heuristic cache of a conversation that is being expired */
+extern void heur_conv_cache_free(void *heur_cache);
+
+/* Find the protocols that may carry one of protos again, for minimal
+ * dissection; see epan_set_minimal_dissection() */
+extern void dissector_tables_get_carriers(const GArray *protos, GArray *carriers);
+
 /* Handle for dissectors you call directly or register with "dissector_add_uint()".
    This handle is opaque outside of "packet.c". */
 struct dissector_handle;
@@ -397,6 +404,11 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
  *  until we find one that recognizes the protocol.
  *  Call this while the parent dissector running.
  *
+ *  Once the first few packets of a conversation have been seen, the
+ *  dissector that accepted them is tried first for the rest of the
+ *  conversation, and dissectors that rejected all of them aren't tried;
+ *  lists of only a few dissectors are always tried in full.
+ *
  * @param sub_dissectors the sub-dissector list
  * @param tvb the tvbuff with the (remaining) packet data
  * @param pinfo the packet info of this packet (additional info)
@@ -408,6 +420,15 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
 WS_DLL_PUBLIC gboolean dissector_try_heuristic(heur_dissector_list_t sub_dissectors,
     tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **hdtbl_entry, void *data);
 
+/** Get the number of heuristic dissectors tried so far, and the number
+ *  not tried because of what earlier packets of the same conversation
+ *  showed, summed over the counts kept by each heuristic dissector list.
+ *
+ * @param[out] tried number of heuristic dissectors called
+ * @param[out] avoided number of heuristic dissectors skipped
+ */
+WS_DLL_PUBLIC void heur_dissector_cache_stats(guint64 *tried, guint64 *avoided);
+
 /** Find a heuristic dissector table by table name.
  *
  * @param name name of the dissector table
@@ -600,14 +621,18 @@ typedef struct frame_data_s
 {
     int file_type_subtype;
     const gchar  *pkt_comment; /**< NULL if not available */
+    gboolean metadata_only; /**< don't dissect the frame's contents */
 } frame_data_t;
 
 /*
  * Dissectors should never modify the record data.
+ *
+ * If metadata_only is TRUE, the frame dissector adds the fields that
+ * describe the record, but doesn't dissect its contents.
  */
 extern void dissect_record(struct epan_dissect *edt, int file_type_subtype,
     struct wtap_pkthdr *phdr, tvbuff_t *tvb,
-    frame_data *fd, column_info *cinfo);
+    frame_data *fd, column_info *cinfo, gboolean metadata_only);
 
 /*
  * Dissectors should never modify the packet data.
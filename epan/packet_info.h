@@ -169,6 +169,7 @@ typedef struct _packet_info {
   struct epan_session *epan;
   nstime_t     rel_ts;       /**< Relative timestamp (yes, it can be negative) */
   const gchar *heur_list_name;    /**< name of heur list if this packet is being heuristically dissected */
+  struct heur_conv_memo *heur_conv_memo; /**< conversation the heuristic lists were tried for, see dissector_try_heuristic() */
 } packet_info;
 
 /** @} */
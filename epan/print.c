@@ -35,6 +35,7 @@
 #include <epan/packet-range.h>
 #include <epan/print.h>
 #include <epan/charsets.h>
+#include <epan/ipv4.h>
 #include <epan/dissectors/packet-data.h>
 #include <epan/dissectors/packet-frame.h>
 #include <wsutil/filesystem.h>
@@ -44,6 +45,20 @@
 #define PDML_VERSION "0"
 #define PSML_VERSION "0"
 
+#define COLUMNAR_MAGIC          "WSCOLS\r\n"
+#define COLUMNAR_VERSION        1
+#define COLUMNAR_ROWS_PER_GROUP 65536
+
+/* Column types in the -T columnar format */
+enum {
+    COLUMNAR_UINT64 = 1,
+    COLUMNAR_INT64,
+    COLUMNAR_DOUBLE,
+    COLUMNAR_IPV4,
+    COLUMNAR_TIME,
+    COLUMNAR_STRING
+};
+
 typedef struct {
     int                  level;
     print_stream_t      *stream;
@@ -64,9 +79,12 @@ typedef struct {
 } write_pdml_data;
 
 typedef struct {
-    output_fields_t *fields;
-    epan_dissect_t  *edt;
-} write_field_data_t;
+    guint32  type;         /* COLUMNAR_xxx */
+    guint32  num_values;
+    GArray  *rows;         /* guint32 LE: index of each row's first value */
+    GArray  *value_ends;   /* guint32 LE: end of each string value */
+    GString *values;
+} columnar_column_t;
 
 struct _output_fields {
     gboolean     print_header;
@@ -74,8 +92,12 @@ struct _output_fields {
     gchar        occurrence;
     gchar        aggregator;
     GPtrArray   *fields;
-    GHashTable  *field_indicies;
-    GPtrArray  **field_values;
+    int         *field_ids;     /* first hf id of each field, -1 for columns */
+    GPtrArray  **tree_finfos;   /* values in tree order of the fields with several ids */
+    GHashTable  *tree_finfo_ids; /* hf id -> the tree_finfos array of its name */
+    GString     *line;          /* reused for every packet */
+    columnar_column_t *columns; /* -T columnar: the current row group */
+    guint32      num_rows;
     gchar        quote;
     gboolean     includes_col_fields;
 };
@@ -91,8 +113,6 @@ static void print_escaped_xml(FILE *fh, const char *unescaped_string);
 
 static void print_pdml_geninfo(proto_tree *tree, FILE *fh);
 
-static void proto_tree_get_node_field_values(proto_node *node, gpointer data);
-
 gboolean
 proto_tree_print(print_args_t *print_args, epan_dissect_t *edt,
                  GHashTable *output_only_tables, print_stream_t *stream)
@@ -137,14 +157,7 @@ proto_tree_print_node(proto_node *node, gpointer data)
     if (!pdata->success)
         return;
 
-    /* was a free format label produced? */
-    if (fi->rep) {
-        label_ptr = fi->rep->representation;
-    }
-    else { /* no, make a generic label */
-        label_ptr = label_str;
-        proto_item_fill_label(fi, label_str);
-    }
+    label_ptr = proto_item_get_label(fi, label_str);
 
     if (PROTO_ITEM_IS_GENERATED(node))
         label_ptr = g_strconcat("[", label_ptr, "]", NULL);
@@ -287,7 +300,7 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
     if (fi->hfinfo->id == hf_text_only) {
         /* Get the text */
         if (fi->rep) {
-            label_ptr = fi->rep->representation;
+            label_ptr = proto_item_get_label(fi, NULL);
         }
         else {
             label_ptr = "";
@@ -355,16 +368,9 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
         print_escaped_xml(pdata->fh, fi->hfinfo->name);
 #endif
 
-        if (fi->rep) {
-            fputs("\" showname=\"", pdata->fh);
-            print_escaped_xml(pdata->fh, fi->rep->representation);
-        }
-        else {
-            label_ptr = label_str;
-            proto_item_fill_label(fi, label_str);
-            fputs("\" showname=\"", pdata->fh);
-            print_escaped_xml(pdata->fh, label_ptr);
-        }
+        label_ptr = proto_item_get_label(fi, label_str);
+        fputs("\" showname=\"", pdata->fh);
+        print_escaped_xml(pdata->fh, label_ptr);
 
         if (PROTO_ITEM_IS_HIDDEN(node))
             fprintf(pdata->fh, "\" hide=\"yes");
@@ -1000,15 +1006,28 @@ void output_fields_free(output_fields_t* fields)
     if (NULL != fields->fields) {
         gsize i;
 
-        if (NULL != fields->field_indicies) {
-            /* Keys are stored in fields->fields, values are
-             * integers.
-             */
-            g_hash_table_destroy(fields->field_indicies);
+        if (NULL != fields->columns) {
+            for(i = 0; i < fields->fields->len; ++i) {
+                g_array_free(fields->columns[i].rows, TRUE);
+                if (NULL != fields->columns[i].value_ends)
+                    g_array_free(fields->columns[i].value_ends, TRUE);
+                g_string_free(fields->columns[i].values, TRUE);
+            }
+            g_free(fields->columns);
         }
-
-        if (NULL != fields->field_values) {
-            g_free(fields->field_values);
+        if (NULL != fields->tree_finfo_ids) {
+            /* A field given more than once shares its array */
+            for(i = 0; i < fields->fields->len; ++i) {
+                if (NULL != fields->tree_finfos[i] &&
+                    g_hash_table_remove(fields->tree_finfo_ids, GINT_TO_POINTER(fields->field_ids[i])))
+                    g_ptr_array_free(fields->tree_finfos[i], TRUE);
+            }
+            g_hash_table_destroy(fields->tree_finfo_ids);
+        }
+        g_free(fields->tree_finfos);
+        g_free(fields->field_ids);
+        if (NULL != fields->line) {
+            g_string_free(fields->line, TRUE);
         }
 
         for(i = 0; i < fields->fields->len; ++i) {
@@ -1199,6 +1218,127 @@ gboolean output_fields_has_cols(output_fields_t* fields)
     return fields->includes_col_fields;
 }
 
+gboolean output_fields_has_field(output_fields_t* fields, const gchar* field)
+{
+    gsize i;
+
+    g_assert(fields);
+    if (NULL == fields->fields)
+        return FALSE;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        if (0 == strcmp((const gchar *)g_ptr_array_index(fields->fields, i), field))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Look up the fields once; a field can be registered several times
+ * under the same name, so remember the first of them.  The values of
+ * such a field are in one array per id, which doesn't say in which
+ * order they are in the tree, so they are collected from the tree
+ * instead.
+ */
+static void output_fields_lookup_ids(output_fields_t* fields)
+{
+    gsize i;
+
+    fields->field_ids = g_new(int, fields->fields->len);  /* free'd in output_fields_free() */
+    fields->tree_finfos = g_new0(GPtrArray *, fields->fields->len);  /* free'd in output_fields_free() */
+    for(i = 0; i < fields->fields->len; ++i) {
+        const gchar       *field  = (const gchar *)g_ptr_array_index(fields->fields, i);
+        header_field_info *hfinfo = proto_registrar_get_byname(field);
+
+        /* Column fields ("_ws.col.*") aren't registered */
+        if (hfinfo) {
+            while (hfinfo->same_name_prev_id != -1)
+                hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+            fields->field_ids[i] = hfinfo->id;
+        } else {
+            fields->field_ids[i] = -1;
+            continue;
+        }
+
+        if (hfinfo->same_name_next == NULL)
+            continue;
+        if (NULL == fields->tree_finfo_ids) {
+            fields->tree_finfo_ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+        }
+        fields->tree_finfos[i] = (GPtrArray *)g_hash_table_lookup(fields->tree_finfo_ids, GINT_TO_POINTER(hfinfo->id));
+        if (NULL == fields->tree_finfos[i]) {
+            fields->tree_finfos[i] = g_ptr_array_new();
+            for (; hfinfo; hfinfo = hfinfo->same_name_next)
+                g_hash_table_insert(fields->tree_finfo_ids, GINT_TO_POINTER(hfinfo->id), fields->tree_finfos[i]);
+        }
+    }
+}
+
+static void collect_tree_finfos(proto_node *node, gpointer data)
+{
+    output_fields_t *fields = (output_fields_t *)data;
+    field_info      *fi     = PNODE_FINFO(node);
+    GPtrArray       *finfos;
+
+    if (fi != NULL) {
+        finfos = (GPtrArray *)g_hash_table_lookup(fields->tree_finfo_ids, GINT_TO_POINTER(fi->hfinfo->id));
+        if (finfos != NULL)
+            g_ptr_array_add(finfos, fi);
+    }
+
+    if (node->first_child != NULL) {
+        proto_tree_children_foreach(node, collect_tree_finfos, data);
+    }
+}
+
+/* Collect the values of the fields with several ids, if there are any */
+static void output_fields_collect_tree_finfos(output_fields_t *fields, epan_dissect_t *edt)
+{
+    gsize i;
+
+    if (NULL == fields->tree_finfo_ids) {
+        return;
+    }
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        if (NULL != fields->tree_finfos[i])
+            g_ptr_array_set_size(fields->tree_finfos[i], 0);
+    }
+    proto_tree_children_foreach(edt->tree, collect_tree_finfos, fields);
+}
+
+/* The values of a field, in the order in which they were added to the tree */
+static GPtrArray *output_fields_finfos(output_fields_t *fields, gsize i, epan_dissect_t *edt)
+{
+    if (NULL != fields->tree_finfos[i]) {
+        return fields->tree_finfos[i];
+    }
+    return proto_get_finfo_ptr_array(edt->tree, fields->field_ids[i]);
+}
+
+void output_fields_prime_edt(epan_dissect_t *edt, output_fields_t* fields)
+{
+    gsize              i;
+    header_field_info *hfinfo;
+
+    g_assert(fields);
+
+    if (NULL == fields->fields) {
+        return;
+    }
+
+    if (NULL == fields->field_ids) {
+        output_fields_lookup_ids(fields);
+    }
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        if (fields->field_ids[i] == -1)
+            continue;
+        for (hfinfo = proto_registrar_get_nth(fields->field_ids[i]); hfinfo; hfinfo = hfinfo->same_name_next)
+            proto_tree_prime_hfid(edt->tree, hfinfo->id);
+    }
+}
+
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
     gsize i;
@@ -1221,164 +1361,503 @@ void write_fields_preamble(output_fields_t* fields, FILE *fh)
     fputc('\n', fh);
 }
 
-static void format_field_values(output_fields_t* fields, gpointer field_index, const gchar* value)
+/*
+ * Append the value of a field to the line, as get_node_field_value()
+ * would return it, without allocating a string for it where we can.
+ */
+static void append_field_value(GString *line, field_info *fi, epan_dissect_t *edt)
+{
+    header_field_info *hfinfo = fi->hfinfo;
+    gchar             *value;
+    gsize              start;
+    int                len;
+
+    if (hfinfo->id != hf_text_only && hfinfo->id != proto_data &&
+        hfinfo->type != FT_PROTOCOL && hfinfo->type != FT_NONE &&
+        fi->value.ftype->val_to_string_repr != NULL) {
+        len = fvalue_string_repr_len(&fi->value, FTREPR_DISPLAY, hfinfo->display);
+        if (len >= 0) {
+            start = line->len;
+            g_string_set_size(line, start + len);
+            fvalue_to_string_repr(&fi->value, FTREPR_DISPLAY, hfinfo->display, line->str + start);
+            /* The length is an upper bound for some types */
+            g_string_truncate(line, start + strlen(line->str + start));
+            return;
+        }
+    }
+
+    value = get_node_field_value(fi, edt);
+    if (value != NULL) {
+        g_string_append(line, value);
+        g_free(value);
+    }
+}
+
+/*
+ * Append one occurrence of a field to the line, preceded by the
+ * aggregator if it isn't the first one.  Empty values don't count as
+ * occurrences.  Returns TRUE if anything was appended.
+ */
+static gboolean append_field_occurrence(output_fields_t *fields, gboolean first,
+                                        field_info *fi, epan_dissect_t *edt)
+{
+    gsize start = fields->line->len;
+    gsize value_start;
+
+    if (!first)
+        g_string_append_c(fields->line, fields->aggregator);
+    value_start = fields->line->len;
+    append_field_value(fields->line, fi, edt);
+    if (fields->line->len == value_start) {
+        g_string_truncate(fields->line, start);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Append the occurrences of a field in the packet that the occurrence
+ * option selects, in the order in which they were added to the tree.
+ */
+static void append_field_occurrences(output_fields_t *fields, gsize field, epan_dissect_t *edt)
 {
-    guint      indx;
-    GPtrArray* fv_p;
+    GPtrArray *finfos = output_fields_finfos(fields, field, edt);
+    gboolean   first = TRUE;
+    gsize      start = fields->line->len;
+    gsize      last_start;
+    guint      i;
 
-    if ((NULL == value) || ('\0' == *value))
+    if (finfos == NULL)
         return;
+    for (i = 0; i < finfos->len; i++) {
+        last_start = fields->line->len;
+        if (append_field_occurrence(fields, first, (field_info *)g_ptr_array_index(finfos, i), edt)) {
+            if (fields->occurrence == 'f')
+                return;
+            if (fields->occurrence == 'l' && !first) {
+                /* Only keep the last one */
+                g_string_erase(fields->line, start, last_start - start + 1);
+            }
+            first = FALSE;
+        }
+    }
+}
+
+/* The same for the columns with the title given in a "_ws.col." field */
+static void append_column_occurrences(output_fields_t *fields, const gchar *field, column_info *cinfo)
+{
+    const gchar *title = field + strlen(COLUMN_FIELD_FILTER);
+    gboolean     first = TRUE;
+    gint         col;
+    gsize        start = fields->line->len;
+
+    for (col = 0; col < cinfo->num_cols; col++) {
+        if (strcmp(cinfo->col_title[col], title) != 0 || cinfo->col_data[col][0] == '\0')
+            continue;
+        switch (fields->occurrence) {
+        case 'l':
+            /* Only keep the last one */
+            g_string_truncate(fields->line, start);
+            break;
+        case 'a':
+            if (!first)
+                g_string_append_c(fields->line, fields->aggregator);
+            break;
+        }
+        g_string_append(fields->line, cinfo->col_data[col]);
+        if (fields->occurrence == 'f')
+            return;
+        first = FALSE;
+    }
+}
+
+/*
+ * The fields were primed with output_fields_prime_edt() before the
+ * packet was dissected, so their values are in the tree's arrays of
+ * interesting fields rather than having to be looked for in the tree,
+ * except for those of fields registered under several ids.
+ */
+void write_fields_proto_tree(output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh)
+{
+    gsize  i;
+    gsize  start;
+    gsize  value_start;
 
-    /* Unwrap change made to disambiguiate zero / null */
-    indx = GPOINTER_TO_UINT(field_index) - 1;
+    g_assert(fields);
+    g_assert(fields->fields);
+    g_assert(edt);
+    g_assert(fh);
 
-    if (fields->field_values[indx] == NULL) {
-        fields->field_values[indx] = g_ptr_array_new();
+    if (NULL == fields->field_ids) {
+        output_fields_lookup_ids(fields);
     }
+    if (NULL == fields->line) {
+        fields->line = g_string_sized_new(256);  /* free'd in output_fields_free() */
+    }
+    g_string_truncate(fields->line, 0);
+    output_fields_collect_tree_finfos(fields, edt);
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        if (0 != i) {
+            g_string_append_c(fields->line, fields->separator);
+        }
+        start = fields->line->len;
+        if (fields->quote != '\0') {
+            g_string_append_c(fields->line, fields->quote);
+        }
+        value_start = fields->line->len;
+
+        if (fields->field_ids[i] != -1) {
+            append_field_occurrences(fields, i, edt);
+        } else if (fields->includes_col_fields && cinfo != NULL) {
+            append_column_occurrences(fields, (const gchar *)g_ptr_array_index(fields->fields, i), cinfo);
+        }
 
-    /* Essentially: fieldvalues[indx] is a 'GPtrArray *' with each array entry */
-    /*  pointing to a string which is (part of) the final output string.       */
+        /* No quotes around a field that isn't there */
+        if (fields->line->len == value_start) {
+            g_string_truncate(fields->line, start);
+        } else if (fields->quote != '\0') {
+            g_string_append_c(fields->line, fields->quote);
+        }
+    }
 
-    fv_p = fields->field_values[indx];
+    fwrite(fields->line->str, 1, fields->line->len, fh);
+}
 
-    switch (fields->occurrence) {
-    case 'f':
-        /* print the value of only the first occurrence of the field */
-        if (g_ptr_array_len(fv_p) != 0)
-            return;
+void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
+{
+    /* Nothing to do */
+}
+
+/*
+ * -T columnar writes the fields in a binary format that can be loaded
+ * into a data frame without parsing text.  All integers are
+ * little-endian, and nothing is aligned.
+ *
+ * The stream starts with the magic "WSCOLS\r\n", a guint32 version
+ * (1) and a guint32 number of columns; then for each column a guint32
+ * type and a guint32 length followed by that many bytes of the field
+ * name.
+ *
+ * Then come row groups of up to 65536 packets.  A row group is a
+ * guint32 number of rows followed by a chunk for each column, in
+ * order; a row group with no rows ends the stream.  A chunk is a
+ * guint32 length of the rest of the chunk, then rows + 1 guint32s
+ * giving the index of the first value of each row and the end of the
+ * last, then the values.  Every column is thus a list column; a field
+ * that isn't in a packet is an empty list, and with -E occurrence=f
+ * or l no list has more than one value.  Unlike with -T fields, empty
+ * strings are kept, as values of length 0.
+ *
+ * The values of a column depend on its type:
+ *
+ *  1 uint64  unsigned integers and booleans (0 or 1), 8 bytes each
+ *  2 int64   signed integers, 8 bytes each
+ *  3 double  floating-point numbers, as 8-byte IEEE 754 doubles
+ *  4 ipv4    IPv4 addresses, 4 bytes each in network byte order
+ *  5 time    int64 nanoseconds, since the epoch for absolute times
+ *  6 string  values + 1 guint32 offsets of the start of each value
+ *            and the end of the last within the UTF-8 text that
+ *            follows; values as -T fields would print them
+ *
+ * The type of a field's column comes from its ftenum; fields that
+ * don't map to one of the above, column fields, and names registered
+ * for fields of different types are string columns.
+ */
+static guint32 columnar_type(enum ftenum type)
+{
+    if (type == FT_BOOLEAN || IS_FT_UINT(type))
+        return COLUMNAR_UINT64;
+    if (IS_FT_INT(type))
+        return COLUMNAR_INT64;
+    if (type == FT_FLOAT || type == FT_DOUBLE)
+        return COLUMNAR_DOUBLE;
+    if (type == FT_IPv4)
+        return COLUMNAR_IPV4;
+    if (IS_FT_TIME(type))
+        return COLUMNAR_TIME;
+    return COLUMNAR_STRING;
+}
+
+static void array_append_le32(GArray *array, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_array_append_val(array, value);
+}
+
+static void string_append_le32(GString *str, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_string_append_len(str, (const gchar *)&value, sizeof value);
+}
+
+static void string_append_le64(GString *str, guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    g_string_append_len(str, (const gchar *)&value, sizeof value);
+}
+
+/* Start a row group */
+static void columnar_start_rows(output_fields_t *fields)
+{
+    gsize i;
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        columnar_column_t *col = &fields->columns[i];
+
+        col->num_values = 0;
+        g_array_set_size(col->rows, 0);
+        array_append_le32(col->rows, 0);
+        g_string_truncate(col->values, 0);
+        if (NULL != col->value_ends) {
+            g_array_set_size(col->value_ends, 0);
+            array_append_le32(col->value_ends, 0);
+        }
+    }
+    fields->num_rows = 0;
+}
+
+static void columnar_columns_new(output_fields_t *fields)
+{
+    header_field_info *hfinfo;
+    gsize              i;
+
+    if (NULL == fields->field_ids) {
+        output_fields_lookup_ids(fields);
+    }
+
+    fields->columns = g_new0(columnar_column_t, fields->fields->len);  /* free'd in output_fields_free() */
+    for(i = 0; i < fields->fields->len; ++i) {
+        columnar_column_t *col = &fields->columns[i];
+
+        if (fields->field_ids[i] == -1) {
+            col->type = COLUMNAR_STRING;
+        } else {
+            hfinfo = proto_registrar_get_nth(fields->field_ids[i]);
+            col->type = columnar_type(hfinfo->type);
+            for (hfinfo = hfinfo->same_name_next; hfinfo; hfinfo = hfinfo->same_name_next) {
+                if (columnar_type(hfinfo->type) != col->type)
+                    col->type = COLUMNAR_STRING;
+            }
+        }
+        col->rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+        if (col->type == COLUMNAR_STRING)
+            col->value_ends = g_array_new(FALSE, FALSE, sizeof(guint32));
+        col->values = g_string_new(NULL);
+    }
+    columnar_start_rows(fields);
+}
+
+/*
+ * Make the value just appended the current row's only value, for
+ * -E occurrence=l.
+ */
+static void columnar_keep_last_value(columnar_column_t *col)
+{
+    guint32 first = GUINT32_FROM_LE(g_array_index(col->rows, guint32, col->rows->len - 1));
+    guint32 last  = col->num_values - 1;
+    guint32 width, row_start, start, end;
+
+    if (last == first)
+        return;
+    if (NULL != col->value_ends) {
+        row_start = GUINT32_FROM_LE(g_array_index(col->value_ends, guint32, first));
+        start     = GUINT32_FROM_LE(g_array_index(col->value_ends, guint32, last));
+        end       = GUINT32_FROM_LE(g_array_index(col->value_ends, guint32, last + 1));
+        memmove(col->values->str + row_start, col->values->str + start, end - start);
+        g_string_truncate(col->values, row_start + (end - start));
+        g_array_set_size(col->value_ends, first + 1);
+        array_append_le32(col->value_ends, row_start + (end - start));
+    } else {
+        width = col->type == COLUMNAR_IPV4 ? 4 : 8;
+        memmove(col->values->str + first * width, col->values->str + last * width, width);
+        g_string_truncate(col->values, (first + 1) * width);
+    }
+    col->num_values = first + 1;
+}
+
+/* Append a value to a column; an empty string is a value of length 0 */
+static void columnar_append_value(columnar_column_t *col, field_info *fi, epan_dissect_t *edt)
+{
+    enum ftenum  type = fi->hfinfo->type;
+    nstime_t    *t;
+    guint32      addr;
+    gdouble      d;
+    guint64      u;
+
+    switch (col->type) {
+    case COLUMNAR_UINT64:
+        if (type == FT_BOOLEAN)
+            u = fvalue_get_integer64(&fi->value) != 0;
+        else if (type == FT_UINT64)
+            u = fvalue_get_integer64(&fi->value);
+        else
+            u = fvalue_get_uinteger(&fi->value);
+        string_append_le64(col->values, u);
         break;
-    case 'l':
-        /* print the value of only the last occurrence of the field */
-        g_ptr_array_set_size(fv_p, 0);
+    case COLUMNAR_INT64:
+        if (type == FT_INT64)
+            u = fvalue_get_integer64(&fi->value);
+        else
+            u = (guint64)(gint64)fvalue_get_sinteger(&fi->value);
+        string_append_le64(col->values, u);
         break;
-    case 'a':
-        /* print the value of all accurrences of the field */
-        /* If not the first, add the 'aggregator' */
-        if (g_ptr_array_len(fv_p) > 0) {
-            g_ptr_array_add(fv_p, (gpointer)g_strdup_printf("%c", fields->aggregator));
-        }
+    case COLUMNAR_DOUBLE:
+        d = fvalue_get_floating(&fi->value);
+        memcpy(&u, &d, sizeof u);
+        string_append_le64(col->values, u);
+        break;
+    case COLUMNAR_IPV4:
+        addr = ipv4_get_net_order_addr((ipv4_addr *)fvalue_get(&fi->value));
+        g_string_append_len(col->values, (const gchar *)&addr, sizeof addr);
+        break;
+    case COLUMNAR_TIME:
+        t = (nstime_t *)fvalue_get(&fi->value);
+        string_append_le64(col->values, (guint64)((gint64)t->secs * G_GINT64_CONSTANT(1000000000) + t->nsecs));
         break;
     default:
-        g_assert_not_reached();
+        append_field_value(col->values, fi, edt);
+        array_append_le32(col->value_ends, (guint32)col->values->len);
         break;
     }
+    col->num_values++;
+}
+
+static void columnar_append_field_values(output_fields_t *fields, columnar_column_t *col,
+                                         gsize field, epan_dissect_t *edt)
+{
+    GPtrArray *finfos = output_fields_finfos(fields, field, edt);
+    guint      i;
 
-    g_ptr_array_add(fv_p, (gpointer)value);
+    if (finfos == NULL)
+        return;
+    for (i = 0; i < finfos->len; i++) {
+        columnar_append_value(col, (field_info *)g_ptr_array_index(finfos, i), edt);
+        if (fields->occurrence == 'f')
+            return;
+        if (fields->occurrence == 'l')
+            columnar_keep_last_value(col);
+    }
 }
 
-static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
+static void columnar_append_column_values(output_fields_t *fields, columnar_column_t *col,
+                                          const gchar *field, column_info *cinfo)
 {
-    write_field_data_t *call_data;
-    field_info *fi;
-    gpointer    field_index;
+    const gchar *title = field + strlen(COLUMN_FIELD_FILTER);
+    gint         col_num;
 
-    call_data = (write_field_data_t *)data;
-    fi = PNODE_FINFO(node);
+    for (col_num = 0; col_num < cinfo->num_cols; col_num++) {
+        if (strcmp(cinfo->col_title[col_num], title) != 0)
+            continue;
+        g_string_append(col->values, cinfo->col_data[col_num]);
+        array_append_le32(col->value_ends, (guint32)col->values->len);
+        col->num_values++;
+        if (fields->occurrence == 'f')
+            return;
+        if (fields->occurrence == 'l')
+            columnar_keep_last_value(col);
+    }
+}
 
-    /* dissection with an invisible proto tree? */
-    g_assert(fi);
+void write_columnar_preamble(output_fields_t *fields, FILE *fh)
+{
+    GString *header;
+    gsize    i;
 
-    field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
-    if (NULL != field_index) {
-        format_field_values(call_data->fields, field_index,
-                            get_node_field_value(fi, call_data->edt) /* g_ alloc'd string */
-            );
+    g_assert(fields);
+    g_assert(fields->fields);
+    g_assert(fh);
+
+    if (NULL == fields->columns) {
+        columnar_columns_new(fields);
     }
 
-    /* Recurse here. */
-    if (node->first_child != NULL) {
-        proto_tree_children_foreach(node, proto_tree_get_node_field_values,
-                                    call_data);
+    header = g_string_new(COLUMNAR_MAGIC);
+    string_append_le32(header, COLUMNAR_VERSION);
+    string_append_le32(header, (guint32)fields->fields->len);
+    for(i = 0; i < fields->fields->len; ++i) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        string_append_le32(header, fields->columns[i].type);
+        string_append_le32(header, (guint32)strlen(field));
+        g_string_append(header, field);
     }
+    fwrite(header->str, 1, header->len, fh);
+    g_string_free(header, TRUE);
 }
 
-void write_fields_proto_tree(output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh)
+/*
+ * Like write_fields_proto_tree(), this relies on the fields having
+ * been primed with output_fields_prime_edt().  The packet's values are
+ * added to the current row group, which is written out when it's full.
+ */
+void write_columnar_proto_tree(output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh)
 {
-    gsize     i;
-    gint      col;
-    gchar    *col_name;
-    gpointer  field_index;
-
-    write_field_data_t data;
+    gsize i;
 
     g_assert(fields);
     g_assert(fields->fields);
     g_assert(edt);
     g_assert(fh);
 
-    data.fields = fields;
-    data.edt = edt;
+    if (NULL == fields->columns) {
+        columnar_columns_new(fields);
+    }
+    output_fields_collect_tree_finfos(fields, edt);
 
-    if (NULL == fields->field_indicies) {
-        /* Prepare a lookup table from string abbreviation for field to its index. */
-        fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
+    for(i = 0; i < fields->fields->len; ++i) {
+        columnar_column_t *col = &fields->columns[i];
 
-        i = 0;
-        while (i < fields->fields->len) {
-            gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
-            /* Store field indicies +1 so that zero is not a valid value,
-             * and can be distinguished from NULL as a pointer.
-             */
-            ++i;
-            g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
+        if (fields->field_ids[i] != -1) {
+            columnar_append_field_values(fields, col, i, edt);
+        } else if (fields->includes_col_fields && cinfo != NULL) {
+            columnar_append_column_values(fields, col, (const gchar *)g_ptr_array_index(fields->fields, i), cinfo);
         }
+        array_append_le32(col->rows, col->num_values);
     }
 
-    /* Array buffer to store values for this packet              */
-    /*  Allocate an array for the 'GPtrarray *' the first time   */
-    /*   ths function is invoked for a file;                     */
-    /*  Any and all 'GPtrArray *' are freed (after use) each     */
-    /*   time (each packet) this function is invoked for a flle. */
-    /* XXX: ToDo: use packet-scope'd memory & (if/when implemented) wmem ptr_array */
-    if (NULL == fields->field_values)
-        fields->field_values = g_new0(GPtrArray*, fields->fields->len);  /* free'd in output_fields_free() */
+    if (++fields->num_rows == COLUMNAR_ROWS_PER_GROUP) {
+        write_columnar_row_group(fields, fh);
+    }
+}
 
-    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
-                                &data);
+void write_columnar_row_group(output_fields_t *fields, FILE *fh)
+{
+    guint32 word;
+    guint32 chunk_len;
+    gsize   i;
 
-    if (fields->includes_col_fields) {
-        for (col = 0; col < cinfo->num_cols; col++) {
-            /* Prepend COLUMN_FIELD_FILTER as the field name */
-            col_name = ep_strdup_printf("%s%s", COLUMN_FIELD_FILTER, cinfo->col_title[col]);
-            field_index = g_hash_table_lookup(fields->field_indicies, col_name);
+    g_assert(fields);
+    g_assert(fh);
 
-            if (NULL != field_index) {
-                format_field_values(fields, field_index, g_strdup(cinfo->col_data[col]));
-            }
-        }
+    if (NULL == fields->columns || 0 == fields->num_rows) {
+        return;
     }
 
+    word = GUINT32_TO_LE(fields->num_rows);
+    fwrite(&word, sizeof word, 1, fh);
     for(i = 0; i < fields->fields->len; ++i) {
-        if (0 != i) {
-            fputc(fields->separator, fh);
-        }
-        if (NULL != fields->field_values[i]) {
-            GPtrArray *fv_p;
-            gchar * str;
-            gsize j;
-            fv_p = fields->field_values[i];
-            if (fields->quote != '\0') {
-                fputc(fields->quote, fh);
-            }
-
-            /* Output the array of (partial) field values */
-            for (j = 0; j < g_ptr_array_len(fv_p); j++ ) {
-                str = (gchar *)g_ptr_array_index(fv_p, j);
-                fputs(str, fh);
-                g_free(str);
-            }
-            if (fields->quote != '\0') {
-                fputc(fields->quote, fh);
-            }
-            g_ptr_array_free(fv_p, TRUE);  /* get ready for the next packet */
-            fields->field_values[i] = NULL;
-        }
+        columnar_column_t *col = &fields->columns[i];
+
+        chunk_len = (guint32)(col->rows->len * sizeof(guint32) + col->values->len);
+        if (NULL != col->value_ends)
+            chunk_len += (guint32)(col->value_ends->len * sizeof(guint32));
+        word = GUINT32_TO_LE(chunk_len);
+        fwrite(&word, sizeof word, 1, fh);
+        fwrite(col->rows->data, sizeof(guint32), col->rows->len, fh);
+        if (NULL != col->value_ends)
+            fwrite(col->value_ends->data, sizeof(guint32), col->value_ends->len, fh);
+        fwrite(col->values->str, 1, col->values->len, fh);
     }
+    columnar_start_rows(fields);
 }
 
-void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
+void write_columnar_finale(output_fields_t *fields, FILE *fh)
 {
-    /* Nothing to do */
+    guint32 end = 0;
+
+    write_columnar_row_group(fields, fh);
+    fwrite(&end, sizeof end, 1, fh);
 }
 
 /* Returns an g_malloced string */
@@ -1388,7 +1867,7 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
         /* Text label.
          * Get the text */
         if (fi->rep) {
-            return g_strdup(fi->rep->representation);
+            return g_strdup(proto_item_get_label(fi, NULL));
         }
         else {
             return get_field_hex_value(edt->pi.data_src, fi);
@@ -1408,7 +1887,7 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
         case FT_PROTOCOL:
             /* Print out the full details for the protocol. */
             if (fi->rep) {
-                return g_strdup(fi->rep->representation);
+                return g_strdup(proto_item_get_label(fi, NULL));
             } else {
                 /* Just print out the protocol abbreviation */
                 return g_strdup(fi->hfinfo->abbrev);
@@ -1473,8 +1952,10 @@ output_fields_t* output_fields_new(void)
     fields->occurrence          = 'a';
     fields->aggregator          = ',';
     fields->fields              = NULL; /*Do lazy initialisation */
-    fields->field_indicies      = NULL;
-    fields->field_values        = NULL;
+    fields->field_ids           = NULL;
+    fields->line                = NULL;
+    fields->columns             = NULL;
+    fields->num_rows            = 0;
     fields->quote               ='\0';
     fields->includes_col_fields = FALSE;
     return fields;
@@ -93,6 +93,10 @@ WS_DLL_PUBLIC gsize output_fields_num_fields(output_fields_t* info);
 WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
+WS_DLL_PUBLIC gboolean output_fields_has_field(output_fields_t* info, const gchar* field);
+/* Prime the epan_dissect_t with the fields before each packet is dissected;
+ * write_fields_proto_tree() only sees the values of primed fields. */
+WS_DLL_PUBLIC void output_fields_prime_edt(epan_dissect_t *edt, output_fields_t* info);
 
 /*
  * Higher-level packet-printing code.
@@ -121,6 +125,14 @@ WS_DLL_PUBLIC void write_fields_preamble(output_fields_t* fields, FILE *fh);
 WS_DLL_PUBLIC void write_fields_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
 WS_DLL_PUBLIC void write_fields_finale(output_fields_t* fields, FILE *fh);
 
+/* -T columnar: the fields in a binary format, a row group at a time;
+ * the format is described in print.c.  write_columnar_row_group()
+ * writes out the packets so far without waiting for the group to fill. */
+WS_DLL_PUBLIC void write_columnar_preamble(output_fields_t* fields, FILE *fh);
+WS_DLL_PUBLIC void write_columnar_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
+WS_DLL_PUBLIC void write_columnar_row_group(output_fields_t* fields, FILE *fh);
+WS_DLL_PUBLIC void write_columnar_finale(output_fields_t* fields, FILE *fh);
+
 WS_DLL_PUBLIC gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt);
 
 #ifdef __cplusplus
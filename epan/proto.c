@@ -190,13 +190,15 @@ static void
 proto_tree_set_representation_value(proto_item *pi, const char *format, va_list ap);
 static void
 proto_tree_set_representation(proto_item *pi, const char *format, va_list ap);
+static void
+label_materialize(field_info *fi);
 
 static void
 proto_tree_set_protocol_tvb(field_info *fi, tvbuff_t *tvb);
 static void
 proto_tree_set_bytes(field_info *fi, const guint8* start_ptr, gint length);
 static void
-proto_tree_set_bytes_tvb(field_info *fi, tvbuff_t *tvb, gint offset, gint length);
+proto_tree_set_bytes_tvb(field_info *fi, proto_tree *tree, tvbuff_t *tvb, gint offset, gint length);
 static void
 proto_tree_set_bytes_gbytearray(field_info *fi, const GByteArray *value);
 static void
@@ -204,7 +206,7 @@ proto_tree_set_time(field_info *fi, const nstime_t *value_ptr);
 static void
 proto_tree_set_string(field_info *fi, const char* value);
 static void
-proto_tree_set_string_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length, gint encoding);
+proto_tree_set_string_tvb(field_info *fi, proto_tree *tree, tvbuff_t *tvb, gint start, gint length, gint encoding);
 static void
 proto_tree_set_ax25(field_info *fi, const guint8* value);
 static void
@@ -310,7 +312,10 @@ static GPtrArray *deregistered_data = NULL;
 
 /* String space for protocol and field items for the GUI */
 #define ITEM_LABEL_NEW(pool, il)			\
-	il = wmem_new(pool, item_label_t);
+	il = wmem_new(pool, item_label_t);		\
+	il->pending = FALSE;				\
+	il->label_func = NULL;				\
+	il->label_data = NULL;
 #define ITEM_LABEL_FREE(pool, il)			\
 	wmem_free(pool, il);
 
@@ -1637,7 +1642,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 			break;
 
 		case FT_BYTES:
-			proto_tree_set_bytes_tvb(new_fi, tvb, start, length);
+			proto_tree_set_bytes_tvb(new_fi, tree, tvb, start, length);
 			break;
 
 		case FT_UINT_BYTES:
@@ -1648,7 +1653,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 			if (encoding)
 				encoding = ENC_LITTLE_ENDIAN;
 			n = get_uint_value(tree, tvb, start, length, encoding);
-			proto_tree_set_bytes_tvb(new_fi, tvb, start + length, n);
+			proto_tree_set_bytes_tvb(new_fi, tree, tvb, start + length, n);
 
 			/* Instead of calling proto_item_set_len(), since we don't yet
 			 * have a proto_item, we set the field_info's length ourselves. */
@@ -1881,7 +1886,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 			break;
 
 		case FT_STRING:
-			proto_tree_set_string_tvb(new_fi, tvb, start, length,
+			proto_tree_set_string_tvb(new_fi, tree, tvb, start, length,
 			    encoding);
 			break;
 
@@ -1957,7 +1962,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 			if (encoding == TRUE)
 				encoding = ENC_ASCII|ENC_LITTLE_ENDIAN;
 			n = get_uint_value(tree, tvb, start, length, encoding & ~ENC_CHARENCODING_MASK);
-			proto_tree_set_string_tvb(new_fi, tvb, start + length, n,
+			proto_tree_set_string_tvb(new_fi, tree, tvb, start + length, n,
 			    encoding);
 
 			/* Instead of calling proto_item_set_len(), since we
@@ -1981,7 +1986,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 			 * array of bytes, we'll need to strip
 			 * trailing NULs.
 			 */
-			proto_tree_set_string_tvb(new_fi, tvb, start, length,
+			proto_tree_set_string_tvb(new_fi, tree, tvb, start, length,
 			    encoding);
 			break;
 
@@ -2271,7 +2276,7 @@ proto_tree_add_bytes_item(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 	}
 	else {
 		/* n will be zero except when it's a FT_UINT_BYTES */
-		proto_tree_set_bytes_tvb(new_fi, tvb, start + n, length);
+		proto_tree_set_bytes_tvb(new_fi, tree, tvb, start + n, length);
 
 		FI_SET_FLAG(new_fi,
 			(encoding & ENC_LITTLE_ENDIAN) ? FI_LITTLE_ENDIAN : FI_BIG_ENDIAN);
@@ -2540,9 +2545,43 @@ proto_tree_set_bytes(field_info *fi, const guint8* start_ptr, gint length)
 }
 
 
+/*
+ * Is this range of tvb part of the frame itself?  The frame's tvbuff
+ * lives as long as the tree does, so a value in it can be left there
+ * until something looks at it; the tvbuffs dissectors make for
+ * decrypted, decompressed or reassembled data can be freed sooner.
+ * The data the frame's tvbuff points to must not change while the tree
+ * is kept either, which is why a tree that's kept while the buffer it
+ * was read into is reused needs a tvbuff with its own copy (see
+ * frame_tvbuff_new_buffer_copy()).  The range has to be in the captured
+ * data, so that fetching it later can't throw an exception.
+ */
+static gboolean
+proto_tree_range_in_frame(proto_tree *tree, tvbuff_t *tvb, gint start, gint length)
+{
+	packet_info *pinfo;
+
+	if (!tree || start < 0 || length < 0)
+		return FALSE;
+	pinfo = PTREE_DATA(tree)->pinfo;
+	if (!pinfo || !pinfo->data_src)
+		return FALSE;
+	if (tvb_get_ds_tvb(tvb) != get_data_source_tvb((const struct data_source *)pinfo->data_src->data))
+		return FALSE;
+
+	/* This can throw an exception, just as fetching the value would */
+	tvb_ensure_bytes_exist(tvb, start, length);
+	return TRUE;
+}
+
 static void
-proto_tree_set_bytes_tvb(field_info *fi, tvbuff_t *tvb, gint offset, gint length)
+proto_tree_set_bytes_tvb(field_info *fi, proto_tree *tree, tvbuff_t *tvb, gint offset, gint length)
 {
+	if (proto_tree_range_in_frame(tree, tvb, offset, length) &&
+	    fvalue_set_tvb_range(&fi->value, tvb_get_ds_tvb(tvb),
+			offset + tvb_raw_offset(tvb), length, ENC_NA))
+		return;
+
 	proto_tree_set_bytes(fi, tvb_get_ptr(tvb, offset, length), length);
 }
 
@@ -3152,7 +3191,7 @@ proto_tree_set_string(field_info *fi, const char* value)
 }
 
 static void
-proto_tree_set_string_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length, gint encoding)
+proto_tree_set_string_tvb(field_info *fi, proto_tree *tree, tvbuff_t *tvb, gint start, gint length, gint encoding)
 {
 	gchar	*string;
 
@@ -3160,6 +3199,18 @@ proto_tree_set_string_tvb(field_info *fi, tvbuff_t *tvb, gint start, gint length
 		length = tvb_ensure_captured_length_remaining(tvb, start);
 	}
 
+	/*
+	 * Leave ASCII and UTF-8 strings in the frame until they're
+	 * needed; decoding those can't fail once we know the bytes
+	 * are there.
+	 */
+	if (((encoding & ENC_CHARENCODING_MASK) == ENC_ASCII ||
+	     (encoding & ENC_CHARENCODING_MASK) == ENC_UTF_8) &&
+	    proto_tree_range_in_frame(tree, tvb, start, length) &&
+	    fvalue_set_tvb_range(&fi->value, tvb_get_ds_tvb(tvb),
+			start + tvb_raw_offset(tvb), length, encoding))
+		return;
+
 	string = tvb_get_string_enc(wmem_packet_scope(), tvb, start, length, encoding);
 	proto_tree_set_string(fi, string);
 }
@@ -4576,12 +4627,15 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
-		 * If we don't already have a representation,
-		 * generate the default representation.
+		 * If we don't already have a representation, don't
+		 * generate the default one now; just remember the
+		 * appended text and let proto_item_get_label() put
+		 * the label in front of it if anybody ever asks.
 		 */
 		if (fi->rep == NULL) {
 			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-			proto_item_fill_label(fi, fi->rep->representation);
+			fi->rep->representation[0] = '\0';
+			fi->rep->pending = TRUE;
 		}
 
 		curlen = strlen(fi->rep->representation);
@@ -4594,6 +4648,32 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 	}
 }
 
+/* Set a deferred formatter for the text of proto_item. */
+void
+proto_item_set_label_func(proto_item *pi, proto_label_func func, gpointer data)
+{
+	field_info *fi = NULL;
+
+	TRY_TO_FAKE_THIS_REPR_VOID(pi);
+
+	fi = PITEM_FINFO(pi);
+	if (fi == NULL)
+		return;
+
+	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
+		if (fi->rep == NULL) {
+			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
+			fi->rep->representation[0] = '\0';
+		} else if (!fi->rep->pending) {
+			/* The formatter replaces any text set so far */
+			fi->rep->representation[0] = '\0';
+		}
+		fi->rep->pending    = TRUE;
+		fi->rep->label_func = func;
+		fi->rep->label_data = data;
+	}
+}
+
 /* Prepend to text of proto_item after having already been created. */
 void
 proto_item_prepend_text(proto_item *pi, const char *format, ...)
@@ -4617,8 +4697,10 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 		if (fi->rep == NULL) {
 			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
 			proto_item_fill_label(fi, representation);
-		} else
+		} else {
+			label_materialize(fi);
 			g_strlcpy(representation, fi->rep->representation, ITEM_LABEL_LENGTH);
+		}
 
 		va_start(ap, format);
 		g_vsnprintf(fi->rep->representation,
@@ -4647,8 +4729,12 @@ proto_item_set_len(proto_item *pi, const gint length)
 	 * larger, if there's no data to back that length;
 	 * you can only make it smaller.
 	 */
-	if (fi->value.ftype->ftype == FT_BYTES && length <= (gint)fi->value.value.bytes->len)
-		fi->value.value.bytes->len = length;
+	if (fi->value.ftype->ftype == FT_BYTES) {
+		GByteArray *bytes = (GByteArray *)fvalue_get(&fi->value);
+
+		if (length <= (gint)bytes->len)
+			bytes->len = length;
+	}
 }
 
 /*
@@ -6244,6 +6330,38 @@ proto_item_fill_label(field_info *fi, gchar *label_str)
 	}
 }
 
+/* Generate the label of an item whose text was deferred, putting it in
+ * front of any text appended in the meantime. */
+static void
+label_materialize(field_info *fi)
+{
+	item_label_t *rep = fi->rep;
+	char          appended[ITEM_LABEL_LENGTH];
+
+	if (rep == NULL || !rep->pending)
+		return;
+
+	rep->pending = FALSE;
+	g_strlcpy(appended, rep->representation, ITEM_LABEL_LENGTH);
+	if (rep->label_func)
+		rep->label_func(fi, rep->representation, rep->label_data);
+	else
+		proto_item_fill_label(fi, rep->representation);
+	g_strlcat(rep->representation, appended, ITEM_LABEL_LENGTH);
+}
+
+gchar *
+proto_item_get_label(field_info *fi, gchar *label_str)
+{
+	if (fi->rep) {
+		label_materialize(fi);
+		return fi->rep->representation;
+	}
+
+	proto_item_fill_label(fi, label_str);
+	return label_str;
+}
+
 static void
 fill_label_boolean(field_info *fi, gchar *label_str)
 {
@@ -568,9 +568,25 @@ typedef struct hf_register_info {
 
 
 
+struct field_info;
+
+/** Deferred label formatter, see proto_item_set_label_func().  It may be
+    called long after the packet was dissected, so it mustn't use anything
+    from wmem_packet_scope() or the packet_info.
+ @param fi the item whose label is being generated
+ @param label_str the string to fill (ITEM_LABEL_LENGTH bytes)
+ @param data the data passed to proto_item_set_label_func() */
+typedef void (*proto_label_func)(struct field_info *fi, gchar *label_str, gpointer data);
+
 /** string representation, if one of the proto_tree_add_..._format() functions used */
 typedef struct _item_label_t {
 	char representation[ITEM_LABEL_LENGTH];
+	/** If set, representation only holds the text appended with
+	 *  proto_item_append_text(); the label itself is generated by
+	 *  label_func (or proto_item_fill_label()) on first access. */
+	gboolean		 pending;
+	proto_label_func	 label_func;      /**< deferred formatter, or NULL */
+	gpointer		 label_data;      /**< data for label_func */
 } item_label_t;
 
 
@@ -850,6 +866,18 @@ WS_DLL_PUBLIC void proto_item_set_text(proto_item *ti, const char *format, ...)
 WS_DLL_PUBLIC void proto_item_append_text(proto_item *ti, const char *format, ...)
 	G_GNUC_PRINTF(2,3);
 
+/** Set a deferred formatter for the text of an item.  The formatter is
+    only called if a consumer (GUI tree, printing, PDML) asks for the
+    label, so items in subtrees that are never shown cost nothing to
+    format.  Text appended with proto_item_append_text() is kept and
+    added after the generated label.
+ @param ti the item to set the formatter for
+ @param func the formatter
+ @param data data passed to func; must live at least as long as the tree,
+        which outlives the packet scope, so allocate it from pinfo->pool or
+        wmem_file_scope(), or pack it into the pointer itself */
+WS_DLL_PUBLIC void proto_item_set_label_func(proto_item *ti, proto_label_func func, gpointer data);
+
 /** Prepend to text of item after it has already been created.
  @param ti the item to prepend the text to
  @param format printf like format string
@@ -1928,6 +1956,15 @@ proto_item_append_string(proto_item *pi, const char *str);
 WS_DLL_PUBLIC void
 proto_item_fill_label(field_info *fi, gchar *label_str);
 
+/** Get the text of an item as shown in the GUI tree, generating any
+    deferred part of it first.
+ @param fi the item to get the label for
+ @param label_str the string to fill (ITEM_LABEL_LENGTH bytes) if the item
+        has no stored representation
+ @return the item's stored representation, or label_str */
+WS_DLL_PUBLIC gchar *
+proto_item_get_label(field_info *fi, gchar *label_str);
+
 
 /** Register a new protocol.
  @param name the full name of the new protocol
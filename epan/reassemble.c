@@ -30,6 +30,18 @@
 #include <epan/reassemble.h>
 #include <epan/tvbuff-int.h>
 
+/*
+ * All reassembly tables that have been initialized and not destroyed,
+ * so that reassembly_tables_expire() can find them.
+ */
+static GSList *reassembly_tables = NULL;
+
+/*
+ * Whether to reassemble into composite tvbuffs; see
+ * reassembly_set_composite_tvbs().
+ */
+static gboolean reassemble_composite_tvbs = FALSE;
+
 /*
  * Functions for reassembly tables where the endpoint addresses, and a
  * fragment ID, are used as the key.
@@ -322,6 +334,79 @@ reassembled_hash(gconstpointer k)
 	return key->frame;
 }
 
+/*
+ * The fragments of a reassembly, in the same order as the list hanging
+ * off its head: sorted by offset and, for equal offsets, by arrival.
+ * "contiguous" is the end of the data, starting at offset 0, covered by
+ * the fragments without a gap; for FD_BLOCKSEQUENCE reassemblies the
+ * offsets are sequence numbers and each fragment covers one of them.
+ *
+ * The index is built from the list the first time a fragment is linked
+ * in, and dropped once the reassembly is complete; it's rebuilt if more
+ * fragments show up after that.
+ */
+struct _fragment_index {
+	fragment_item **frags;
+	guint32 count;
+	guint32 alloc;
+	guint32 contiguous;
+};
+
+static void
+fragment_index_extend(const fragment_head *fd_head, guint32 pos)
+{
+	struct _fragment_index *index = fd_head->index;
+	fragment_item *fd_i;
+	guint32 end;
+
+	for (; pos < index->count; pos++) {
+		fd_i = index->frags[pos];
+		if (fd_i->offset > index->contiguous)
+			break;
+		if (fd_head->flags & FD_BLOCKSEQUENCE)
+			end = fd_i->offset + 1;
+		else
+			end = fd_i->offset + fd_i->len;
+		if (end > index->contiguous)
+			index->contiguous = end;
+	}
+}
+
+static void
+fragment_index_append(struct _fragment_index *index, fragment_item *fd)
+{
+	if (index->count == index->alloc) {
+		index->alloc = index->alloc ? index->alloc * 2 : 16;
+		index->frags = (fragment_item **)g_realloc(index->frags,
+		    index->alloc * sizeof (fragment_item *));
+	}
+	index->frags[index->count++] = fd;
+}
+
+static struct _fragment_index *
+fragment_index_get(fragment_head *fd_head)
+{
+	fragment_item *fd_i;
+
+	if (fd_head->index == NULL) {
+		fd_head->index = g_slice_new0(struct _fragment_index);
+		for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next)
+			fragment_index_append(fd_head->index, fd_i);
+		fragment_index_extend(fd_head, 0);
+	}
+	return fd_head->index;
+}
+
+static void
+fragment_index_free(fragment_head *fd_head)
+{
+	if (fd_head->index != NULL) {
+		g_free(fd_head->index->frags);
+		g_slice_free(struct _fragment_index, fd_head->index);
+		fd_head->index = NULL;
+	}
+}
+
 /*
  * For a fragment hash table entry, free the associated fragments.
  * The entry value (fd_chain) is freed herein and the entry is freed
@@ -342,6 +427,7 @@ free_all_fragments(gpointer key_arg _U_, gpointer value, gpointer user_data _U_)
 
 		if(fd_head->tvb_data && !(fd_head->flags&FD_SUBSET_TVB))
 			tvb_free(fd_head->tvb_data);
+		fragment_index_free(fd_head);
 		g_slice_free(fragment_item, fd_head);
 	}
 
@@ -386,6 +472,7 @@ free_all_reassembled_fragments(gpointer key_arg, gpointer value,
 		if (fd_head->flags != FD_VISITED_FREE) {
 			if (fd_head->flags & FD_SUBSET_TVB)
 				fd_head->tvb_data = NULL;
+			fragment_index_free(fd_head);
 			g_ptr_array_add(allocated_fragments, fd_head);
 			fd_head->flags = FD_VISITED_FREE;
 		}
@@ -413,6 +500,9 @@ void
 reassembly_table_init(reassembly_table *table,
 		      const reassembly_table_functions *funcs)
 {
+	if (g_slist_find(reassembly_tables, table) == NULL)
+		reassembly_tables = g_slist_prepend(reassembly_tables, table);
+
 	if (table->temporary_key_func == NULL)
 		table->temporary_key_func = funcs->temporary_key_func;
 	if (table->persistent_key_func == NULL)
@@ -466,6 +556,8 @@ reassembly_table_init(reassembly_table *table,
 void
 reassembly_table_destroy(reassembly_table *table)
 {
+	reassembly_tables = g_slist_remove(reassembly_tables, table);
+
 	/*
 	 * Clear the function pointers.
 	 */
@@ -516,6 +608,79 @@ reassembly_table_destroy(reassembly_table *table)
 	}
 }
 
+/*
+ * For a fragment hash table entry, free the associated fragments if none
+ * of them was seen in or after the frame pointed to by user_data.
+ * Reassemblies that haven't got any fragments yet are kept.
+ */
+static gboolean
+expire_fragments(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	const guint32 oldest_frame = *(const guint32 *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+	fragment_item *fd;
+
+	if (fd_head->next == NULL)
+		return FALSE;
+	for (fd = fd_head->next; fd != NULL; fd = fd->next) {
+		if (fd->frame >= oldest_frame)
+			return FALSE;
+	}
+	return free_all_fragments(key_arg, value, NULL);
+}
+
+typedef struct {
+	guint32 oldest_frame;
+	GPtrArray *allocated_fragments;
+} expire_reassembled_data;
+
+/*
+ * For a reassembled-packet hash table entry, free the entry, and collect
+ * the fragment data for freeing, if it was reassembled before the oldest
+ * frame.
+ */
+static gboolean
+expire_reassembled_fragments(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	expire_reassembled_data *expire = (expire_reassembled_data *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+
+	/* reassembled_in is kept when the flags are set to FD_VISITED_FREE */
+	if (fd_head->reassembled_in >= expire->oldest_frame)
+		return FALSE;
+	return free_all_reassembled_fragments(key_arg, value,
+	    expire->allocated_fragments);
+}
+
+/*
+ * Free the reassemblies in progress that haven't had a fragment since
+ * before oldest_frame, and the reassembled packets that were completed
+ * before oldest_frame, in all reassembly tables.
+ */
+void
+reassembly_tables_expire(const guint32 oldest_frame)
+{
+	GSList *item;
+	expire_reassembled_data expire;
+
+	expire.oldest_frame = oldest_frame;
+	for (item = reassembly_tables; item != NULL; item = item->next) {
+		reassembly_table *table = (reassembly_table *)item->data;
+
+		if (table->fragment_table != NULL) {
+			g_hash_table_foreach_remove(table->fragment_table,
+			    expire_fragments, &expire.oldest_frame);
+		}
+		if (table->reassembled_table != NULL) {
+			expire.allocated_fragments = g_ptr_array_new();
+			g_hash_table_foreach_remove(table->reassembled_table,
+			    expire_reassembled_fragments, &expire);
+			g_ptr_array_foreach(expire.allocated_fragments, free_fragments, NULL);
+			g_ptr_array_free(expire.allocated_fragments, TRUE);
+		}
+	}
+}
+
 /*
  * Look up an fd_head in the fragment table, optionally returning the key
  * for it.
@@ -598,6 +763,7 @@ fragment_delete(reassembly_table *table, const packet_info *pinfo,
 		g_slice_free(fragment_item, fd);
 		fd=tmp_fd;
 	}
+	fragment_index_free(fd_head);
 	g_slice_free(fragment_head, fd_head);
 	g_hash_table_remove(table->fragment_table, key);
 
@@ -822,18 +988,110 @@ fragment_reassembled(reassembly_table *table, fragment_head *fd_head,
 	fd_head->reassembled_in = pinfo->fd->num;
 }
 
+void
+reassembly_set_composite_tvbs(const gboolean composite)
+{
+	reassemble_composite_tvbs = composite;
+}
+
+/*
+ * If the fragments of a reassembly simply follow each other, without
+ * overlaps, and add up to "size" bytes, make the fragments' tvbuffs the
+ * reassembled data, as members of a composite tvbuff that takes ownership
+ * of them, instead of copying them into a new buffer.
+ *
+ * Returns FALSE, without changing anything, if the data has to be copied
+ * after all, so that overlaps and such are checked for and flagged.
+ */
+static gboolean
+fragment_defragment_composite(fragment_head *fd_head, const guint32 size)
+{
+	fragment_item *fd_i;
+	fragment_item *last_fd = NULL;
+	guint32 dfpos = 0;
+	tvbuff_t *composite = NULL;
+
+	if (!reassemble_composite_tvbs || fd_head->tvb_data != NULL || size == 0)
+		return FALSE;
+
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (fd_head->flags & FD_BLOCKSEQUENCE) {
+			if (last_fd && last_fd->offset == fd_i->offset)
+				return FALSE;
+		} else if (fd_i->offset != dfpos) {
+			return FALSE;
+		}
+		if (fd_i->len &&
+		    (fd_i->tvb_data == NULL || (fd_i->flags & FD_SUBSET_TVB)))
+			return FALSE;
+		dfpos += fd_i->len;
+		last_fd = fd_i;
+	}
+	if (dfpos != size)
+		return FALSE;
+
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (fd_i->len == 0)
+			continue;
+		if (fd_head->tvb_data == NULL) {
+			/* a single fragment doesn't need a composite */
+			fd_head->tvb_data = fd_i->tvb_data;
+		} else {
+			if (composite == NULL) {
+				composite = tvb_new_composite();
+				tvb_composite_append(composite, fd_head->tvb_data);
+			}
+			tvb_composite_append(composite, fd_i->tvb_data);
+		}
+		fd_i->tvb_data = NULL;
+	}
+	if (composite != NULL) {
+		tvb_composite_finalize_owner(composite);
+		fd_head->tvb_data = composite;
+	}
+
+	return TRUE;
+}
+
 static void
 LINK_FRAG(fragment_head *fd_head,fragment_item *fd)
 {
+	struct _fragment_index *index = fragment_index_get(fd_head);
 	fragment_item *fd_i;
+	guint32 lo, hi, mid;
 
-	/* add fragment to list, keep list sorted */
-	for(fd_i= fd_head; fd_i->next;fd_i=fd_i->next) {
-		if (fd->offset < fd_i->next->offset )
-			break;
+	/*
+	 * Find the first fragment with a larger offset; fragments mostly
+	 * arrive in order, so try the end of the list first.
+	 */
+	lo = index->count;
+	if (lo != 0 && fd->offset < index->frags[lo - 1]->offset) {
+		lo = 0;
+		hi = index->count - 1;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (fd->offset < index->frags[mid]->offset)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
 	}
+
+	/* add fragment to list, keep list sorted */
+	fd_i = lo ? index->frags[lo - 1] : fd_head;
 	fd->next=fd_i->next;
 	fd_i->next=fd;
+
+	fragment_index_append(index, fd);
+	if (lo != index->count - 1) {
+		memmove(&index->frags[lo + 1], &index->frags[lo],
+		    (index->count - 1 - lo) * sizeof (fragment_item *));
+		index->frags[lo] = fd;
+	}
+
+	/* a fragment past the first gap doesn't add contiguous data */
+	if (fd->offset <= index->contiguous)
+		fragment_index_extend(fd_head, lo);
 }
 
 /*
@@ -875,6 +1133,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->frame = pinfo->fd->num;
 	fd->offset = frag_offset;
 	fd->fragment_nr_offset = 0; /* will only be used with sequence */
+	fd->index = NULL;
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
@@ -1032,19 +1291,13 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 * Check if we have received the entire fragment.
 	 * This is easy since the list is sorted and the head is faked.
 	 *
-	 * First, we compute the amount of contiguous data that's
-	 * available.  (The check for fd_i->offset <= max rules out
+	 * First, we look up the amount of contiguous data that's
+	 * available, which LINK_FRAG keeps track of.  (It leaves out
 	 * fragments that don't start before or at the end of the
 	 * previous fragment, i.e. fragments that have a gap between
 	 * them and the previous fragment.)
 	 */
-	max = 0;
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
-			max = fd_i->offset+fd_i->len;
-		}
-	}
+	max = fd_head->index->contiguous;
 
 	if (max < (fd_head->datalen)) {
 		/*
@@ -1058,6 +1311,13 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	/* we have received an entire packet, defragment it and
 	 * free all fragments
 	 */
+	if (fragment_defragment_composite(fd_head, fd_head->datalen)) {
+		fragment_index_free(fd_head);
+		fd_head->flags |= FD_DEFRAGMENTED;
+		fd_head->reassembled_in=pinfo->fd->num;
+		return TRUE;
+	}
+
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
 	data = (guint8 *) g_malloc(fd_head->datalen);
@@ -1068,7 +1328,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	for (dfpos=0,fd_i=fd_head;fd_i;fd_i=fd_i->next) {
 		if (fd_i->len) {
 			/*
-			 * The loop above that calculates max also
+			 * The check for contiguous data above also
 			 * ensures that the only gaps that exist here
 			 * are ones where a fragment starts past the
 			 * end of the reassembled datagram, and there's
@@ -1110,7 +1370,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					 * already rejected fragments that
 					 * start past the end of the
 					 * reassembled datagram, and
-					 * the loop that calculated max
+					 * the check for contiguous data
 					 * should have ruled out gaps,
 					 * but could fd_i->offset +
 					 * fd_i->len overflow?
@@ -1184,6 +1444,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 	if (old_tvb_data)
 		tvb_add_to_chain(tvb, old_tvb_data);
+	fragment_index_free(fd_head);
 	/* mark this packet as defragmented.
 	   allows us to skip any trailing fragments */
 	fd_head->flags |= FD_DEFRAGMENTED;
@@ -1494,12 +1755,20 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 		last_fd=fd_i;
 	}
 
+	fd_head->len = size;		/* record size for caller	*/
+
+	if (fragment_defragment_composite(fd_head, size)) {
+		fragment_index_free(fd_head);
+		fd_head->flags |= FD_DEFRAGMENTED;
+		fd_head->reassembled_in=pinfo->fd->num;
+		return;
+	}
+
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
 	data = (guint8 *) g_malloc(size);
 	fd_head->tvb_data = tvb_new_real_data(data, size, size);
 	tvb_set_free_cb(fd_head->tvb_data, g_free);
-	fd_head->len = size;		/* record size for caller	*/
 
 	/* add all data fragments */
 	last_fd=NULL;
@@ -1533,6 +1802,7 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 	}
 	if (old_tvb_data)
 		tvb_free(old_tvb_data);
+	fragment_index_free(fd_head);
 
 	/* mark this packet as defragmented.
 	 * allows us to skip any trailing fragments.
@@ -1608,6 +1878,7 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->index = NULL;
 
 	if (!more_frags) {
 		/*
@@ -1751,15 +2022,10 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 
 	/* check if we have received the entire fragment
-	 * this is easy since the list is sorted and the head is faked.
-	 * common case the whole list is scanned.
+	 * this is easy since LINK_FRAG keeps track of the first
+	 * sequence number that's missing.
 	 */
-	max = 0;
-	for(fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-	  if ( fd_i->offset==max ){
-		max++;
-	  }
-	}
+	max = fd_head->index->contiguous;
 	/* max will now be datalen+1 if all fragments have been seen */
 
 	if (max <= fd_head->datalen) {
@@ -1862,16 +2128,17 @@ fragment_add_seq_common(reassembly_table *table, tvbuff_t *tvb,
 			*orig_keyp = orig_key;
 
 		if (flags & REASSEMBLE_FLAGS_NO_FRAG_NUMBER) {
-			fragment_item *fd;
+			struct _fragment_index *index;
 			/*
 			 * If we weren't given an initial fragment number,
 			 * use the next expected fragment number as the fragment
 			 * number for this fragment.
 			 */
-			for (fd = fd_head; fd != NULL; fd = fd->next) {
-				if (fd->next == NULL)
-					frag_number = fd->offset + 1;
-			}
+			index = fragment_index_get(fd_head);
+			if (index->count != 0)
+				frag_number = index->frags[index->count - 1]->offset + 1;
+			else
+				frag_number = fd_head->offset + 1;
 		}
 	}
 
@@ -2090,6 +2357,7 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->tvb_data = NULL;
 		fd_head->reassembled_in = 0;
 		fd_head->error = NULL;
+		fd_head->index = NULL;
 
 		insert_fd_head(table, fd_head, pinfo, id, data);
 	}
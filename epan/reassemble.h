@@ -98,6 +98,14 @@ typedef struct _fragment_item {
 	 * reassembly and for the fragments in a reassembly.
 	 */
 	const char *error;
+
+	/*
+	 * Only valid in the first item of the list: the fragments sorted
+	 * by offset, so that adding a fragment and checking whether the
+	 * reassembly is complete take logarithmic rather than linear
+	 * time; managed by reassemble.c.
+	 */
+	struct _fragment_index *index;
 } fragment_item, fragment_head;
 
 
@@ -170,6 +178,25 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Free, in all reassembly tables, the reassemblies in progress that
+ * haven't had a fragment in or after oldest_frame and the reassembled
+ * packets that were completed before oldest_frame.  Only safe when
+ * packets are dissected once, in order; see epan_set_flow_timeouts().
+ */
+extern void
+reassembly_tables_expire(const guint32 oldest_frame);
+
+/*
+ * If TRUE, reassembled data that is simply the concatenation of its
+ * fragments is handed out as a composite tvbuff of the fragments' data,
+ * rather than being copied into a new buffer; it's only flattened into
+ * one buffer if a dissector needs a contiguous pointer across fragments.
+ * Off by default.
+ */
+WS_DLL_PUBLIC void
+reassembly_set_composite_tvbs(const gboolean composite);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
@@ -1521,6 +1521,150 @@ test_missing_data_fragment_add_seq_next_3(void)
 }
 
 
+/* With composite tvbuffs enabled, checks that fragments that follow each
+ * other are reassembled without copying, and that overlapping ones are
+ * still copied and checked.
+ */
+static void
+test_fragment_add_composite(void)
+{
+    fragment_head *fd_head;
+
+    printf("Starting test test_fragment_add_composite\n");
+
+    reassembly_set_composite_tvbs(TRUE);
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 10, &pinfo, 15, NULL,
+                                  50, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 100, &pinfo, 15, NULL,
+                                  40, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 3;
+    fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 15, NULL,
+                                  60, FALSE);
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(150,fd_head->len);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_BLOCKSEQUENCE|FD_DATALEN_SET,fd_head->flags);
+    ASSERT_NE(NULL,fd_head->tvb_data);
+    ASSERT_EQ(150,tvb_length(fd_head->tvb_data));
+    ASSERT_EQ(NULL,fd_head->next->tvb_data);
+    ASSERT_EQ(NULL,fd_head->next->next->tvb_data);
+    ASSERT_EQ(NULL,fd_head->next->next->next->tvb_data);
+
+    /* test the actual reassembly, including across fragments */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+10,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+100,40));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,90,data+5,60));
+    ASSERT(!memcmp(tvb_get_ptr(fd_head->tvb_data,45,10),data+55,5));
+    ASSERT(!memcmp(tvb_get_ptr(fd_head->tvb_data,50,5),data+100,5));
+
+    /* overlapping fragments can't be used as they are */
+    pinfo.fd->num = 4;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 20, &pinfo, 16, NULL,
+                         0, 30, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 5;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 40, &pinfo, 16, NULL,
+                         20, 30, FALSE);
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(50,fd_head->datalen);
+    ASSERT(fd_head->flags & FD_OVERLAP);
+    ASSERT(!(fd_head->flags & FD_OVERLAPCONFLICT));
+    ASSERT_EQ(50,tvb_length(fd_head->tvb_data));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+20,30));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,30,data+50,20));
+
+    reassembly_set_composite_tvbs(FALSE);
+}
+
+
+/* Adds a large number of fragments in a scrambled order, with every tenth
+ * one retransmitted, and checks that they are reassembled correctly. This
+ * also serves as a benchmark: with a linear fragment list the time taken
+ * grows quadratically with the number of fragments.
+ */
+#define MANY_FRAGMENTS 20011 /* prime, so that the stride below visits all */
+#define MANY_FRAGMENTS_LEN 8
+#define MANY_FRAGMENTS_STRIDE 7919
+
+static guint32
+many_fragments_offset(guint32 frag)
+{
+    return frag % (DATA_LEN - MANY_FRAGMENTS_LEN);
+}
+
+static void
+test_fragment_add_many(gboolean seq)
+{
+    fragment_head *fd_head = NULL;
+    GTimer *timer;
+    guint32 i, frag, n = 0;
+
+    printf("Starting test test_fragment_add_many%s\n", seq ? "_seq" : "");
+
+    timer = g_timer_new();
+    for (i = 0; i < MANY_FRAGMENTS; i++) {
+        frag = (i * MANY_FRAGMENTS_STRIDE) % MANY_FRAGMENTS;
+        do {
+            pinfo.fd->num = ++n;
+            if (seq) {
+                fd_head = fragment_add_seq(&test_reassembly_table, tvb,
+                                           many_fragments_offset(frag), &pinfo,
+                                           14, NULL, frag, MANY_FRAGMENTS_LEN,
+                                           frag != MANY_FRAGMENTS - 1, 0);
+            } else {
+                fd_head = fragment_add(&test_reassembly_table, tvb,
+                                       many_fragments_offset(frag), &pinfo,
+                                       14, NULL, frag * MANY_FRAGMENTS_LEN,
+                                       MANY_FRAGMENTS_LEN,
+                                       frag != MANY_FRAGMENTS - 1);
+            }
+        } while (fd_head == NULL && n % 10 == 0);
+
+        if (i < MANY_FRAGMENTS - 1)
+            ASSERT_EQ(NULL,fd_head);
+    }
+    g_timer_stop(timer);
+    printf("    %u fragments reassembled in %.3f seconds\n", n,
+           g_timer_elapsed(timer, NULL));
+    g_timer_destroy(timer);
+
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(n,fd_head->reassembled_in);
+    ASSERT(fd_head->flags & FD_DEFRAGMENTED);
+    ASSERT(fd_head->flags & FD_OVERLAP);
+    ASSERT(!(fd_head->flags & FD_OVERLAPCONFLICT));
+    ASSERT_NE(NULL,fd_head->tvb_data);
+    ASSERT_EQ(MANY_FRAGMENTS * MANY_FRAGMENTS_LEN,
+              tvb_length(fd_head->tvb_data));
+
+    /* test the actual reassembly */
+    for (frag = 0; frag < MANY_FRAGMENTS; frag++) {
+        ASSERT(!tvb_memeql(fd_head->tvb_data, frag * MANY_FRAGMENTS_LEN,
+                           data + many_fragments_offset(frag),
+                           MANY_FRAGMENTS_LEN));
+    }
+}
+
+static void
+test_fragment_add_many_bytes(void)
+{
+    test_fragment_add_many(FALSE);
+}
+
+static void
+test_fragment_add_many_seq(void)
+{
+    test_fragment_add_many(TRUE);
+}
+
+
 /**********************************************************************************
  *
  * main
@@ -1548,6 +1692,9 @@ main(int argc _U_, char **argv _U_)
         test_missing_data_fragment_add_seq_next,
         test_missing_data_fragment_add_seq_next_2,
         test_missing_data_fragment_add_seq_next_3,
+        test_fragment_add_composite,
+        test_fragment_add_many_bytes,
+        test_fragment_add_many_seq,
 #if 0
         test_fragment_add_seq_check_multiple
 #endif
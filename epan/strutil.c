@@ -29,6 +29,8 @@
 #include "emem.h"
 
 #include <wsutil/str_util.h>
+#include <wsutil/ws_memmem.h>
+#include <wsutil/ws_strscan.h>
 #include <epan/proto.h>
 
 #ifdef _WIN32
@@ -140,6 +142,34 @@ get_token_len(const guchar *linep, const guchar *lineend,
 
 #define    INITIAL_FMTBUF_SIZE    128
 
+/*
+ * Copy the run of printable characters at "*stringp" into a format_text()
+ * buffer at "column", growing the buffer if necessary, and return the new
+ * column.  This avoids going through the escaping code a character at a
+ * time for the common case of strings that need no escaping at all.
+ */
+static int
+copy_printable(gchar **fmtbufp, int *fmtbuf_lenp, int column,
+               const guchar **stringp, const guchar *stringend)
+{
+    size_t span;
+
+    span = ws_printable_span(*stringp, stringend - *stringp);
+    if (span == 0)
+        return column;
+
+    /* Room for the run plus a terminating '\0' */
+    if (column + span + 1 >= (size_t)*fmtbuf_lenp) {
+        while (column + span + 1 >= (size_t)*fmtbuf_lenp)
+            *fmtbuf_lenp *= 2;
+        *fmtbufp = (gchar *)g_realloc(*fmtbufp, *fmtbuf_lenp);
+    }
+
+    memcpy(*fmtbufp + column, *stringp, span);
+    *stringp += span;
+    return column + (int)span;
+}
+
 /*
  * Given a string, generate a string from it that shows non-printable
  * characters as C-style escapes, and return a pointer to it.
@@ -166,6 +196,11 @@ format_text(const guchar *string, size_t len)
     }
     column = 0;
     while (string < stringend) {
+        column = copy_printable(&fmtbuf[idx], &fmtbuf_len[idx], column,
+                                &string, stringend);
+        if (string >= stringend)
+            break;
+
         /*
          * Is there enough room for this character, if it expands to
          * a backslash plus 3 octal digits (which is the most it can
@@ -272,6 +307,11 @@ format_text_wsp(const guchar *string, size_t len)
     }
     column = 0;
     while (string < stringend) {
+        column = copy_printable(&fmtbuf[idx], &fmtbuf_len[idx], column,
+                                &string, stringend);
+        if (string >= stringend)
+            break;
+
         /*
          * Is there enough room for this character, if it expands to
          * a backslash plus 3 octal digits (which is the most it can
@@ -940,31 +980,13 @@ xml_escape(const gchar *unescaped)
 /* Return the first occurrence of needle in haystack.
  * If not found, return NULL.
  * If either haystack or needle has 0 length, return NULL.
- * Algorithm copied from GNU's glibc 2.3.2 memmem() under LGPL 2.1+ */
+ * The search itself is done by ws_memmem(), which uses SIMD
+ * instructions where they're available. */
 const guint8 *
 epan_memmem(const guint8 *haystack, guint haystack_len,
         const guint8 *needle, guint needle_len)
 {
-    const guint8 *begin;
-    const guint8 *const last_possible = haystack + haystack_len - needle_len;
-
-    if (needle_len == 0) {
-        return NULL;
-    }
-
-    if (needle_len > haystack_len) {
-        return NULL;
-    }
-
-    for (begin = haystack ; begin <= last_possible; ++begin) {
-        if (begin[0] == needle[0] &&
-                !memcmp(&begin[1], needle + 1,
-                    needle_len - 1)) {
-            return begin;
-        }
-    }
-
-    return NULL;
+    return ws_memmem(haystack, haystack_len, needle, needle_len);
 }
 
 /*
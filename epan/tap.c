@@ -68,6 +68,7 @@ typedef struct _tap_listener_t {
 	gboolean needs_redraw;
 	guint flags;
 	dfilter_t *code;
+	guint group_index;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -75,6 +76,41 @@ typedef struct _tap_listener_t {
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
+/* The filters of all tap listeners merged into one, so that every
+ * filter is applied at most once per packet no matter how many packets
+ * were queued for its tap; listener->group_index is the bit of the
+ * listener's filter. It is rebuilt when a filter is added or removed.
+ */
+static dfilter_group_t *tap_filter_group=NULL;
+
+static void
+tap_filter_group_invalidate(void)
+{
+	dfilter_group_free(tap_filter_group);
+	tap_filter_group=NULL;
+}
+
+static const guint32 *
+tap_filter_group_apply(epan_dissect_t *edt)
+{
+	tap_listener_t *tl;
+	GPtrArray *dfilters;
+
+	if(!tap_filter_group){
+		dfilters=g_ptr_array_new();
+		for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+			if(tl->code){
+				tl->group_index=dfilters->len;
+				g_ptr_array_add(dfilters, tl->code);
+			}
+		}
+		tap_filter_group=dfilter_group_new((dfilter_t **)dfilters->pdata, dfilters->len);
+		g_ptr_array_free(dfilters, TRUE);
+	}
+
+	return dfilter_group_apply_edt(tap_filter_group, edt);
+}
+
 #ifdef HAVE_PLUGINS
 
 #include <gmodule.h>
@@ -303,6 +339,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 {
 	tap_packet_t *tp;
 	tap_listener_t *tl;
+	const guint32 *matched=NULL;
 	guint i;
 
 	/* nothing to do, just return */
@@ -325,7 +362,10 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 			if(tp->tap_id==tl->tap_id){
 				gboolean passed=TRUE;
 				if(tl->code){
-					passed=dfilter_apply_edt(tl->code, edt);
+					if(!matched){
+						matched=tap_filter_group_apply(edt);
+					}
+					passed=DFILTER_GROUP_MATCHED(matched, tl->group_index);
 				}
 				if(passed && tl->packet){
 					tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
@@ -502,6 +542,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->draw=draw;
 	tl->next=(tap_listener_t *)tap_listener_queue;
 
+	tap_filter_group_invalidate();
 	tap_listener_queue=tl;
 
 	return NULL;
@@ -532,6 +573,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
+		tap_filter_group_invalidate();
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
@@ -577,6 +619,7 @@ remove_tap_listener(void *tapdata)
 	}
 
 	if(tl){
+		tap_filter_group_invalidate();
 		if(tl->code){
 			dfilter_free(tl->code);
 		}
@@ -606,6 +649,32 @@ tap_listeners_require_dissection(void)
 
 }
 
+/* Add the protocols behind the taps that have listeners to proto_ids;
+ * taps are registered under the filter name of their protocol. */
+gboolean
+tap_listeners_get_protocols(GArray *proto_ids)
+{
+	tap_listener_t *tl;
+	tap_dissector_t *td;
+	int i, proto_id;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->flags & TL_REQUIRES_COLUMNS)
+			return FALSE;
+
+		for(i=1,td=tap_dissector_list;td && i<tl->tap_id;i++,td=td->next)
+			;
+		if(!td)
+			return FALSE;
+
+		proto_id=proto_get_id_by_filter_name(td->name);
+		if(proto_id == -1)
+			return FALSE;
+		g_array_append_val(proto_ids, proto_id);
+	}
+	return TRUE;
+}
+
 /* Returns TRUE there is an active tap listener for the specified tap id. */
 gboolean
 have_tap_listener(int tap_id)
@@ -226,6 +226,11 @@ WS_DLL_PUBLIC void remove_tap_listener(void *tapdata);
  */
 WS_DLL_PUBLIC gboolean tap_listeners_require_dissection(void);
 
+/** Add the ids of the protocols whose taps have listeners to proto_ids.
+ *  Returns FALSE if a listener needs the columns or listens to a tap that
+ *  isn't named after a protocol. */
+extern gboolean tap_listeners_get_protocols(GArray *proto_ids);
+
 /** Returns TRUE there is an active tap listener for the specified tap id. */
 WS_DLL_PUBLIC gboolean have_tap_listener(int tap_id);
 
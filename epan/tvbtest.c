@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "tvbuff.h"
+#include "proto.h"
 #include "exceptions.h"
 #include "wsutil/pint.h"
 
@@ -44,7 +45,9 @@ test(tvbuff_t *tvb, const gchar* name,
 	volatile gboolean	ex_thrown;
 	volatile guint32	val32;
 	guint32			expected32;
-	guint			incr, i;
+	guint			incr, i, j;
+	guint8			needles[3];
+	guchar			found_needle;
 
 	length = tvb_length(tvb);
 
@@ -278,6 +281,34 @@ test(tvbuff_t *tvb, const gchar* name,
 	}
 	wmem_free(NULL, ptr);
 
+	/* Search for every byte, from the start and from where it is; for
+	 * composites, this searches across member boundaries */
+	for (i = 0; i < length; i++) {
+		for (j = 0; expected_data[j] != expected_data[i]; j++)
+			;
+		if (tvb_find_guint8(tvb, 0, -1, expected_data[i]) != (gint) j ||
+		    tvb_find_guint8(tvb, i, -1, expected_data[i]) != (gint) i) {
+			printf("13: Failed TVB=%s Offset=%d "
+					"Bad find_guint8\n", name, i);
+			failed = TRUE;
+			return FALSE;
+		}
+
+		if (expected_data[i] == '\0')
+			continue;
+		needles[0] = 0xff;
+		needles[1] = expected_data[i];
+		needles[2] = '\0';
+		found_needle = 0;
+		if (tvb_pbrk_guint8(tvb, 0, -1, needles, &found_needle) != (gint) j ||
+		    found_needle != expected_data[i]) {
+			printf("14: Failed TVB=%s Offset=%d "
+					"Bad pbrk_guint8\n", name, i);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+
 
 	printf("Passed TVB=%s\n", name);
 
@@ -494,6 +525,128 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* Checks tvb_get_string_enc() with strings that do and don't take the
+ * all-ASCII/all-valid fast paths. */
+void
+run_string_tests(void)
+{
+	static const struct {
+		const char	*name;
+		const char	*data;
+		gint		length;
+		guint		encoding;
+		const char	*expected;
+	} string_tests[] = {
+		{ "ASCII", "The quick brown fox jumps over the lazy dog", 43, ENC_ASCII,
+		  "The quick brown fox jumps over the lazy dog" },
+		{ "ASCII high bit", "abcdefghijklmnopq\xc0r", 19, ENC_ASCII,
+		  "abcdefghijklmnopq\xef\xbf\xbdr" },
+		{ "UTF-8", "h\xc3\xa9llo w\xc3\xb6rld \xe2\x82\xac \xf0\x9f\x98\x80", 22, ENC_UTF_8,
+		  "h\xc3\xa9llo w\xc3\xb6rld \xe2\x82\xac \xf0\x9f\x98\x80" },
+		{ "UTF-8 surrogate", "a\xed\xa0\x80" "b", 5, ENC_UTF_8,
+		  "a\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" "b" },
+		{ "UTF-8 truncated", "abc\xe2\x82", 5, ENC_UTF_8,
+		  "abc\xef\xbf\xbd\xef\xbf\xbd" },
+		{ "UTF-16LE",
+		  "S\0M\0B\0 \0s\0h\0a\0r\0e\0 \0n\0a\0m\0e\0 \0t\0h\0a\0t\0 \0i\0s\0 \0l\0o\0n\0g\0\xe9\0",
+		  56, ENC_UTF_16|ENC_LITTLE_ENDIAN,
+		  "SMB share name that is long\xc3\xa9" },
+		{ "UTF-16LE surrogates", "x\0\x3d\xd8\x00\xdey\0", 8, ENC_UTF_16|ENC_LITTLE_ENDIAN,
+		  "x\xf0\x9f\x98\x80y" },
+		{ "UTF-16BE", "\0a\0b\0\xe9", 6, ENC_UTF_16|ENC_BIG_ENDIAN,
+		  "ab\xc3\xa9" },
+	};
+	tvbuff_t	*tvb;
+	guint8		*str;
+	guint		i;
+
+	for (i = 0; i < G_N_ELEMENTS(string_tests); i++) {
+		tvb = tvb_new_real_data((const guint8 *)string_tests[i].data,
+				string_tests[i].length, string_tests[i].length);
+		str = tvb_get_string_enc(NULL, tvb, 0, string_tests[i].length,
+				string_tests[i].encoding);
+		if (strcmp((const char *)str, string_tests[i].expected) != 0) {
+			printf("17: Failed String=%s Bad string \"%s\"\n",
+					string_tests[i].name, str);
+			failed = TRUE;
+		} else {
+			printf("Passed String=%s\n", string_tests[i].name);
+		}
+		g_free(str);
+		tvb_free(tvb);
+	}
+}
+
+#define SEARCH_LEN	65536
+#define SEARCH_ROUNDS	200
+
+/* Checks tvb_pbrk_guint8() and tvb_find_tvb() against naive scans at
+ * every alignment the SIMD paths care about, then times them on a
+ * buffer where the match is near the end. */
+void
+run_search_tests(void)
+{
+	guint8		*data;
+	guint8		needles[3] = { '\r', '\n', '\0' };
+	const guint8	pattern[] = { 'a', 'b', 'c', 'd', 'e' };
+	tvbuff_t	*tvb, *needle_tvb;
+	guchar		found_needle;
+	GTimer		*timer;
+	gint		expected, result;
+	guint		i, j, round;
+
+	data = (guint8 *)g_malloc(SEARCH_LEN);
+	for (i = 0; i < SEARCH_LEN; i++)
+		data[i] = (guint8)('a' + i % 3);
+	tvb = tvb_new_real_data(data, SEARCH_LEN, SEARCH_LEN);
+	needle_tvb = tvb_new_real_data(pattern, sizeof pattern, sizeof pattern);
+
+	for (i = 0; i < 96; i++) {
+		for (j = i; j < 192; j++) {
+			data[j] = '\n';
+			memcpy(&data[j + 200], pattern, sizeof pattern);
+
+			result = tvb_pbrk_guint8(tvb, i, -1, needles, &found_needle);
+			if (result != (gint) j || found_needle != '\n') {
+				printf("15: Failed Offset=%u Match=%u "
+						"Bad pbrk_guint8\n", i, j);
+				failed = TRUE;
+			}
+			expected = j + 200;
+			result = tvb_find_tvb(tvb, needle_tvb, i);
+			if (result != expected) {
+				printf("16: Failed Offset=%u Match=%u "
+						"Bad find_tvb\n", i, j);
+				failed = TRUE;
+			}
+
+			data[j] = (guint8)('a' + j % 3);
+			for (expected = j + 200; expected < (gint) (j + 200 + sizeof pattern); expected++)
+				data[expected] = (guint8)('a' + expected % 3);
+		}
+	}
+
+	data[SEARCH_LEN - 2] = '\n';
+	memcpy(&data[SEARCH_LEN - 2 - sizeof pattern], pattern, sizeof pattern);
+
+	timer = g_timer_new();
+	for (round = 0; round < SEARCH_ROUNDS; round++)
+		result = tvb_pbrk_guint8(tvb, 0, -1, needles, &found_needle);
+	printf("pbrk_guint8: %u x %u bytes in %.3f s (%d)\n",
+			SEARCH_ROUNDS, SEARCH_LEN, g_timer_elapsed(timer, NULL), result);
+
+	g_timer_start(timer);
+	for (round = 0; round < SEARCH_ROUNDS; round++)
+		result = tvb_find_tvb(tvb, needle_tvb, 0);
+	printf("find_tvb: %u x %u bytes in %.3f s (%d)\n",
+			SEARCH_ROUNDS, SEARCH_LEN, g_timer_elapsed(timer, NULL), result);
+	g_timer_destroy(timer);
+
+	tvb_free(needle_tvb);
+	tvb_free(tvb);
+	g_free(data);
+}
+
 /* Note: valgrind can be used to check for tvbuff memory leaks */
 int
 main(void)
@@ -504,6 +657,8 @@ main(void)
 
 	except_init();
 	run_tests();
+	run_string_tests();
+	run_search_tests();
 	except_deinit();
 	exit(failed?1:0);
 }
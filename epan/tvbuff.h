@@ -219,6 +219,12 @@ WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
 
+/** Like tvb_composite_finalize(), but the composite tvbuff takes ownership
+ * of its members: they're freed along with it, instead of it being freed
+ * along with its first member. The members must not be part of any other
+ * chain. */
+WS_DLL_PUBLIC void tvb_composite_finalize_owner(tvbuff_t *tvb);
+
 
 /* Get amount of captured data in the buffer (which is *NOT* necessarily the
  * length of the packet). You probably want tvb_reported_length instead. */
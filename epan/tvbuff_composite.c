@@ -23,6 +23,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <epan/emem.h>
 
 #include "tvbuff.h"
@@ -30,14 +32,21 @@
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
 
 typedef struct {
-	GSList		*tvbs;
+	/* The member tvbuffs, in order */
+	GPtrArray	*tvbs;
 
 	/* Used for quick testing to see if this
 	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	 * interested in; sorted, so that the
+	 * member for an offset can be found with
+	 * a binary search. */
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/* The member that was accessed last, as
+	 * accesses tend to be sequential. */
+	guint		last_member;
+
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -52,7 +61,7 @@ composite_free(tvbuff_t *tvb)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	g_slist_free(composite->tvbs);
+	g_ptr_array_free(composite->tvbs, TRUE);
 
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
@@ -68,42 +77,71 @@ static guint
 composite_offset(const tvbuff_t *tvb, const guint counter)
 {
 	const struct tvb_composite *composite_tvb = (const struct tvb_composite *) tvb;
-	const tvbuff_t *member = (const tvbuff_t *)composite_tvb->composite.tvbs->data;
+	const tvbuff_t *member = (const tvbuff_t *)g_ptr_array_index(composite_tvb->composite.tvbs, 0);
 
 	return tvb_offset_from_real_beginning_counter(member, counter);
 }
 
+/*
+ * Return the index of the member tvbuff that holds the byte at abs_offset,
+ * or the number of members if abs_offset is the end of the composite.
+ */
+static guint
+composite_find_member(tvb_comp_t *composite, const guint abs_offset)
+{
+	guint num_members = composite->tvbs->len;
+	guint i = composite->last_member;
+	guint lo, hi, mid;
+
+	/* Try the member used last, and the one after it, first */
+	if (abs_offset >= composite->start_offsets[i]) {
+		if (abs_offset <= composite->end_offsets[i])
+			return i;
+		if (i + 1 < num_members && abs_offset <= composite->end_offsets[i + 1]) {
+			composite->last_member = i + 1;
+			return i + 1;
+		}
+	}
+
+	if (abs_offset > composite->end_offsets[num_members - 1])
+		return num_members;
+
+	lo = 0;
+	hi = num_members - 1;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (abs_offset > composite->end_offsets[mid])
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	composite->last_member = lo;
+	return lo;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->tvbs->len) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = (tvbuff_t *)g_ptr_array_index(composite->tvbs, i);
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -127,63 +165,108 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	guint8 *target = (guint8 *) _target;
 
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->tvbs->len) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
+	/* Copy the part that's in the first member, then the
+	 * following members' parts, until we have copied all data. */
 	member_offset = abs_offset - composite->start_offsets[i];
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->tvbs->len);
+		member_tvb = (tvbuff_t *)g_ptr_array_index(composite->tvbs, i);
+		member_length = member_tvb->length - member_offset;
+		if (member_length > abs_length)
+			member_length = abs_length;
 
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
+		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		target		+= member_length;
+		abs_length	-= member_length;
+		member_offset	 = 0;
+		i++;
 	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_length_remaining(member_tvb, member_offset);
 
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
+	return _target;
+}
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset, member_limit;
+	gint	    result;
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
+	/* Search each member in turn, without flattening the composite */
+	i = composite_find_member(composite, abs_offset);
+	if (i == composite->tvbs->len)
+		return -1;
+
+	member_offset = abs_offset - composite->start_offsets[i];
+	while (limit > 0 && i < composite->tvbs->len) {
+		member_tvb = (tvbuff_t *)g_ptr_array_index(composite->tvbs, i);
+		member_limit = member_tvb->length - member_offset;
+		if (member_limit > limit)
+			member_limit = limit;
+
+		result = tvb_find_guint8(member_tvb, member_offset, member_limit, needle);
+		if (result != -1) {
+			composite->last_member = i;
+			return composite->start_offsets[i] + result;
 		}
+		limit	     -= member_limit;
+		member_offset = 0;
+		i++;
+	}
 
-		return target;
+	return -1;
+}
+
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset, member_limit;
+	gint	    result;
+
+	/* Search each member in turn, without flattening the composite */
+	i = composite_find_member(composite, abs_offset);
+	if (i == composite->tvbs->len)
+		return -1;
+
+	member_offset = abs_offset - composite->start_offsets[i];
+	while (limit > 0 && i < composite->tvbs->len) {
+		member_tvb = (tvbuff_t *)g_ptr_array_index(composite->tvbs, i);
+		member_limit = member_tvb->length - member_offset;
+		if (member_limit > limit)
+			member_limit = limit;
+
+		result = tvb_pbrk_guint8(member_tvb, member_offset, member_limit, needles, found_needle);
+		if (result != -1) {
+			composite->last_member = i;
+			return composite->start_offsets[i] + result;
+		}
+		limit	     -= member_limit;
+		member_offset = 0;
+		i++;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return -1;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -193,8 +276,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
 };
 
@@ -213,9 +296,10 @@ tvb_new_composite(void)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	composite->tvbs		 = NULL;
+	composite->tvbs		 = g_ptr_array_new();
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->last_member	 = 0;
 
 	return tvb;
 }
@@ -235,7 +319,7 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 	DISSECTOR_ASSERT(member->length);
 
 	composite       = &composite_tvb->composite;
-	composite->tvbs = g_slist_append(composite->tvbs, member);
+	g_ptr_array_add(composite->tvbs, member);
 }
 
 void
@@ -253,18 +337,20 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	DISSECTOR_ASSERT(member->length);
 
 	composite       = &composite_tvb->composite;
-	composite->tvbs = g_slist_prepend(composite->tvbs, member);
+	g_ptr_array_add(composite->tvbs, NULL);
+	memmove(&composite->tvbs->pdata[1], &composite->tvbs->pdata[0],
+	    (composite->tvbs->len - 1) * sizeof (gpointer));
+	composite->tvbs->pdata[0] = member;
 }
 
-void
-tvb_composite_finalize(tvbuff_t *tvb)
+static tvb_comp_t *
+composite_finalize(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	GSList	   *slist;
 	guint	    num_members;
 	tvbuff_t   *member_tvb;
 	tvb_comp_t *composite;
-	int	    i = 0;
+	guint	    i;
 
 	DISSECTOR_ASSERT(tvb && !tvb->initialized);
 	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
@@ -272,7 +358,7 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	DISSECTOR_ASSERT(tvb->reported_length == 0);
 
 	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
+	num_members = composite->tvbs->len;
 
 	/* Dissectors should not create composite TVBs if they're not going to
 	 * put at least one TVB in them.
@@ -283,20 +369,35 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
 
-	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
-		DISSECTOR_ASSERT((guint) i < num_members);
-		member_tvb = (tvbuff_t *)slist->data;
+	for (i = 0; i < num_members; i++) {
+		member_tvb = (tvbuff_t *)g_ptr_array_index(composite->tvbs, i);
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
 		composite->end_offsets[i] = tvb->length - 1;
-		i++;
 	}
 
-	DISSECTOR_ASSERT(composite->tvbs);
-
-	tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
 	tvb->initialized = TRUE;
+	return composite;
+}
+
+void
+tvb_composite_finalize(tvbuff_t *tvb)
+{
+	tvb_comp_t *composite = composite_finalize(tvb);
+
+	tvb_add_to_chain((tvbuff_t *)g_ptr_array_index(composite->tvbs, 0), tvb); /* chain composite tvb to first member */
+}
+
+void
+tvb_composite_finalize_owner(tvbuff_t *tvb)
+{
+	tvb_comp_t *composite = composite_finalize(tvb);
+	guint	    i;
+
+	/* chain the members to the composite tvb, so that they're freed with it */
+	for (i = 0; i < composite->tvbs->len; i++)
+		tvb_add_to_chain(tvb, (tvbuff_t *)g_ptr_array_index(composite->tvbs, i));
 }
 
 /*
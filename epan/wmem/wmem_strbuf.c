@@ -154,6 +154,22 @@ wmem_strbuf_append(wmem_strbuf_t *strbuf, const gchar *str)
     strbuf->len = MIN(strbuf->len + append_len, strbuf->alloc_len - 1);
 }
 
+void
+wmem_strbuf_append_len(wmem_strbuf_t *strbuf, const gchar *str, gsize append_len)
+{
+    if (!append_len || !str) {
+        return;
+    }
+
+    wmem_strbuf_grow(strbuf, append_len);
+
+    /* unlike wmem_strbuf_append, embedded nulls are copied too */
+    append_len = MIN(append_len, WMEM_STRBUF_ROOM(strbuf));
+    memcpy(&strbuf->str[strbuf->len], str, append_len);
+    strbuf->len += append_len;
+    strbuf->str[strbuf->len] = '\0';
+}
+
 static void
 wmem_strbuf_append_vprintf(wmem_strbuf_t *strbuf, const gchar *fmt, va_list ap)
 {
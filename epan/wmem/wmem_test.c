@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 
 #include "wmem.h"
@@ -771,6 +772,12 @@ wmem_test_strbuf(void)
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "TESTFUZZ3aq\xC2\xA9");
     g_assert(wmem_strbuf_get_len(strbuf) == 13);
 
+    wmem_strbuf_append_len(strbuf, "\0xyz", 3);
+    g_assert(memcmp(wmem_strbuf_get_str(strbuf), "TESTFUZZ3aq\xC2\xA9\0xy", 17) == 0);
+    g_assert(wmem_strbuf_get_len(strbuf) == 16);
+
+    wmem_strbuf_truncate(strbuf, 13);
+
     wmem_strbuf_truncate(strbuf, 32);
     wmem_strbuf_truncate(strbuf, 24);
     wmem_strbuf_truncate(strbuf, 16);
@@ -803,6 +810,10 @@ wmem_test_strbuf(void)
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "FUZZ3abcd");
     g_assert(wmem_strbuf_get_len(strbuf) == 9);
 
+    wmem_strbuf_append_len(strbuf, "q", 1);
+    g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "FUZZ3abcd");
+    g_assert(wmem_strbuf_get_len(strbuf) == 9);
+
     wmem_strbuf_append_unichar(strbuf, g_utf8_get_char("\xC2\xA9"));
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "FUZZ3abcd");
     g_assert(wmem_strbuf_get_len(strbuf) == 9);
@@ -922,6 +933,29 @@ wmem_test_tree(void)
     }
     wmem_free_all(allocator);
 
+    /* test destroying a tree, with subtrees, and its values */
+    tree = wmem_tree_new(allocator);
+    keys[0].length = 2;
+    keys[0].key    = wmem_alloc_array(allocator, guint32, 2);
+    keys[1].length = 0;
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        keys[0].key[0] = i % 7;
+        keys[0].key[1] = i;
+        wmem_tree_insert32_array(tree, keys, wmem_new(allocator, guint32));
+        wmem_tree_insert32(tree, CONTAINER_ITERS + i, wmem_new(allocator, guint32));
+    }
+    wmem_tree_destroy(tree, TRUE);
+    wmem_free(allocator, keys[0].key);
+    wmem_strict_check_canaries(allocator);
+
+    tree = wmem_tree_new(allocator);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_tree_insert32(tree, i, GINT_TO_POINTER(i));
+    }
+    wmem_tree_destroy(tree, FALSE);
+    wmem_tree_destroy(wmem_tree_new(allocator), TRUE);
+    wmem_free_all(allocator);
+
     /* test string key functionality */
     tree = wmem_tree_new(allocator);
     for (i=0; i<CONTAINER_ITERS; i++) {
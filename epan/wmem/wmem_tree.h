@@ -72,6 +72,15 @@ wmem_tree_t *
 wmem_tree_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
 G_GNUC_MALLOC;
 
+/** Frees a tree created with wmem_tree_new() and all of its nodes, and the
+ * values stored in it as well if free_values is TRUE (they must then have
+ * been allocated from the tree's allocator).  This lets a tree be freed
+ * before its scope is emptied; it must not be used on trees created with
+ * wmem_tree_new_autoreset(). */
+WS_DLL_PUBLIC
+void
+wmem_tree_destroy(wmem_tree_t *tree, gboolean free_values);
+
 /** Returns true if the tree is empty (has no nodes). */
 WS_DLL_PUBLIC
 gboolean
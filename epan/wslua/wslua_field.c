@@ -177,7 +177,7 @@ WSLUA_METAMETHOD FieldInfo__call(lua_State* L) {
                 if (fi->ws_fi->length > 0 && fi->ws_fi->rep) {
                     /* it has a length, but calling fvalue_get() on an FT_NONE asserts,
                        so get the label instead (it's a FT_NONE, so a label is what it basically is) */
-                    lua_pushstring(L, fi->ws_fi->rep->representation);
+                    lua_pushstring(L, proto_item_get_label(fi->ws_fi, NULL));
                     return 1;
                 }
                 return 0;
@@ -252,11 +252,7 @@ static int FieldInfo_get_display(lua_State* L) {
     gchar        *label_ptr;
     gchar        *value_ptr;
 
-    if (!fi->ws_fi->rep) {
-        label_ptr = label_str;
-        proto_item_fill_label(fi->ws_fi, label_str);
-    } else
-        label_ptr = fi->ws_fi->rep->representation;
+    label_ptr = proto_item_get_label(fi->ws_fi, label_str);
 
     if (!label_ptr) return 0;
 
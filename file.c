@@ -42,6 +42,7 @@
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/ws_version_info.h>
+#include <wsutil/ws_bitmap.h>
 
 #include <wiretap/merge.h>
 
@@ -108,7 +109,11 @@ gboolean auto_scroll_live;
 static int read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
     column_info *cinfo, gint64 offset);
 
-static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
+typedef struct dfilter_result dfilter_result_t;
+static void dfilter_results_clear(capture_file *cf);
+static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect,
+                           dfilter_relation_t relation, const dfilter_result_t *cached,
+                           gboolean mark_dependents);
 
 typedef enum {
   MR_NOTMATCHED,
@@ -346,6 +351,8 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   cf->count     = 0;
   cf->packet_comment_count = 0;
   cf->displayed_count = 0;
+  cf->dfilter_stale = FALSE;
+  cf->dependents_stale = FALSE;
   cf->marked_count = 0;
   cf->ignored_count = 0;
   cf->ref_time_count = 0;
@@ -460,6 +467,7 @@ cf_close(capture_file *cf)
     g_tree_destroy(cf->frames_user_comments);
     cf->frames_user_comments = NULL;
   }
+  dfilter_results_clear(cf);
   cf_unselect_packet(cf);   /* nothing to select */
   cf->first_displayed = 0;
   cf->last_displayed = 0;
@@ -1112,10 +1120,19 @@ void cf_set_rfcode(capture_file *cf, dfilter_t *rfcode)
   cf->rfcode = rfcode;
 }
 
+/* How add_packet_to_packet_list() finds out whether a frame passes the
+   display filter. */
+typedef enum {
+  FILTER_DISSECT,       /* dissect the frame and apply the filter */
+  FILTER_METADATA,      /* the filter only needs the frame's metadata */
+  FILTER_UNCHANGED      /* the frame's current result still holds */
+} filter_mode_e;
+
 static int
 add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     epan_dissect_t *edt, dfilter_t *dfcode, column_info *cinfo,
-    struct wtap_pkthdr *phdr, const guint8 *buf, gboolean add_to_packet_list)
+    struct wtap_pkthdr *phdr, const guint8 *buf, gboolean add_to_packet_list,
+    filter_mode_e filter_mode)
 {
   gint            row               = -1;
 
@@ -1123,26 +1140,32 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
                                 &cf->ref, cf->prev_dis);
   cf->prev_cap = fdata;
 
-  if (dfcode != NULL) {
-      epan_dissect_prime_dfilter(edt, dfcode);
-  }
+  if (filter_mode != FILTER_UNCHANGED) {
+    if (dfcode != NULL) {
+        epan_dissect_prime_dfilter(edt, dfcode);
+    }
 
-  /* Dissect the frame. */
-  epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new(fdata, buf), fdata, cinfo);
+    /* Dissect the frame, or only look at its metadata if that's all
+       the filter needs. */
+    if (filter_mode == FILTER_METADATA)
+      epan_dissect_run_metadata(edt, cf->cd_t, phdr, frame_tvbuff_new(fdata, buf), fdata);
+    else
+      epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new(fdata, buf), fdata, cinfo);
 
-  /* If we don't have a display filter, set "passed_dfilter" to 1. */
-  if (dfcode != NULL) {
-    fdata->flags.passed_dfilter = dfilter_apply_edt(dfcode, edt) ? 1 : 0;
+    /* If we don't have a display filter, set "passed_dfilter" to 1. */
+    if (dfcode != NULL) {
+      fdata->flags.passed_dfilter = dfilter_apply_edt(dfcode, edt) ? 1 : 0;
 
-    if (fdata->flags.passed_dfilter) {
-      /* This frame passed the display filter but it may depend on other
-       * (potentially not displayed) frames.  Find those frames and mark them
-       * as depended upon.
-       */
-      g_slist_foreach(edt->pi.dependent_frames, find_and_mark_frame_depended_upon, cf->frames);
-    }
-  } else
-    fdata->flags.passed_dfilter = 1;
+      if (fdata->flags.passed_dfilter) {
+        /* This frame passed the display filter but it may depend on other
+         * (potentially not displayed) frames.  Find those frames and mark them
+         * as depended upon.
+         */
+        g_slist_foreach(edt->pi.dependent_frames, find_and_mark_frame_depended_upon, cf->frames);
+      }
+    } else
+      fdata->flags.passed_dfilter = 1;
+  }
 
   if (fdata->flags.passed_dfilter || fdata->flags.ref_time)
     cf->displayed_count++;
@@ -1231,7 +1254,7 @@ read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
 
     if (!cf->redissecting) {
       row = add_packet_to_packet_list(fdata, cf, edt, dfcode,
-                                      cinfo, phdr, buf, TRUE);
+                                      cinfo, phdr, buf, TRUE, FILTER_DISSECT);
     }
   }
 
@@ -1646,12 +1669,179 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     return CF_OK;
 }
 
+/* Does the filter look at something that depends on how the frames were
+   displayed, rather than only on the frames: the time since the previous
+   displayed frame, or the coloring rule that the packet list gave a frame
+   when it last drew it (which it does lazily, and again whenever the
+   coloring rules change)?  The result for a frame can change without
+   the frame changing, so it can't be remembered or reused. */
+static gboolean
+dfilter_depends_on_display(const dfilter_t *dfcode)
+{
+  const int *fields;
+  int        num_fields, i;
+  int        hf_delta_displayed;
+  int        hf_color_filter_name, hf_color_filter_text;
+
+  if (dfcode == NULL)
+    return FALSE;
+
+  hf_delta_displayed = proto_registrar_get_id_byname("frame.time_delta_displayed");
+  hf_color_filter_name = proto_registrar_get_id_byname("frame.coloring_rule.name");
+  hf_color_filter_text = proto_registrar_get_id_byname("frame.coloring_rule.string");
+  fields = dfilter_interesting_fields(dfcode, &num_fields);
+  for (i = 0; i < num_fields; i++) {
+    if (fields[i] == hf_delta_displayed ||
+        fields[i] == hf_color_filter_name ||
+        fields[i] == hf_color_filter_text)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* The results of the last few display filters applied to every frame,
+   most recently used first, so that going back to one of them, or to a
+   combination of two of them, needn't dissect anything. */
+#define DFILTER_RESULTS_MAX 8
+
+struct dfilter_result {
+  gchar       *dftext;          /* Normalized text of the filter */
+  guint32      count;           /* Frames 1 to count have results */
+  ws_bitmap_t *passed;          /* Frames that passed the filter */
+  ws_bitmap_t *depended_upon;   /* Frames that those frames depend upon */
+  gboolean     dependents_stale; /* depended_upon may miss some frames */
+};
+
+static void
+dfilter_result_free(gpointer data, gpointer user_data _U_)
+{
+  dfilter_result_t *result = (dfilter_result_t *)data;
+
+  g_free(result->dftext);
+  ws_bitmap_free(result->passed);
+  ws_bitmap_free(result->depended_upon);
+  g_free(result);
+}
+
+static void
+dfilter_results_clear(capture_file *cf)
+{
+  g_list_foreach(cf->dfilter_results, dfilter_result_free, NULL);
+  g_list_free(cf->dfilter_results);
+  cf->dfilter_results = NULL;
+}
+
+/* Find the results of a filter, given its normalized text, and make them
+   the most recently used ones. */
+static dfilter_result_t *
+dfilter_results_find(capture_file *cf, const gchar *dftext)
+{
+  GList *item;
+
+  for (item = cf->dfilter_results; item != NULL; item = g_list_next(item)) {
+    if (strcmp(((dfilter_result_t *)item->data)->dftext, dftext) == 0) {
+      cf->dfilter_results = g_list_remove_link(cf->dfilter_results, item);
+      cf->dfilter_results = g_list_concat(item, cf->dfilter_results);
+      return (dfilter_result_t *)item->data;
+    }
+  }
+  return NULL;
+}
+
+static void
+dfilter_results_add(capture_file *cf, dfilter_result_t *result)
+{
+  GList *last;
+
+  cf->dfilter_results = g_list_prepend(cf->dfilter_results, result);
+  if (g_list_length(cf->dfilter_results) > DFILTER_RESULTS_MAX) {
+    last = g_list_last(cf->dfilter_results);
+    dfilter_result_free(last->data, NULL);
+    cf->dfilter_results = g_list_delete_link(cf->dfilter_results, last);
+  }
+}
+
+/* Find the results of a filter, or work them out from those of the two
+   filters it's the "and" or "or" of. */
+static dfilter_result_t *
+dfilter_results_lookup(capture_file *cf, const gchar *dftext)
+{
+  dfilter_result_t *result;
+  dfilter_result_t *left_result, *right_result;
+  gboolean          is_and;
+  gchar            *left, *right;
+
+  result = dfilter_results_find(cf, dftext);
+  if (result != NULL || !dfilter_text_split(dftext, &is_and, &left, &right))
+    return result;
+
+  left_result = dfilter_results_find(cf, left);
+  right_result = dfilter_results_find(cf, right);
+  if (left_result != NULL && right_result != NULL &&
+      left_result->count == right_result->count) {
+    result = g_new(dfilter_result_t, 1);
+    result->dftext = g_strdup(dftext);
+    result->count = left_result->count;
+    if (is_and)
+      result->passed = ws_bitmap_and(left_result->passed, right_result->passed);
+    else
+      result->passed = ws_bitmap_or(left_result->passed, right_result->passed);
+    /* We don't know which of the frames the two filters' frames depend
+       upon the frames passing this one depend upon, so keep them all;
+       for an "and", that may be more than needed. */
+    result->depended_upon = ws_bitmap_or(left_result->depended_upon,
+                                         right_result->depended_upon);
+    result->dependents_stale = is_and || left_result->dependents_stale ||
+                               right_result->dependents_stale;
+    dfilter_results_add(cf, result);
+  }
+  g_free(left);
+  g_free(right);
+  return result;
+}
+
+/* Remember which frames passed the current filter. */
+static void
+dfilter_results_record(capture_file *cf, const gchar *dftext)
+{
+  dfilter_result_t *result;
+  guint32           framenum;
+  frame_data       *fdata;
+
+  result = dfilter_results_find(cf, dftext);
+  if (result != NULL) {
+    if (result->count == cf->count &&
+        result->dependents_stale == cf->dependents_stale)
+      return;
+    cf->dfilter_results = g_list_remove(cf->dfilter_results, result);
+    dfilter_result_free(result, NULL);
+  }
+
+  result = g_new(dfilter_result_t, 1);
+  result->dftext = g_strdup(dftext);
+  result->count = cf->count;
+  result->passed = ws_bitmap_new();
+  result->depended_upon = ws_bitmap_new();
+  result->dependents_stale = cf->dependents_stale;
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (fdata->flags.passed_dfilter)
+      ws_bitmap_add(result->passed, framenum);
+    if (fdata->flags.dependent_of_displayed)
+      ws_bitmap_add(result->depended_upon, framenum);
+  }
+  dfilter_results_add(cf, result);
+}
+
 cf_status_t
 cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
 {
   const char *filter_new = dftext ? dftext : "";
   const char *filter_old = cf->dfilter ? cf->dfilter : "";
   dfilter_t  *dfcode;
+  dfilter_relation_t relation;
+  dfilter_result_t *cached;
+  gchar      *dfkey;
   GTimeVal    start_time;
 
   /* if new filter equals old one, do nothing unless told to do so */
@@ -1689,6 +1879,23 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
     }
   }
 
+  /* If the new filter just narrows or widens the current one, and every
+     frame has been tested against that one, not every frame has to be
+     tested again. */
+  relation = cf->dfilter_stale ? DFILTER_UNRELATED :
+    dfilter_text_relation(cf->dfilter, dftext);
+
+  /* Whatever made the current filter's results out of date may have done
+     the same to the ones we've remembered. */
+  if (cf->dfilter_stale)
+    dfilter_results_clear(cf);
+
+  /* Have we seen this filter, or the filters it's made of, before? */
+  dfkey = dftext != NULL ? dfilter_text_normalize(dftext) : NULL;
+  cached = dfkey != NULL ? dfilter_results_lookup(cf, dfkey) : NULL;
+  if (cached != NULL)
+    relation = DFILTER_UNRELATED;
+
   /* We have a valid filter.  Replace the current filter. */
   g_free(cf->dfilter);
   cf->dfilter = dftext;
@@ -1698,11 +1905,20 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
   /* Now rescan the packet list, applying the new filter, but not
      throwing away information constructed on a previous pass. */
   if (dftext == NULL) {
-    rescan_packets(cf, "Resetting", "Filter", FALSE);
+    rescan_packets(cf, "Resetting", "Filter", FALSE, relation, NULL, FALSE);
   } else {
-    rescan_packets(cf, "Filtering", dftext, FALSE);
+    rescan_packets(cf, "Filtering", dftext, FALSE, relation, cached, FALSE);
   }
 
+  /* Remember the results, unless the filter might mean something else
+     next time: macros can change, and the times since the previous
+     displayed frames and the frames' coloring rules depend on how the
+     frames were displayed. */
+  if (dfkey != NULL && !cf->dfilter_stale && strchr(dfkey, '$') == NULL &&
+      !dfilter_depends_on_display(dfcode))
+    dfilter_results_record(cf, dfkey);
+  g_free(dfkey);
+
   /* Cleanup and release all dfilter resources */
   dfilter_free(dfcode);
 
@@ -1713,16 +1929,35 @@ void
 cf_reftime_packets(capture_file *cf)
 {
   ref_time_packets(cf);
+  cf->dfilter_stale = TRUE;
 }
 
 void
 cf_redissect_packets(capture_file *cf)
 {
   if (cf->state != FILE_CLOSED) {
-    rescan_packets(cf, "Reprocessing", "all packets", TRUE);
+    dfilter_results_clear(cf);
+    rescan_packets(cf, "Reprocessing", "all packets", TRUE, DFILTER_UNRELATED, NULL, FALSE);
   }
 }
 
+void
+cf_mark_dependents(capture_file *cf)
+{
+  gchar *dfkey;
+
+  if (cf->state == FILE_CLOSED || cf->dfilter == NULL || !cf->dependents_stale)
+    return;
+
+  rescan_packets(cf, "Filtering", cf->dfilter, FALSE, DFILTER_UNRELATED, NULL, TRUE);
+
+  /* Remember the marks, if we remember this filter's results. */
+  dfkey = dfilter_text_normalize(cf->dfilter);
+  if (!cf->dfilter_stale && dfilter_results_find(cf, dfkey) != NULL)
+    dfilter_results_record(cf, dfkey);
+  g_free(dfkey);
+}
+
 gboolean
 cf_read_record_r(capture_file *cf, const frame_data *fdata,
                  struct wtap_pkthdr *phdr, Buffer *buf)
@@ -1788,9 +2023,22 @@ cf_read_record(capture_file *cf, frame_data *fdata)
    "redissect" is TRUE if we need to make the dissectors reconstruct
    any state information they have (because a preference that affects
    some dissector has changed, meaning some dissector might construct
-   its state differently from the way it was constructed the last time). */
+   its state differently from the way it was constructed the last time).
+
+   "relation" says how the current display filter relates to the one
+   that was applied before it; frames that failed a filter it refines,
+   or passed a filter it relaxes, needn't be looked at again.
+
+   "cached", if not null, has the results of an earlier pass with the
+   current display filter, so the frames it covers needn't be looked at
+   again either.
+
+   "mark_dependents" is TRUE if every frame has to be dissected, so that
+   the frames the displayed ones depend upon get marked. */
 static void
-rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect)
+rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect,
+               dfilter_relation_t relation, const dfilter_result_t *cached,
+               gboolean mark_dependents)
 {
   /* Rescan packets new packet list */
   guint32     framenum;
@@ -1812,6 +2060,11 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    create_proto_tree;
   guint       tap_flags;
   gboolean    add_to_packet_list = FALSE;
+  gboolean    metadata_only;
+  gboolean    dependents_stale = FALSE;
+  gboolean    skip_unchanged;
+  gboolean    incremental;
+  gboolean    keep_result;
   gboolean    compiled;
   guint32     frames_count;
 
@@ -1828,6 +2081,30 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   create_proto_tree =
     (dfcode != NULL || have_filtering_tap_listeners() || (tap_flags & TL_REQUIRES_PROTO_TREE));
 
+  /* If the filter only looks at things like the frames' lengths and
+     time stamps, and nothing else needs the packets dissected, the frame
+     dissector alone can tell which frames pass.  Frames that displayed
+     frames depend on, such as earlier parts of a reassembled PDU, are
+     only found by dissecting, so they don't get marked that way; we
+     note that, and cf_mark_dependents() dissects them all if printing
+     or exporting the displayed frames needs those marks. */
+  metadata_only = !redissect && !mark_dependents && dfcode != NULL && cinfo == NULL &&
+    !tap_listeners_require_dissection() && epan_dfilter_is_metadata_only(dfcode);
+
+  /* Frames whose result can't have changed needn't be read or dissected
+     at all, unless something else wants to see every frame.  That's not
+     so if the filter looks at how the frames were displayed, such as the
+     time since the previous displayed frame, as which frames are
+     displayed is what's changing, or their coloring rules, which the
+     packet list may have changed since. */
+  skip_unchanged = !redissect && !mark_dependents && cinfo == NULL &&
+    !tap_listeners_require_dissection() && !dfilter_depends_on_display(dfcode);
+  incremental = skip_unchanged && relation != DFILTER_UNRELATED;
+
+  /* Widening the filter keeps the marks we had, right or not. */
+  if (incremental && relation == DFILTER_RELAXES && cf->dependents_stale)
+    dependents_stale = TRUE;
+
   reset_tap_listeners();
   /* Which frame, if any, is the currently selected frame?
      XXX - should the selected frame or the focus frame be the "current"
@@ -1968,11 +2245,33 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     }
 
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
-    fdata->flags.dependent_of_displayed = 0;
+    if (skip_unchanged && cached != NULL && framenum <= cached->count) {
+      /* We already know this frame's result. */
+      fdata->flags.passed_dfilter = ws_bitmap_contains(cached->passed, framenum) ? 1 : 0;
+      fdata->flags.dependent_of_displayed = ws_bitmap_contains(cached->depended_upon, framenum) ? 1 : 0;
+      if (cached->dependents_stale)
+        dependents_stale = TRUE;
+      keep_result = TRUE;
+    } else {
+      /* Only displayed frames mark the frames they depend upon.  When
+         narrowing the filter, every frame that was displayed is tested
+         again, and marks again what it still depends upon; when widening
+         it, the frames that were displayed still are, and keep theirs. */
+      if (!incremental || relation == DFILTER_REFINES)
+        fdata->flags.dependent_of_displayed = 0;
+
+      /* A frame that failed the filter this one refines fails this one too,
+         and one that passed the filter this one relaxes passes this one. */
+      keep_result = incremental &&
+        fdata->flags.passed_dfilter == (relation == DFILTER_RELAXES ? 1 : 0);
+    }
 
-    if (!cf_read_record(cf, fdata))
+    if (!keep_result && !cf_read_record(cf, fdata))
       break; /* error reading the frame */
 
+    if (!keep_result && metadata_only)
+      dependents_stale = TRUE;
+
     /* If the previous frame is displayed, and we haven't yet seen the
        selected frame, remember that frame - it's the closest one we've
        yet seen before the selected frame. */
@@ -1984,7 +2283,9 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     add_packet_to_packet_list(fdata, cf, &edt, dfcode,
                                     cinfo, &cf->phdr,
                                     ws_buffer_start_ptr(&cf->buf),
-                                    add_to_packet_list);
+                                    add_to_packet_list,
+                                    keep_result ? FILTER_UNCHANGED :
+                                    metadata_only ? FILTER_METADATA : FILTER_DISSECT);
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -2006,6 +2307,11 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     prev_frame = fdata;
   }
 
+  /* If we stopped early, the frames we didn't get to still have the
+     previous filter's results. */
+  cf->dfilter_stale = (framenum <= frames_count);
+  cf->dependents_stale = dependents_stale || cf->dfilter_stale;
+
   epan_dissect_cleanup(&edt);
 
   /* We are done redissecting the packet list. */
@@ -2233,8 +2539,11 @@ process_specified_records(capture_file *cf, packet_range_t *range,
   progbar_stop_flag = FALSE;
   g_get_current_time(&progbar_start_time);
 
-  if (range != NULL)
+  if (range != NULL) {
+    if (range->process_filtered && range->include_dependents)
+      cf_mark_dependents(cf);
     packet_range_process_init(range);
+  }
 
   /* Iterate through all the packets, printing the packets that
      were selected by the current display filter.  */
@@ -3106,14 +3415,7 @@ match_subtree_text(proto_node *node, gpointer data)
   if (PROTO_ITEM_IS_HIDDEN(node))
     return;
 
-  /* was a free format label produced? */
-  if (fi->rep) {
-    label_ptr = fi->rep->representation;
-  } else {
-    /* no, make a generic label */
-    label_ptr = label_str;
-    proto_item_fill_label(fi, label_str);
-  }
+  label_ptr = proto_item_get_label(fi, label_str);
 
   /* Does that label match? */
   label_len = strlen(label_ptr);
@@ -3814,7 +4116,9 @@ cf_select_packet(capture_file *cf, int row)
   cf->edt = epan_dissect_new(cf->epan, TRUE, TRUE);
 
   tap_build_interesting(cf->edt);
-  epan_dissect_run(cf->edt, cf->cd_t, &cf->phdr, frame_tvbuff_new_buffer(cf->current_frame, &cf->buf),
+  /* cf->buf is reused for other frames while this tree is kept, and
+     field values can still point into the frame; give it a copy. */
+  epan_dissect_run(cf->edt, cf->cd_t, &cf->phdr, frame_tvbuff_new_buffer_copy(cf->current_frame, &cf->buf),
                    cf->current_frame, NULL);
 
   dfilter_macro_build_ftv_cache(cf->edt->tree);
@@ -3867,6 +4171,7 @@ cf_mark_frame(capture_file *cf, frame_data *frame)
     frame->flags.marked = TRUE;
     if (cf->count > cf->marked_count)
       cf->marked_count++;
+    cf->dfilter_stale = TRUE;
   }
 }
 
@@ -3880,6 +4185,7 @@ cf_unmark_frame(capture_file *cf, frame_data *frame)
     frame->flags.marked = FALSE;
     if (cf->marked_count > 0)
       cf->marked_count--;
+    cf->dfilter_stale = TRUE;
   }
 }
 
@@ -3893,6 +4199,7 @@ cf_ignore_frame(capture_file *cf, frame_data *frame)
     frame->flags.ignored = TRUE;
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
+    cf->dfilter_stale = TRUE;
   }
 }
 
@@ -3906,6 +4213,7 @@ cf_unignore_frame(capture_file *cf, frame_data *frame)
     frame->flags.ignored = FALSE;
     if (cf->ignored_count > 0)
       cf->ignored_count--;
+    cf->dfilter_stale = TRUE;
   }
 }
 
@@ -4023,6 +4331,7 @@ cf_set_user_packet_comment(capture_file *cf, frame_data *fd, const gchar *new_co
     cf->packet_comment_count++;
 
   fd->flags.has_user_comment = TRUE;
+  cf->dfilter_stale = TRUE;
 
   if (!cf->frames_user_comments)
     cf->frames_user_comments = g_tree_new_full(frame_cmp, NULL, NULL, g_free);
@@ -4898,6 +5207,8 @@ cf_export_specified_packets(capture_file *cf, const char *fname,
 
   cf_callback_invoke(cf_cb_file_export_specified_packets_started, (gpointer)fname);
 
+  if (range->process_filtered && range->include_dependents)
+    cf_mark_dependents(cf);
   packet_range_process_init(range);
 
   /* We're writing out specified packets from the specified capture
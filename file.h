@@ -387,6 +387,15 @@ void cf_set_rfcode(capture_file *cf, dfilter_t *rfcode);
  */
 cf_status_t cf_filter_packets(capture_file *cf, gchar *dfilter, gboolean force);
 
+/**
+ * Make sure the frames that displayed frames depend upon are marked.
+ * Filtering may leave them unmarked if it didn't dissect every frame;
+ * if so, dissect every frame again with the current display filter.
+ *
+ * @param cf the capture file
+ */
+void cf_mark_dependents(capture_file *cf);
+
 /**
  * At least one "Refence Time" flag has changed, rescan all packets.
  *
@@ -236,6 +236,30 @@ frame_tvbuff_new_buffer(const frame_data *fd, Buffer *buf)
 	return frame_tvbuff_new(fd, ws_buffer_start_ptr(buf));
 }
 
+/*
+ * Like frame_tvbuff_new_buffer(), but the tvbuff gets its own copy of
+ * the data, for a dissection that's kept while buf is reused for other
+ * frames.
+ */
+tvbuff_t *
+frame_tvbuff_new_buffer_copy(const frame_data *fd, Buffer *buf)
+{
+	struct tvb_frame *frame_tvb;
+	tvbuff_t *tvb;
+
+	tvb = frame_tvbuff_new(fd, NULL);
+	frame_tvb = (struct tvb_frame *) tvb;
+
+	frame_tvb->buf = (struct Buffer *) g_malloc(sizeof(struct Buffer));
+	ws_buffer_init(frame_tvb->buf, fd->cap_len);
+	ws_buffer_append(frame_tvb->buf, ws_buffer_start_ptr(buf), fd->cap_len);
+	frame_tvb->offset = 0;
+
+	tvb->real_data = ws_buffer_start_ptr(frame_tvb->buf);
+
+	return tvb;
+}
+
 static tvbuff_t *
 frame_clone(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
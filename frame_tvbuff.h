@@ -33,6 +33,8 @@ extern tvbuff_t *frame_tvbuff_new(const frame_data *fd, const guint8 *buf);
 
 extern tvbuff_t *frame_tvbuff_new_buffer(const frame_data *fd, Buffer *buf);
 
+extern tvbuff_t *frame_tvbuff_new_buffer_copy(const frame_data *fd, Buffer *buf);
+
 extern tvbuff_t *file_tvbuff_new(const frame_data *fd, const guint8 *buf);
 
 extern tvbuff_t *file_tvbuff_new_buffer(const frame_data *fd, Buffer *buf);
@@ -0,0 +1,561 @@
+#!/bin/bash
+#
+# Test the output formats of TShark
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 2005 Ulf Lamping
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+
+# common exit status values
+EXIT_OK=0
+EXIT_COMMAND_LINE=1
+EXIT_ERROR=2
+
+DIFF_OUT=./diff-output.txt
+ACTUAL_OUT=./actual-output.txt
+EXPECTED_OUT=./expected-output.txt
+FLOWS_TXT=./flows.txt
+FLOWS_PCAP=./flows.pcap
+COLUMNAR_OUT=./columnar-output.bin
+
+# Prints the "show" attributes of a field in -T pdml, separated by commas,
+# one line per packet.
+#   $1: quote put around each value, to tell empty values from none
+#   $2: capture file
+#   $3: field name
+#   further arguments are passed to TShark
+output_pdml_field_values() {
+	QUOTE="$1"
+	CAPTURE="$2"
+	FIELD="$3"
+	shift 3
+
+	$TSHARK "$@" -r "$CAPTURE" -T pdml \
+		| awk -v name="<field name=\"$FIELD\" " -v quote="$QUOTE" '
+			/^<packet>/ { values = ""; sep = "" }
+			index($0, name) && match($0, / show="[^"]*"/) {
+				values = values sep quote substr($0, RSTART + 7, RLENGTH - 8) quote
+				sep = ","
+			}
+			/^<\/packet>/ { print values }'
+}
+
+# Checks that -T fields gives all values of a field in the order in which
+# they are in the tree, by comparing it with the "show" attributes of the
+# field in -T pdml.
+#   $1: capture file
+#   $2: field name
+#   further arguments are passed to TShark
+output_fields_tree_order() {
+	CAPTURE="$1"
+	FIELD="$2"
+	shift 2
+
+	$TSHARK "$@" -r "$CAPTURE" \
+		-T fields -E occurrence=a -E aggregator=, -e "$FIELD" \
+		> $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	output_pdml_field_values "" "$CAPTURE" "$FIELD" "$@" > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "$FIELD values aren't in tree order"
+		return
+	fi
+	test_step_ok
+}
+
+# Checks -T columnar the same way, by reading back the single column it
+# writes for a field and printing its values as -T pdml would show them,
+# quoted so that empty strings show.  Only uint64 and string columns can
+# be read back.
+#   $1: capture file
+#   $2: field name
+#   further arguments are passed to TShark
+output_columnar_tree_order() {
+	CAPTURE="$1"
+	FIELD="$2"
+	shift 2
+
+	$TSHARK "$@" -r "$CAPTURE" -T columnar -e "$FIELD" > $COLUMNAR_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	od -An -v -tu1 $COLUMNAR_OUT | LC_ALL=C awk -v name="$FIELD" '
+		function le32(i) {
+			return b[i] + b[i + 1] * 256 + b[i + 2] * 65536 + b[i + 3] * 16777216
+		}
+		function text(start, end,   s, i) {
+			s = ""
+			for (i = start; i < end; i++)
+				s = s sprintf("%c", b[i])
+			return s
+		}
+		{ for (i = 1; i <= NF; i++) b[n++] = $i }
+		END {
+			if (text(0, 8) != "WSCOLS\r\n" || le32(8) != 1 || le32(12) != 1) {
+				print "bad header"
+				exit 1
+			}
+			type = le32(16)
+			if (text(24, 24 + le32(20)) != name) {
+				print "bad column name"
+				exit 1
+			}
+			p = 24 + le32(20)
+			while ((rows = le32(p)) > 0) {
+				end = p + 8 + le32(p + 4)
+				p += 8
+				for (r = 0; r <= rows; r++)
+					row[r] = le32(p + 4 * r)
+				p += 4 * (rows + 1)
+				if (type == 6) {
+					for (v = 0; v <= row[rows]; v++)
+						value_end[v] = le32(p + 4 * v)
+					p += 4 * (row[rows] + 1)
+				} else if (type != 1) {
+					print "unexpected column type " type
+					exit 1
+				}
+				for (r = 0; r < rows; r++) {
+					values = ""
+					for (v = row[r]; v < row[r + 1]; v++) {
+						if (type == 6)
+							value = text(p + value_end[v], p + value_end[v + 1])
+						else
+							value = sprintf("%.0f", le32(p + 8 * v) + le32(p + 8 * v + 4) * 4294967296)
+						values = values (v > row[r] ? "," : "") "\047" value "\047"
+					}
+					print values
+				}
+				p = end
+			}
+			if (p + 4 != n) {
+				print "trailing data"
+				exit 1
+			}
+		}' > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $ACTUAL_OUT
+		test_step_failed "Can't read -T columnar output"
+		return
+	fi
+
+	output_pdml_field_values "'" "$CAPTURE" "$FIELD" "$@" > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "$FIELD values read back from -T columnar differ"
+		return
+	fi
+	test_step_ok
+}
+
+# The SSL handshake types of a packet are a list in a uint64 column
+output_step_columnar_ssl_handshake_types() {
+	output_columnar_tree_order "$CAPTURE_DIR/rsasnakeoil2.pcap" ssl.handshake.type
+}
+
+# bootp.server is an empty string when the client gives no server name
+output_step_columnar_empty_strings() {
+	output_columnar_tree_order "$CAPTURE_DIR/dhcp.pcap" bootp.server
+}
+
+# ber.id.uni_tag and ber.id.tag are each registered for short and long
+# form tags
+output_step_fields_ber_tags() {
+	output_fields_tree_order "$CAPTURE_DIR/rsasnakeoil2.pcap" ber.id.uni_tag \
+		-o "ber.show_internals: TRUE"
+}
+
+# bootp.option.value.uint is registered for each size of value
+output_step_fields_bootp_values() {
+	output_fields_tree_order "$CAPTURE_DIR/dhcp.pcap" bootp.option.value.uint
+}
+
+# ssl.handshake.type is registered for SSLv2 and later versions
+output_step_fields_ssl_handshake_types() {
+	output_fields_tree_order "$CAPTURE_DIR/rsasnakeoil2.pcap" ssl.handshake.type
+}
+
+# The UDP summary in the tree is only formatted when the tree is printed
+output_step_deferred_label() {
+	$TSHARK -n -V -r "$CAPTURE_DIR/dhcp.pcap" > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	COUNT=`grep -c '^User Datagram Protocol, Src Port: 68 (68), Dst Port: 67 (67)$' $ACTUAL_OUT`
+	if [ ! "$COUNT" -eq 2 ]; then
+		test_step_failed "Found $COUNT client UDP summaries, expected 2"
+		return
+	fi
+	COUNT=`grep -c '^User Datagram Protocol, Src Port: 67 (67), Dst Port: 68 (68)$' $ACTUAL_OUT`
+	if [ ! "$COUNT" -eq 2 ]; then
+		test_step_failed "Found $COUNT server UDP summaries, expected 2"
+		return
+	fi
+	test_step_ok
+}
+
+# Output with --workers must be that of a single process, here for DNS
+# and ICMP traffic.
+output_step_workers() {
+	if [ "$WS_SYSTEM" == "Windows" ] ; then
+		test_step_skipped
+		return
+	fi
+
+	$TSHARK -n -r "$CAPTURE_DIR/dns+icmp.pcapng.gz" > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n --workers 3 -r "$CAPTURE_DIR/dns+icmp.pcapng.gz" > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK --workers: $RETURNVALUE"
+		return
+	fi
+
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "Output with --workers differs"
+		return
+	fi
+	test_step_ok
+}
+
+# The same for a filter and the fields of each packet, which must include
+# the time since the previous captured frame.
+output_step_workers_fields() {
+	if [ "$WS_SYSTEM" == "Windows" ] ; then
+		test_step_skipped
+		return
+	fi
+
+	FIELDS="-T fields -e frame.number -e frame.time_delta -e frame.time_relative -e ip.src -e dns.qry.name -e icmp.type"
+	$TSHARK -n -r "$CAPTURE_DIR/dns+icmp.pcapng.gz" -Y "dns || icmp.type == 8" $FIELDS > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n --workers 3 -r "$CAPTURE_DIR/dns+icmp.pcapng.gz" -Y "dns || icmp.type == 8" $FIELDS > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK --workers: $RETURNVALUE"
+		return
+	fi
+
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "Fields with --workers differ"
+		return
+	fi
+	test_step_ok
+}
+
+# What each worker would only count for its own packets is refused.
+output_step_workers_refused() {
+	if [ "$WS_SYSTEM" == "Windows" ] ; then
+		test_step_skipped
+		return
+	fi
+
+	for ARGS in "-q -z conv,udp" "-T fields -e frame.cum_bytes" "-Y frame.time_delta_displayed>0"; do
+		$TSHARK -n --workers 3 -r "$CAPTURE_DIR/dns+icmp.pcapng.gz" $ARGS > $ACTUAL_OUT 2>&1
+		RETURNVALUE=$?
+		if [ $RETURNVALUE -eq $EXIT_OK ]; then
+			echo
+			cat $ACTUAL_OUT
+			test_step_failed "$TSHARK --workers accepted $ARGS"
+			return
+		fi
+	done
+	test_step_ok
+}
+
+# Writes a capture of $1 UDP packets, one second apart, spread over $2
+# flows
+output_write_flows() {
+	i=0
+	while [ $i -lt $1 ]; do
+		PORT=$((10000 + i % $2))
+		printf "%02d:%02d:%02d.0\n" $((i / 3600)) $((i / 60 % 60)) $((i % 60))
+		printf "000000 00 00 00 00 00 02 00 00 00 00 00 01 08 00 45 00\n"
+		printf "000010 00 24 00 00 00 00 40 11 00 00 c0 00 02 01 c0 00\n"
+		printf "000020 02 02 %02x %02x 30 39 00 10 00 00 78 78 78 78 78 78\n" \
+			$((PORT / 256)) $((PORT % 256))
+		printf "000030 78 78\n"
+		i=$((i + 1))
+	done > $FLOWS_TXT
+	$TEXT2PCAP -q -t "%H:%M:%S." $FLOWS_TXT $FLOWS_PCAP
+}
+
+# With --flow-idle-timeout the number of conversations kept stays bounded
+# by the traffic within the timeout rather than growing with the capture.
+output_step_flow_expiry() {
+	output_write_flows 200 200
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TEXT2PCAP: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n -q -z flows,stat -r $FLOWS_PCAP > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+	LIVE=`sed -n 's/^Live: //p' $EXPECTED_OUT`
+	if [ "$LIVE" != 200 ]; then
+		test_step_failed "$LIVE conversations kept without a timeout, expected 200"
+		return
+	fi
+
+	$TSHARK -n -q -z flows,stat --flow-idle-timeout 5 -r $FLOWS_PCAP > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK --flow-idle-timeout: $RETURNVALUE"
+		return
+	fi
+	LIVE=`sed -n 's/^Live: //p' $ACTUAL_OUT`
+	EXPIRED=`sed -n 's/^Expired: //p' $ACTUAL_OUT`
+	RETIRED=`sed -n 's/^Expired, not freed yet: //p' $ACTUAL_OUT`
+	if [ ! "$LIVE" -le 10 -o ! "$RETIRED" -le 10 ]; then
+		test_step_failed "$LIVE conversations kept and $RETIRED not freed with a 5 second timeout"
+		return
+	fi
+	if [ ! $((LIVE + EXPIRED)) -eq 200 ]; then
+		test_step_failed "$LIVE conversations kept and $EXPIRED expired, expected 200 in all"
+		return
+	fi
+	test_step_ok
+}
+
+# Heuristic dissectors that rejected the first packets of a conversation
+# aren't tried on the others
+output_step_heur_stat() {
+	output_write_flows 10 1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TEXT2PCAP: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n -q -z heur,stat -r $FLOWS_PCAP > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+	TRIED=`sed -n 's/^Tried: //p' $ACTUAL_OUT`
+	AVOIDED=`sed -n 's/^Not tried, as they rejected earlier packets: //p' $ACTUAL_OUT`
+	if [ ! "$TRIED" -gt 0 -o ! "$AVOIDED" -gt 0 ]; then
+		test_step_failed "$TRIED heuristic dissectors tried and $AVOIDED not tried"
+		return
+	fi
+	test_step_ok
+}
+
+# --minimal-dissection still finds the fields of the packet quoted in an
+# ICMP error, here a port unreachable for a UDP packet
+output_step_minimal_icmp_error() {
+	printf "000000 00 00 00 00 00 01 00 00 00 00 00 02 08 00 45 00\n" > $FLOWS_TXT
+	printf "000010 00 40 00 00 00 00 40 01 00 00 c0 00 02 02 c0 00\n" >> $FLOWS_TXT
+	printf "000020 02 01 03 03 00 00 00 00 00 00 45 00 00 24 00 00\n" >> $FLOWS_TXT
+	printf "000030 00 00 40 11 00 00 c0 00 02 01 c0 00 02 02 27 10\n" >> $FLOWS_TXT
+	printf "000040 30 39 00 10 00 00 78 78 78 78 78 78 78 78\n" >> $FLOWS_TXT
+	$TEXT2PCAP -q $FLOWS_TXT $FLOWS_PCAP
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TEXT2PCAP: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n -r $FLOWS_PCAP -T fields -E aggregator=, \
+		-e ip.src -e udp.srcport > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n -r $FLOWS_PCAP -T fields -E aggregator=, \
+		-e ip.src -e udp.srcport --minimal-dissection > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK --minimal-dissection: $RETURNVALUE"
+		return
+	fi
+
+	if ! grep -q '^192.0.2.2,192.0.2.1	10000$' $EXPECTED_OUT; then
+		test_step_failed "Unexpected fields of the ICMP error: `cat $EXPECTED_OUT`"
+		return
+	fi
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "Output with --minimal-dissection differs"
+		return
+	fi
+	test_step_ok
+}
+
+# --minimal-dissection with statistics but no -e
+output_step_minimal_stat() {
+	$TSHARK -n -q -z conv,udp -r "$CAPTURE_DIR/dhcp.pcap" > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+
+	$TSHARK -n -q -z conv,udp --minimal-dissection \
+		-r "$CAPTURE_DIR/dhcp.pcap" > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK --minimal-dissection: $RETURNVALUE"
+		return
+	fi
+
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "Statistics with --minimal-dissection differ"
+		return
+	fi
+	test_step_ok
+}
+
+# Output with --pipeline must be that without it, including the names
+# from the file's name resolution block.
+output_step_pipeline() {
+	$TSHARK -N n -o "nameres.use_external_name_resolver: FALSE" \
+		-r "$CAPTURE_DIR/dns+icmp.pcapng.gz" > $EXPECTED_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+	if ! grep -q 'Crunch\.local' $EXPECTED_OUT; then
+		test_step_failed "Names from the name resolution block weren't used"
+		return
+	fi
+
+	$TSHARK -N n -o "nameres.use_external_name_resolver: FALSE" --pipeline \
+		-r "$CAPTURE_DIR/dns+icmp.pcapng.gz" > $ACTUAL_OUT
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK --pipeline: $RETURNVALUE"
+		return
+	fi
+
+	diff -u $EXPECTED_OUT $ACTUAL_OUT > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		cat $DIFF_OUT
+		test_step_failed "Output with --pipeline differs"
+		return
+	fi
+	test_step_ok
+}
+
+tshark_output_suite() {
+	test_step_add "Fields registered more than once (BER tags)" output_step_fields_ber_tags
+	test_step_add "Fields registered more than once (BOOTP values)" output_step_fields_bootp_values
+	test_step_add "Fields registered more than once (SSL handshake types)" output_step_fields_ssl_handshake_types
+	test_step_add "Columnar lists of values (SSL handshake types)" output_step_columnar_ssl_handshake_types
+	test_step_add "Columnar empty strings (BOOTP server names)" output_step_columnar_empty_strings
+	test_step_add "Deferred item labels" output_step_deferred_label
+	test_step_add "Dissection split between workers" output_step_workers
+	test_step_add "Fields from dissection split between workers" output_step_workers_fields
+	test_step_add "Per-process counts refused with workers" output_step_workers_refused
+	test_step_add "Conversations forgotten after an idle timeout" output_step_flow_expiry
+	test_step_add "Heuristic dissectors skipped for a conversation" output_step_heur_stat
+	test_step_add "Minimal dissection of an ICMP error" output_step_minimal_icmp_error
+	test_step_add "Minimal dissection for statistics only" output_step_minimal_stat
+	test_step_add "Reading and writing in their own threads" output_step_pipeline
+}
+
+output_cleanup_step() {
+	rm -f $DIFF_OUT $ACTUAL_OUT $EXPECTED_OUT $FLOWS_TXT $FLOWS_PCAP $COLUMNAR_OUT
+}
+
+output_suite() {
+	test_step_set_pre output_cleanup_step
+	test_step_set_post output_cleanup_step
+	test_suite_add "TShark output formats" tshark_output_suite
+}
+
+#
+# Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+#
+# Local variables:
+# c-basic-offset: 8
+# tab-width: 8
+# indent-tabs-mode: t
+# End:
+#
+# vi: set shiftwidth=8 tabstop=8 noexpandtab:
+# :indentSize=8:tabSize=8:noTabs=false:
+#
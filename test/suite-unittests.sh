@@ -77,6 +77,12 @@ unittests_step_exntest() {
 	unittests_step_test
 }
 
+unittests_step_conversation_test() {
+	set_dut conversation_test
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_oids_test() {
 	set_dut oids_test
 	ARGS=
@@ -95,6 +101,12 @@ unittests_step_tvbtest() {
 	unittests_step_test
 }
 
+unittests_step_ws_bitmap_test() {
+	set_dut ../wsutil/ws_bitmap_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_step_wmem_test() {
 	set_dut wmem/wmem_test
 	ARGS=--verbose
@@ -108,11 +120,13 @@ unittests_cleanup_step() {
 unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
+	test_step_add "conversation_test" unittests_step_conversation_test
 	test_step_add "exntest" unittests_step_exntest
 	test_step_add "oids_test" unittests_step_oids_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
 	test_step_add "tvbtest" unittests_step_tvbtest
 	test_step_add "wmem_test" unittests_step_wmem_test
+	test_step_add "ws_bitmap_test" unittests_step_ws_bitmap_test
 }
 #
 # Editor modelines  -  http://www.wireshark.org/tools/modelines.html
@@ -54,6 +54,7 @@ Usage: $THIS [-c] [-h] [-s <suite>]
       fileformats
       io
       nameres
+      output
       prerequisites
       unittests
       wslua
@@ -102,6 +103,7 @@ source $TESTS_DIR/suite-unittests.sh
 source $TESTS_DIR/suite-fileformats.sh
 source $TESTS_DIR/suite-decryption.sh
 source $TESTS_DIR/suite-nameres.sh
+source $TESTS_DIR/suite-output.sh
 source $TESTS_DIR/suite-wslua.sh
 
 test_cleanup() {
@@ -162,6 +164,7 @@ test_suite() {
 	test_suite_add "File formats" fileformats_suite
 	test_suite_add "Decryption" decryption_suite
 	test_suite_add "Name Resolution" name_resolution_suite
+	test_suite_add "Output formats" output_suite
 	test_suite_add "Lua API" wslua_suite
 }
 
@@ -202,6 +205,9 @@ if [ -n "$RUN_SUITE" ] ; then
 		"nameres")
 			test_suite_run "Name Resolution" name_resolution_suite
 			exit $? ;;
+		"output")
+			test_suite_run "Output formats" output_suite
+			exit $? ;;
 		"prerequisites")
 			test_suite_run "Prerequisites" prerequisites_suite
 			exit $? ;;
@@ -1667,6 +1667,11 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* If we're writing fields, prime the epan_dissect_t with them, so
+       their values can be picked up without searching the tree. */
+    if (print_packet_info && output_action == WRITE_FIELDS)
+      output_fields_prime_edt(edt, output_fields);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -2084,6 +2089,11 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* If we're writing fields, prime the epan_dissect_t with them, so
+       their values can be picked up without searching the tree. */
+    if (print_packet_info && output_action == WRITE_FIELDS)
+      output_fields_prime_edt(edt, output_fields);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
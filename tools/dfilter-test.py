@@ -30,11 +30,14 @@ from dftestlib.bytes_type import testBytes
 from dftestlib.bytes_ether import testBytesEther
 from dftestlib.bytes_ipv6 import testBytesIPv6
 from dftestlib.double import testDouble
+from dftestlib.group import testGroup
 from dftestlib.integer import testInteger
 from dftestlib.integer_1byte import testInteger1Byte
 from dftestlib.ipv4 import testIPv4
+from dftestlib.matches import testMatches
 from dftestlib.range_method import testRange
 from dftestlib.scanner import testScanner
+from dftestlib.specialized import testSpecialized
 from dftestlib.string_type import testString
 from dftestlib.stringz import testStringz
 from dftestlib.time_type import testTime
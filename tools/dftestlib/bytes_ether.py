@@ -116,3 +116,11 @@ class testBytesEther(dftest.DFTest):
     def test_contains_4(self):
         dfilter = "ipx.src.node contains aa:e3"
         self.assertDFilterCount(dfilter, 0)
+
+    def test_in_1(self):
+        dfilter = "eth.dst in {00:01:02:03:04:05 ff:ff:ff:ff:ff:ff}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_2(self):
+        dfilter = "eth.src in {00:01:02:03:04:05 ff:ff:ff:ff:ff:ff}"
+        self.assertDFilterCount(dfilter, 0)
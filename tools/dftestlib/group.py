@@ -0,0 +1,119 @@
+# Copyright (c) 2013 by Gilbert Ramirez <gram@alumni.rice.edu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+import os
+
+from dftestlib import dftest
+from dftestlib import util
+
+class testGroup(dftest.DFTest):
+    """The filters of all tap listeners are applied as one merged
+    dfilter group, the way coloring rules are. Each io,stat column is a
+    tap listener, so its frame count is what the group gave that filter;
+    it must be what the filter gives on its own."""
+
+    # Enough packets for a test's memo slot to be true for some and
+    # false for others
+    trace_file = os.path.join("..", "..", "test", "captures",
+            "rsasnakeoil2.pcap")
+
+    def runGroup(self, dfilters):
+        cmdv = [dftest.TSHARK,
+                "-n",
+                "-r",
+                self.trace_file,
+                "-q",
+                "-z",
+                "io,stat,0," + ",".join(dfilters)]
+
+        (status, output) = util.exec_cmdv(cmdv)
+        self.assertEqual(status, util.SUCCESS, output)
+
+        # The one row of a 0 interval: | 0 <> Dur | frames | bytes | ...
+        rows = [L for L in output.split("\n") if "<>" in L]
+        self.assertEqual(len(rows), 1, output)
+        cells = [c.strip() for c in rows[0].split("|")[2:] if c.strip() != ""]
+        return [int(c) for c in cells[0::2]]
+
+    def assertGroupMatchesSingle(self, dfilters):
+        counts = self.runGroup(dfilters)
+        self.assertEqual(len(counts), len(dfilters))
+        for dfilter, count in zip(dfilters, counts):
+            self.assertDFilterCount(dfilter, count)
+
+    def test_shared_field_1(self):
+        self.assertGroupMatchesSingle([
+            "tcp.port == 38713",
+            "tcp.port == 38713 && ssl",
+            "!(tcp.port == 38713)",
+            "tcp.srcport == 443 || tcp.port == 38713"])
+
+    def test_shared_exists_1(self):
+        self.assertGroupMatchesSingle([
+            "ssl",
+            "ssl && tcp",
+            "!ssl",
+            "udp || ssl"])
+
+    def test_order_1(self):
+        # The filter that reaches a shared test first evaluates it
+        self.assertGroupMatchesSingle([
+            "udp || ssl",
+            "!ssl",
+            "ssl && tcp",
+            "ssl"])
+
+    def test_skipped_memo_1(self):
+        # The first filter only reaches the shared test for some
+        # packets; the second has to evaluate it for the others.
+        self.assertGroupMatchesSingle([
+            "ssl && tcp.srcport == 443",
+            "tcp.srcport == 443",
+            "!(tcp.srcport == 443)"])
+
+    def test_same_constant_1(self):
+        # The constant is shared, but the tests aren't
+        self.assertGroupMatchesSingle([
+            "tcp.srcport == 443",
+            "tcp.dstport == 443",
+            "tcp.srcport == 443 || tcp.dstport == 443"])
+
+    def test_relations_1(self):
+        self.assertGroupMatchesSingle([
+            "frame.len > 100",
+            "frame.len > 100 && tcp",
+            "frame.len >= 100",
+            "frame.len < 100",
+            "frame.len > 1000"])
+
+    def test_duplicates_1(self):
+        self.assertGroupMatchesSingle([
+            "tcp.flags.syn == 1",
+            "tcp.flags.syn == 1",
+            "!(tcp.flags.syn == 1)"])
+
+    def test_changed_filters_1(self):
+        # Changing one filter, like editing a coloring rule, builds a
+        # new group that must not keep the old filter's memo slots.
+        self.assertGroupMatchesSingle([
+            "ssl",
+            "tcp.len > 0",
+            "tcp.srcport == 443"])
+        self.assertGroupMatchesSingle([
+            "ssl",
+            "tcp.len > 0 && ssl",
+            "tcp.srcport == 443"])
@@ -147,3 +147,35 @@ class testInteger(dftest.DFTest):
     def test_bool_ne_2(self):
         dfilter = "ip.flags.df != 0"
         self.assertDFilterCount(dfilter, 0)
+
+    def test_in_1(self):
+        dfilter = "ip.version in {4 6}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_2(self):
+        dfilter = "ip.version in {5, 6}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_bool_in_1(self):
+        dfilter = "ip.flags.df in {0}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_bool_in_2(self):
+        dfilter = "ip.flags.df in {1}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_or_merge_1(self):
+        dfilter = "ip.version == 5 || ip.version == 6 || ip.version == 4"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_or_merge_2(self):
+        dfilter = "ip.version == 5 || ip.version in {6 7}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_not_not_1(self):
+        dfilter = "!!(ip.version == 4)"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_and_order_1(self):
+        dfilter = "ip.version == 4 && ntp && !(ip.version == 6)"
+        self.assertDFilterCount(dfilter, 1)
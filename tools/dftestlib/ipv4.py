@@ -120,4 +120,28 @@ class testIPv4(dftest.DFTest):
         dfilter = "ip.src != 200.0.0.0/8"
         self.assertDFilterCount(dfilter, 2)
 
+    def test_in_1(self):
+        dfilter = "ip.src in {172.25.100.14 10.0.0.1}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_2(self):
+        dfilter = "ip.src in {10.0.0.1, 10.0.0.2}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_3(self):
+        dfilter = "ip.dst in {198.95.230.20}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_cidr_in_1(self):
+        dfilter = "ip.src in {10.0.0.0/8 172.25.0.0/16}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_cidr_in_2(self):
+        dfilter = "ip.src in {10.0.0.0/8 172.25.100.0/28 192.168.0.0/16}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_cidr_in_3(self):
+        dfilter = "ip.src in {10.0.0.0/8 172.25.100.16/28}"
+        self.assertDFilterCount(dfilter, 0)
+
 
@@ -0,0 +1,125 @@
+# Copyright (c) 2013 by Gilbert Ramirez <gram@alumni.rice.edu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+from dftestlib import dftest
+
+class testMatches(dftest.DFTest):
+    """A "matches" pattern is only run on data containing the longest
+    literal text that every match must contain. These patterns all have
+    parts that must not be taken for such text; each one that matches
+    the trace must still match it."""
+
+    # HEAD /v4/iuident.cab?0307011208 HTTP/1.1
+    # User-Agent: Industry Update Control
+    # Host: windowsupdate.microsoft.com
+    trace_file = "http.pcap"
+
+    def test_plain_1(self):
+        dfilter = 'http.user_agent matches "Update Control"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_plain_2(self):
+        dfilter = 'http.user_agent matches "Update Controls"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_alternation_1(self):
+        dfilter = 'http.user_agent matches "Foo|Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_alternation_2(self):
+        dfilter = 'http.user_agent matches "Industry (Foo|Update)"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_alternation_3(self):
+        dfilter = 'http.user_agent matches "Foo|Bar"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_optional_1(self):
+        dfilter = 'http.user_agent matches "Industry (Big )?Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_optional_2(self):
+        dfilter = 'http.user_agent matches "Industry (Big )*Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_optional_3(self):
+        dfilter = 'http.user_agent matches "Industryx? Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_optional_4(self):
+        dfilter = 'http.user_agent matches "Industryx{0,2} Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_optional_5(self):
+        dfilter = 'http.user_agent matches "Indus(try)+ Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_class_1(self):
+        dfilter = 'http.host matches "windows[a-z]pdate"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_class_2(self):
+        dfilter = 'http.host matches "windows[]u]pdate"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_class_3(self):
+        dfilter = 'http.host matches "windows[[:lower:]]pdate"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_class_4(self):
+        dfilter = 'http.host matches "windows[^u]pdate"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_caseless_1(self):
+        dfilter = 'http.user_agent matches "(?i)industry update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_caseless_2(self):
+        dfilter = 'http.host matches "(?i)WINDOWSUPDATE"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_caseless_3(self):
+        dfilter = 'http.user_agent matches "industry update"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_escape_1(self):
+        dfilter = r'http.request.uri matches "iuident\\.cab\\?0307"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_escape_2(self):
+        dfilter = r'http.request.uri matches "iuident\\.cabx"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_escape_3(self):
+        dfilter = r'http.request.uri matches "\\?\\d{10}"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_escape_4(self):
+        dfilter = r'http.host matches "microsoft\\Dcom"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_escape_5(self):
+        dfilter = r'http.request.uri matches "\\x2fv4\\x2f"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_protocol_1(self):
+        dfilter = 'frame matches "Industry (Big )?Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_protocol_2(self):
+        dfilter = 'frame matches "(?i)industry|nothing"'
+        self.assertDFilterCount(dfilter, 1)
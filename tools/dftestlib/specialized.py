@@ -0,0 +1,182 @@
+# Copyright (c) 2013 by Gilbert Ramirez <gram@alumni.rice.edu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+import os
+
+from dftestlib import dftest
+from dftestlib import util
+
+INTERPRET_ENV = "WIRESHARK_DEBUG_DFILTER_INTERPRET"
+
+class testSpecialized(dftest.DFTest):
+    """A test against a constant of a common type runs a function
+    specialized for it. Each filter is run that way and through the
+    generic interpreter loop, which setting
+    WIRESHARK_DEBUG_DFILTER_INTERPRET selects, and both must give the
+    expected count."""
+
+    trace_file = "ntp.pcap"
+
+    def runDFilterEngine(self, trace_file, dfilter, interpret):
+        env = dict(os.environ)
+        if interpret:
+            env[INTERPRET_ENV] = "1"
+        elif INTERPRET_ENV in env:
+            del env[INTERPRET_ENV]
+
+        cmdv = [dftest.TSHARK,
+                "-n",
+                "-r",
+                trace_file,
+                "-Y",
+                dfilter]
+
+        return util.exec_cmdv(cmdv, env=env)
+
+    def assertBothCount(self, dfilter, expected_count, trace_file=None):
+        if trace_file is None:
+            trace_file = self.trace_file
+        else:
+            trace_file = os.path.join(".", "tools", "dftestfiles",
+                    trace_file)
+
+        for interpret in (False, True):
+            (status, output) = self.runDFilterEngine(trace_file,
+                    dfilter, interpret)
+            self.assertEqual(status, util.SUCCESS, output)
+
+            lines = [L for L in output.split("\n") if L != ""]
+            msg = "Expected %d with%s %s, got: %s" % (expected_count,
+                    "" if interpret else "out", INTERPRET_ENV, output)
+            self.assertEqual(len(lines), expected_count, msg)
+
+    def test_u_eq_1(self):
+        self.assertBothCount("ip.version == 4", 1)
+
+    def test_u_eq_2(self):
+        self.assertBothCount("ip.version == 6", 0)
+
+    def test_u_ne_1(self):
+        self.assertBothCount("ip.version != 6", 1)
+
+    def test_u_ne_2(self):
+        self.assertBothCount("ip.version != 4", 0)
+
+    def test_u_gt_1(self):
+        self.assertBothCount("ip.version > 3", 1)
+
+    def test_u_gt_2(self):
+        self.assertBothCount("ip.version > 4", 0)
+
+    def test_u_ge_1(self):
+        self.assertBothCount("ip.version >= 4", 1)
+
+    def test_u_ge_2(self):
+        self.assertBothCount("ip.version >= 5", 0)
+
+    def test_u_lt_1(self):
+        self.assertBothCount("ip.version < 5", 1)
+
+    def test_u_lt_2(self):
+        self.assertBothCount("ip.version < 4", 0)
+
+    def test_u_le_1(self):
+        self.assertBothCount("ip.version <= 4", 1)
+
+    def test_u_le_2(self):
+        self.assertBothCount("ip.version <= 3", 0)
+
+    def test_u_and_1(self):
+        self.assertBothCount("ip.version & 0x04", 1)
+
+    def test_u_and_2(self):
+        self.assertBothCount("ip.version & 0x03", 0)
+
+    # ntp.precision is -11, 0xf5 as a byte
+    def test_s_eq_1(self):
+        self.assertBothCount("ntp.precision == -11", 1)
+
+    def test_s_eq_2(self):
+        self.assertBothCount("ntp.precision == 11", 0)
+
+    def test_s_ne_1(self):
+        self.assertBothCount("ntp.precision != 11", 1)
+
+    def test_s_ne_2(self):
+        self.assertBothCount("ntp.precision != -11", 0)
+
+    def test_s_gt_1(self):
+        # Compared as unsigned, -11 would be greater than 1
+        self.assertBothCount("ntp.precision > 1", 0)
+
+    def test_s_gt_2(self):
+        self.assertBothCount("ntp.precision > -12", 1)
+
+    def test_s_ge_1(self):
+        self.assertBothCount("ntp.precision >= -11", 1)
+
+    def test_s_ge_2(self):
+        self.assertBothCount("ntp.precision >= -10", 0)
+
+    def test_s_lt_1(self):
+        self.assertBothCount("ntp.precision < 1", 1)
+
+    def test_s_lt_2(self):
+        self.assertBothCount("ntp.precision < -11", 0)
+
+    def test_s_le_1(self):
+        self.assertBothCount("ntp.precision <= -11", 1)
+
+    def test_s_le_2(self):
+        self.assertBothCount("ntp.precision <= -12", 0)
+
+    def test_s_and_1(self):
+        self.assertBothCount("ntp.precision & 0x04", 1)
+
+    def test_s_and_2(self):
+        self.assertBothCount("ntp.precision & 0x08", 0)
+
+    def test_ipv4_eq_1(self):
+        self.assertBothCount("ip.src == 172.25.100.14", 1, "nfs.pcap")
+
+    def test_ipv4_eq_2(self):
+        self.assertBothCount("ip.src == 172.25.100.15", 0, "nfs.pcap")
+
+    def test_ipv4_eq_3(self):
+        self.assertBothCount("ip.src == 172.25.100.0/24", 1, "nfs.pcap")
+
+    def test_ipv4_eq_4(self):
+        self.assertBothCount("ip.src == 172.26.0.0/16", 0, "nfs.pcap")
+
+    def test_bytes_eq_1(self):
+        self.assertBothCount("arp.dst.hw == 00:64", 1, "arp.pcap")
+
+    def test_bytes_eq_2(self):
+        self.assertBothCount("arp.dst.hw == 00:00", 0, "arp.pcap")
+
+    def test_bytes_eq_3(self):
+        self.assertBothCount("eth.src == 00:aa:00:a3:e3:a4", 1,
+                "ipx_rip.pcap")
+
+    def test_bytes_eq_4(self):
+        # Same length and first byte, different last byte
+        self.assertBothCount("eth.src == 00:aa:00:a3:e3:a5", 0,
+                "ipx_rip.pcap")
+
+    def test_bytes_eq_5(self):
+        # Different length
+        self.assertBothCount("arp.dst.hw == 00:64:00", 0, "arp.pcap")
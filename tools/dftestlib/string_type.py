@@ -172,3 +172,15 @@ class testString(dftest.DFTest):
         dfilter = 'lower(tcp.seq) == 4'
         self.assertDFilterFail(dfilter)
 
+    def test_in_1(self):
+        dfilter = 'http.request.method in {"GET" "HEAD"}'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_2(self):
+        dfilter = 'http.request.method in {"POST", "PUT"}'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_3(self):
+        dfilter = 'lower(http.request.method) in {"head"}'
+        self.assertDFilterFail(dfilter)
+
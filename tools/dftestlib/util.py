@@ -18,16 +18,17 @@
 import subprocess
 
 SUCCESS = 0
-def exec_cmdv(cmdv, cwd=None, stdin=None):
+def exec_cmdv(cmdv, cwd=None, stdin=None, env=None):
     """Run the commands in cmdv, returning (retval, output),
     where output is stdout and stderr combined.
     If cwd is given, the child process runs in that directory.
     If a filehandle is passed as stdin, it is used as stdin.
+    If env is given, it is the child process's environment.
     If there is an OS-level error, None is the retval."""
 
     try:
         output = subprocess.check_output(cmdv, stderr=subprocess.STDOUT,
-                cwd=cwd, stdin=stdin)
+                cwd=cwd, stdin=stdin, env=env)
         retval = SUCCESS
 
     # If file isn't executable
@@ -46,6 +46,7 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/wait.h>
 #endif
 
 #ifdef HAVE_SYS_STAT_H
@@ -78,6 +79,7 @@
 #include <wsutil/filesystem.h>
 #include <wsutil/report_err.h>
 #include <wsutil/ws_version_info.h>
+#include <wsutil/pint.h>
 
 #include "globals.h"
 #include <epan/timestamp.h>
@@ -91,6 +93,7 @@
 #include <epan/prefs.h>
 #include <epan/column.h>
 #include <epan/print.h>
+#include <epan/reassemble.h>
 #include <epan/addr_resolv.h>
 #ifdef HAVE_LIBPCAP
 #include "ui/capture_ui_utils.h"
@@ -104,6 +107,7 @@
 #include <epan/stat_tap_ui.h>
 #include <epan/conversation_table.h>
 #include <epan/ex-opt.h>
+#include <epan/etypes.h>
 
 #if defined(HAVE_HEIMDAL_KERBEROS) || defined(HAVE_MIT_KERBEROS)
 #include <epan/asn1.h>
@@ -148,6 +152,13 @@ static frame_data prev_cap_frame;
 static const char* prev_display_dissector_name = NULL;
 
 static gboolean perform_two_pass_analysis;
+static gboolean minimal_dissection;
+static gboolean metadata_only_dfilter; /* TRUE if the frames' metadata is enough */
+static guint flow_idle_timeout;
+static guint flow_age_timeout;
+static guint num_workers;         /* --workers; 0 means don't fork any */
+static gboolean stats_requested;  /* TRUE if -z was given */
+static gboolean use_pipeline;     /* --pipeline */
 
 /*
  * The way the packet decode is to be written.
@@ -155,7 +166,8 @@ static gboolean perform_two_pass_analysis;
 typedef enum {
   WRITE_TEXT,   /* summary or detail text */
   WRITE_XML,    /* PDML or PSML */
-  WRITE_FIELDS  /* User defined list of fields */
+  WRITE_FIELDS, /* User defined list of fields */
+  WRITE_COLUMNAR /* The same fields, in a binary columnar format */
   /* Add CSV and the like here */
 } output_action_e;
 
@@ -170,6 +182,7 @@ static gboolean really_quiet = FALSE;
 
 static print_format_e print_format = PR_FMT_TEXT;
 static print_stream_t *print_stream;
+static FILE *print_fh;            /* where print_packet() prints to */
 
 static output_fields_t* output_fields  = NULL;
 
@@ -211,11 +224,17 @@ static int load_cap_file(capture_file *, char *, int, gboolean, int, gint64);
 static gboolean process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
     struct wtap_pkthdr *whdr, const guchar *pd,
     guint tap_flags);
+static gboolean dfilter_needs_only_metadata(capture_file *cf);
 static void show_capture_file_io_error(const char *, int, gboolean);
 static void show_print_file_io_error(int err);
 static gboolean write_preamble(capture_file *cf);
 static gboolean print_packet(capture_file *cf, epan_dissect_t *edt);
 static gboolean write_finale(void);
+#ifndef _WIN32
+static gboolean start_workers(void);
+static int merge_workers_output(void);
+static const char *workers_unsupported_field(capture_file *cf);
+#endif
 static const char *cf_open_error_message(int err, gchar *err_info,
     gboolean for_writing, int file_type);
 
@@ -341,6 +360,20 @@ print_usage(FILE *output)
   fprintf(output, "  -R <read filter>         packet Read filter in Wireshark display filter syntax\n");
   fprintf(output, "  -Y <display filter>      packet displaY filter in Wireshark display filter\n");
   fprintf(output, "                           syntax\n");
+  fprintf(output, "  --minimal-dissection     only dissect the protocols needed by the filters,\n");
+  fprintf(output, "                           output fields and statistics\n");
+  fprintf(output, "  --flow-idle-timeout <seconds>\n");
+  fprintf(output, "                           forget conversations and reassemblies idle for\n");
+  fprintf(output, "                           that long (single-pass only)\n");
+  fprintf(output, "  --flow-age-timeout <seconds>\n");
+  fprintf(output, "                           forget conversations set up that long ago\n");
+  fprintf(output, "                           (single-pass only)\n");
+  fprintf(output, "  --composite-reassembly   keep reassembled data as references to the\n");
+  fprintf(output, "                           fragments instead of copying it\n");
+  fprintf(output, "  --workers <count>        split the packets of the capture file by flow\n");
+  fprintf(output, "                           between that many processes\n");
+  fprintf(output, "  --pipeline               read and write out packets in separate threads\n");
+  fprintf(output, "                           while dissecting (single-pass only)\n");
   fprintf(output, "  -n                       disable all name resolutions (def: all enabled)\n");
   fprintf(output, "  -N <name resolve flags>  enable specific name resolution(s): \"mntC\"\n");
   fprintf(output, "  -d %s ...\n", decode_as_arg_template);
@@ -362,10 +395,10 @@ print_usage(FILE *output)
   fprintf(output, "  -P                       print packet summary even when writing to a file\n");
   fprintf(output, "  -S <separator>           the line separator to print between packets\n");
   fprintf(output, "  -x                       add output of hex and ASCII dump (Packet Bytes)\n");
-  fprintf(output, "  -T pdml|ps|psml|text|fields\n");
+  fprintf(output, "  -T pdml|ps|psml|text|fields|columnar\n");
   fprintf(output, "                           format of text output (def: text)\n");
-  fprintf(output, "  -e <field>               field to print if -Tfields selected (e.g. tcp.port,\n");
-  fprintf(output, "                           _ws.col.Info)\n");
+  fprintf(output, "  -e <field>               field to print if -Tfields or -Tcolumnar selected\n");
+  fprintf(output, "                           (e.g. tcp.port, _ws.col.Info)\n");
   fprintf(output, "                           this option can be repeated to print multiple fields\n");
   fprintf(output, "  -E<fieldsoption>=<value> set options for output when -Tfields selected:\n");
   fprintf(output, "     header=y|n            switch headers on and off\n");
@@ -948,9 +981,21 @@ main(int argc, char *argv[])
   GString             *runtime_info_str;
   char                *init_progfile_dir_error;
   int                  opt;
+#define LONGOPT_MINIMAL_DISSECTION MIN_NON_CAPTURE_LONGOPT
+#define LONGOPT_FLOW_IDLE_TIMEOUT  MIN_NON_CAPTURE_LONGOPT+1
+#define LONGOPT_FLOW_AGE_TIMEOUT   MIN_NON_CAPTURE_LONGOPT+2
+#define LONGOPT_COMPOSITE_REASSEMBLY MIN_NON_CAPTURE_LONGOPT+3
+#define LONGOPT_WORKERS            MIN_NON_CAPTURE_LONGOPT+4
+#define LONGOPT_PIPELINE           MIN_NON_CAPTURE_LONGOPT+5
   static const struct option long_options[] = {
     {(char *)"help", no_argument, NULL, 'h'},
     {(char *)"version", no_argument, NULL, 'v'},
+    {(char *)"minimal-dissection", no_argument, NULL, LONGOPT_MINIMAL_DISSECTION},
+    {(char *)"flow-idle-timeout", required_argument, NULL, LONGOPT_FLOW_IDLE_TIMEOUT},
+    {(char *)"flow-age-timeout", required_argument, NULL, LONGOPT_FLOW_AGE_TIMEOUT},
+    {(char *)"composite-reassembly", no_argument, NULL, LONGOPT_COMPOSITE_REASSEMBLY},
+    {(char *)"workers", required_argument, NULL, LONGOPT_WORKERS},
+    {(char *)"pipeline", no_argument, NULL, LONGOPT_PIPELINE},
     LONGOPT_CAPTURE_COMMON
     {0, 0, 0, 0 }
   };
@@ -1610,9 +1655,15 @@ main(int argc, char *argv[])
         output_action = WRITE_FIELDS;
         print_details = TRUE;   /* Need full tree info */
         print_summary = FALSE;  /* Don't allow summary */
+      } else if (strcmp(optarg, "columnar") == 0) {
+        output_action = WRITE_COLUMNAR;
+        print_details = TRUE;   /* Need full tree info */
+        print_summary = FALSE;  /* Don't allow summary */
       } else {
         cmdarg_err("Invalid -T parameter \"%s\"; it must be one of:", optarg);                   /* x */
-        cmdarg_err_cont("\t\"fields\" The values of fields specified with the -e option, in a form\n"
+        cmdarg_err_cont("\t\"columnar\" The values of fields specified with the -e option, in a\n"
+                        "\t         binary columnar format for loading into analysis tools.\n"
+                        "\t\"fields\" The values of fields specified with the -e option, in a form\n"
                         "\t         specified by the -E option.\n"
                         "\t\"pdml\"   Packet Details Markup Language, an XML-based format for the\n"
                         "\t         details of a decoded packet. This information is equivalent to\n"
@@ -1671,6 +1722,24 @@ main(int argc, char *argv[])
     case 'Y':
       dfilter = optarg;
       break;
+    case LONGOPT_MINIMAL_DISSECTION:
+      minimal_dissection = TRUE;
+      break;
+    case LONGOPT_FLOW_IDLE_TIMEOUT:
+      flow_idle_timeout = get_positive_int(optarg, "flow idle timeout");
+      break;
+    case LONGOPT_FLOW_AGE_TIMEOUT:
+      flow_age_timeout = get_positive_int(optarg, "flow age timeout");
+      break;
+    case LONGOPT_COMPOSITE_REASSEMBLY:
+      reassembly_set_composite_tvbs(TRUE);
+      break;
+    case LONGOPT_WORKERS:
+      num_workers = get_positive_int(optarg, "number of workers");
+      break;
+    case LONGOPT_PIPELINE:
+      use_pipeline = TRUE;
+      break;
     case 'z':
       /* We won't call the init function for the stat this soon
          as it would disallow MATE's fields (which are registered
@@ -1687,6 +1756,7 @@ main(int argc, char *argv[])
         list_stat_cmd_args();
         return 1;
       }
+      stats_requested = TRUE;
       break;
     default:
     case '?':        /* Bad flag - print usage message */
@@ -1703,7 +1773,8 @@ main(int argc, char *argv[])
   }
 
   /* If we specified output fields, but not the output field type... */
-  if (WRITE_FIELDS != output_action && 0 != output_fields_num_fields(output_fields)) {
+  if (WRITE_FIELDS != output_action && WRITE_COLUMNAR != output_action &&
+      0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
             "but \"-Tfields\" was not specified.");
         return 1;
@@ -1711,6 +1782,11 @@ main(int argc, char *argv[])
         cmdarg_err("\"-Tfields\" was specified, but no fields were "
                     "specified with \"-e\".");
 
+        return 1;
+  } else if (WRITE_COLUMNAR == output_action && 0 == output_fields_num_fields(output_fields)) {
+        cmdarg_err("\"-Tcolumnar\" was specified, but no fields were "
+                    "specified with \"-e\".");
+
         return 1;
   }
 
@@ -1815,6 +1891,69 @@ main(int argc, char *argv[])
     return 1;
   }
 
+  /* Summary lines and packet details need every protocol. */
+  if (minimal_dissection && print_packet_info &&
+      (print_summary || print_hex ||
+       (output_action != WRITE_FIELDS && output_action != WRITE_COLUMNAR) ||
+       output_fields_has_cols(output_fields))) {
+    cmdarg_err("--minimal-dissection can only be used with -T fields or -T columnar (without column fields), -q or -w.");
+    return 1;
+  }
+
+  /* The second pass would need the state that timed out. */
+  if ((flow_idle_timeout || flow_age_timeout) && perform_two_pass_analysis) {
+    cmdarg_err("--flow-idle-timeout and --flow-age-timeout can't be used with -2.");
+    return 1;
+  }
+
+  /* Every worker reads the file for itself, and they only print. */
+  if (num_workers > 1) {
+#ifdef _WIN32
+    cmdarg_err("--workers isn't supported on Windows.");
+    return 1;
+#else
+    if (cf_name == NULL || strcmp(cf_name, "-") == 0) {
+      cmdarg_err("--workers can only be used when reading a capture file other than the standard input.");
+      return 1;
+    }
+    if (perform_two_pass_analysis) {
+      cmdarg_err("--workers can't be used with -2.");
+      return 1;
+    }
+    if (print_packet_info && output_action == WRITE_COLUMNAR) {
+      /* A row group holds packets from all over the file. */
+      cmdarg_err("--workers can't be used with -T columnar.");
+      return 1;
+    }
+    if (stats_requested) {
+      /* Each worker would only count its own packets. */
+      cmdarg_err("--workers can't be used with -z.");
+      return 1;
+    }
+#ifdef HAVE_LIBPCAP
+    if (global_capture_opts.saving_to_file) {
+#else
+    if (output_file_name != NULL) {
+#endif
+      cmdarg_err("--workers can't be used with -w.");
+      return 1;
+    }
+#endif
+  }
+
+  /* The reader can't read ahead of the second pass's seeks, and a
+     worker's output has to be in its file when it marks a frame. */
+  if (use_pipeline) {
+    if (perform_two_pass_analysis) {
+      cmdarg_err("--pipeline can't be used with -2.");
+      return 1;
+    }
+    if (num_workers > 1) {
+      cmdarg_err("--pipeline can't be used with --workers.");
+      return 1;
+    }
+  }
+
 #ifdef HAVE_LIBPCAP
   if (list_link_layer_types) {
     /* We're supposed to list the link-layer types for an interface;
@@ -2073,6 +2212,18 @@ main(int argc, char *argv[])
   }
   cfile.dfcode = dfcode;
 
+#ifndef _WIN32
+  if (num_workers > 1) {
+    const char *field = workers_unsupported_field(&cfile);
+
+    if (field != NULL) {
+      cmdarg_err("--workers can't be used with %s.", field);
+      return 1;
+    }
+  }
+#endif
+
+  print_fh = stdout;
   if (print_packet_info) {
     /* If we're printing as text or PostScript, we have
        to create a print stream. */
@@ -2108,6 +2259,17 @@ main(int argc, char *argv[])
     /*
      * We're reading a capture file.
      */
+#ifndef _WIN32
+    if (num_workers > 1 && !start_workers()) {
+      /* We're the parent; the workers read and dissect the file,
+         and we put their output together. */
+      exit_status = merge_workers_output();
+      g_free(cf_name);
+      epan_cleanup();
+      output_fields_free(output_fields);
+      return exit_status;
+    }
+#endif
     if (cf_open(&cfile, cf_name, in_file_type, FALSE, &err) != CF_OK) {
       epan_cleanup();
       return 2;
@@ -2403,6 +2565,22 @@ tshark_epan_new(capture_file *cf)
   epan->get_interface_name = cap_file_get_interface_name;
   epan->get_user_comment = NULL;
 
+  if (minimal_dissection) {
+    epan_dissect_t *edt = epan_dissect_new(epan, TRUE, FALSE);
+
+    if (cf->rfcode)
+      epan_dissect_prime_dfilter(edt, cf->rfcode);
+    if (cf->dfcode)
+      epan_dissect_prime_dfilter(edt, cf->dfcode);
+    output_fields_prime_edt(edt, output_fields);
+    if (!epan_set_minimal_dissection(epan, edt))
+      cmdarg_err("The requested statistics need a full dissection; ignoring --minimal-dissection.");
+    epan_dissect_free(edt);
+  }
+
+  if (flow_idle_timeout || flow_age_timeout)
+    epan_set_flow_timeouts(epan, flow_idle_timeout, flow_age_timeout);
+
   return epan;
 }
 
@@ -2699,6 +2877,8 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
+  metadata_only_dfilter = dfilter_needs_only_metadata(cf);
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
@@ -2898,6 +3078,24 @@ capture_cleanup(int signum _U_)
 #endif /* _WIN32 */
 #endif /* HAVE_LIBPCAP */
 
+/*
+ * If all we do with the packets is filter them, and the display filter
+ * only looks at the frames' metadata (lengths, time stamps, ...), the
+ * contents of the frames needn't be dissected.
+ *
+ * Not with two passes, though: the first pass dissects every frame to
+ * find the frames that the displayed ones depend upon, which are written
+ * out too, and the second pass has to see the frames the same way.
+ */
+static gboolean
+dfilter_needs_only_metadata(capture_file *cf)
+{
+  return cf->dfcode != NULL && !print_packet_info &&
+         !perform_two_pass_analysis &&
+         !tap_listeners_require_dissection() &&
+         epan_dfilter_is_metadata_only(cf->dfcode);
+}
+
 static gboolean
 process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
                gint64 offset, struct wtap_pkthdr *whdr,
@@ -3007,6 +3205,12 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* If we're writing fields, prime the epan_dissect_t with them, so
+       their values can be picked up without searching the tree. */
+    if (print_packet_info &&
+        (output_action == WRITE_FIELDS || output_action == WRITE_COLUMNAR))
+      output_fields_prime_edt(edt, output_fields);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3025,7 +3229,10 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
       ref = &ref_frame;
     }
 
-    epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new_buffer(fdata, buf), fdata, cinfo);
+    if (metadata_only_dfilter)
+      epan_dissect_run_metadata(edt, cf->cd_t, phdr, frame_tvbuff_new_buffer(fdata, buf), fdata);
+    else
+      epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new_buffer(fdata, buf), fdata, cinfo);
 
     /* Run the read/display filter if we have one. */
     if (cf->dfcode)
@@ -3078,6 +3285,920 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
   return passed || fdata->flags.dependent_of_displayed;
 }
 
+/*
+ * With --workers, the packets of the capture file are split between
+ * several worker processes by flow.  Every worker reads the whole file,
+ * but only dissects the packets whose flow hashes to it, so each one
+ * sees all the packets of its flows, and conversations and reassembly
+ * work as they would in a single process.  The workers write their
+ * output to temporary files, and tell the parent through a pipe where
+ * the output for each frame ends; the parent copies it to its standard
+ * output in frame order.
+ */
+static guint worker_num;            /* which worker this is */
+static int   worker_mark_fd = -1;   /* -1 if this isn't a worker */
+
+/* Where in a worker's output the output for a frame ends */
+typedef struct {
+  gint64  end;
+  guint32 framenum;
+} worker_mark_t;
+
+/* Pseudo-frame numbers for the preamble and finale, which sort
+   before and after every frame */
+#define WORKER_MARK_PREAMBLE  0
+#define WORKER_MARK_FINALE    G_MAXUINT32
+
+/* FNV-1a */
+static guint32
+hash_bytes(guint32 h, const guint8 *p, size_t len)
+{
+  while (len--) {
+    h ^= *p++;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+/*
+ * Which worker dissects a packet: a hash of its IP addresses, with the
+ * lower address first so that both directions go to the same worker.
+ * Nothing past the addresses is used, so that the fragments of a
+ * datagram, which have no ports after the first, and IPv6 packets with
+ * extension headers go where the rest of their flow goes.  Packets that
+ * aren't IP, or whose link layer we don't look into, all go to the
+ * first worker.
+ */
+static guint
+worker_of_packet(const struct wtap_pkthdr *phdr, const guchar *pd)
+{
+  guint32       len = phdr->caplen;
+  guint16       ethertype;
+  const guint8 *addr_a, *addr_b, *addr_tmp;
+  size_t        addr_len;
+  guint32       h;
+
+  if (phdr->rec_type != REC_TYPE_PACKET)
+    return 0;
+
+  switch (phdr->pkt_encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+    if (len < 14)
+      return 0;
+    ethertype = pntoh16(pd + 12);
+    pd += 14;
+    len -= 14;
+    while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_IEEE_802_1AD) &&
+           len >= 4) {
+      ethertype = pntoh16(pd + 2);
+      pd += 4;
+      len -= 4;
+    }
+    break;
+
+  case WTAP_ENCAP_SLL:
+    if (len < 16)
+      return 0;
+    ethertype = pntoh16(pd + 14);
+    pd += 16;
+    len -= 16;
+    break;
+
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    if (len < 1)
+      return 0;
+    ethertype = (pd[0] >> 4) == 6 ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+    break;
+
+  default:
+    return 0;
+  }
+
+  if (ethertype == ETHERTYPE_IP) {
+    if (len < 20 || (pd[0] >> 4) != 4)
+      return 0;
+    addr_a = pd + 12;
+    addr_b = pd + 16;
+    addr_len = 4;
+  } else if (ethertype == ETHERTYPE_IPv6) {
+    if (len < 40 || (pd[0] >> 4) != 6)
+      return 0;
+    addr_a = pd + 8;
+    addr_b = pd + 24;
+    addr_len = 16;
+  } else {
+    return 0;
+  }
+
+  if (memcmp(addr_a, addr_b, addr_len) > 0) {
+    addr_tmp = addr_a;
+    addr_a = addr_b;
+    addr_b = addr_tmp;
+  }
+
+  h = 2166136261U;
+  h = hash_bytes(h, addr_a, addr_len);
+  h = hash_bytes(h, addr_b, addr_len);
+  return h % num_workers;
+}
+
+/*
+ * Count a packet that another worker dissects, and remember it as the
+ * previous captured frame and, if it's the first, as the reference
+ * frame, so that our packets' time fields are right.  Our cumulative
+ * bytes and "previous displayed frame" only cover our own packets.
+ */
+static void
+skip_packet(capture_file *cf, gint64 offset, struct wtap_pkthdr *whdr)
+{
+  frame_data fdata;
+
+  cf->count++;
+  frame_data_init(&fdata, cf->count, whdr, offset, cum_bytes);
+  if (ref == NULL) {
+    ref_frame = fdata;
+    ref = &ref_frame;
+  }
+  prev_cap_frame = fdata;
+  prev_cap = &prev_cap_frame;
+  frame_data_destroy(&fdata);
+}
+
+/*
+ * A worker's cumulative bytes and "previous displayed frame" only cover
+ * its own packets, so their fields and columns would differ from those
+ * of a single process.  Returns the name of the first one we'd print or
+ * filter on, or NULL if there's none.
+ */
+static const char *
+workers_unsupported_field(capture_file *cf)
+{
+  static const char *fields[] = {
+    "frame.cum_bytes",
+    "frame.time_delta_displayed"
+  };
+  dfilter_t *dfcodes[2];
+  const int *ids;
+  int        num_ids, id;
+  guint      i, j;
+  int        k;
+
+  dfcodes[0] = cf->rfcode;
+  dfcodes[1] = cf->dfcode;
+  for (i = 0; i < G_N_ELEMENTS(fields); i++) {
+    if (print_packet_info && output_fields_has_field(output_fields, fields[i]))
+      return fields[i];
+
+    id = proto_registrar_get_id_byname(fields[i]);
+    for (j = 0; j < G_N_ELEMENTS(dfcodes); j++) {
+      if (dfcodes[j] == NULL)
+        continue;
+      ids = dfilter_interesting_fields(dfcodes[j], &num_ids);
+      for (k = 0; k < num_ids; k++) {
+        if (ids[k] == id)
+          return fields[i];
+      }
+    }
+  }
+
+  if (print_packet_info && (print_summary || output_fields_has_cols(output_fields))) {
+    for (k = 0; k < cf->cinfo.num_cols; k++) {
+      switch (cf->cinfo.col_fmt[k]) {
+      case COL_CUMULATIVE_BYTES:
+        return "the cumulative bytes column";
+      case COL_DELTA_TIME_DIS:
+        return "the delta time displayed column";
+      default:
+        break;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* In a worker, tell the parent that we've written the output for
+   a frame, or the preamble or finale. */
+static void
+worker_mark(guint32 framenum)
+{
+  worker_mark_t mark;
+
+  if (worker_mark_fd == -1)
+    return;
+
+  fflush(stdout);
+  memset(&mark, 0, sizeof mark);
+  mark.end = (gint64)ws_lseek64(1, 0, SEEK_CUR);
+  mark.framenum = framenum;
+  if (ws_write(worker_mark_fd, &mark, sizeof mark) < (int)sizeof mark) {
+    /* The parent has gone away, so no one will see our output. */
+    exit(2);
+  }
+}
+
+#ifndef _WIN32
+typedef struct {
+  pid_t          pid;
+  FILE          *out;         /* the worker's standard output */
+  int            mark_fd;
+  worker_mark_t  mark;        /* the last mark it sent */
+  gboolean       marks_done;  /* no more marks are coming */
+  gint64         copied;      /* how much of its output we've dealt with */
+} worker_t;
+
+static worker_t *workers;
+
+static void
+kill_workers(guint count)
+{
+  guint i;
+
+  for (i = 0; i < count; i++) {
+    kill(workers[i].pid, SIGTERM);
+    waitpid(workers[i].pid, NULL, 0);
+  }
+}
+
+/*
+ * Fork the workers.  Returns TRUE in each worker, which goes on to
+ * open and read the file as tshark normally does, and FALSE in the
+ * parent.
+ */
+static gboolean
+start_workers(void)
+{
+  guint i, j;
+  int   mark_pipe[2];
+
+  workers = g_new0(worker_t, num_workers);
+
+  /* Don't let the workers write out what we've buffered. */
+  fflush(stdout);
+  fflush(stderr);
+
+  for (i = 0; i < num_workers; i++) {
+    workers[i].out = tmpfile();
+    if (workers[i].out == NULL || pipe(mark_pipe) == -1) {
+      cmdarg_err("Couldn't set up worker %u: %s.", i + 1, g_strerror(errno));
+      kill_workers(i);
+      exit(2);
+    }
+
+    workers[i].pid = fork();
+    if (workers[i].pid == -1) {
+      cmdarg_err("Couldn't start worker %u: %s.", i + 1, g_strerror(errno));
+      kill_workers(i);
+      exit(2);
+    }
+
+    if (workers[i].pid == 0) {
+      /* We're worker i. */
+      for (j = 0; j < i; j++) {
+        fclose(workers[j].out);
+        ws_close(workers[j].mark_fd);
+      }
+      ws_close(mark_pipe[0]);
+      if (dup2(fileno(workers[i].out), 1) == -1) {
+        cmdarg_err("Couldn't redirect the output of worker %u: %s.", i + 1,
+                   g_strerror(errno));
+        exit(2);
+      }
+      fclose(workers[i].out);
+      g_free(workers);
+      workers = NULL;
+
+      worker_num = i;
+      worker_mark_fd = mark_pipe[1];
+      return TRUE;
+    }
+
+    ws_close(mark_pipe[1]);
+    workers[i].mark_fd = mark_pipe[0];
+  }
+  return FALSE;
+}
+
+/* Read a worker's next mark; returns FALSE once it's sent its last. */
+static gboolean
+read_worker_mark(worker_t *w)
+{
+  size_t  got = 0;
+  ssize_t n;
+
+  while (got < sizeof w->mark) {
+    n = read(w->mark_fd, (char *)&w->mark + got, sizeof w->mark - got);
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      w->marks_done = TRUE;
+      return FALSE;
+    }
+    got += n;
+  }
+  return TRUE;
+}
+
+/* Copy a worker's output up to "end" to our standard output, or, if
+   "copy" is FALSE, skip it. */
+static gboolean
+copy_worker_output(worker_t *w, gint64 end, gboolean copy)
+{
+  static char buf[65536];
+  ssize_t     n;
+
+  while (copy && w->copied < end) {
+    n = pread(fileno(w->out), buf, (size_t)MIN((gint64)sizeof buf, end - w->copied),
+              (off_t)w->copied);
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    if (fwrite(buf, 1, n, stdout) != (size_t)n)
+      return FALSE;
+    w->copied += n;
+  }
+  w->copied = end;
+  return TRUE;
+}
+
+/*
+ * In the parent, copy the workers' output for each frame to our standard
+ * output in frame order, as they write it.  The preamble and finale are
+ * the same for every worker, so only the first worker's are used.  Anything
+ * a worker writes after the finale is copied last, in worker order.
+ * Returns the exit status for tshark: the worst of the workers' statuses.
+ */
+static int
+merge_workers_output(void)
+{
+  worker_t   *w, *next;
+  guint       i;
+  pid_t       pid;
+  int         status;
+  int         exit_status = 0;
+  ws_statb64  statb;
+
+  for (i = 0; i < num_workers; i++)
+    read_worker_mark(&workers[i]);
+
+  for (;;) {
+    next = NULL;
+    for (i = 0; i < num_workers; i++) {
+      w = &workers[i];
+      if (!w->marks_done && (next == NULL || w->mark.framenum < next->mark.framenum))
+        next = w;
+    }
+    if (next == NULL)
+      break;
+
+    if (!copy_worker_output(next, next->mark.end,
+                            next == &workers[0] ||
+                            (next->mark.framenum != WORKER_MARK_PREAMBLE &&
+                             next->mark.framenum != WORKER_MARK_FINALE)))
+      goto write_error;
+    if (line_buffered)
+      fflush(stdout);
+    read_worker_mark(next);
+  }
+
+  for (i = 0; i < num_workers; i++) {
+    w = &workers[i];
+    do {
+      pid = waitpid(w->pid, &status, 0);
+    } while (pid == -1 && errno == EINTR);
+    if (pid == -1 || !WIFEXITED(status))
+      exit_status = MAX(exit_status, 2);
+    else
+      exit_status = MAX(exit_status, WEXITSTATUS(status));
+
+    if (ws_fstat64(fileno(w->out), &statb) == 0 &&
+        !copy_worker_output(w, statb.st_size, TRUE))
+      goto write_error;
+    ws_close(w->mark_fd);
+    fclose(w->out);
+  }
+  fflush(stdout);
+  if (ferror(stdout))
+    goto write_error;
+
+  g_free(workers);
+  workers = NULL;
+  return exit_status;
+
+write_error:
+  show_print_file_io_error(errno);
+  kill_workers(num_workers);
+  return 2;
+}
+#endif /* _WIN32 */
+
+/*
+ * With --pipeline, reading, dissecting and writing out the packets of
+ * a capture file overlap: a reader thread reads records ahead of the
+ * dissection, and, if the C library lets us print into memory, a writer
+ * thread writes out what was printed for a packet while the following
+ * ones are dissected.  The records and the printed output are handed
+ * over through rings of slots with one producer and one consumer each,
+ * which only take a lock when one side has to wait for the other.
+ *
+ * Formatting stays in the dissecting thread, as it walks the protocol
+ * tree and uses the per-packet memory, both of which are gone once the
+ * next packet is dissected.
+ *
+ * Names from pcapng name resolution blocks are read by the reader too,
+ * but addr_resolv isn't thread safe, and a name should only be used for
+ * the packets after its block; so they are queued with the record that
+ * follows them and added when the dissecting thread gets to it.
+ */
+#define PIPELINE_RECORDS  256     /* must be powers of 2 */
+#define PIPELINE_OUTPUTS  64
+
+typedef struct {
+  guint          size;
+  volatile gint  head;            /* number of slots filled so far */
+  volatile gint  tail;            /* number of slots emptied so far */
+  volatile gint  done;            /* the producer won't fill any more */
+  volatile gint  stopped;         /* the consumer won't empty any more */
+  volatile gint  waiting;         /* how many sleep in pipeline_wait() */
+  GMutex        *mutex;
+  GCond         *cond;
+} pipeline_ring_t;
+
+typedef struct {
+  gboolean            ipv6;
+  guint8              addr[16];
+  gchar              *name;
+} pipeline_name_t;
+
+typedef struct {
+  gint64              offset;
+  struct wtap_pkthdr  phdr;
+  Buffer              buf;
+  GArray             *names;      /* pipeline_name_t read before this one */
+} pipeline_record_t;
+
+typedef struct {
+  FILE               *fh;         /* an open_memstream() on buf */
+  char               *buf;
+  size_t              len;
+  print_stream_t     *stream;     /* for -T text and ps, printing to fh */
+} pipeline_output_t;
+
+static struct {
+  gboolean            active;
+  GMutex             *wtap_lock;  /* held while the reader is in wtap_read() */
+  const char       *(*get_interface_name)(void *data, guint32 interface_id);
+
+  GThread            *reader;
+  pipeline_ring_t     records;
+  pipeline_record_t   record[PIPELINE_RECORDS];
+  pipeline_record_t  *reading;    /* the one the reader is filling in */
+  pipeline_record_t  *last_names; /* names after the last record, if any */
+  gboolean            have_record; /* we're dissecting the one at the tail */
+  int                 err;
+  gchar              *err_info;
+
+  GThread            *writer;
+  pipeline_ring_t     outputs;
+  pipeline_output_t   output[PIPELINE_OUTPUTS];
+  print_stream_t     *print_stream; /* the one for standard output */
+} pipeline;
+
+static GMutex *
+pipeline_mutex_new(void)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+  GMutex *mutex = g_new(GMutex, 1);
+
+  g_mutex_init(mutex);
+  return mutex;
+#else
+  return g_mutex_new();
+#endif
+}
+
+static void
+pipeline_mutex_free(GMutex *mutex)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+  g_mutex_clear(mutex);
+  g_free(mutex);
+#else
+  g_mutex_free(mutex);
+#endif
+}
+
+static void
+pipeline_ring_init(pipeline_ring_t *ring, guint size)
+{
+  memset(ring, 0, sizeof *ring);
+  ring->size = size;
+  ring->mutex = pipeline_mutex_new();
+#if GLIB_CHECK_VERSION(2,31,0)
+  ring->cond = g_new(GCond, 1);
+  g_cond_init(ring->cond);
+#else
+  ring->cond = g_cond_new();
+#endif
+}
+
+static void
+pipeline_ring_free(pipeline_ring_t *ring)
+{
+  pipeline_mutex_free(ring->mutex);
+#if GLIB_CHECK_VERSION(2,31,0)
+  g_cond_clear(ring->cond);
+  g_free(ring->cond);
+#else
+  g_cond_free(ring->cond);
+#endif
+}
+
+static guint
+pipeline_ring_used(pipeline_ring_t *ring)
+{
+  return (guint)g_atomic_int_get(&ring->head) - (guint)g_atomic_int_get(&ring->tail);
+}
+
+/* Can the producer fill a slot, or the consumer empty one? */
+static gboolean
+pipeline_ring_ready(pipeline_ring_t *ring, gboolean producer)
+{
+  if (producer)
+    return pipeline_ring_used(ring) < ring->size || g_atomic_int_get(&ring->stopped);
+  return pipeline_ring_used(ring) != 0 || g_atomic_int_get(&ring->done);
+}
+
+/*
+ * Sleep until the other side has moved on.  We count ourselves as
+ * waiting before checking the ring again, and the other side checks
+ * the count after moving on, so one of us sees what the other did.
+ */
+static void
+pipeline_wait(pipeline_ring_t *ring, gboolean producer)
+{
+  while (!pipeline_ring_ready(ring, producer)) {
+    g_mutex_lock(ring->mutex);
+    g_atomic_int_inc(&ring->waiting);
+    if (!pipeline_ring_ready(ring, producer))
+      g_cond_wait(ring->cond, ring->mutex);
+    g_atomic_int_dec_and_test(&ring->waiting);
+    g_mutex_unlock(ring->mutex);
+  }
+}
+
+static void
+pipeline_wake(pipeline_ring_t *ring)
+{
+  if (g_atomic_int_get(&ring->waiting)) {
+    g_mutex_lock(ring->mutex);
+    g_cond_broadcast(ring->cond);
+    g_mutex_unlock(ring->mutex);
+  }
+}
+
+/* The slot the producer fills next; *stopped is set if the consumer
+   has stopped, in which case it mustn't be filled */
+static guint
+pipeline_produce_slot(pipeline_ring_t *ring, gboolean *stopped)
+{
+  pipeline_wait(ring, TRUE);
+  *stopped = g_atomic_int_get(&ring->stopped);
+  return (guint)g_atomic_int_get(&ring->head) & (ring->size - 1);
+}
+
+static void
+pipeline_produced(pipeline_ring_t *ring)
+{
+  g_atomic_int_inc(&ring->head);
+  pipeline_wake(ring);
+}
+
+/* The slot the consumer empties next; FALSE if the producer is done
+   and everything it produced has been consumed */
+static gboolean
+pipeline_consume_slot(pipeline_ring_t *ring, guint *slot)
+{
+  pipeline_wait(ring, FALSE);
+  if (pipeline_ring_used(ring) == 0)
+    return FALSE;
+  *slot = (guint)g_atomic_int_get(&ring->tail) & (ring->size - 1);
+  return TRUE;
+}
+
+static void
+pipeline_consumed(pipeline_ring_t *ring)
+{
+  g_atomic_int_inc(&ring->tail);
+  pipeline_wake(ring);
+}
+
+static void
+pipeline_finish(volatile gint *flag, pipeline_ring_t *ring)
+{
+  g_atomic_int_set(flag, 1);
+  pipeline_wake(ring);
+}
+
+static gpointer
+pipeline_read_records(gpointer data)
+{
+  capture_file       *cf = (capture_file *)data;
+  pipeline_record_t  *rec;
+  struct wtap_pkthdr *phdr;
+  gboolean            stopped;
+  gboolean            ok;
+  Buffer              ft_specific_data;
+  gchar              *opt_comment;
+
+  for (;;) {
+    rec = &pipeline.record[pipeline_produce_slot(&pipeline.records, &stopped)];
+    if (stopped)
+      break;
+
+    g_mutex_lock(pipeline.wtap_lock);
+    pipeline.reading = rec;
+    ok = wtap_read(cf->wth, &pipeline.err, &pipeline.err_info, &rec->offset);
+    if (ok) {
+      /* The file type specific data is only used while reading */
+      phdr = wtap_phdr(cf->wth);
+      ft_specific_data = rec->phdr.ft_specific_data;
+      opt_comment = rec->phdr.opt_comment;
+      rec->phdr = *phdr;
+      rec->phdr.ft_specific_data = ft_specific_data;
+      rec->phdr.opt_comment = g_strdup(phdr->opt_comment);
+      g_free(opt_comment);
+      ws_buffer_clean(&rec->buf);
+      ws_buffer_append(&rec->buf, wtap_buf_ptr(cf->wth), phdr->caplen);
+    }
+    g_mutex_unlock(pipeline.wtap_lock);
+    if (!ok) {
+      pipeline.last_names = rec;
+      break;
+    }
+
+    pipeline_produced(&pipeline.records);
+  }
+
+  pipeline_finish(&pipeline.records.done, &pipeline.records);
+  return NULL;
+}
+
+/* Called by wtap_read() in the reader for name resolution blocks */
+static void
+pipeline_queue_name(gboolean ipv6, const void *addr, const gchar *name)
+{
+  pipeline_record_t *rec = pipeline.reading;
+  pipeline_name_t    entry;
+
+  entry.ipv6 = ipv6;
+  memcpy(entry.addr, addr, ipv6 ? 16 : 4);
+  entry.name = g_strdup(name);
+  if (rec->names == NULL)
+    rec->names = g_array_new(FALSE, FALSE, sizeof(pipeline_name_t));
+  g_array_append_val(rec->names, entry);
+}
+
+static void
+pipeline_new_ipv4(const guint addr, const gchar *name)
+{
+  pipeline_queue_name(FALSE, &addr, name);
+}
+
+static void
+pipeline_new_ipv6(const void *addrp, const gchar *name)
+{
+  pipeline_queue_name(TRUE, addrp, name);
+}
+
+/* Add the names queued with a record, in the dissecting thread */
+static void
+pipeline_add_names(pipeline_record_t *rec)
+{
+  pipeline_name_t *entry;
+  guint            addr;
+  guint            i;
+
+  if (rec->names == NULL)
+    return;
+
+  for (i = 0; i < rec->names->len; i++) {
+    entry = &g_array_index(rec->names, pipeline_name_t, i);
+    if (entry->ipv6) {
+      add_ipv6_name((const struct e_in6_addr *)entry->addr, entry->name);
+    } else {
+      memcpy(&addr, entry->addr, 4);
+      add_ipv4_name(addr, entry->name);
+    }
+    g_free(entry->name);
+  }
+  g_array_set_size(rec->names, 0);
+}
+
+/*
+ * The reader may add interfaces to the file's list while it reads, so
+ * look them up under the same lock.
+ */
+static const char *
+pipeline_get_interface_name(void *data, guint32 interface_id)
+{
+  const char *name;
+
+  g_mutex_lock(pipeline.wtap_lock);
+  name = pipeline.get_interface_name(data, interface_id);
+  g_mutex_unlock(pipeline.wtap_lock);
+  return name;
+}
+
+#ifdef HAVE_OPEN_MEMSTREAM
+static gpointer
+pipeline_write_output(gpointer data _U_)
+{
+  pipeline_output_t *out;
+  guint              slot;
+
+  while (pipeline_consume_slot(&pipeline.outputs, &slot)) {
+    out = &pipeline.output[slot];
+    /* An error is left in stdout for process_packet() to report */
+    if (out->len != 0)
+      fwrite(out->buf, 1, out->len, stdout);
+    if (line_buffered)
+      fflush(stdout);
+    pipeline_consumed(&pipeline.outputs);
+  }
+  return NULL;
+}
+#endif
+
+static GThread *
+pipeline_thread_new(const char *name _U_, GThreadFunc func, gpointer data)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+  return g_thread_new(name, func, data);
+#else
+  return g_thread_create(func, data, TRUE, NULL);
+#endif
+}
+
+static void
+pipeline_start(capture_file *cf)
+{
+  guint i;
+
+  pipeline.active = TRUE;
+  pipeline.wtap_lock = pipeline_mutex_new();
+  pipeline.get_interface_name = cf->epan->get_interface_name;
+  cf->epan->get_interface_name = pipeline_get_interface_name;
+
+  pipeline_ring_init(&pipeline.records, PIPELINE_RECORDS);
+  for (i = 0; i < PIPELINE_RECORDS; i++) {
+    wtap_phdr_init(&pipeline.record[i].phdr);
+    ws_buffer_init(&pipeline.record[i].buf, 1500);
+    pipeline.record[i].names = NULL;
+  }
+  pipeline.reading = NULL;
+  pipeline.last_names = NULL;
+  wtap_set_cb_new_ipv4(cf->wth, pipeline_new_ipv4);
+  wtap_set_cb_new_ipv6(cf->wth, pipeline_new_ipv6);
+  pipeline.have_record = FALSE;
+  pipeline.err = 0;
+  pipeline.err_info = NULL;
+  pipeline.reader = pipeline_thread_new("Reader", pipeline_read_records, cf);
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  if (print_packet_info) {
+    pipeline_ring_init(&pipeline.outputs, PIPELINE_OUTPUTS);
+    for (i = 0; i < PIPELINE_OUTPUTS; i++) {
+      pipeline_output_t *out = &pipeline.output[i];
+
+      out->fh = open_memstream(&out->buf, &out->len);
+      if (out->fh == NULL) {
+        show_print_file_io_error(errno);
+        exit(2);
+      }
+      out->stream = NULL;
+      if (output_action == WRITE_TEXT) {
+        if (print_format == PR_FMT_PS)
+          out->stream = print_stream_ps_stdio_new(out->fh);
+        else
+          out->stream = print_stream_text_stdio_new(out->fh);
+      }
+    }
+    pipeline.print_stream = print_stream;
+    pipeline.writer = pipeline_thread_new("Writer", pipeline_write_output, NULL);
+  }
+#endif
+}
+
+/*
+ * Get the next record from the reader, letting it reuse the previous
+ * one.  Returns FALSE, with the wtap_read() error if any, at the end.
+ */
+static gboolean
+pipeline_read(int *err, gchar **err_info, gint64 *data_offset,
+              struct wtap_pkthdr **phdr, const guchar **pd)
+{
+  pipeline_record_t *rec;
+  guint              slot;
+
+  if (pipeline.have_record) {
+    pipeline_consumed(&pipeline.records);
+    pipeline.have_record = FALSE;
+  }
+  if (!pipeline_consume_slot(&pipeline.records, &slot)) {
+    *err = pipeline.err;
+    *err_info = pipeline.err_info;
+    pipeline.err_info = NULL;
+    return FALSE;
+  }
+  rec = &pipeline.record[slot];
+  pipeline.have_record = TRUE;
+  pipeline_add_names(rec);
+  *data_offset = rec->offset;
+  *phdr = &rec->phdr;
+  *pd = ws_buffer_start_ptr(&rec->buf);
+  return TRUE;
+}
+
+/* Make print_packet() print into the next free output slot */
+static void
+pipeline_output_begin(void)
+{
+  pipeline_output_t *out;
+  gboolean           stopped;
+
+  out = &pipeline.output[pipeline_produce_slot(&pipeline.outputs, &stopped)];
+  rewind(out->fh);
+  print_fh = out->fh;
+  if (out->stream != NULL)
+    print_stream = out->stream;
+}
+
+/* Hand what print_packet() printed over to the writer */
+static void
+pipeline_output_end(void)
+{
+  if (fflush(print_fh) == EOF || ferror(print_fh)) {
+    show_print_file_io_error(errno);
+    exit(2);
+  }
+  print_fh = stdout;
+  print_stream = pipeline.print_stream;
+  pipeline_produced(&pipeline.outputs);
+}
+
+static void
+pipeline_stop(capture_file *cf)
+{
+  guint i, j;
+
+  if (!pipeline.active)
+    return;
+
+  /* We may have stopped before the end of the file */
+  pipeline_finish(&pipeline.records.stopped, &pipeline.records);
+  g_thread_join(pipeline.reader);
+  wtap_set_cb_new_ipv4(cf->wth, add_ipv4_name);
+  wtap_set_cb_new_ipv6(cf->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+  /* Names at the end of the file, as they'd have been added without us */
+  if (pipeline.last_names != NULL)
+    pipeline_add_names(pipeline.last_names);
+  for (i = 0; i < PIPELINE_RECORDS; i++) {
+    if (pipeline.record[i].names != NULL) {
+      /* Records we stopped before getting to */
+      for (j = 0; j < pipeline.record[i].names->len; j++)
+        g_free(g_array_index(pipeline.record[i].names, pipeline_name_t, j).name);
+      g_array_free(pipeline.record[i].names, TRUE);
+    }
+    g_free(pipeline.record[i].phdr.opt_comment);
+    wtap_phdr_cleanup(&pipeline.record[i].phdr);
+    ws_buffer_free(&pipeline.record[i].buf);
+  }
+  pipeline_ring_free(&pipeline.records);
+  g_free(pipeline.err_info);
+
+  if (pipeline.writer != NULL) {
+    pipeline_finish(&pipeline.outputs.done, &pipeline.outputs);
+    g_thread_join(pipeline.writer);
+    pipeline.writer = NULL;
+    for (i = 0; i < PIPELINE_OUTPUTS; i++) {
+      if (pipeline.output[i].stream != NULL)
+        destroy_print_stream(pipeline.output[i].stream);  /* closes fh */
+      else
+        fclose(pipeline.output[i].fh);
+      free(pipeline.output[i].buf);
+    }
+    pipeline_ring_free(&pipeline.outputs);
+  }
+
+  cf->epan->get_interface_name = pipeline.get_interface_name;
+  pipeline_mutex_free(pipeline.wtap_lock);
+  pipeline.active = FALSE;
+}
+
 static int
 load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -3098,6 +4219,8 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   struct wtap_pkthdr phdr;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
+  struct wtap_pkthdr *whdr;
+  const guchar *pd;
 
   wtap_phdr_init(&phdr);
 
@@ -3177,6 +4300,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
         show_print_file_io_error(err);
         goto out;
       }
+      worker_mark(WORKER_MARK_PREAMBLE);
     }
     g_free(idb_inf);
     idb_inf = NULL;
@@ -3186,6 +4310,8 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
+  metadata_only_dfilter = dfilter_needs_only_metadata(cf);
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
@@ -3371,17 +4497,30 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
     }
 
-    while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+    if (use_pipeline)
+      pipeline_start(cf);
+
+    for (;;) {
+      if (pipeline.active) {
+        if (!pipeline_read(&err, &err_info, &data_offset, &whdr, &pd))
+          break;
+      } else {
+        if (!wtap_read(cf->wth, &err, &err_info, &data_offset))
+          break;
+        whdr = wtap_phdr(cf->wth);
+        pd = wtap_buf_ptr(cf->wth);
+      }
       framenum++;
 
-      if (process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                         wtap_buf_ptr(cf->wth),
-                         tap_flags)) {
+      if (num_workers > 1 && worker_of_packet(whdr, pd) != worker_num) {
+        /* Another worker dissects this one. */
+        skip_packet(cf, data_offset, whdr);
+      } else if (process_packet(cf, edt, data_offset, whdr, pd, tap_flags)) {
         /* Either there's no read filtering or this packet passed the
            filter, so, if we're writing to a capture file, write
            this packet out. */
         if (pdh != NULL) {
-          if (!wtap_dump(pdh, wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth), &err, &err_info)) {
+          if (!wtap_dump(pdh, whdr, pd, &err, &err_info)) {
             /* Error writing to a capture file */
             switch (err) {
 
@@ -3457,6 +4596,8 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       }
     }
 
+    pipeline_stop(cf);
+
     if (edt) {
       epan_dissect_free(edt);
       edt = NULL;
@@ -3545,6 +4686,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
           err = errno;
           show_print_file_io_error(err);
         }
+        worker_mark(WORKER_MARK_FINALE);
       }
     }
   }
@@ -3594,6 +4736,12 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* If we're writing fields, prime the epan_dissect_t with them, so
+       their values can be picked up without searching the tree. */
+    if (print_packet_info &&
+        (output_action == WRITE_FIELDS || output_action == WRITE_COLUMNAR))
+      output_fields_prime_edt(edt, output_fields);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3613,7 +4761,10 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
       ref = &ref_frame;
     }
 
-    epan_dissect_run_with_taps(edt, cf->cd_t, whdr, frame_tvbuff_new(&fdata, pd), &fdata, cinfo);
+    if (metadata_only_dfilter)
+      epan_dissect_run_metadata(edt, cf->cd_t, whdr, frame_tvbuff_new(&fdata, pd), &fdata);
+    else
+      epan_dissect_run_with_taps(edt, cf->cd_t, whdr, frame_tvbuff_new(&fdata, pd), &fdata, cinfo);
 
     /* Run the filter if we have it. */
     if (cf->dfcode)
@@ -3627,7 +4778,11 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
     if (print_packet_info) {
       /* We're printing packet information; print the information for
          this packet. */
+      if (pipeline.writer != NULL)
+        pipeline_output_begin();
       print_packet(cf, edt);
+      if (pipeline.writer != NULL)
+        pipeline_output_end();
 
       /* The ANSI C standard does not appear to *require* that a line-buffered
          stream be flushed to the host environment whenever a newline is
@@ -3648,14 +4803,18 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
          tcpdump or TShark is to allow the output of a live capture to
          be piped to a program or script and to have that script see the
          information for the packet as soon as it's printed, rather than
-         having to wait until a standard I/O buffer fills up. */
-      if (line_buffered)
+         having to wait until a standard I/O buffer fills up.
+
+         With --pipeline, the writer thread does that. */
+      if (line_buffered && pipeline.writer == NULL)
         fflush(stdout);
 
       if (ferror(stdout)) {
         show_print_file_io_error(errno);
         exit(2);
       }
+
+      worker_mark(fdata.num);
     }
 
     /* this must be set after print_packet() [bug #8160] */
@@ -3692,6 +4851,14 @@ write_preamble(capture_file *cf)
     write_fields_preamble(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_COLUMNAR:
+#ifdef _WIN32
+    if (_setmode(fileno(stdout), O_BINARY) == -1)
+      return FALSE;
+#endif
+    write_columnar_preamble(output_fields, stdout);
+    return !ferror(stdout);
+
   default:
     g_assert_not_reached();
     return FALSE;
@@ -3990,9 +5157,10 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
         break;
 
       case WRITE_XML:
-        write_psml_columns(edt, stdout);
-        return !ferror(stdout);
+        write_psml_columns(edt, print_fh);
+        return !ferror(print_fh);
       case WRITE_FIELDS: /*No non-verbose "fields" format */
+      case WRITE_COLUMNAR:
         g_assert_not_reached();
         break;
       }
@@ -4024,13 +5192,19 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       break;
 
     case WRITE_XML:
-      write_pdml_proto_tree(edt, stdout);
-      printf("\n");
-      return !ferror(stdout);
+      write_pdml_proto_tree(edt, print_fh);
+      fprintf(print_fh, "\n");
+      return !ferror(print_fh);
     case WRITE_FIELDS:
-      write_fields_proto_tree(output_fields, edt, &cf->cinfo, stdout);
-      printf("\n");
-      return !ferror(stdout);
+      write_fields_proto_tree(output_fields, edt, &cf->cinfo, print_fh);
+      fprintf(print_fh, "\n");
+      return !ferror(print_fh);
+    case WRITE_COLUMNAR:
+      write_columnar_proto_tree(output_fields, edt, &cf->cinfo, print_fh);
+      /* With -l, a packet can't wait for the rest of its row group. */
+      if (line_buffered)
+        write_columnar_row_group(output_fields, print_fh);
+      return !ferror(print_fh);
     }
   }
   if (print_hex) {
@@ -4065,6 +5239,10 @@ write_finale(void)
     write_fields_finale(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_COLUMNAR:
+    write_columnar_finale(output_fields, stdout);
+    return !ferror(stdout);
+
   default:
     g_assert_not_reached();
     return FALSE;
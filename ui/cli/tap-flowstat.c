@@ -0,0 +1,101 @@
+/* tap-flowstat.c
+ * Statistics on the conversations kept while dissecting
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <epan/packet_info.h>
+#include <epan/conversation.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+void register_tap_listener_flowstat(void);
+
+static int
+flowstat_packet(void *pss _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *psi _U_)
+{
+	return 0;
+}
+
+static void
+flowstat_draw(void *pss _U_)
+{
+	guint live, retired;
+	guint64 expired;
+
+	conversation_expire_stats(&live, &retired, &expired);
+
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Conversations:\n");
+	printf("Live: %u\n", live);
+	printf("Expired: %" G_GINT64_MODIFIER "u\n", expired);
+	printf("Expired, not freed yet: %u\n", retired);
+	printf("===================================================================\n");
+}
+
+static void
+flowstat_init(const char *opt_arg _U_, void *userdata _U_)
+{
+	GString *error_string;
+
+	error_string = register_tap_listener("frame", NULL, NULL, 0, NULL, flowstat_packet, flowstat_draw);
+	if (error_string) {
+		fprintf(stderr, "tshark: Couldn't register flows,stat tap: %s\n",
+			error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+}
+
+static stat_tap_ui flowstat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"flows,stat",
+	flowstat_init,
+	-1,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_flowstat(void)
+{
+	register_stat_tap_ui(&flowstat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
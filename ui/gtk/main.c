@@ -672,9 +672,8 @@ copy_selected_plist_cb(GtkWidget *w _U_, gpointer data _U_, COPY_SELECTED_E acti
     switch(action)
     {
     case COPY_SELECTED_DESCRIPTION:
-        if (cfile.finfo_selected->rep &&
-            strlen (cfile.finfo_selected->rep->representation) > 0) {
-            g_string_append(gtk_text_str, cfile.finfo_selected->rep->representation);
+        if (cfile.finfo_selected->rep) {
+            g_string_append(gtk_text_str, proto_item_get_label(cfile.finfo_selected, NULL));
         }
         break;
     case COPY_SELECTED_FIELDNAME:
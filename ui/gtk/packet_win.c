@@ -282,11 +282,7 @@ finfo_window_refresh(struct FieldinfoWinData *DataPtr)
 
 	/* XXX, update fvalue_edit, e.g. when hexedit was changed */
 
-	if (finfo->rep == NULL) {
-		proto_item_fill_label(finfo, label_str);
-		gtk_entry_set_text(GTK_ENTRY(DataPtr->repr), label_str);
-	} else
-		gtk_entry_set_text(GTK_ENTRY(DataPtr->repr), finfo->rep->representation);
+	gtk_entry_set_text(GTK_ENTRY(DataPtr->repr), proto_item_get_label(finfo, label_str));
 
 	epan_dissect_cleanup(&edt);
 	return TRUE;
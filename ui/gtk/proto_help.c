@@ -434,7 +434,7 @@ static gchar* ph_capture_get_description(capture_file *cf)
 	gchar *buffer = NULL;
 
 	if(cf->finfo_selected->rep &&
-	   strlen(cf->finfo_selected->rep->representation) > 0)
+	   strlen(proto_item_get_label(cf->finfo_selected, NULL)) > 0)
 	{
 		buffer = g_strdup(cf->finfo_selected->rep->representation);
 	}
@@ -153,11 +153,7 @@ fi_get_string(field_info *fi)
 	gchar         label_str[ITEM_LABEL_LENGTH];
 	gchar        *label_ptr;
 
-	if (!fi->rep) {
-		label_ptr = label_str;
-		proto_item_fill_label(fi, label_str);
-	} else
-		label_ptr = fi->rep->representation;
+	label_ptr = proto_item_get_label(fi, label_str);
 
 	if (FI_GET_FLAG(fi, FI_GENERATED)) {
 		if (FI_GET_FLAG(fi, FI_HIDDEN))
@@ -1579,9 +1579,8 @@ void MainWindow::actionEditCopyTriggered(MainWindow::CopySelected selection_type
 
     switch(selection_type) {
     case CopySelectedDescription:
-        if (capture_file_.capFile()->finfo_selected->rep &&
-                strlen (capture_file_.capFile()->finfo_selected->rep->representation) > 0) {
-            clip.append(capture_file_.capFile()->finfo_selected->rep->representation);
+        if (capture_file_.capFile()->finfo_selected->rep) {
+            clip.append(proto_item_get_label(capture_file_.capFile()->finfo_selected, NULL));
         }
         break;
     case CopySelectedFieldName:
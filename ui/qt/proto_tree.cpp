@@ -57,14 +57,7 @@ proto_tree_draw_node(proto_node *node, gpointer data)
         return;
 
     // Fill in our label
-    /* was a free format label produced? */
-    if (fi->rep) {
-        label_ptr = fi->rep->representation;
-    }
-    else { /* no, make a generic label */
-        label_ptr = label_str;
-        proto_item_fill_label(fi, label_str);
-    }
+    label_ptr = proto_item_get_label(fi, label_str);
 
     if (node->first_child != NULL) {
         is_branch = TRUE;
@@ -97,6 +97,6 @@ void arg_list_utf_16to8(int argc, char *argv[]);
 #define IS_TRAIL_SURROGATE(uchar2) \
 	((uchar2) >= 0xdc00 && (uchar2) < 0xe000)
 #define SURROGATE_VALUE(lead, trail) \
-	(((((lead) - 0xd800) << 10) | ((trail) - 0xdc00)) + 0x100000)
+	(((((lead) - 0xd800) << 10) | ((trail) - 0xdc00)) + 0x10000)
 
 #endif /* __UNICODEUTIL_H__ */
@@ -0,0 +1,417 @@
+/* ws_bitmap.c
+ * Compressed bitmaps of 32-bit values
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_bitmap.h"
+#include "bits_count_ones.h"
+#include "bits_ctz.h"
+
+/* A chunk holding 65536 values as bits takes 8 KiB, as much as an array
+ * of 4096 16-bit values; chunks with more values than that are bitmaps. */
+#define CHUNK_WORDS		1024
+#define CHUNK_ARRAY_MAX		4096
+
+typedef struct {
+	guint16  key;		/* upper 16 bits of the values */
+	guint32  count;		/* number of values */
+	guint32  capacity;	/* allocated length of the array */
+	union {
+		guint16 *array;	/* count <= CHUNK_ARRAY_MAX: sorted lower 16 bits */
+		guint64 *words;	/* otherwise: one bit per lower 16 bits */
+	} u;
+} chunk_t;
+
+#define CHUNK_IS_BITMAP(c)	((c)->count > CHUNK_ARRAY_MAX)
+
+struct _ws_bitmap_t {
+	chunk_t *chunks;	/* sorted by key */
+	guint    num_chunks;
+	guint    capacity;
+};
+
+ws_bitmap_t *
+ws_bitmap_new(void)
+{
+	return g_new0(ws_bitmap_t, 1);
+}
+
+void
+ws_bitmap_free(ws_bitmap_t *bitmap)
+{
+	guint i;
+
+	if (bitmap == NULL)
+		return;
+
+	for (i = 0; i < bitmap->num_chunks; i++) {
+		if (CHUNK_IS_BITMAP(&bitmap->chunks[i]))
+			g_free(bitmap->chunks[i].u.words);
+		else
+			g_free(bitmap->chunks[i].u.array);
+	}
+	g_free(bitmap->chunks);
+	g_free(bitmap);
+}
+
+/* Returns the index of the chunk for key, or of where it would go. */
+static guint
+chunk_index(const ws_bitmap_t *bitmap, guint16 key)
+{
+	guint lo = 0, hi = bitmap->num_chunks, mid;
+
+	/* Values are mostly added in order, so look at the last one first */
+	if (hi > 0 && bitmap->chunks[hi - 1].key <= key)
+		return bitmap->chunks[hi - 1].key == key ? hi - 1 : hi;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (bitmap->chunks[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Takes over the chunk, inserting it at index. */
+static void
+insert_chunk(ws_bitmap_t *bitmap, guint index, const chunk_t *chunk)
+{
+	if (bitmap->num_chunks == bitmap->capacity) {
+		bitmap->capacity = bitmap->capacity ? bitmap->capacity * 2 : 4;
+		bitmap->chunks = g_renew(chunk_t, bitmap->chunks, bitmap->capacity);
+	}
+	memmove(&bitmap->chunks[index + 1], &bitmap->chunks[index],
+		(bitmap->num_chunks - index) * sizeof(chunk_t));
+	bitmap->chunks[index] = *chunk;
+	bitmap->num_chunks++;
+}
+
+/* Index of low in a chunk's array, or of where it would go. */
+static guint32
+array_index(const chunk_t *chunk, guint16 low)
+{
+	guint32 lo = 0, hi = chunk->count, mid;
+
+	if (hi > 0 && chunk->u.array[hi - 1] < low)
+		return hi;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (chunk->u.array[mid] < low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static guint64 *
+chunk_to_words(const chunk_t *chunk)
+{
+	guint64 *words;
+	guint32  i;
+
+	if (CHUNK_IS_BITMAP(chunk))
+		return (guint64 *)g_memdup(chunk->u.words, CHUNK_WORDS * sizeof(guint64));
+
+	words = g_new0(guint64, CHUNK_WORDS);
+	for (i = 0; i < chunk->count; i++)
+		words[chunk->u.array[i] >> 6] |= G_GUINT64_CONSTANT(1) << (chunk->u.array[i] & 63);
+	return words;
+}
+
+/* Makes a chunk out of words, which it takes over, holding count values. */
+static void
+chunk_from_words(chunk_t *chunk, guint64 *words, guint32 count)
+{
+	guint32 i, n = 0;
+	guint64 word;
+
+	chunk->count = count;
+	if (CHUNK_IS_BITMAP(chunk)) {
+		chunk->capacity = 0;
+		chunk->u.words = words;
+		return;
+	}
+
+	chunk->capacity = count;
+	chunk->u.array = g_new(guint16, count);
+	for (i = 0; i < CHUNK_WORDS; i++) {
+		for (word = words[i]; word != 0; word &= word - 1)
+			chunk->u.array[n++] = (guint16)((i << 6) | (guint32)ws_ctz(word));
+	}
+	g_free(words);
+}
+
+void
+ws_bitmap_add(ws_bitmap_t *bitmap, guint32 value)
+{
+	guint16  key = (guint16)(value >> 16);
+	guint16  low = (guint16)value;
+	guint    index;
+	guint32  pos;
+	chunk_t *chunk;
+	chunk_t  new_chunk;
+	guint64  bit;
+
+	index = chunk_index(bitmap, key);
+	if (index == bitmap->num_chunks || bitmap->chunks[index].key != key) {
+		new_chunk.key = key;
+		new_chunk.count = 0;
+		new_chunk.capacity = 0;
+		new_chunk.u.array = NULL;
+		insert_chunk(bitmap, index, &new_chunk);
+	}
+	chunk = &bitmap->chunks[index];
+
+	if (CHUNK_IS_BITMAP(chunk)) {
+		bit = G_GUINT64_CONSTANT(1) << (low & 63);
+		if (!(chunk->u.words[low >> 6] & bit)) {
+			chunk->u.words[low >> 6] |= bit;
+			chunk->count++;
+		}
+		return;
+	}
+
+	pos = array_index(chunk, low);
+	if (pos < chunk->count && chunk->u.array[pos] == low)
+		return;
+
+	if (chunk->count == CHUNK_ARRAY_MAX) {
+		guint64 *words = chunk_to_words(chunk);
+
+		words[low >> 6] |= G_GUINT64_CONSTANT(1) << (low & 63);
+		g_free(chunk->u.array);
+		chunk_from_words(chunk, words, CHUNK_ARRAY_MAX + 1);
+		return;
+	}
+
+	if (chunk->count == chunk->capacity) {
+		chunk->capacity = chunk->capacity ? MIN(chunk->capacity * 2, CHUNK_ARRAY_MAX) : 16;
+		chunk->u.array = g_renew(guint16, chunk->u.array, chunk->capacity);
+	}
+	memmove(&chunk->u.array[pos + 1], &chunk->u.array[pos],
+		(chunk->count - pos) * sizeof(guint16));
+	chunk->u.array[pos] = low;
+	chunk->count++;
+}
+
+gboolean
+ws_bitmap_contains(const ws_bitmap_t *bitmap, guint32 value)
+{
+	guint16        key = (guint16)(value >> 16);
+	guint16        low = (guint16)value;
+	guint          index;
+	guint32        pos;
+	const chunk_t *chunk;
+
+	index = chunk_index(bitmap, key);
+	if (index == bitmap->num_chunks || bitmap->chunks[index].key != key)
+		return FALSE;
+	chunk = &bitmap->chunks[index];
+
+	if (CHUNK_IS_BITMAP(chunk))
+		return (chunk->u.words[low >> 6] >> (low & 63)) & 1;
+
+	pos = array_index(chunk, low);
+	return pos < chunk->count && chunk->u.array[pos] == low;
+}
+
+guint32
+ws_bitmap_count(const ws_bitmap_t *bitmap)
+{
+	guint32 count = 0;
+	guint   i;
+
+	for (i = 0; i < bitmap->num_chunks; i++)
+		count += bitmap->chunks[i].count;
+	return count;
+}
+
+/* Appends a chunk to a bitmap being built in key order, unless it's empty. */
+static void
+append_chunk(ws_bitmap_t *bitmap, chunk_t *chunk)
+{
+	if (chunk->count == 0) {
+		g_free(chunk->u.array);
+		return;
+	}
+	insert_chunk(bitmap, bitmap->num_chunks, chunk);
+}
+
+static void
+copy_chunk(chunk_t *dst, const chunk_t *src)
+{
+	*dst = *src;
+	if (CHUNK_IS_BITMAP(src)) {
+		dst->u.words = (guint64 *)g_memdup(src->u.words, CHUNK_WORDS * sizeof(guint64));
+	} else {
+		dst->capacity = src->count;
+		dst->u.array = (guint16 *)g_memdup(src->u.array, src->count * sizeof(guint16));
+	}
+}
+
+static void
+and_chunks(chunk_t *dst, const chunk_t *a, const chunk_t *b)
+{
+	guint32  i, j, count;
+	guint64 *words;
+
+	dst->key = a->key;
+	if (CHUNK_IS_BITMAP(a) && CHUNK_IS_BITMAP(b)) {
+		words = g_new(guint64, CHUNK_WORDS);
+		count = 0;
+		for (i = 0; i < CHUNK_WORDS; i++) {
+			words[i] = a->u.words[i] & b->u.words[i];
+			count += (guint32)ws_count_ones(words[i]);
+		}
+		chunk_from_words(dst, words, count);
+		return;
+	}
+
+	/* The result is no bigger than the array; make sure that's a */
+	if (CHUNK_IS_BITMAP(a)) {
+		const chunk_t *t = a;
+		a = b;
+		b = t;
+	}
+	dst->count = 0;
+	dst->capacity = a->count;
+	dst->u.array = g_new(guint16, MAX(a->count, 1));
+	if (CHUNK_IS_BITMAP(b)) {
+		for (i = 0; i < a->count; i++) {
+			if ((b->u.words[a->u.array[i] >> 6] >> (a->u.array[i] & 63)) & 1)
+				dst->u.array[dst->count++] = a->u.array[i];
+		}
+	} else {
+		for (i = 0, j = 0; i < a->count && j < b->count; ) {
+			if (a->u.array[i] < b->u.array[j]) {
+				i++;
+			} else if (a->u.array[i] > b->u.array[j]) {
+				j++;
+			} else {
+				dst->u.array[dst->count++] = a->u.array[i];
+				i++;
+				j++;
+			}
+		}
+	}
+}
+
+static void
+or_chunks(chunk_t *dst, const chunk_t *a, const chunk_t *b)
+{
+	guint32  i, j, count;
+	guint64 *words, *b_words;
+
+	dst->key = a->key;
+	if (!CHUNK_IS_BITMAP(a) && !CHUNK_IS_BITMAP(b) &&
+	    a->count + b->count <= CHUNK_ARRAY_MAX) {
+		dst->count = 0;
+		dst->capacity = a->count + b->count;
+		dst->u.array = g_new(guint16, dst->capacity);
+		for (i = 0, j = 0; i < a->count || j < b->count; ) {
+			if (j == b->count || (i < a->count && a->u.array[i] < b->u.array[j])) {
+				dst->u.array[dst->count++] = a->u.array[i++];
+			} else if (i == a->count || a->u.array[i] > b->u.array[j]) {
+				dst->u.array[dst->count++] = b->u.array[j++];
+			} else {
+				dst->u.array[dst->count++] = a->u.array[i];
+				i++;
+				j++;
+			}
+		}
+		return;
+	}
+
+	words = chunk_to_words(a);
+	b_words = chunk_to_words(b);
+	count = 0;
+	for (i = 0; i < CHUNK_WORDS; i++) {
+		words[i] |= b_words[i];
+		count += (guint32)ws_count_ones(words[i]);
+	}
+	g_free(b_words);
+	chunk_from_words(dst, words, count);
+}
+
+ws_bitmap_t *
+ws_bitmap_and(const ws_bitmap_t *a, const ws_bitmap_t *b)
+{
+	ws_bitmap_t *result = ws_bitmap_new();
+	guint        i = 0, j = 0;
+	chunk_t      chunk;
+
+	while (i < a->num_chunks && j < b->num_chunks) {
+		if (a->chunks[i].key < b->chunks[j].key) {
+			i++;
+		} else if (a->chunks[i].key > b->chunks[j].key) {
+			j++;
+		} else {
+			and_chunks(&chunk, &a->chunks[i], &b->chunks[j]);
+			append_chunk(result, &chunk);
+			i++;
+			j++;
+		}
+	}
+	return result;
+}
+
+ws_bitmap_t *
+ws_bitmap_or(const ws_bitmap_t *a, const ws_bitmap_t *b)
+{
+	ws_bitmap_t *result = ws_bitmap_new();
+	guint        i = 0, j = 0;
+	chunk_t      chunk;
+
+	while (i < a->num_chunks || j < b->num_chunks) {
+		if (j == b->num_chunks || (i < a->num_chunks && a->chunks[i].key < b->chunks[j].key)) {
+			copy_chunk(&chunk, &a->chunks[i++]);
+		} else if (i == a->num_chunks || a->chunks[i].key > b->chunks[j].key) {
+			copy_chunk(&chunk, &b->chunks[j++]);
+		} else {
+			or_chunks(&chunk, &a->chunks[i], &b->chunks[j]);
+			i++;
+			j++;
+		}
+		append_chunk(result, &chunk);
+	}
+	return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,70 @@
+/* ws_bitmap.h
+ * Compressed bitmaps of 32-bit values
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_BITMAP_H__
+#define __WS_BITMAP_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * A set of guint32 values, such as frame numbers, stored the way
+ * "roaring" bitmaps are: values are grouped by their upper 16 bits,
+ * and each group is kept as a sorted array of the lower 16 bits if it
+ * has few members, or as a 65536-bit bitmap if it has many.  A set of
+ * a few scattered frames, or of almost all of them, thus takes little
+ * memory, and intersections and unions work a group at a time.
+ */
+typedef struct _ws_bitmap_t ws_bitmap_t;
+
+/** Create an empty set. */
+WS_DLL_PUBLIC ws_bitmap_t *ws_bitmap_new(void);
+
+/** Free a set. NULL is allowed. */
+WS_DLL_PUBLIC void ws_bitmap_free(ws_bitmap_t *bitmap);
+
+/** Add a value to a set.  This is fastest if values are added in
+ * ascending order. */
+WS_DLL_PUBLIC void ws_bitmap_add(ws_bitmap_t *bitmap, guint32 value);
+
+/** Is a value in a set? */
+WS_DLL_PUBLIC gboolean ws_bitmap_contains(const ws_bitmap_t *bitmap, guint32 value);
+
+/** The number of values in a set. */
+WS_DLL_PUBLIC guint32 ws_bitmap_count(const ws_bitmap_t *bitmap);
+
+/** A new set with the values that are in both a and b. */
+WS_DLL_PUBLIC ws_bitmap_t *ws_bitmap_and(const ws_bitmap_t *a, const ws_bitmap_t *b);
+
+/** A new set with the values that are in a or b or both. */
+WS_DLL_PUBLIC ws_bitmap_t *ws_bitmap_or(const ws_bitmap_t *a, const ws_bitmap_t *b);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_BITMAP_H__ */
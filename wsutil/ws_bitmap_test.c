@@ -0,0 +1,319 @@
+/* ws_bitmap_test.c
+ * Tests for the compressed bitmaps of 32-bit values
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "ws_bitmap.h"
+
+/* A chunk turns from an array into a bitmap after this many values */
+#define CHUNK_ARRAY_MAX  4096
+
+/* Values are checked against a plain bit array over this range */
+#define TEST_RANGE       (4 * 65536)
+
+typedef struct {
+    guint8 *bits;
+    guint32 count;
+} reference_t;
+
+static void
+reference_init(reference_t *ref)
+{
+    ref->bits = g_new0(guint8, TEST_RANGE / 8);
+    ref->count = 0;
+}
+
+static void
+reference_add(reference_t *ref, guint32 value)
+{
+    if (!(ref->bits[value / 8] & (1 << (value % 8)))) {
+        ref->bits[value / 8] |= 1 << (value % 8);
+        ref->count++;
+    }
+}
+
+static gboolean
+reference_contains(const reference_t *ref, guint32 value)
+{
+    return (ref->bits[value / 8] >> (value % 8)) & 1;
+}
+
+/* Adds a value to both the set and its reference */
+static void
+add_value(ws_bitmap_t *bitmap, reference_t *ref, guint32 value)
+{
+    ws_bitmap_add(bitmap, value);
+    reference_add(ref, value);
+}
+
+static void
+check_matches(const ws_bitmap_t *bitmap, const reference_t *ref)
+{
+    guint32 value;
+
+    g_assert_cmpuint(ws_bitmap_count(bitmap), ==, ref->count);
+    for (value = 0; value < TEST_RANGE; value++)
+        g_assert(ws_bitmap_contains(bitmap, value) == reference_contains(ref, value));
+}
+
+/*
+ * Fills a set with one of several patterns over the test range, chosen
+ * so that some chunks stay arrays, some become bitmaps and some are
+ * missing.
+ */
+static void
+fill(ws_bitmap_t *bitmap, reference_t *ref, GRand *rand, guint pattern)
+{
+    guint32 value, i;
+
+    switch (pattern) {
+    case 0:
+        /* Sparse, in descending order */
+        for (value = TEST_RANGE; value-- > 0; ) {
+            if (g_rand_int_range(rand, 0, 100) == 0)
+                add_value(bitmap, ref, value);
+        }
+        break;
+    case 1:
+        /* Dense in the second chunk, sparse in the fourth */
+        for (value = 65536; value < 2 * 65536; value++) {
+            if (g_rand_boolean(rand))
+                add_value(bitmap, ref, value);
+        }
+        for (i = 0; i < 1000; i++)
+            add_value(bitmap, ref, 3 * 65536 + g_rand_int_range(rand, 0, 65536));
+        break;
+    case 2:
+        /* Random values anywhere, with repeats */
+        for (i = 0; i < 50000; i++)
+            add_value(bitmap, ref, g_rand_int_range(rand, 0, TEST_RANGE));
+        break;
+    default:
+        /* Every value of the first two chunks */
+        for (value = 0; value < 2 * 65536; value++)
+            add_value(bitmap, ref, value);
+        break;
+    }
+}
+
+static void
+test_empty(void)
+{
+    ws_bitmap_t *bitmap = ws_bitmap_new();
+    ws_bitmap_t *other = ws_bitmap_new();
+    ws_bitmap_t *result;
+
+    g_assert_cmpuint(ws_bitmap_count(bitmap), ==, 0);
+    g_assert(!ws_bitmap_contains(bitmap, 0));
+    g_assert(!ws_bitmap_contains(bitmap, G_MAXUINT32));
+
+    result = ws_bitmap_and(bitmap, other);
+    g_assert_cmpuint(ws_bitmap_count(result), ==, 0);
+    ws_bitmap_free(result);
+    result = ws_bitmap_or(bitmap, other);
+    g_assert_cmpuint(ws_bitmap_count(result), ==, 0);
+    ws_bitmap_free(result);
+
+    ws_bitmap_free(bitmap);
+    ws_bitmap_free(other);
+    ws_bitmap_free(NULL);
+}
+
+static void
+test_add(void)
+{
+    ws_bitmap_t *bitmap = ws_bitmap_new();
+
+    ws_bitmap_add(bitmap, 7);
+    ws_bitmap_add(bitmap, 7);
+    ws_bitmap_add(bitmap, G_MAXUINT32);
+    ws_bitmap_add(bitmap, 65536);
+    ws_bitmap_add(bitmap, 3);
+
+    g_assert_cmpuint(ws_bitmap_count(bitmap), ==, 4);
+    g_assert(ws_bitmap_contains(bitmap, 3));
+    g_assert(ws_bitmap_contains(bitmap, 7));
+    g_assert(ws_bitmap_contains(bitmap, 65536));
+    g_assert(ws_bitmap_contains(bitmap, G_MAXUINT32));
+    g_assert(!ws_bitmap_contains(bitmap, 4));
+    g_assert(!ws_bitmap_contains(bitmap, 65537));
+    g_assert(!ws_bitmap_contains(bitmap, 7 + 65536));
+
+    ws_bitmap_free(bitmap);
+}
+
+/* A chunk becomes a bitmap at CHUNK_ARRAY_MAX + 1 values, and still
+ * holds the same values afterwards. */
+static void
+test_array_to_bitmap(void)
+{
+    ws_bitmap_t *bitmap = ws_bitmap_new();
+    reference_t  ref;
+    guint32      i;
+
+    reference_init(&ref);
+
+    /* Every other value, from the top down, so each add is an insert */
+    for (i = CHUNK_ARRAY_MAX; i > 0; i--)
+        add_value(bitmap, &ref, 65536 + i * 2);
+    check_matches(bitmap, &ref);
+
+    add_value(bitmap, &ref, 65536 + 1);
+    check_matches(bitmap, &ref);
+
+    /* Adding values that are already there changes nothing */
+    add_value(bitmap, &ref, 65536 + 2);
+    add_value(bitmap, &ref, 65536 + 1);
+    check_matches(bitmap, &ref);
+
+    ws_bitmap_free(bitmap);
+    g_free(ref.bits);
+}
+
+/*
+ * Intersections and unions of sets with each pair of patterns,
+ * including arrays with bitmaps and results that have to be turned
+ * from one into the other.
+ */
+static void
+test_and_or(void)
+{
+    GRand       *rand = g_rand_new_with_seed(42);
+    ws_bitmap_t *a, *b, *and_ab, *or_ab;
+    reference_t  ref_a, ref_b, ref_and, ref_or;
+    guint        pattern_a, pattern_b;
+    guint32      value;
+
+    for (pattern_a = 0; pattern_a < 4; pattern_a++) {
+        for (pattern_b = 0; pattern_b < 4; pattern_b++) {
+            a = ws_bitmap_new();
+            b = ws_bitmap_new();
+            reference_init(&ref_a);
+            reference_init(&ref_b);
+            reference_init(&ref_and);
+            reference_init(&ref_or);
+
+            fill(a, &ref_a, rand, pattern_a);
+            fill(b, &ref_b, rand, pattern_b);
+            check_matches(a, &ref_a);
+            check_matches(b, &ref_b);
+
+            for (value = 0; value < TEST_RANGE; value++) {
+                if (reference_contains(&ref_a, value) && reference_contains(&ref_b, value))
+                    reference_add(&ref_and, value);
+                if (reference_contains(&ref_a, value) || reference_contains(&ref_b, value))
+                    reference_add(&ref_or, value);
+            }
+
+            and_ab = ws_bitmap_and(a, b);
+            or_ab = ws_bitmap_or(a, b);
+            check_matches(and_ab, &ref_and);
+            check_matches(or_ab, &ref_or);
+
+            /* The operands are left alone */
+            check_matches(a, &ref_a);
+            check_matches(b, &ref_b);
+
+            /* A result can be added to like any other set */
+            add_value(and_ab, &ref_and, TEST_RANGE - 1);
+            check_matches(and_ab, &ref_and);
+
+            ws_bitmap_free(a);
+            ws_bitmap_free(b);
+            ws_bitmap_free(and_ab);
+            ws_bitmap_free(or_ab);
+            g_free(ref_a.bits);
+            g_free(ref_b.bits);
+            g_free(ref_and.bits);
+            g_free(ref_or.bits);
+        }
+    }
+    g_rand_free(rand);
+}
+
+/* Two dense chunks whose intersection is small enough to be an array,
+ * and two sparse ones whose union is too big to be one. */
+static void
+test_conversions(void)
+{
+    ws_bitmap_t *a = ws_bitmap_new();
+    ws_bitmap_t *b = ws_bitmap_new();
+    ws_bitmap_t *result;
+    guint32      i;
+
+    for (i = 0; i < 65536; i++) {
+        if (i % 2 == 0 || i < 100)
+            ws_bitmap_add(a, i);
+        if (i % 2 == 1 || i < 100)
+            ws_bitmap_add(b, i);
+    }
+    result = ws_bitmap_and(a, b);
+    g_assert_cmpuint(ws_bitmap_count(result), ==, 100);
+    for (i = 0; i < 200; i++)
+        g_assert(ws_bitmap_contains(result, i) == (i < 100));
+    ws_bitmap_free(result);
+    ws_bitmap_free(a);
+    ws_bitmap_free(b);
+
+    a = ws_bitmap_new();
+    b = ws_bitmap_new();
+    for (i = 0; i < CHUNK_ARRAY_MAX; i++) {
+        ws_bitmap_add(a, i * 4);
+        ws_bitmap_add(b, i * 4 + 1);
+    }
+    result = ws_bitmap_or(a, b);
+    g_assert_cmpuint(ws_bitmap_count(result), ==, 2 * CHUNK_ARRAY_MAX);
+    for (i = 0; i < CHUNK_ARRAY_MAX * 4; i++)
+        g_assert(ws_bitmap_contains(result, i) == (i % 4 < 2));
+    ws_bitmap_free(result);
+    ws_bitmap_free(a);
+    ws_bitmap_free(b);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/ws_bitmap/empty",            test_empty);
+    g_test_add_func("/ws_bitmap/add",              test_add);
+    g_test_add_func("/ws_bitmap/array_to_bitmap",  test_array_to_bitmap);
+    g_test_add_func("/ws_bitmap/and_or",           test_and_or);
+    g_test_add_func("/ws_bitmap/conversions",      test_conversions);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -28,15 +28,24 @@
  */
 
 #if defined(_MSC_VER)     /* MSVC */
-static gboolean
+#include <intrin.h>
+#include <immintrin.h>
+
+static inline gboolean
 ws_cpuid(guint32 *CPUInfo, guint32 selector)
 {
 	CPUInfo[0] = CPUInfo[1] = CPUInfo[2] = CPUInfo[3] = 0;
-	__cpuid((int *) CPUInfo, selector);
+	__cpuidex((int *) CPUInfo, selector, 0);
 	/* XXX, how to check if it's supported on MSVC? just in case clear all flags above */
 	return TRUE;
 }
 
+static inline guint64
+ws_xgetbv(guint32 index)
+{
+	return _xgetbv(index);
+}
+
 #elif defined(__GNUC__)  /* GCC/clang */
 
 #if defined(__x86_64__)
@@ -48,11 +57,23 @@ ws_cpuid(guint32 *CPUInfo, int selector)
 							"=b" (CPUInfo[1]),
 							"=c" (CPUInfo[2]),
 							"=d" (CPUInfo[3])
-						: "a"(selector));
+						: "a"(selector), "c"(0));
 	return TRUE;
 }
+
+static inline guint64
+ws_xgetbv(guint32 index)
+{
+	guint32 eax, edx;
+
+	/* xgetbv, spelled out for assemblers that don't know it */
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"
+						: "=a" (eax), "=d" (edx)
+						: "c" (index));
+	return ((guint64) edx << 32) | eax;
+}
 #elif defined(__i386__)
-static gboolean
+static inline gboolean
 ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 {
 	/*
@@ -80,25 +101,43 @@ ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 	 */
 	return FALSE;
 }
+
+static inline guint64
+ws_xgetbv(guint32 index _U_)
+{
+	return 0;
+}
 #else /* not x86 */
-static gboolean
+static inline gboolean
 ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 {
 	/* Not x86, so no cpuid instruction */
 	return FALSE;
 }
+
+static inline guint64
+ws_xgetbv(guint32 index _U_)
+{
+	return 0;
+}
 #endif
 
 #else /* Other compilers */
 
-static gboolean
+static inline gboolean
 ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 {
 	return FALSE;
 }
+
+static inline guint64
+ws_xgetbv(guint32 index _U_)
+{
+	return 0;
+}
 #endif
 
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	guint32 CPUInfo[4];
@@ -109,3 +148,29 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+static inline int
+ws_cpuid_avx2(void)
+{
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return 0;
+
+	/* in ECX bits 27 (OSXSAVE) and 28 (AVX) toggled on... */
+	if ((CPUInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return 0;
+
+	/* ...the OS saving the SSE and AVX registers... */
+	if ((ws_xgetbv(0) & 0x6) != 0x6)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 7))
+		return 0;
+
+	/* ...and in EBX bit 5 of leaf 7 toggled on */
+	return (CPUInfo[1] & (1 << 5));
+}
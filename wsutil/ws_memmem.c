@@ -0,0 +1,243 @@
+/* ws_memmem.c
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+#endif
+#include "ws_memmem.h"
+
+/* SSE2 is always there on x86-64, so it needs no run-time check */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_MEMMEM_SSE2
+#include <emmintrin.h>
+#endif
+
+const guint8 *
+_ws_memmem(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len)
+{
+	const guint8 *begin;
+	const guint8 *last_possible;
+
+	if (needle_len == 0 || needle_len > haystack_len)
+		return NULL;
+
+	last_possible = haystack + haystack_len - needle_len;
+	for (begin = haystack; begin <= last_possible; begin++) {
+		begin = (const guint8 *)memchr(begin, needle[0], last_possible - begin + 1);
+		if (begin == NULL)
+			return NULL;
+		if (!memcmp(begin + 1, needle + 1, needle_len - 1))
+			return begin;
+	}
+
+	return NULL;
+}
+
+#ifdef WS_MEMMEM_SSE2
+static inline guint32
+lowest_bit(guint32 bits)
+{
+#if defined(__GNUC__)
+	return (guint32)__builtin_ctz(bits);
+#else
+	guint32 i = 0;
+
+	while (!(bits & 1)) {
+		bits >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+/*
+ * Look for two bytes of the needle, at offsets "a" and "b", at 16
+ * positions at a time, and only compare the whole needle where both
+ * match.
+ */
+static const guint8 *
+ws_memmem_sse2(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len, size_t a, size_t b)
+{
+	const __m128i byte_a = _mm_set1_epi8((char)needle[a]);
+	const __m128i byte_b = _mm_set1_epi8((char)needle[b]);
+	__m128i block_a, block_b;
+	size_t  i;
+	guint32 mask, bit;
+
+	for (i = 0; i + needle_len - 1 + 16 <= haystack_len; i += 16) {
+		block_a = _mm_loadu_si128((const __m128i *)(haystack + i + a));
+		block_b = _mm_loadu_si128((const __m128i *)(haystack + i + b));
+		mask = (guint32)_mm_movemask_epi8(_mm_and_si128(
+		    _mm_cmpeq_epi8(byte_a, block_a),
+		    _mm_cmpeq_epi8(byte_b, block_b)));
+
+		while (mask) {
+			bit = lowest_bit(mask);
+			if (!memcmp(haystack + i + bit, needle, needle_len))
+				return haystack + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	return _ws_memmem(haystack + i, haystack_len - i, needle, needle_len);
+}
+#endif
+
+/*
+ * Search with the vector code if the haystack is long enough for it,
+ * filtering candidate positions on needle[a] and needle[b].
+ */
+static const guint8 *
+ws_memmem_pair(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len, size_t a, size_t b)
+{
+#ifdef HAVE_AVX2
+	static int have_avx2 = -1;
+
+	if G_UNLIKELY(have_avx2 < 0)
+		have_avx2 = ws_cpuid_avx2();
+
+	if (haystack_len - needle_len >= 31 && have_avx2)
+		return _ws_memmem_avx2(haystack, haystack_len, needle, needle_len, a, b);
+#endif
+
+#ifdef WS_MEMMEM_SSE2
+	if (haystack_len - needle_len >= 15)
+		return ws_memmem_sse2(haystack, haystack_len, needle, needle_len, a, b);
+#else
+	(void)a;
+	(void)b;
+#endif
+
+	return _ws_memmem(haystack, haystack_len, needle, needle_len);
+}
+
+const guint8 *
+ws_memmem(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len)
+{
+	if (needle_len == 0 || needle_len > haystack_len)
+		return NULL;
+
+	if (needle_len == 1)
+		return (const guint8 *)memchr(haystack, needle[0], haystack_len);
+
+	return ws_memmem_pair(haystack, haystack_len, needle, needle_len,
+	    0, needle_len - 1);
+}
+
+/*
+ * A rough guess at how common a byte is in packet data, lower being
+ * rarer: zero and 0xff padding are everywhere, as are lower-case text
+ * and the punctuation of text protocols; capitals and digits less so,
+ * and other bytes least of all.
+ */
+static int
+byte_rank(guint8 c)
+{
+	if (c == 0x00)
+		return 6;
+	if (c == 0xff)
+		return 5;
+	if (c == ' ' || (c >= 'a' && c <= 'z'))
+		return 4;
+	if (c >= '0' && c <= '9')
+		return 2;
+	if (c >= 'A' && c <= 'Z')
+		return 2;
+	if (c > 0x20 && c < 0x7f)
+		return 3;
+	if (c < 0x20)
+		return 1;
+	return 0;
+}
+
+void
+ws_memmem_compile(ws_memmem_pattern_t *pattern, const guint8 *needle,
+		size_t needle_len)
+{
+	size_t i, a, b;
+
+	pattern->needle = needle;
+	pattern->needle_len = needle_len;
+	pattern->a = 0;
+	pattern->b = needle_len > 1 ? needle_len - 1 : 0;
+	if (needle_len < 3)
+		return;
+
+	/*
+	 * The vector scan stops to compare the whole needle wherever
+	 * the two bytes it looks for are both there, so look for the
+	 * rarest byte of the needle and the rarest one that differs
+	 * from it.
+	 */
+	a = 0;
+	for (i = 1; i < needle_len; i++) {
+		if (byte_rank(needle[i]) < byte_rank(needle[a]))
+			a = i;
+	}
+	b = a == 0 ? 1 : 0;
+	for (i = 0; i < needle_len; i++) {
+		if (needle[i] == needle[a])
+			continue;
+		if (needle[b] == needle[a] ||
+		    byte_rank(needle[i]) < byte_rank(needle[b]))
+			b = i;
+	}
+	pattern->a = a;
+	pattern->b = b;
+}
+
+const guint8 *
+ws_memmem_exec(const ws_memmem_pattern_t *pattern, const guint8 *haystack,
+		size_t haystack_len)
+{
+	if (pattern->needle_len == 0 || pattern->needle_len > haystack_len)
+		return NULL;
+
+	if (pattern->needle_len == 1)
+		return (const guint8 *)memchr(haystack, pattern->needle[0],
+		    haystack_len);
+
+	return ws_memmem_pair(haystack, haystack_len, pattern->needle,
+	    pattern->needle_len, pattern->a, pattern->b);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
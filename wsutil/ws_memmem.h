@@ -0,0 +1,80 @@
+/* ws_memmem.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_MEMMEM_H__
+#define __WS_MEMMEM_H__
+
+#include "ws_symbol_export.h"
+
+/** Find the first occurrence of needle in haystack.
+ *
+ * @param haystack The data to search
+ * @param haystack_len The length of the data to search
+ * @param needle The string to look for
+ * @param needle_len The length of the string to look for
+ * @return A pointer to the first occurrence of "needle" in
+ *         "haystack".  If "needle" isn't found, or if
+ *         "needle_len" is 0, NULL is returned.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memmem(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len);
+
+/** A needle prepared once so that it can be looked for in many
+ * haystacks; ws_memmem() has to guess which of its bytes to scan for,
+ * while the prepared needle picks the ones least likely to turn up in
+ * packet data.  The needle isn't copied, and must stay around for as
+ * long as the pattern is used.
+ */
+typedef struct {
+	const guint8	*needle;
+	size_t		needle_len;
+	size_t		a, b;	/**< offsets of the bytes to scan for */
+} ws_memmem_pattern_t;
+
+/** Prepare a needle for ws_memmem_exec().
+ *
+ * @param pattern The pattern to fill in
+ * @param needle The string to look for
+ * @param needle_len The length of the string to look for
+ */
+WS_DLL_PUBLIC void ws_memmem_compile(ws_memmem_pattern_t *pattern,
+		const guint8 *needle, size_t needle_len);
+
+/** Find the first occurrence of a prepared needle in haystack.
+ *
+ * @param pattern The needle, as prepared by ws_memmem_compile()
+ * @param haystack The data to search
+ * @param haystack_len The length of the data to search
+ * @return A pointer to the first occurrence of the needle in
+ *         "haystack".  If it isn't found, or is empty, NULL is
+ *         returned.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memmem_exec(const ws_memmem_pattern_t *pattern,
+		const guint8 *haystack, size_t haystack_len);
+
+#ifdef HAVE_AVX2
+const guint8 *_ws_memmem_avx2(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len, size_t a, size_t b);
+#endif
+
+const guint8 *_ws_memmem(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+
+#endif /* __WS_MEMMEM_H__ */
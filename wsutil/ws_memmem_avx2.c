@@ -0,0 +1,96 @@
+/* ws_memmem_avx2.c
+ * memmem with AVX2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <string.h>
+
+#include <glib.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#include "ws_memmem.h"
+
+static inline guint32
+lowest_bit(guint32 bits)
+{
+#if defined(__GNUC__)
+	return (guint32)__builtin_ctz(bits);
+#else
+	unsigned long i;
+
+	_BitScanForward(&i, bits);
+	return (guint32)i;
+#endif
+}
+
+/*
+ * Look for two bytes of the needle, at offsets "a" and "b", at 32
+ * positions at a time, and only compare the whole needle where both
+ * match.
+ */
+const guint8 *
+_ws_memmem_avx2(const guint8 *haystack, size_t haystack_len,
+		const guint8 *needle, size_t needle_len, size_t a, size_t b)
+{
+	const __m256i byte_a = _mm256_set1_epi8((char)needle[a]);
+	const __m256i byte_b = _mm256_set1_epi8((char)needle[b]);
+	__m256i block_a, block_b;
+	size_t  i;
+	guint32 mask, bit;
+
+	for (i = 0; i + needle_len - 1 + 32 <= haystack_len; i += 32) {
+		block_a = _mm256_loadu_si256((const __m256i *)(haystack + i + a));
+		block_b = _mm256_loadu_si256((const __m256i *)(haystack + i + b));
+		mask = (guint32)_mm256_movemask_epi8(_mm256_and_si256(
+		    _mm256_cmpeq_epi8(byte_a, block_a),
+		    _mm256_cmpeq_epi8(byte_b, block_b)));
+
+		while (mask) {
+			bit = lowest_bit(mask);
+			if (!memcmp(haystack + i + bit, needle, needle_len))
+				return haystack + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	return _ws_memmem(haystack + i, haystack_len - i, needle, needle_len);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
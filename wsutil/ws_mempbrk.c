@@ -23,7 +23,7 @@
 
 #include <glib.h>
 #include "ws_symbol_export.h"
-#ifdef HAVE_SSE4_2
+#if defined(HAVE_SSE4_2) || defined(HAVE_AVX2)
 #include "ws_cpuid.h"
 #endif
 #include "ws_mempbrk.h"
@@ -52,10 +52,21 @@ ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
 {
 #ifdef HAVE_SSE4_2
 	static int have_sse42 = -1;
+#endif
+#ifdef HAVE_AVX2
+	static int have_avx2 = -1;
 #endif
 	if (*needles == 0)
 		return NULL;
 
+#ifdef HAVE_AVX2
+	if G_UNLIKELY(have_avx2 < 0)
+		have_avx2 = ws_cpuid_avx2();
+
+	if (haystacklen >= 32 && have_avx2)
+		return _ws_mempbrk_avx2(haystack, haystacklen, needles);
+#endif
+
 #ifdef HAVE_SSE4_2
 	if G_UNLIKELY(have_sse42 < 0)
 		have_sse42 = ws_cpuid_sse42();
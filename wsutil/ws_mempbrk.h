@@ -30,6 +30,10 @@ WS_DLL_PUBLIC const guint8 *ws_mempbrk(const guint8* haystack, size_t haystackle
 const char *_ws_mempbrk_sse42(const char* haystack, size_t haystacklen, const char *needles);
 #endif
 
+#ifdef HAVE_AVX2
+const guint8 *_ws_mempbrk_avx2(const guint8* haystack, size_t haystacklen, const guint8 *needles);
+#endif
+
 const guint8 *_ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles);
 
 
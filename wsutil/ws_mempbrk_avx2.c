@@ -0,0 +1,128 @@
+/* ws_mempbrk_avx2.c
+ * mempbrk with AVX2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <glib.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#include "ws_mempbrk.h"
+
+static inline guint32
+lowest_bit(guint32 bits)
+{
+#if defined(__GNUC__)
+	return (guint32)__builtin_ctz(bits);
+#else
+	unsigned long i;
+
+	_BitScanForward(&i, bits);
+	return (guint32)i;
+#endif
+}
+
+/*
+ * The needles are kept as a 16x16 bit matrix, indexed by the low and the
+ * high nibble of a byte.  The low nibble of each byte of the haystack picks
+ * a row of the matrix with vpshufb: from "rows_low" if the high nibble is
+ * below 8, from "rows_high" otherwise; the high nibble picks the bit within
+ * the row, again with vpshufb.  That checks 32 bytes against any set of
+ * needles at once, including NUL bytes in the haystack, which the SSE4.2
+ * version has to leave to the byte-by-byte loop.
+ */
+const guint8 *
+_ws_mempbrk_avx2(const guint8* haystack, size_t haystacklen, const guint8 *needles)
+{
+	guint8  rows_low[16] = { 0 };
+	guint8  rows_high[16] = { 0 };
+	guint8  c, row;
+	__m128i rows;
+	__m256i low_table, high_table, bit_table, nibble_mask;
+	__m256i data, low, high, bits;
+	guint32 mask;
+
+	while (*needles) {
+		c = *needles++;
+		if (c & 0x80)
+			rows_high[c & 0x0f] |= 1 << ((c >> 4) & 7);
+		else
+			rows_low[c & 0x0f] |= 1 << (c >> 4);
+	}
+
+	rows = _mm_loadu_si128((const __m128i *) rows_low);
+	low_table = _mm256_inserti128_si256(_mm256_castsi128_si256(rows), rows, 1);
+	rows = _mm_loadu_si128((const __m128i *) rows_high);
+	high_table = _mm256_inserti128_si256(_mm256_castsi128_si256(rows), rows, 1);
+	bit_table = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+		1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	nibble_mask = _mm256_set1_epi8(0x0f);
+
+	while (haystacklen >= 32) {
+		data = _mm256_loadu_si256((const __m256i *) haystack);
+		low  = _mm256_and_si256(data, nibble_mask);
+		high = _mm256_and_si256(_mm256_srli_epi16(data, 4), nibble_mask);
+
+		/* the top bit of each byte selects the table to use */
+		bits = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_table, low),
+		    _mm256_shuffle_epi8(high_table, low), data);
+		bits = _mm256_and_si256(bits, _mm256_shuffle_epi8(bit_table, high));
+
+		mask = (guint32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, _mm256_setzero_si256()));
+		if (mask != 0xffffffff)
+			return haystack + lowest_bit(~mask);
+
+		haystack    += 32;
+		haystacklen -= 32;
+	}
+
+	while (haystacklen) {
+		c = *haystack;
+		row = (c & 0x80) ? rows_high[c & 0x0f] : rows_low[c & 0x0f];
+		if (row & (1 << ((c >> 4) & 7)))
+			return haystack;
+		haystack++;
+		haystacklen--;
+	}
+
+	return NULL;
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
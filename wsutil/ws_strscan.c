@@ -0,0 +1,187 @@
+/* ws_strscan.c
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#include "ws_strscan.h"
+
+/* SSE2 is always there on x86-64, so it needs no run-time check */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_STRSCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef WS_STRSCAN_SSE2
+static inline guint32
+lowest_bit(guint32 mask)
+{
+#if defined(__GNUC__)
+	return (guint32)__builtin_ctz(mask);
+#else
+	guint32 bit = 0;
+
+	while (!(mask & 1)) {
+		mask >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+#endif
+
+size_t
+ws_ascii_span(const guint8 *ptr, size_t len)
+{
+	size_t  i = 0;
+#ifdef WS_STRSCAN_SSE2
+	guint32 mask;
+
+	for (; i + 16 <= len; i += 16) {
+		mask = (guint32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(ptr + i)));
+		if (mask)
+			return i + lowest_bit(mask);
+	}
+#endif
+
+	while (i < len && ptr[i] < 0x80)
+		i++;
+	return i;
+}
+
+size_t
+ws_printable_span(const guint8 *ptr, size_t len)
+{
+	size_t  i = 0;
+#ifdef WS_STRSCAN_SSE2
+	/*
+	 * As signed octets, everything at or above 0x80 is negative, so
+	 * "less than space or equal to DEL" catches all of the
+	 * non-printables.
+	 */
+	const __m128i space = _mm_set1_epi8(0x20);
+	const __m128i del   = _mm_set1_epi8(0x7f);
+	__m128i block;
+	guint32 mask;
+
+	for (; i + 16 <= len; i += 16) {
+		block = _mm_loadu_si128((const __m128i *)(ptr + i));
+		mask = (guint32)_mm_movemask_epi8(_mm_or_si128(
+		    _mm_cmplt_epi8(block, space),
+		    _mm_cmpeq_epi8(block, del)));
+		if (mask)
+			return i + lowest_bit(mask);
+	}
+#endif
+
+	while (i < len && ptr[i] >= 0x20 && ptr[i] < 0x7f)
+		i++;
+	return i;
+}
+
+/*
+ * Length of the valid UTF-8 sequence with a non-ASCII lead octet at
+ * "ptr", or 0 if it isn't valid.  The second-octet ranges are the ones
+ * in table 3-7 of the Unicode standard.
+ */
+static size_t
+utf8_sequence_length(const guint8 *ptr, size_t len)
+{
+	guint8 lead = ptr[0];
+	guint8 lo = 0x80, hi = 0xBF;
+	size_t seqlen, i;
+
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		seqlen = 2;
+	} else if (lead >= 0xE0 && lead <= 0xEF) {
+		seqlen = 3;
+		if (lead == 0xE0)
+			lo = 0xA0;	/* overlong */
+		else if (lead == 0xED)
+			hi = 0x9F;	/* surrogates */
+	} else if (lead >= 0xF0 && lead <= 0xF4) {
+		seqlen = 4;
+		if (lead == 0xF0)
+			lo = 0x90;	/* overlong */
+		else if (lead == 0xF4)
+			hi = 0x8F;	/* past U+10FFFF */
+	} else {
+		return 0;
+	}
+
+	if (len < seqlen || ptr[1] < lo || ptr[1] > hi)
+		return 0;
+	for (i = 2; i < seqlen; i++) {
+		if ((ptr[i] & 0xC0) != 0x80)
+			return 0;
+	}
+	return seqlen;
+}
+
+size_t
+ws_utf8_valid_span(const guint8 *ptr, size_t len)
+{
+	size_t i = 0, seqlen;
+
+	for (;;) {
+		/* Runs of ASCII go through the vector loop */
+		i += ws_ascii_span(ptr + i, len - i);
+		if (i == len)
+			return len;
+		seqlen = utf8_sequence_length(ptr + i, len - i);
+		if (seqlen == 0)
+			return i;
+		i += seqlen;
+	}
+}
+
+size_t
+ws_utf16le_ascii_narrow(guint8 *dst, const guint8 *src, size_t len)
+{
+	size_t  i = 0;
+#ifdef WS_STRSCAN_SSE2
+	/*
+	 * 16 code units at a time; if none of them has any of the bits
+	 * 0xFF80 set, they're all ASCII and packing them to octets with
+	 * unsigned saturation just drops the zero high octets.
+	 */
+	const __m128i non_ascii = _mm_set1_epi16((short)0xFF80);
+	__m128i lo, hi;
+
+	for (; i + 32 <= len; i += 32) {
+		lo = _mm_loadu_si128((const __m128i *)(src + i));
+		hi = _mm_loadu_si128((const __m128i *)(src + i + 16));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(
+		    _mm_and_si128(_mm_or_si128(lo, hi), non_ascii),
+		    _mm_setzero_si128())) != 0xFFFF)
+			break;
+		_mm_storeu_si128((__m128i *)(dst + i / 2), _mm_packus_epi16(lo, hi));
+	}
+#endif
+
+	for (; i + 1 < len; i += 2) {
+		if (src[i] >= 0x80 || src[i + 1] != 0)
+			break;
+		dst[i / 2] = src[i];
+	}
+	return i;
+}
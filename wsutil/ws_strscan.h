@@ -0,0 +1,74 @@
+/* ws_strscan.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_STRSCAN_H__
+#define __WS_STRSCAN_H__
+
+#include "ws_symbol_export.h"
+
+/*
+ * Scanners used by the string conversion and formatting code to find
+ * out how much of a string can just be copied.  Each returns the length
+ * of the longest prefix that has the property in question, so the caller
+ * can copy that much in one go and handle the byte after it by hand.
+ */
+
+/** Length of the prefix of a buffer that contains only ASCII (no octets
+ * with the high-order bit set).
+ *
+ * @param ptr The data to scan
+ * @param len The length of the data
+ * @return The number of leading ASCII octets
+ */
+WS_DLL_PUBLIC size_t ws_ascii_span(const guint8 *ptr, size_t len);
+
+/** Length of the prefix of a buffer that contains only printable ASCII
+ * (0x20 through 0x7E, as tested by g_ascii_isprint()).
+ *
+ * @param ptr The data to scan
+ * @param len The length of the data
+ * @return The number of leading printable octets
+ */
+WS_DLL_PUBLIC size_t ws_printable_span(const guint8 *ptr, size_t len);
+
+/** Length of the prefix of a buffer that is valid UTF-8: no overlong
+ * forms, no surrogates, nothing past U+10FFFF and no truncated
+ * sequences.
+ *
+ * @param ptr The data to scan
+ * @param len The length of the data
+ * @return The number of leading octets that form valid UTF-8
+ */
+WS_DLL_PUBLIC size_t ws_utf8_valid_span(const guint8 *ptr, size_t len);
+
+/** Convert the leading UTF-16LE code units that are ASCII to UTF-8,
+ * i.e. drop their high octets.
+ *
+ * @param dst Where to put the converted characters; must have room for
+ *            len / 2 octets
+ * @param src The UTF-16LE data
+ * @param len The length of the UTF-16LE data in octets
+ * @return The number of octets of "src" consumed (twice the number of
+ *         octets written to "dst")
+ */
+WS_DLL_PUBLIC size_t ws_utf16le_ascii_narrow(guint8 *dst, const guint8 *src, size_t len);
+
+#endif /* __WS_STRSCAN_H__ */